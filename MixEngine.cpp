@@ -1,6 +1,7 @@
 #include "MixEngine.h"
 #include "Mx/Window/MxWindow.h"
 #include "Mx/Time/MxTime.h"
+#include "Mx/Time/MxBenchmark.h"
 #include "Mx/Input/MxInput.h"
 #include "Mx/Audio/MxAudio.hpp"
 #include "Mx/Physics/MxPhysicsWorld.h"
@@ -11,11 +12,55 @@
 #include "Mx/Scene/MxSceneManager.h"
 #include "Mx/Engine/MxPlatform.h"
 #include "MxApplicationBase.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 
 namespace Mix {
     MixEngine::MixEngine(int _argc, char** _argv) {
         for (int i = 0; i < _argc; ++i)
             mCommandLines.emplace_back(_argv[i]);
+        parseCommandLines();
+    }
+
+    void MixEngine::parseCommandLines() {
+        bool seedGiven = false;
+        for (auto& arg : mCommandLines) {
+            const auto split = arg.find('=');
+            const auto name = arg.substr(0, split);
+            const auto value = split == std::string::npos ? std::string() : arg.substr(split + 1);
+
+            if (name == "--headless") {
+                mHeadless = true;
+                int32_t width, height;
+                if (std::sscanf(value.c_str(), "%dx%d", &width, &height) == 2 && width > 0 && height > 0) {
+                    mHeadlessWidth = width;
+                    mHeadlessHeight = height;
+                }
+            }
+            else if (name == "--frames")
+                mFrameLimit = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+            else if (name == "--capture")
+                mCapturePath = value;
+            else if (name == "--benchmark")
+                mBenchmarkPath = value.empty() ? "benchmark.json" : value;
+            else if (name == "--scene")
+                mSceneName = value;
+            else if (name == "--warmup")
+                mWarmupFrames = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+            else if (name == "--seed") {
+                mSeed = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+                seedGiven = true;
+            }
+        }
+
+        if (mBenchmarkPath.empty()) {
+            mWarmupFrames = 0;
+            if (!seedGiven)
+                mSeed = static_cast<uint32_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+        }
+        else if (mFrameLimit == 0)
+            mFrameLimit = DefaultBenchmarkFrames;
     }
 
     void MixEngine::requestQuit() {
@@ -41,7 +86,12 @@ namespace Mix {
         mApp = std::move(_app);
 
         Time::Awake();
-        Platform::Initialize();
+        // a fixed step makes every benchmark run simulate the same frames
+        if (!mBenchmarkPath.empty())
+            Time::CaptureDeltaTime() = Time::FixedDeltaTime();
+        mRandom.setSeed(mSeed);
+
+        Platform::Initialize(mHeadless);
         Platform::QuitEvent.connect(std::bind(&MixEngine::onQuitRequested, this));
 
         mApp->startUp(getCommandLines());
@@ -52,14 +102,17 @@ namespace Mix {
 
             loadMainScene();
 
+            if (!mBenchmarkPath.empty())
+                Benchmark::Start(mWarmupFrames);
+
             while (!mQuit) {
                 /*awake();
                 init();*/
                 Platform::Update();
                 Time::Tick();
                 if (mRunning) {
-                    // Limit FPS if limit was set.
-                    if (mFPSLimit > 0) {
+                    // Limit FPS if limit was set, the time doesn't follow the clock with a capture step
+                    if (mFPSLimit > 0 && Time::CaptureDeltaTime() <= 0.0f) {
                         float currentTime = Time::TotalTime();
                         float nextFrameTime = mLastFrameTime + mFrameStep;
                         while (nextFrameTime > currentTime) {
@@ -84,22 +137,22 @@ namespace Mix {
                     }
                     //Window::Get()->setTitle(std::to_string(mFramePerSecond));
 
-                    //auto start = Time::RealTime();
-                    update();
-                    //Log::Info("Update %1%", Time::RealTime() - start);
-
-                    //start = Time::RealTime();
-                    lateUpdate();
-                    //Log::Info("lateUpdate %1%", Time::RealTime() - start);
-
-                    //start = Time::RealTime();
-                    render();
-                    //Log::Info("render %1%", Time::RealTime() - start);
-
-                    //start = Time::RealTime();
-                    postRender();
-                    //Log::Info("postRender %1%", Time::RealTime() - start);
-                    //Log::Info("");
+                    {
+                        Benchmark::Scope scope(FramePhase::Frame);
+                        update();
+                        lateUpdate();
+                        render();
+                        postRender();
+                    }
+                    Benchmark::NextFrame();
+
+                    if (mFrameLimit > 0 && ++mFramesRendered >= mWarmupFrames + mFrameLimit) {
+                        if (!mCapturePath.empty())
+                            mModuleHolder.get<Graphics>()->saveFrame(mCapturePath);
+                        if (!mBenchmarkPath.empty())
+                            writeBenchmark();
+                        onQuitRequested();
+                    }
                 }
             }
         }
@@ -120,22 +173,66 @@ namespace Mix {
         sceneManager->setActiveScene(scene);
 
         mApp->onMainSceneCreated();
+
+        // e.g. the scene a benchmark runs, created by the application along with the main scene
+        if (!mSceneName.empty()) {
+            auto named = sceneManager->getScene(mSceneName);
+            if (!named)
+                throw std::runtime_error(Utils::StringFormat("Scene %1% doesn't exist.", mSceneName));
+
+            sceneManager->loadScene(mSceneName);
+            sceneManager->setActiveScene(named);
+        }
+    }
+
+    void MixEngine::writeBenchmark() const {
+        BenchmarkInfo info;
+        info.scene = mModuleHolder.get<SceneManager>()->getActiveScene()->getName();
+        info.frames = mFrameLimit;
+        info.warmupFrames = mWarmupFrames;
+        info.seed = mSeed;
+        info.frameStep = Time::CaptureDeltaTime();
+        info.headless = mHeadless;
+
+        if (Benchmark::Write(mBenchmarkPath, info))
+            Log::Info("Benchmark of %1% frames written to %2%", Benchmark::FrameCount(), mBenchmarkPath);
     }
 
     void MixEngine::update() {
-        mApp->onUpdate();
-        mModuleHolder.get<Physics::World>()->sync(Time::FixedDeltaTime(), Time::SmoothingFactor());
-        mModuleHolder.get<SceneManager>()->sceneUpdate();
+        {
+            Benchmark::Scope scope(FramePhase::Update);
+            // resources loaded asynchronously are created before scripts run
+            mModuleHolder.get<ResourceLoader>()->update();
+            mApp->onUpdate();
+        }
+        {
+            Benchmark::Scope scope(FramePhase::Physics);
+            mModuleHolder.get<Physics::World>()->sync(Time::FixedDeltaTime(), Time::SmoothingFactor());
+        }
+        {
+            Benchmark::Scope scope(FramePhase::Update);
+            mModuleHolder.get<SceneManager>()->sceneUpdate();
+        }
 
         for (auto i = 0u; i < Time::sFixedClampedSteps; ++i) {
-            mApp->onFixedUpdate();
+            {
+                Benchmark::Scope scope(FramePhase::FixedUpdate);
+                mApp->onFixedUpdate();
+            }
             fixedUpdate();
         }
     }
 
     void MixEngine::fixedUpdate() {
-        mApp->onFixedUpdate();
-        mModuleHolder.get<Physics::World>()->step(Time::FixedDeltaTime());
+        {
+            Benchmark::Scope scope(FramePhase::FixedUpdate);
+            mApp->onFixedUpdate();
+        }
+        {
+            Benchmark::Scope scope(FramePhase::Physics);
+            mModuleHolder.get<Physics::World>()->step(Time::FixedDeltaTime());
+        }
+        Benchmark::Scope scope(FramePhase::FixedUpdate);
         mModuleHolder.get<SceneManager>()->sceneFixedUpdate();
 
 #ifdef MX_ENABLE_PHYSICS_DEBUG_DRAW_
@@ -144,6 +241,7 @@ namespace Mix {
     }
 
     void MixEngine::lateUpdate() {
+        Benchmark::Scope scope(FramePhase::LateUpdate);
         mApp->onLateUpdate();
         mModuleHolder.get<SceneManager>()->sceneLateUpdate();
         mModuleHolder.get<SceneObjectManager>()->lateUpdate();
@@ -151,10 +249,14 @@ namespace Mix {
     }
 
     void MixEngine::loadModule() {
-        SDL_Rect rect;
-        SDL_GetDisplayBounds(0, &rect);
+        if (mHeadless)
+            mModuleHolder.add<Window>(Vector2i{ mHeadlessWidth, mHeadlessHeight })->load();
+        else {
+            SDL_Rect rect;
+            SDL_GetDisplayBounds(0, &rect);
 
-        mModuleHolder.add<Window>("Mix Engine Demo", Vector2i{ rect.w * 0.4f, rect.h * 0.8f }, WindowFlag::Vulkan | WindowFlag::Shown)->load();
+            mModuleHolder.add<Window>("Mix Engine Demo", Vector2i{ rect.w * 0.4f, rect.h * 0.8f }, WindowFlag::Vulkan | WindowFlag::Shown)->load();
+        }
         mModuleHolder.add<Input>()->load();
         mModuleHolder.add<Audio::Core>()->load();
         mModuleHolder.add<Physics::World>()->load();
@@ -188,20 +290,25 @@ namespace Mix {
     }
 
     void MixEngine::render() {
-        mApp->onRender();
+        {
+            // Graphics::render() times its own phases
+            Benchmark::Scope scope(FramePhase::RenderGather);
+            mApp->onRender();
 
 #ifdef MX_ENABLE_PHYSICS_DEBUG_DRAW_
-        mModuleHolder.get<Physics::World>()->render();
+            mModuleHolder.get<Physics::World>()->render();
 #endif
-        mModuleHolder.get<GUI>()->beginGUI();
-        mApp->onGUI();
-        mModuleHolder.get<GUI>()->endGUI();
-        mModuleHolder.get<GUI>()->update();
-        mModuleHolder.get<Graphics>()->update();
+            mModuleHolder.get<GUI>()->beginGUI();
+            mApp->onGUI();
+            mModuleHolder.get<GUI>()->endGUI();
+            mModuleHolder.get<GUI>()->update();
+            mModuleHolder.get<Graphics>()->update();
+        }
         mModuleHolder.get<Graphics>()->render();
 }
 
     void MixEngine::postRender() {
+        Benchmark::Scope scope(FramePhase::PostRender);
         mApp->onPostRender();
         mModuleHolder.get<SceneManager>()->scenePostRender();
         mModuleHolder.get<SceneObjectManager>()->postRender();
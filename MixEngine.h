@@ -5,6 +5,7 @@
 
 #include "Mx/Engine/MxModuleHolder.h"
 #include "Mx/Utils/MxEvent.h"
+#include "Mx/Math/MxRandom.h"
 
 namespace Mix {
     class Window;
@@ -128,7 +129,55 @@ namespace Mix {
         const std::vector<std::string>& getCommandLines() const { return mCommandLines; }
 
     private:
+        /**
+         * \brief Read the engine options from the command lines:\n
+         *        --headless[=<width>x<height>] renders offscreen without window, e.g. on build machines\n
+         *        --frames=<count> quits after this many frames\n
+         *        --capture=<file.png> saves the last of these frames, headless only\n
+         *        --benchmark[=<file.json>] records the cpu time of the frame phases with a fixed time step,
+         *        by default for 1000 frames, and writes their percentiles\n
+         *        --warmup=<count> frames run before the recorded ones, 30 by default, benchmark only\n
+         *        --scene=<name> runs the named scene instead of the main scene\n
+         *        --seed=<value> seeds getRandom(), 0 by default for benchmarks
+         */
+        void parseCommandLines();
+
         std::vector<std::string> mCommandLines;
+
+        //////////////////////////////////////////////////////////////////
+        //                          Benchmark                           //
+        //////////////////////////////////////////////////////////////////
+    public:
+        /** \brief Engine wide random generator, seeded by --seed so that benchmark runs are reproducible */
+        Random& getRandom() { return mRandom; }
+
+    private:
+        /** \brief Write the statistics of the frames recorded by Benchmark to the file given by --benchmark */
+        void writeBenchmark() const;
+
+        static constexpr uint32_t DefaultBenchmarkFrames = 1000;
+
+        std::string mBenchmarkPath;
+        std::string mSceneName;
+        uint32_t mWarmupFrames = 30;
+        uint32_t mSeed = 0;
+        Random mRandom;
+
+        //////////////////////////////////////////////////////////////////
+        //                           Headless                           //
+        //////////////////////////////////////////////////////////////////
+    public:
+        bool isHeadless() const { return mHeadless; }
+
+    private:
+        bool mHeadless = false;
+        int32_t mHeadlessWidth = 1280;
+        int32_t mHeadlessHeight = 720;
+
+        // 0 runs until a quit is requested
+        uint32_t mFrameLimit = 0;
+        uint32_t mFramesRendered = 0;
+        std::string mCapturePath;
     };
 }
 
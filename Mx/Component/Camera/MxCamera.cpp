@@ -46,7 +46,7 @@ namespace Mix {
 
     void Camera::updateMatrix() const {
         if (mDirty) {
-            mProjMat = Matrix4::Perspective(Math::Radians(mFov), float(mExtent.x) / mExtent.y, 0.1f, 1000.0f);
+            mProjMat = Matrix4::Perspective(Math::Radians(mFov), float(mExtent.x) / mExtent.y, mNear, mFar);
             mDirty = false;
         }
     }
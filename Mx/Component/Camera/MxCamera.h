@@ -19,6 +19,10 @@ namespace Mix {
 
         void setFov(float _fov);
 
+        float getNearClipPlane() const { return mNear; }
+
+        float getFarClipPlane() const { return mFar; }
+
         Vector2i getExtent() const { return mExtent; }
 
         void setExtent(const Vector2i& _extent);
@@ -29,6 +33,8 @@ namespace Mix {
         mutable bool mDirty;
         Vector2i mExtent;
         float mFov;
+        float mNear = 0.1f;
+        float mFar = 1000.0f;
 
         mutable Matrix4 mProjMat;
         void updateMatrix() const;
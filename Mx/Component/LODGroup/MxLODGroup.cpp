@@ -0,0 +1,63 @@
+#include "MxLODGroup.h"
+#include "../Camera/MxCamera.h"
+#include "../Transform/MxTransform.h"
+#include "../../Math/MxMath.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Mix {
+	MX_IMPLEMENT_RTTI(LODGroup, Component);
+
+	void LODGroup::setLODs(std::vector<LOD> _lods) {
+		mLODs = std::move(_lods);
+		mCurrentLOD = 0;
+	}
+
+	void LODGroup::setLODs(const std::vector<std::shared_ptr<Mesh>>& _meshes) {
+		std::vector<LOD> lods(_meshes.size());
+		float height = 0.5f;
+		for (size_t i = 0; i < lods.size(); ++i, height *= 0.5f) {
+			lods[i].mesh = _meshes[i];
+			// the coarsest level is never culled
+			lods[i].screenRelativeHeight = i + 1 < lods.size() ? height : 0.0f;
+		}
+		setLODs(std::move(lods));
+	}
+
+	float LODGroup::getScreenRelativeHeight(const Camera& _camera) const {
+		if (mLODs.empty() || !mLODs.front().mesh)
+			return 0.0f;
+
+		const auto& bounds = mLODs.front().mesh->getBounds();
+		const auto scale = transform()->getLossyScale();
+		const float maxScale = std::max({ std::abs(scale.x), std::abs(scale.y), std::abs(scale.z) });
+
+		const Vector3f center = transform()->localToWorldMatrix().multiplyPoint(bounds.getCenter());
+		const float radius = bounds.getExtent().length() * 0.5f * maxScale;
+		const float distance = (center - _camera.transform()->getPosition()).length();
+
+		// the camera is inside the sphere
+		if (distance <= radius)
+			return 1.0f;
+
+		return radius / (distance * std::tan(Math::Radians(_camera.getFov()) * 0.5f));
+	}
+
+	std::shared_ptr<Mesh> LODGroup::selectMesh(const Camera& _camera) {
+		if (mLODs.empty())
+			return nullptr;
+
+		const float height = getScreenRelativeHeight(_camera);
+
+		// thresholds of finer levels are raised and the others lowered, so that a level is kept until the height clearly leaves its range
+		uint32_t lod = 0;
+		for (; lod < mLODs.size(); ++lod) {
+			const float bias = lod < mCurrentLOD ? 1.0f + mHysteresis : 1.0f - mHysteresis;
+			if (height >= mLODs[lod].screenRelativeHeight * bias)
+				break;
+		}
+
+		mCurrentLOD = lod;
+		return lod < mLODs.size() ? mLODs[lod].mesh : nullptr;
+	}
+}
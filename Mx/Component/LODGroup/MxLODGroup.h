@@ -0,0 +1,53 @@
+#pragma once
+#ifndef MX_LOD_GROUP_H_
+#define MX_LOD_GROUP_H_
+#include "../MxComponent.h"
+#include "../../Graphics/Mesh/MxMesh.h"
+
+namespace Mix {
+	class Camera;
+
+	/**
+	 * @brief Replaces the mesh of the MeshFilter by a coarser one as the object gets smaller on screen
+	 */
+	class LODGroup :public Component {
+		MX_DECLARE_RTTI;
+	public:
+		struct LOD {
+			std::shared_ptr<Mesh> mesh;
+			// smallest height of the bounding sphere relative to the screen height the level is used at
+			float screenRelativeHeight = 0.0f;
+		};
+
+		/** @param _lods From fine to coarse, below the height of the last level the object isn't drawn */
+		void setLODs(std::vector<LOD> _lods);
+
+		/** @brief Use @p _meshes from fine to coarse, each level when the object covers half the height of the previous one */
+		void setLODs(const std::vector<std::shared_ptr<Mesh>>& _meshes);
+
+		const std::vector<LOD>& getLODs() const { return mLODs; }
+
+		/** @brief Fraction of a threshold the height has to cross it by before the level changes, avoids popping back and forth */
+		void setHysteresis(float _hysteresis) { mHysteresis = std::max(_hysteresis, 0.0f); }
+
+		float getHysteresis() const { return mHysteresis; }
+
+		/** @return Index of the level chosen by the last selectMesh(), equal to the LOD count when culled */
+		uint32_t getCurrentLOD() const { return mCurrentLOD; }
+
+		float getScreenRelativeHeight(const Camera& _camera) const;
+
+		/**
+		 * @brief Choose the level for @p _camera
+		 * @return The mesh to draw, nullptr when the object is too small
+		 */
+		std::shared_ptr<Mesh> selectMesh(const Camera& _camera);
+
+	private:
+		std::vector<LOD> mLODs;
+		float mHysteresis = 0.1f;
+		uint32_t mCurrentLOD = 0;
+	};
+}
+
+#endif
@@ -0,0 +1,31 @@
+#include "MxLight.h"
+#include "../Transform/MxTransform.h"
+#include "../../Math/MxMath.h"
+#include <cmath>
+
+namespace Mix {
+	MX_IMPLEMENT_RTTI(Light, Component);
+
+	void Light::setSpotAngle(const float _angle) {
+		mSpotAngle = std::clamp(_angle, 1.0f, 179.0f);
+	}
+
+	void Light::setInnerSpotAngle(const float _angle) {
+		mInnerSpotAngle = std::clamp(_angle, 0.0f, 179.0f);
+	}
+
+	Vector4f Light::getBoundingSphere() const {
+		const Vector3f position = transform()->getPosition();
+		if (mType == LightType::Point)
+			return Vector4f(position, mRange);
+
+		// smallest sphere around the cone, wide cones are bounded by the circle of their base
+		const float halfAngle = Math::Radians(mSpotAngle) * 0.5f;
+		const float cosHalf = std::cos(halfAngle);
+		if (halfAngle > Math::Radians(45.0f))
+			return Vector4f(position + transform()->forward() * (mRange * cosHalf), mRange * std::sin(halfAngle));
+
+		const float radius = mRange / (2.0f * cosHalf);
+		return Vector4f(position + transform()->forward() * radius, radius);
+	}
+}
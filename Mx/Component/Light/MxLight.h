@@ -0,0 +1,61 @@
+#pragma once
+#ifndef MX_LIGHT_H_
+#define MX_LIGHT_H_
+#include "../MxComponent.h"
+#include "../../Math/MxColor.h"
+#include "../../Math/MxVector4.h"
+#include <algorithm>
+
+namespace Mix {
+	enum class LightType {
+		Point,
+		// cone along the forward direction of the transform
+		Spot
+	};
+
+	/**
+	 * @brief Dynamic light shaded by the clustered forward path, its influence ends at the range
+	 */
+	class Light :public Component {
+		MX_DECLARE_RTTI;
+	public:
+		LightType getType() const { return mType; }
+
+		void setType(const LightType _type) { mType = _type; }
+
+		const Color& getColor() const { return mColor; }
+
+		void setColor(const Color& _color) { mColor = _color; }
+
+		float getIntensity() const { return mIntensity; }
+
+		void setIntensity(const float _intensity) { mIntensity = std::max(_intensity, 0.0f); }
+
+		float getRange() const { return mRange; }
+
+		void setRange(const float _range) { mRange = std::max(_range, 0.0f); }
+
+		/** @brief Full angle of the cone in degrees, only used by spot lights */
+		float getSpotAngle() const { return mSpotAngle; }
+
+		void setSpotAngle(float _angle);
+
+		/** @brief Full angle in degrees inside which a spot light isn't faded, at most the spot angle */
+		float getInnerSpotAngle() const { return std::min(mInnerSpotAngle, mSpotAngle); }
+
+		void setInnerSpotAngle(float _angle);
+
+		/** @brief Bounding sphere of the lit volume in world space, xyz is the center and w the radius */
+		Vector4f getBoundingSphere() const;
+
+	private:
+		LightType mType = LightType::Point;
+		Color mColor = Color::White;
+		float mIntensity = 1.0f;
+		float mRange = 10.0f;
+		float mSpotAngle = 30.0f;
+		float mInnerSpotAngle = 20.0f;
+	};
+}
+
+#endif
@@ -55,6 +55,10 @@ const char* Mix::ToString(TextureFormat e) {
     case TextureFormat::Unknown: return "Unknown";
     case TextureFormat::R8G8B8A8_Unorm: return "R8G8B8A8_Unorm";
     case TextureFormat::B8G8R8A8_Unorm: return "B8G8R8A8_Unorm";
+    case TextureFormat::BC1_RGBA_Unorm: return "BC1_RGBA_Unorm";
+    case TextureFormat::BC3_Unorm: return "BC3_Unorm";
+    case TextureFormat::BC5_Unorm: return "BC5_Unorm";
+    case TextureFormat::BC7_Unorm: return "BC7_Unorm";
     default: return "Unknown";
     }
 }
@@ -92,6 +96,16 @@ const char* Mix::ToString(VertexAttribute e) {
     }
 }
 
+const char* Mix::ToString(VertexCompression e) {
+    switch (e) {
+    case VertexCompression::None: return "None";
+    case VertexCompression::Position: return "Position";
+    case VertexCompression::Normal: return "Normal";
+    case VertexCompression::UV: return "UV";
+    default: return "Unknown";
+    }
+}
+
 const char* Mix::ToString(UVChannel e) {
     switch (e) {
     case UVChannel::UV0: return "UV0";
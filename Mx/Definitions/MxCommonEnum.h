@@ -51,7 +51,11 @@ namespace Mix {
     enum class TextureFormat {
         Unknown = 0,
         R8G8B8A8_Unorm = 1,
-        B8G8R8A8_Unorm = 2
+        B8G8R8A8_Unorm = 2,
+        BC1_RGBA_Unorm = 3,
+        BC3_Unorm = 4,
+        BC5_Unorm = 5,
+        BC7_Unorm = 6
     };
 
     const char* ToString(TextureFormat e);
@@ -95,6 +99,23 @@ namespace Mix {
 
     MX_ALLOW_FLAGS_FOR_ENUM(VertexAttribute);
 
+    /**
+     * \brief Reduced precision encodings of the vertex attributes of a Mesh, see Mesh::setCompression()
+     */
+    enum class VertexCompression {
+        None = 0x0000,
+        // 16 bit normalized positions, mapped back to local space by Mesh::getVertexTransform()
+        Position = 0x0001,
+        // 8 bit normalized normals and tangents
+        Normal = 0x0002,
+        // half float UV0 and UV1
+        UV = 0x0004
+    };
+
+    const char* ToString(VertexCompression e);
+
+    MX_ALLOW_FLAGS_FOR_ENUM(VertexCompression);
+
 
     /**
      * \brief This enumeration is used with VertexAttribute to identify a channel of UV.
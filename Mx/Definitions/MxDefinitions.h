@@ -48,6 +48,8 @@ namespace Mix {
     class AudioListener;
     class AudioSource;
     class MeshFilter;
+    class LODGroup;
+    class Light;
     class RigidBody;
     class Transform;
     class Camera;
@@ -72,6 +74,8 @@ namespace Mix {
     using HAdudioListener = SceneObjectHandle<AudioListener>;
     using HAudioSource = SceneObjectHandle<AudioSource>;
     using HMeshFilter = SceneObjectHandle<MeshFilter>;
+    using HLODGroup = SceneObjectHandle<LODGroup>;
+    using HLight = SceneObjectHandle<Light>;
     using HRigidBody = SceneObjectHandle<RigidBody>;
     using HTransform = SceneObjectHandle<Transform>;
     using HCamera = SceneObjectHandle<Camera>;
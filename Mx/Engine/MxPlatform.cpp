@@ -209,9 +209,9 @@ namespace Mix {
     Event<void(const PFGamepadDeviceEventData&)>	Platform::GamepadDeviceEvent;
     Event<void()>									Platform::QuitEvent;
 
-    bool Platform::Initialize() {
+    bool Platform::Initialize(const bool _headless) {
         if (!sInitialized) {
-            if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER)) {
+            if (SDL_Init((_headless ? SDL_INIT_EVENTS : SDL_INIT_VIDEO) | SDL_INIT_GAMECONTROLLER)) {
                 Log::Error("Failed to initialize SDL2");
                 sInitialized = false;
             }
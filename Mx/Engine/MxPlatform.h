@@ -95,7 +95,8 @@ namespace Mix {
 
 	class Platform :public GeneralBase::StaticBase {
 	public:
-		static bool Initialize();
+		/** @param _headless Leave out the video subsystem, so no display is needed */
+		static bool Initialize(bool _headless = false);
 
 		static void ShutDown();
 
@@ -51,6 +51,71 @@ namespace Mix {
         if (!GUIEvent.empty())
             GUIEvent.trigger();
 
+        if (mShowMemoryStats)
+            drawMemoryStats();
+    }
+
+    void GUI::drawMemoryStats() {
+        static auto toMiB = [](const vk::DeviceSize _size) {
+            return static_cast<float>(_size) / (1024.0f * 1024.0f);
+        };
+
+        if (!ImGui::Begin("GPU Memory", &mShowMemoryStats)) {
+            ImGui::End();
+            return;
+        }
+
+        const auto& allocator = mVulkan->getAllocator();
+
+        ImGui::Text("Heaps");
+        ImGui::Columns(5, "heaps");
+        ImGui::Text("Heap"); ImGui::NextColumn();
+        ImGui::Text("Size (MiB)"); ImGui::NextColumn();
+        ImGui::Text("Allocated"); ImGui::NextColumn();
+        ImGui::Text("Usage"); ImGui::NextColumn();
+        ImGui::Text("Budget"); ImGui::NextColumn();
+        ImGui::Separator();
+        for (auto& heap : allocator->getHeapBudgets()) {
+            ImGui::Text("%u%s", heap.heapIndex, heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal ? " (device)" : "");
+            ImGui::NextColumn();
+            ImGui::Text("%.1f", toMiB(heap.heapSize)); ImGui::NextColumn();
+            ImGui::Text("%.1f", toMiB(heap.allocatedSize)); ImGui::NextColumn();
+            ImGui::Text("%.1f", toMiB(heap.usage)); ImGui::NextColumn();
+            ImGui::Text("%.1f%s", toMiB(heap.budget), heap.fromExtension ? "" : " (est.)"); ImGui::NextColumn();
+        }
+        ImGui::Columns(1);
+        ImGui::Spacing();
+
+        ImGui::Text("Memory types");
+        ImGui::Columns(9, "types");
+        ImGui::Text("Type"); ImGui::NextColumn();
+        ImGui::Text("Chunks"); ImGui::NextColumn();
+        ImGui::Text("Dedicated"); ImGui::NextColumn();
+        ImGui::Text("Allocs"); ImGui::NextColumn();
+        ImGui::Text("Allocated"); ImGui::NextColumn();
+        ImGui::Text("Used"); ImGui::NextColumn();
+        ImGui::Text("Free"); ImGui::NextColumn();
+        ImGui::Text("Largest free"); ImGui::NextColumn();
+        ImGui::Text("Fragment."); ImGui::NextColumn();
+        ImGui::Separator();
+        for (auto& stats : allocator->getStatistics()) {
+            ImGui::Text("%u (heap %u)", stats.memoryTypeIndex, stats.heapIndex); ImGui::NextColumn();
+            ImGui::Text("%u", stats.chunkCount); ImGui::NextColumn();
+            ImGui::Text("%u", stats.dedicatedCount); ImGui::NextColumn();
+            ImGui::Text("%u", stats.allocationCount); ImGui::NextColumn();
+            ImGui::Text("%.2f", toMiB(stats.allocatedSize)); ImGui::NextColumn();
+            ImGui::Text("%.2f", toMiB(stats.usedSize)); ImGui::NextColumn();
+            ImGui::Text("%.2f", toMiB(stats.freeSize)); ImGui::NextColumn();
+            ImGui::Text("%.2f", toMiB(stats.largestFreeBlock)); ImGui::NextColumn();
+            ImGui::Text("%.0f%%", stats.fragmentation * 100.0f); ImGui::NextColumn();
+        }
+        ImGui::Columns(1);
+        ImGui::Spacing();
+
+        if (ImGui::Button("Defragment"))
+            Graphics::Get()->defragmentMemory();
+
+        ImGui::End();
     }
 
     bool GUI::getRenderData(UIRenderData& _renderData) {
@@ -58,7 +123,7 @@ namespace Mix {
 
         if (!drawData)
             return false;
-        mCurrFrame = mVulkan->getSwapchain()->getCurrFrame();
+        mCurrFrame = mVulkan->getCurrFrame();
         const auto fbWidth = static_cast<int>(drawData->DisplaySize.x * drawData->FramebufferScale.x);
         const auto fbHeight = static_cast<int>(drawData->DisplaySize.y * drawData->FramebufferScale.y);
         if (fbWidth <= 0 || fbHeight <= 0 || drawData->TotalVtxCount == 0)
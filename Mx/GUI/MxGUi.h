@@ -47,6 +47,11 @@ namespace Mix {
 
         void endGUI();
 
+        /** @brief Toggle the window showing GPU memory statistics */
+        void showMemoryStats(const bool _show) { mShowMemoryStats = _show; }
+
+        bool isShowingMemoryStats() const { return mShowMemoryStats; }
+
         Event<void()> GUIEvent;
 
     private:
@@ -54,6 +59,8 @@ namespace Mix {
 
         void render();
 
+        void drawMemoryStats();
+
         void createFontTexture();
 
         IndexFormat getIndexFormat() const;
@@ -65,6 +72,8 @@ namespace Mix {
         bool mFontTextureChanged = true;
         std::shared_ptr<Texture2D> mFontTexture;
 
+        bool mShowMemoryStats = false;
+
         static char* sClipboardTextData;
         static void SetClipboardText(void*, const char* _text);
         static const char* GetClipboardText(void*);
@@ -0,0 +1,265 @@
+#include "MxOcclusionCuller.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Mix {
+    namespace {
+        // clip space w below which a vertex counts as behind the camera
+        const float MinW = 1e-5f;
+    }
+
+    void OcclusionCuller::begin(const Matrix4& _viewProj) {
+        mViewProj = _viewProj;
+        mStatistics = {};
+        mOccluders.clear();
+        mHasOccluders = false;
+
+        mWidth = std::max(1u, mSettings.width);
+        mHeight = std::max(1u, mSettings.height);
+        // zero to one depth, 1 is the far plane
+        mDepth.assign(static_cast<size_t>(mWidth) * mHeight, 1.0f);
+    }
+
+    void OcclusionCuller::addOccluder(const std::shared_ptr<const Mesh::Occluder>& _occluder, const AABB& _bounds, const Matrix4& _localToWorld) {
+        if (!mSettings.enabled || !_occluder || _occluder->indices.empty())
+            return;
+
+        Occluder occluder;
+        occluder.geometry = _occluder;
+        occluder.transform = mViewProj * _localToWorld;
+
+        ScreenRect rect;
+        if (project(_bounds, occluder.transform, rect)) {
+            if (rect.maxX < 0.0f || rect.maxY < 0.0f || rect.minX > mWidth || rect.minY > mHeight)
+                return;
+            if ((rect.maxY - rect.minY) < mSettings.minOccluderScreenSize * mHeight)
+                return;
+            occluder.area = (rect.maxX - rect.minX) * (rect.maxY - rect.minY);
+        }
+        else {
+            // the camera is next to or inside the occluder, which likely covers much of the screen
+            occluder.area = std::numeric_limits<float>::max();
+        }
+
+        mOccluders.push_back(std::move(occluder));
+    }
+
+    void OcclusionCuller::rasterizeOccluders() {
+        std::sort(mOccluders.begin(), mOccluders.end(), [](const Occluder& _a, const Occluder& _b) { return _a.area > _b.area; });
+
+        for (auto& occluder : mOccluders) {
+            const auto triangleCount = static_cast<uint32_t>(occluder.geometry->indices.size() / 3);
+            if (mStatistics.triangleCount + triangleCount > mSettings.maxTriangles)
+                continue;
+
+            rasterize(occluder);
+            mStatistics.triangleCount += triangleCount;
+            ++mStatistics.occluderCount;
+        }
+        mOccluders.clear();
+
+        mHasOccluders = mStatistics.occluderCount != 0;
+        if (mHasOccluders)
+            buildPyramid();
+    }
+
+    bool OcclusionCuller::isVisible(const AABB& _bounds, const Matrix4& _localToWorld) {
+        if (!mHasOccluders)
+            return true;
+
+        ++mStatistics.testedCount;
+
+        ScreenRect rect;
+        if (!project(_bounds, mViewProj * _localToWorld, rect))
+            return true;
+
+        // parts outside of the screen are left to frustum culling
+        const int x0 = std::max(0, static_cast<int>(std::floor(rect.minX)));
+        const int y0 = std::max(0, static_cast<int>(std::floor(rect.minY)));
+        const int x1 = std::min(static_cast<int>(mWidth) - 1, static_cast<int>(std::floor(rect.maxX)));
+        const int y1 = std::min(static_cast<int>(mHeight) - 1, static_cast<int>(std::floor(rect.maxY)));
+        if (x0 > x1 || y0 > y1)
+            return true;
+
+        // the finest level at which the rectangle spans at most 4 texels per side
+        const uint32_t lastLevel = static_cast<uint32_t>(mLevels.size() - 1);
+        uint32_t level = 0;
+        while (level < lastLevel && ((x1 >> level) - (x0 >> level) >= 4 || (y1 >> level) - (y0 >> level) >= 4))
+            ++level;
+
+        // the coarser level decides most objects, in front of all occluders of a texel or behind all of them
+        const uint32_t coarse = std::min(level + 1, lastLevel);
+        bool ambiguous = false;
+        {
+            const auto& texels = mLevels[coarse];
+            for (int y = y0 >> coarse; y <= y1 >> coarse; ++y) {
+                for (int x = x0 >> coarse; x <= x1 >> coarse; ++x) {
+                    const size_t i = static_cast<size_t>(y) * texels.width + x;
+                    if (rect.maxZ < texels.minDepth[i])
+                        return true;
+                    if (rect.minZ <= texels.maxDepth[i])
+                        ambiguous = true;
+                }
+            }
+        }
+
+        if (ambiguous) {
+            const auto& texels = mLevels[level];
+            for (int y = y0 >> level; y <= y1 >> level; ++y) {
+                for (int x = x0 >> level; x <= x1 >> level; ++x) {
+                    if (rect.minZ <= texels.maxDepth[static_cast<size_t>(y) * texels.width + x])
+                        return true;
+                }
+            }
+        }
+
+        ++mStatistics.occludedCount;
+        return false;
+    }
+
+    bool OcclusionCuller::project(const AABB& _bounds, const Matrix4& _transform, ScreenRect& _rect) const {
+        _rect.minX = _rect.minY = _rect.minZ = std::numeric_limits<float>::max();
+        _rect.maxX = _rect.maxY = _rect.maxZ = std::numeric_limits<float>::lowest();
+
+        for (uint32_t i = 0; i < 8; ++i) {
+            const auto corner = _bounds.getCorner(static_cast<AABB::Corner>(i));
+            const auto clip = _transform * Vector4f(corner.x, corner.y, corner.z, 1.0f);
+            if (clip.w < MinW || clip.z < 0.0f)
+                return false;
+
+            const float invW = 1.0f / clip.w;
+            const float x = (clip.x * invW * 0.5f + 0.5f) * mWidth;
+            const float y = (clip.y * invW * 0.5f + 0.5f) * mHeight;
+            const float z = clip.z * invW;
+
+            _rect.minX = std::min(_rect.minX, x);
+            _rect.maxX = std::max(_rect.maxX, x);
+            _rect.minY = std::min(_rect.minY, y);
+            _rect.maxY = std::max(_rect.maxY, y);
+            _rect.minZ = std::min(_rect.minZ, z);
+            _rect.maxZ = std::max(_rect.maxZ, z);
+        }
+        return true;
+    }
+
+    void OcclusionCuller::rasterize(const Occluder& _occluder) {
+        const auto& positions = _occluder.geometry->positions;
+        const auto& indices = _occluder.geometry->indices;
+
+        mClipVertices.resize(positions.size());
+        for (size_t i = 0; i < positions.size(); ++i)
+            mClipVertices[i] = _occluder.transform * Vector4f(positions[i].x, positions[i].y, positions[i].z, 1.0f);
+
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            ScreenVertex vertices[3];
+            bool clipped = false;
+            for (uint32_t j = 0; j < 3; ++j) {
+                const auto& clip = mClipVertices[indices[i + j]];
+                // geometry in front of the near plane is not drawn, so it must not hide anything
+                if (clip.w < MinW || clip.z < 0.0f) {
+                    clipped = true;
+                    break;
+                }
+
+                const float invW = 1.0f / clip.w;
+                vertices[j] = { (clip.x * invW * 0.5f + 0.5f) * mWidth,
+                                (clip.y * invW * 0.5f + 0.5f) * mHeight,
+                                clip.z * invW };
+            }
+
+            if (!clipped)
+                rasterizeTriangle(vertices[0], vertices[1], vertices[2]);
+        }
+    }
+
+    void OcclusionCuller::rasterizeTriangle(ScreenVertex _a, ScreenVertex _b, ScreenVertex _c) {
+        float area = (_b.x - _a.x) * (_c.y - _a.y) - (_b.y - _a.y) * (_c.x - _a.x);
+        if (std::abs(area) < 1e-8f)
+            return;
+
+        // both windings are drawn, occluders don't need to be closed
+        if (area < 0.0f) {
+            std::swap(_b, _c);
+            area = -area;
+        }
+
+        // pixel centers covered by the bounding box
+        const int minX = std::max(0, static_cast<int>(std::ceil(std::min({ _a.x, _b.x, _c.x }) - 0.5f)));
+        const int minY = std::max(0, static_cast<int>(std::ceil(std::min({ _a.y, _b.y, _c.y }) - 0.5f)));
+        const int maxX = std::min(static_cast<int>(mWidth) - 1, static_cast<int>(std::floor(std::max({ _a.x, _b.x, _c.x }) - 0.5f)));
+        const int maxY = std::min(static_cast<int>(mHeight) - 1, static_cast<int>(std::floor(std::max({ _a.y, _b.y, _c.y }) - 0.5f)));
+        if (minX > maxX || minY > maxY)
+            return;
+
+        const auto edge = [](const ScreenVertex& _from, const ScreenVertex& _to, const float _x, const float _y) {
+            return (_to.x - _from.x) * (_y - _from.y) - (_to.y - _from.y) * (_x - _from.x);
+        };
+
+        // edge functions are the barycentric weights of the opposite vertex times the area
+        const float stepA = _b.y - _c.y;
+        const float stepB = _c.y - _a.y;
+        const float stepC = _a.y - _b.y;
+        const float invArea = 1.0f / area;
+        const float za = _a.z * invArea;
+        const float zb = _b.z * invArea;
+        const float zc = _c.z * invArea;
+
+        for (int y = minY; y <= maxY; ++y) {
+            const float px = minX + 0.5f;
+            const float py = y + 0.5f;
+            const float rowA = edge(_b, _c, px, py);
+            const float rowB = edge(_c, _a, px, py);
+            const float rowC = edge(_a, _b, px, py);
+
+            // branchless span, compilers turn it into SIMD code
+            float* depth = mDepth.data() + static_cast<size_t>(y) * mWidth;
+            const int count = maxX - minX + 1;
+            for (int i = 0; i < count; ++i) {
+                const float wa = rowA + stepA * i;
+                const float wb = rowB + stepB * i;
+                const float wc = rowC + stepC * i;
+                const float z = wa * za + wb * zb + wc * zc;
+                const bool inside = std::min(wa, std::min(wb, wc)) >= 0.0f;
+                const float current = depth[minX + i];
+                depth[minX + i] = inside && z < current ? z : current;
+            }
+        }
+    }
+
+    void OcclusionCuller::buildPyramid() {
+        mLevels.resize(1);
+        mLevels[0].width = mWidth;
+        mLevels[0].height = mHeight;
+        mLevels[0].minDepth = mDepth;
+        mLevels[0].maxDepth = mDepth;
+
+        while (mLevels.back().width > 1 || mLevels.back().height > 1) {
+            Level next;
+            {
+                const auto& prev = mLevels.back();
+                next.width = std::max(1u, (prev.width + 1) / 2);
+                next.height = std::max(1u, (prev.height + 1) / 2);
+                next.minDepth.resize(static_cast<size_t>(next.width) * next.height);
+                next.maxDepth.resize(next.minDepth.size());
+
+                for (uint32_t y = 0; y < next.height; ++y) {
+                    // odd sizes repeat the last row and column
+                    const size_t row0 = static_cast<size_t>(y * 2) * prev.width;
+                    const size_t row1 = static_cast<size_t>(std::min(y * 2 + 1, prev.height - 1)) * prev.width;
+                    for (uint32_t x = 0; x < next.width; ++x) {
+                        const uint32_t x0 = x * 2;
+                        const uint32_t x1 = std::min(x * 2 + 1, prev.width - 1);
+                        const size_t i = static_cast<size_t>(y) * next.width + x;
+
+                        next.minDepth[i] = std::min({ prev.minDepth[row0 + x0], prev.minDepth[row0 + x1],
+                                                      prev.minDepth[row1 + x0], prev.minDepth[row1 + x1] });
+                        next.maxDepth[i] = std::max({ prev.maxDepth[row0 + x0], prev.maxDepth[row0 + x1],
+                                                      prev.maxDepth[row1 + x0], prev.maxDepth[row1 + x1] });
+                    }
+                }
+            }
+            mLevels.push_back(std::move(next));
+        }
+    }
+}
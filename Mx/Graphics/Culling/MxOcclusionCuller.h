@@ -0,0 +1,115 @@
+#pragma once
+#ifndef MX_OCCLUSION_CULLER_H_
+#define MX_OCCLUSION_CULLER_H_
+
+#include "../Mesh/MxMesh.h"
+#include "../../Math/MxMatrix4.h"
+#include "../../Math/MxAABB.h"
+#include <vector>
+#include <memory>
+
+namespace Mix {
+    struct OcclusionCullingSettings {
+        bool enabled = true;
+
+        // resolution of the software depth buffer
+        uint32_t width = 256;
+        uint32_t height = 128;
+
+        // occluders whose bounds cover less of the screen height are not rasterized
+        float minOccluderScreenSize = 0.1f;
+
+        // triangles rasterized per frame, the largest occluders on screen go first
+        uint32_t maxTriangles = 16384;
+    };
+
+    struct OcclusionCullingStatistics {
+        uint32_t occluderCount = 0;
+        uint32_t triangleCount = 0;
+        uint32_t testedCount = 0;
+        uint32_t occludedCount = 0;
+    };
+
+    /**
+     * @brief Occlusion culling against a small depth buffer rasterized on the CPU.
+     *
+     * Each frame the occluders, simplified triangles of large static meshes, are rasterized into a
+     * low resolution depth buffer, from which a pyramid of min and max depths is built. Candidates
+     * are tested by the screen rectangle and nearest depth of their bounds, an object is occluded
+     * when it lies behind the farthest occluder depth of every texel its rectangle covers.
+     * Occluder triangles crossing the near plane are skipped, so the result stays conservative.
+     */
+    class OcclusionCuller :public GeneralBase::NoCopyBase {
+    public:
+        /** @brief Clear the depth buffer and the occluders of the previous frame */
+        void begin(const Matrix4& _viewProj);
+
+        /**
+         * @param _bounds Local bounds of the mesh the occluder belongs to
+         */
+        void addOccluder(const std::shared_ptr<const Mesh::Occluder>& _occluder, const AABB& _bounds, const Matrix4& _localToWorld);
+
+        /** @brief Rasterize the occluders added since begin() and build the depth pyramid */
+        void rasterizeOccluders();
+
+        /**
+         * @brief Whether anything of a box in local space may be visible, always true without occluders
+         */
+        bool isVisible(const AABB& _bounds, const Matrix4& _localToWorld);
+
+        void setSettings(const OcclusionCullingSettings& _settings) { mSettings = _settings; }
+
+        const OcclusionCullingSettings& getSettings() const { return mSettings; }
+
+        bool isEnabled() const { return mSettings.enabled; }
+
+        const OcclusionCullingStatistics& getStatistics() const { return mStatistics; }
+
+    private:
+        struct ScreenRect {
+            float minX, minY, maxX, maxY;
+            float minZ, maxZ;
+        };
+
+        struct ScreenVertex {
+            float x, y, z;
+        };
+
+        struct Occluder {
+            std::shared_ptr<const Mesh::Occluder> geometry;
+            Matrix4 transform;
+            float area;
+        };
+
+        struct Level {
+            uint32_t width = 0;
+            uint32_t height = 0;
+            std::vector<float> minDepth;
+            std::vector<float> maxDepth;
+        };
+
+        /** @brief Pixel rectangle and depth range of a box, false when the box is not entirely in front of the near plane */
+        bool project(const AABB& _bounds, const Matrix4& _transform, ScreenRect& _rect) const;
+
+        void rasterize(const Occluder& _occluder);
+
+        void rasterizeTriangle(ScreenVertex _a, ScreenVertex _b, ScreenVertex _c);
+
+        void buildPyramid();
+
+        OcclusionCullingSettings mSettings;
+        OcclusionCullingStatistics mStatistics;
+
+        Matrix4 mViewProj;
+        uint32_t mWidth = 0;
+        uint32_t mHeight = 0;
+        std::vector<float> mDepth;
+        std::vector<Level> mLevels;
+        bool mHasOccluders = false;
+
+        std::vector<Occluder> mOccluders;
+        std::vector<Vector4f> mClipVertices;
+    };
+}
+
+#endif
@@ -0,0 +1,204 @@
+#include "MxLightClusterer.h"
+#include "../../Component/Light/MxLight.h"
+#include "../../Component/Camera/MxCamera.h"
+#include "../../Utils/MxThreadPool.h"
+#include "../../Resource/MxResourceLoader.h"
+#include "../../Math/MxMath.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Mix {
+    void LightClusterer::setSettings(const LightClusterSettings& _settings) {
+        mSettings = _settings;
+        mSettings.tilesX = std::max(1u, mSettings.tilesX);
+        mSettings.tilesY = std::max(1u, mSettings.tilesY);
+        mSettings.slices = std::max(1u, mSettings.slices);
+        mGridDirty = true;
+    }
+
+    void LightClusterer::build(const Camera& _camera, const std::vector<Light*>& _lights) {
+        buildGrid(_camera);
+
+        const Matrix4 view = _camera.getViewMat();
+        const float nearPlane = _camera.getNearClipPlane();
+        const float farPlane = _camera.getFarClipPlane();
+
+        mLights.clear();
+        mCenterX.clear();
+        mCenterY.clear();
+        mCenterZ.clear();
+        mRadius.clear();
+
+        for (auto light : _lights) {
+            if (mLights.size() >= mSettings.maxLights)
+                break;
+            if (light->getRange() <= 0.0f || light->getIntensity() <= 0.0f)
+                continue;
+
+            const Vector4f sphere = light->getBoundingSphere();
+            const Vector3f center = view.multiplyPoint(Vector3f(sphere.x, sphere.y, sphere.z));
+            if (center.z + sphere.w < nearPlane || center.z - sphere.w > farPlane)
+                continue;
+
+            const Color& color = light->getColor();
+            const float intensity = light->getIntensity();
+            const float cosOuter = std::cos(Math::Radians(light->getSpotAngle()) * 0.5f);
+            const float cosInner = std::cos(Math::Radians(light->getInnerSpotAngle()) * 0.5f);
+            const float spotScale = 1.0f / std::max(cosInner - cosOuter, 1e-4f);
+
+            ClusterLight data;
+            data.positionRange = Vector4f(light->transform()->getPosition(), light->getRange());
+            data.color = Vector4f(color.r * intensity, color.g * intensity, color.b * intensity, static_cast<float>(light->getType()));
+            data.direction = Vector4f(light->transform()->forward(), cosOuter);
+            data.spot = Vector4f(spotScale, -cosOuter * spotScale, 0.0f, 0.0f);
+            mLights.push_back(data);
+
+            mCenterX.push_back(center.x);
+            mCenterY.push_back(center.y);
+            mCenterZ.push_back(center.z);
+            mRadius.push_back(sphere.w);
+        }
+
+        mParams.gridSize[3] = static_cast<uint32_t>(mLights.size());
+
+        // each slice only writes its own froxels, the persistent workers take slices along with this thread
+        ResourceLoader::Get()->getWorkers().parallelFor(mSettings.slices, 1, [this](size_t _begin, size_t _end) {
+            for (size_t slice = _begin; slice < _end; ++slice)
+                binSlice(static_cast<uint32_t>(slice));
+        });
+
+        // froxels of a slice are consecutive, so the slice lists are only concatenated
+        mIndices.clear();
+        uint32_t offset = 0;
+        const uint32_t tileCount = mSettings.tilesX * mSettings.tilesY;
+        for (uint32_t slice = 0; slice < mSettings.slices; ++slice) {
+            for (uint32_t tile = 0; tile < tileCount; ++tile) {
+                auto& cluster = mClusters[slice * tileCount + tile];
+                cluster.offset = offset;
+                offset += cluster.count;
+            }
+            mIndices.insert(mIndices.end(), mSliceIndices[slice].begin(), mSliceIndices[slice].end());
+        }
+    }
+
+    void LightClusterer::buildGrid(const Camera& _camera) {
+        const Matrix4 proj = _camera.getProjMat();
+        const Vector2i extent = _camera.getExtent();
+        if (!mGridDirty && proj == mGridProj && static_cast<uint32_t>(extent.x) == mGridWidth && static_cast<uint32_t>(extent.y) == mGridHeight)
+            return;
+
+        mGridDirty = false;
+        mGridProj = proj;
+        mGridWidth = extent.x;
+        mGridHeight = extent.y;
+
+        const uint32_t tilesX = mSettings.tilesX;
+        const uint32_t tilesY = mSettings.tilesY;
+        const uint32_t slices = mSettings.slices;
+        const uint32_t tileCount = tilesX * tilesY;
+
+        const float nearPlane = _camera.getNearClipPlane();
+        const float farPlane = _camera.getFarClipPlane();
+        const float logRatio = std::log(farPlane / nearPlane);
+
+        // pixels are rounded up, so the tiles cover the whole screen
+        const float tileWidth = static_cast<float>((std::max(1u, mGridWidth) + tilesX - 1) / tilesX);
+        const float tileHeight = static_cast<float>((std::max(1u, mGridHeight) + tilesY - 1) / tilesY);
+
+        mParams.gridSize[0] = tilesX;
+        mParams.gridSize[1] = tilesY;
+        mParams.gridSize[2] = slices;
+        // slice = log(z) * scale + bias, the slices grow exponentially from the near to the far plane
+        mParams.tileSizeSliceScaleBias = Vector4f(tileWidth, tileHeight, slices / logRatio, -slices * std::log(nearPlane) / logRatio);
+
+        mSliceNear.resize(slices);
+        mSliceFar.resize(slices);
+        for (uint32_t slice = 0; slice < slices; ++slice) {
+            mSliceNear[slice] = nearPlane * std::exp(logRatio * slice / slices);
+            mSliceFar[slice] = nearPlane * std::exp(logRatio * (slice + 1) / slices);
+        }
+
+        // view space x is ndc * z / proj[0][0], the framebuffer y of Vulkan points down so y is -ndc * z / proj[1][1]
+        const float invScaleX = 1.0f / proj[0][0];
+        const float invScaleY = 1.0f / proj[1][1];
+        const auto toNdc = [](const float _pixel, const uint32_t _size) {
+            return std::min(_pixel, static_cast<float>(_size)) / _size * 2.0f - 1.0f;
+        };
+
+        mMinX.resize(static_cast<size_t>(tileCount) * slices);
+        mMaxX.resize(mMinX.size());
+        mMinY.resize(mMinX.size());
+        mMaxY.resize(mMinX.size());
+        for (uint32_t slice = 0; slice < slices; ++slice) {
+            const float zn = mSliceNear[slice];
+            const float zf = mSliceFar[slice];
+            for (uint32_t y = 0; y < tilesY; ++y) {
+                const float top = -toNdc(y * tileHeight, mGridHeight) * invScaleY;
+                const float bottom = -toNdc((y + 1) * tileHeight, mGridHeight) * invScaleY;
+                for (uint32_t x = 0; x < tilesX; ++x) {
+                    const float left = toNdc(x * tileWidth, mGridWidth) * invScaleX;
+                    const float right = toNdc((x + 1) * tileWidth, mGridWidth) * invScaleX;
+
+                    // the frustum of the tile widens with depth, its box spans both ends of the slice
+                    const size_t i = static_cast<size_t>(slice) * tileCount + y * tilesX + x;
+                    mMinX[i] = std::min(left * zn, left * zf);
+                    mMaxX[i] = std::max(right * zn, right * zf);
+                    mMinY[i] = std::min(bottom * zn, bottom * zf);
+                    mMaxY[i] = std::max(top * zn, top * zf);
+                }
+            }
+        }
+
+        mClusters.assign(static_cast<size_t>(tileCount) * slices, LightCluster());
+        mSliceIndices.resize(slices);
+    }
+
+    void LightClusterer::binSlice(const uint32_t _slice) {
+        const uint32_t tileCount = mSettings.tilesX * mSettings.tilesY;
+        const size_t first = static_cast<size_t>(_slice) * tileCount;
+        const float zn = mSliceNear[_slice];
+        const float zf = mSliceFar[_slice];
+
+        auto& indices = mSliceIndices[_slice];
+        indices.clear();
+
+        // lights reaching into the depth range of the slice, with the squared radius left after the distance along z
+        std::vector<uint32_t> candidates;
+        std::vector<float> centerX, centerY, radiusSq;
+        for (uint32_t i = 0; i < static_cast<uint32_t>(mLights.size()); ++i) {
+            const float dz = std::max(std::max(zn - mCenterZ[i], mCenterZ[i] - zf), 0.0f);
+            const float rest = mRadius[i] * mRadius[i] - dz * dz;
+            if (rest < 0.0f)
+                continue;
+
+            candidates.push_back(i);
+            centerX.push_back(mCenterX[i]);
+            centerY.push_back(mCenterY[i]);
+            radiusSq.push_back(rest);
+        }
+
+        const size_t count = candidates.size();
+        std::vector<uint8_t> hits(count);
+        for (uint32_t tile = 0; tile < tileCount; ++tile) {
+            const size_t i = first + tile;
+            const float minX = mMinX[i], maxX = mMaxX[i];
+            const float minY = mMinY[i], maxY = mMaxY[i];
+
+            // sphere against box without branches, compilers turn it into SIMD code
+            for (size_t j = 0; j < count; ++j) {
+                const float dx = std::max(std::max(minX - centerX[j], centerX[j] - maxX), 0.0f);
+                const float dy = std::max(std::max(minY - centerY[j], centerY[j] - maxY), 0.0f);
+                hits[j] = dx * dx + dy * dy <= radiusSq[j];
+            }
+
+            uint32_t lightCount = 0;
+            for (size_t j = 0; j < count && lightCount < mSettings.maxLightsPerCluster; ++j) {
+                if (hits[j]) {
+                    indices.push_back(candidates[j]);
+                    ++lightCount;
+                }
+            }
+            mClusters[i].count = lightCount;
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+#ifndef MX_LIGHT_CLUSTERER_H_
+#define MX_LIGHT_CLUSTERER_H_
+
+#include "../../Utils/MxGeneralBase.hpp"
+#include "../../Math/MxMatrix4.h"
+#include "../../Math/MxVector4.h"
+#include <vector>
+
+namespace Mix {
+    class Camera;
+    class Light;
+
+    struct LightClusterSettings {
+        // froxels across the screen and view space depth slices
+        uint32_t tilesX = 16;
+        uint32_t tilesY = 9;
+        uint32_t slices = 24;
+
+        // lights beyond are dropped, the order of the scene decides which ones
+        uint32_t maxLights = 1024;
+
+        // indices stored per froxel, further lights touching it are ignored
+        uint32_t maxLightsPerCluster = 128;
+    };
+
+    /** @brief Light as read by the shaders, std430 layout shared with ClusteredLighting.glsl */
+    struct ClusterLight {
+        // world space position and range
+        Vector4f positionRange;
+        // linear color times intensity, w is the LightType
+        Vector4f color;
+        // world space direction of spot lights, w is the cosine of the outer half angle
+        Vector4f direction;
+        // spot fade, smoothstep from w = cos outer to cos inner as scale and offset of the cosine
+        Vector4f spot;
+    };
+
+    static_assert(sizeof(ClusterLight) == 64, "ClusterLight has to match the std430 layout of the shaders");
+
+    /** @brief Offset into the index list and light count of a froxel */
+    struct LightCluster {
+        uint32_t offset = 0;
+        uint32_t count = 0;
+    };
+
+    /** @brief Uniform telling fragment shaders how to find their froxel, std140 */
+    struct LightClusterParams {
+        // tiles along x and y, slices and light count
+        uint32_t gridSize[4];
+        // tile size in pixels, then scale and bias turning log(view depth) into a slice
+        Vector4f tileSizeSliceScaleBias;
+    };
+
+    /**
+     * @brief Bins the lights of a frame into view space froxels for clustered forward shading.
+     *
+     * The screen is split into tiles and the view depth into exponentially growing slices, the
+     * bounding sphere of every light is tested against the view space box of each froxel. A
+     * fragment then only iterates the lights of its froxel, so the cost follows the number of
+     * lights per pixel instead of their total. Slices are binned in parallel, within a slice the
+     * lights overlapping its depth range are kept as arrays of components and tested against
+     * each tile in branchless loops the compiler vectorizes.
+     */
+    class LightClusterer :public GeneralBase::NoCopyBase {
+    public:
+        /** @brief Bin @p _lights for the view of @p _camera, replaces the result of the previous frame */
+        void build(const Camera& _camera, const std::vector<Light*>& _lights);
+
+        const std::vector<ClusterLight>& getLights() const { return mLights; }
+
+        /** @brief Froxels ordered by slice, then row and column */
+        const std::vector<LightCluster>& getClusters() const { return mClusters; }
+
+        const std::vector<uint32_t>& getIndices() const { return mIndices; }
+
+        const LightClusterParams& getParams() const { return mParams; }
+
+        void setSettings(const LightClusterSettings& _settings);
+
+        const LightClusterSettings& getSettings() const { return mSettings; }
+
+        uint32_t clusterCount() const { return mSettings.tilesX * mSettings.tilesY * mSettings.slices; }
+
+    private:
+        /** @brief View space boxes of the froxels, rebuilt when the projection or extent changes */
+        void buildGrid(const Camera& _camera);
+
+        void binSlice(uint32_t _slice);
+
+        LightClusterSettings mSettings;
+        LightClusterParams mParams = {};
+
+        std::vector<ClusterLight> mLights;
+        std::vector<LightCluster> mClusters;
+        std::vector<uint32_t> mIndices;
+
+        // view space bounding spheres of the lights
+        std::vector<float> mCenterX, mCenterY, mCenterZ, mRadius;
+
+        // view space boxes of the tiles per slice, x and y scale with depth so they are stored per slice
+        std::vector<float> mMinX, mMaxX, mMinY, mMaxY;
+        std::vector<float> mSliceNear, mSliceFar;
+
+        // light indices of the froxels of each slice before they are concatenated
+        std::vector<std::vector<uint32_t>> mSliceIndices;
+
+        Matrix4 mGridProj;
+        uint32_t mGridWidth = 0;
+        uint32_t mGridHeight = 0;
+        bool mGridDirty = true;
+    };
+}
+
+#endif
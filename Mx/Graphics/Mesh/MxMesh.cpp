@@ -1,9 +1,13 @@
 #include "MxMesh.h"
 #include "../../Vulkan/MxVulkan.h"
+#include "../../Vulkan/Buffers/MxVkUploadManager.h"
+#include "../../Vulkan/Buffers/MxVkGeometryPool.h"
 #include <any>
 #include "../MxGraphics.h"
 #include <iostream>
 #include "MxMeshUtils.h"
+#include "../../Log/MxLog.h"
+#include <algorithm>
 #include <numeric>
 
 namespace Mix {
@@ -169,42 +173,28 @@ namespace Mix {
     void Mesh::recalculateNormals() {
         if (mMeshData && !mMeshData->positions.empty() && mMeshData->indexSet.has_value()) {
             mMeshData->normals.resize(mMeshData->positions.size());
-            if (mMeshData->indexSet->size() == 1) {
+            if (mMeshData->isSingleTriangleList()) {
                 MeshUtils::CalculateNormals(mMeshData->positions, mMeshData->indexSet.value()[0], mMeshData->normals.data());
             }
             else {
-                size_t indexCount = std::accumulate(mMeshData->indexSet->begin(), mMeshData->indexSet->end(), 0, [](size_t _val, const std::vector<uint32_t>& _i) {return _val + _i.size(); });
-                std::vector<uint32_t> indices(indexCount);
-                size_t offset = 0;
-                for (auto& index : mMeshData->indexSet.value()) {
-                    memcpy(indices.data() + offset, index.data(), index.size() * sizeof(uint32_t));
-                    offset += index.size() * sizeof(uint32_t);
-                }
-                MeshUtils::CalculateNormals(mMeshData->positions, indices, mMeshData->normals.data());
+                MeshUtils::CalculateNormals(mMeshData->positions, mMeshData->getTriangles(), mMeshData->normals.data());
             }
         }
     }
 
     void Mesh::recalculateTangents() {
         if (mMeshData && !mMeshData->positions.empty() && !mMeshData->uv0.empty() && mMeshData->indexSet.has_value()) {
-            mMeshData->normals.resize(mMeshData->positions.size());
-            if (mMeshData->indexSet->size() == 1) {
+            mMeshData->tangents.resize(mMeshData->positions.size());
+            if (mMeshData->isSingleTriangleList()) {
                 MeshUtils::CalculateTangents(mMeshData->positions, mMeshData->indexSet.value()[0], mMeshData->uv0, mMeshData->tangents.data());
             }
             else {
-                size_t indexCount = std::accumulate(mMeshData->indexSet->begin(), mMeshData->indexSet->end(), size_t(0), [](size_t _val, const std::vector<uint32_t>& _i) {return _val + _i.size(); });
-                std::vector<uint32_t> indices(indexCount);
-                size_t offset = 0;
-                for (auto& index : mMeshData->indexSet.value()) {
-                    memcpy(indices.data() + offset, index.data(), index.size() * sizeof(uint32_t));
-                    offset += index.size() * sizeof(uint32_t);
-                }
-                MeshUtils::CalculateTangents(mMeshData->positions, indices, mMeshData->uv0, mMeshData->normals.data());
+                MeshUtils::CalculateTangents(mMeshData->positions, mMeshData->getTriangles(), mMeshData->uv0, mMeshData->tangents.data());
             }
         }
     }
 
-    void Mesh::uploadMeshData(bool _markNoLongerReadable) {
+    void Mesh::uploadMeshData(bool _markNoLongerReadable, bool _optimize) {
         // Check if has mesh data
         if (!mMeshData)
             return;
@@ -232,49 +222,74 @@ namespace Mix {
             }
         }
 
-        // Merge vertex data 
+        if (_optimize)
+            optimizeMeshData();
 
-        std::vector<std::pair<std::byte*, uint32_t>> srcs;
-        uint32_t stride = sizeof(PositionType); // A mesh always has Vertex attribute
-        Flags<VertexAttribute> attribute = VertexAttribute::Position;
-        srcs.emplace_back(reinterpret_cast<std::byte*>(mMeshData->positions.data()), sizeof(PositionType));
+        // Merge vertex data 
 
-        if (!mMeshData->normals.empty()) {
-            stride += sizeof(NormalType);
+        Flags<VertexAttribute> attribute = VertexAttribute::Position; // A mesh always has Vertex attribute
+        if (!mMeshData->normals.empty())
             attribute |= VertexAttribute::Normal;
-            srcs.emplace_back(reinterpret_cast<std::byte*>(mMeshData->normals.data()), sizeof(NormalType));
-        }
-        if (!mMeshData->tangents.empty()) {
-            stride += sizeof(TangentType);
+        if (!mMeshData->tangents.empty())
             attribute |= VertexAttribute::Tangent;
-            srcs.emplace_back(reinterpret_cast<std::byte*>(mMeshData->tangents.data()), sizeof(TangentType));
-        }
-        if (!mMeshData->uv0.empty()) {
-            stride += sizeof(UV2DType);
+        if (!mMeshData->uv0.empty())
             attribute |= VertexAttribute::UV0;
-            srcs.emplace_back(reinterpret_cast<std::byte*>(mMeshData->uv0.data()), sizeof(UV2DType));
-        }
-        if (!mMeshData->uv1.empty()) {
-            stride += sizeof(UV2DType);
+        if (!mMeshData->uv1.empty())
             attribute |= VertexAttribute::UV1;
-            srcs.emplace_back(reinterpret_cast<std::byte*>(mMeshData->uv1.data()), sizeof(UV2DType));
-        }
-        if (!mMeshData->colors.empty()) {
-            stride += sizeof(ColorType);
+        if (!mMeshData->colors.empty())
             attribute |= VertexAttribute::Color;
-            srcs.emplace_back(reinterpret_cast<std::byte*>(mMeshData->colors.data()), sizeof(ColorType));
+
+        const auto declaration = std::make_shared<VertexDeclaration>(attribute, mCompression);
+        const uint32_t stride = declaration->getSizeOfStream(0);
+
+        auto min = mMeshData->positions.front();
+        auto max = mMeshData->positions.front();
+        for (auto& position : mMeshData->positions) {
+            for (uint32_t i = 0; i < 3; ++i) {
+                min.linear[i] = std::min(min.linear[i], position.linear[i]);
+                max.linear[i] = std::max(max.linear[i], position.linear[i]);
+            }
         }
 
+        PositionQuantization quantization;
+        const bool quantizePositions = mCompression.isSet(VertexCompression::Position);
+        if (quantizePositions)
+            quantization = PositionQuantization(min, max);
+
         const size_t vertexByteSize = mMeshData->positions.size() * stride;
         std::vector<std::byte> vertexData(vertexByteSize);
         {
             auto ptr = vertexData.data();
             auto count = mMeshData->positions.size();
-            for (size_t i = 0; i < count; ++i) {
-                for (uint32_t j = 0; j < srcs.size(); ++j) {
-                    memcpy(ptr, srcs[j].first, srcs[j].second);
-                    ptr += srcs[j].second;
-                    srcs[j].first += srcs[j].second;
+            for (size_t i = 0; i < count; ++i, ptr += stride) {
+                for (auto& element : declaration->getElements()) {
+                    const auto dst = ptr + element.getOffset();
+
+                    float values[4] = {};
+                    switch (element.getSemantic()) {
+                    case VertexElementSemantic::Position:
+                    {
+                        const auto position = quantizePositions ? quantization.quantize(mMeshData->positions[i]) : mMeshData->positions[i];
+                        std::copy_n(position.linear, 3, values);
+                        break;
+                    }
+                    case VertexElementSemantic::Normal:
+                        std::copy_n(mMeshData->normals[i].linear, 3, values);
+                        break;
+                    case VertexElementSemantic::Tangent:
+                        std::copy_n(mMeshData->tangents[i].linear, 3, values);
+                        break;
+                    case VertexElementSemantic::TexCoord:
+                        std::copy_n((element.getSemanticIndex() == 0 ? mMeshData->uv0[i] : mMeshData->uv1[i]).linear, 2, values);
+                        break;
+                    case VertexElementSemantic::Color:
+                        memcpy(dst, &mMeshData->colors[i], sizeof(ColorType));
+                        continue;
+                    default:
+                        break;
+                    }
+
+                    MeshUtils::EncodeVertexElement(element.getType(), values, dst);
                 }
             }
         }
@@ -285,8 +300,15 @@ namespace Mix {
         IndexFormat indexFormat = IndexFormat::UInt16;
         std::vector<std::byte> indexData;
         if (mMeshData->indexSet.has_value()) {
+            // indices are relative to the base vertex of their sub mesh, 16 bit is enough as long as they fit
+            uint32_t maxIndex = 0;
+            for (const auto& indices : mMeshData->indexSet.value()) {
+                if (!indices.empty())
+                    maxIndex = std::max(maxIndex, *std::max_element(indices.begin(), indices.end()));
+            }
+
             // Calculate the size of indexData
-            indexFormat = mMeshData->positions.size() > std::numeric_limits<uint16_t>::max() ? IndexFormat::UInt32 : IndexFormat::UInt16;
+            indexFormat = maxIndex > std::numeric_limits<uint16_t>::max() ? IndexFormat::UInt32 : IndexFormat::UInt16;
             const auto indexFormatSizeInByte = (indexFormat == IndexFormat::UInt16 ? sizeof(Index16Type) : sizeof(Index32Type));
 
             uint32_t count = 0;
@@ -301,31 +323,39 @@ namespace Mix {
             indexData.resize(indexByteSize);
             if (indexFormat == IndexFormat::UInt32) {
                 size_t offset = 0;
-                for (auto index : mMeshData->indexSet.value()) {
-                    memcpy(indexData.data(), index.data(), index.size() * indexFormatSizeInByte);
+                for (const auto& index : mMeshData->indexSet.value()) {
+                    memcpy(indexData.data() + offset, index.data(), index.size() * indexFormatSizeInByte);
                     offset += index.size() * indexFormatSizeInByte;
                 }
             }
             else {
                 auto dst = reinterpret_cast<uint16_t*>(indexData.data());
-                for (auto index : mMeshData->indexSet.value()) {
+                for (const auto& index : mMeshData->indexSet.value()) {
                     dst = std::copy(index.begin(), index.end(), dst);
                 }
             }
         }
 
-        std::shared_ptr<Vulkan::Buffer> vertexBuffer;
-        std::shared_ptr<Vulkan::Buffer> indexBuffer;
+        std::shared_ptr<Vulkan::GeometryRange> vertexRange;
+        std::shared_ptr<Vulkan::GeometryRange> indexRange;
 
-        SendToGPU({ vertexByteSize,vertexData.data() }, { indexByteSize,indexData.data() }, vertexBuffer, indexBuffer);
+        if (!SendToGPU(*declaration,
+                       { vertexByteSize,vertexData.data() },
+                       indexFormat,
+                       { indexByteSize,indexData.data() },
+                       vertexRange,
+                       indexRange))
+            return;
 
-        mVertexBuffer = vertexBuffer;
-        mIndexBuffer = indexBuffer;
+        mVertexRange = vertexRange;
+        mIndexRange = indexRange;
         mIndexFormat = indexFormat;
-        mHasIndex = indexByteSize == 0;
         mAttributes = attribute;
         mSubMeshes = mMeshData->subMeshes.value();
-        mVertexDeclaration = std::make_shared<VertexDeclaration>(mAttributes);
+        mVertexDeclaration = declaration;
+        mVertexTransform = quantizePositions ? quantization.dequantizeMatrix() : Matrix4::Identity;
+        mBounds = AABB(min, max);
+        mUVDensity = CalculateUVDensity(*mMeshData);
 
         if (_markNoLongerReadable) {
             markNoLongerReadable();
@@ -336,28 +366,82 @@ namespace Mix {
         mMeshData.reset();
     }
 
+    void Mesh::generateOccluder(const size_t _maxTriangles) {
+        if (!mMeshData) {
+            Log::Warning("%1%: The mesh is not readable", __FUNCTION__);
+            return;
+        }
+
+        // an occluder must not stick out of the surface, so the error stays small even if the target isn't reached
+        auto indices = mMeshData->getTriangles();
+        if (indices.size() > _maxTriangles * 3)
+            indices = MeshUtils::Simplify(indices, mMeshData->positions, _maxTriangles * 3);
+
+        if (indices.empty()) {
+            mOccluder.reset();
+            return;
+        }
+
+        auto occluder = std::make_shared<Occluder>();
+        occluder->positions = mMeshData->positions;
+        const auto remap = MeshUtils::OptimizeVertexFetch(indices, occluder->positions.size());
+        MeshUtils::RemapVertices(occluder->positions, remap);
+        occluder->positions.resize(*std::max_element(indices.begin(), indices.end()) + 1);
+        occluder->indices = std::move(indices);
+        mOccluder = std::move(occluder);
+    }
+
     void Mesh::clear() {
-        mIndexBuffer.reset();
-        mVertexBuffer.reset();
+        mOccluder.reset();
+        mIndexRange.reset();
+        mVertexRange.reset();
         mAttributes = Flags<VertexAttribute>();
     }
 
+    uint64_t Mesh::memorySize() const {
+        uint64_t result = 0;
+        if (mVertexRange)
+            result += mVertexRange->byteSize();
+        if (mIndexRange)
+            result += mIndexRange->byteSize();
+
+        if (mOccluder) {
+            result += mOccluder->positions.size() * sizeof(PositionType);
+            result += mOccluder->indices.size() * sizeof(uint32_t);
+        }
+
+        // readable meshes also keep their data on the cpu
+        if (mMeshData) {
+            result += mMeshData->positions.size() * sizeof(PositionType);
+            result += mMeshData->normals.size() * sizeof(NormalType);
+            result += mMeshData->tangents.size() * sizeof(TangentType);
+            result += (mMeshData->uv0.size() + mMeshData->uv1.size()) * sizeof(UV2DType);
+            result += mMeshData->colors.size() * sizeof(ColorType);
+            if (mMeshData->indexSet) {
+                for (auto& indices : mMeshData->indexSet.value())
+                    result += indices.size() * sizeof(uint32_t);
+            }
+        }
+        return result;
+    }
+
     std::shared_ptr<Mesh> Mesh::Create(const std::vector<std::byte>& _vertexData,
                                        Flags<VertexAttribute> _attributeFlags,
                                        const std::vector<std::byte>& _indexData,
                                        IndexFormat _format,
                                        const std::vector<SubMesh>& _subMeshes) {
-        std::shared_ptr<Vulkan::Buffer> vertexBuffer;
-        std::shared_ptr<Vulkan::Buffer> indexBuffer;
+        auto declaration = std::make_shared<VertexDeclaration>(_attributeFlags);
+        std::shared_ptr<Vulkan::GeometryRange> vertexRange;
+        std::shared_ptr<Vulkan::GeometryRange> indexRange;
 
-        if (SendToGPU(_vertexData, _indexData, vertexBuffer, indexBuffer)) {
+        if (SendToGPU(*declaration, _vertexData, _format, _indexData, vertexRange, indexRange)) {
             std::shared_ptr<Mesh> result = std::make_shared<Mesh>();
             result->mAttributes = _attributeFlags;
-            result->mHasIndex = indexBuffer == nullptr;
+            result->mIndexFormat = _format;
             result->mSubMeshes = _subMeshes;
-            result->mVertexBuffer = vertexBuffer;
-            result->mIndexBuffer = indexBuffer;
-            result->mVertexDeclaration = std::make_shared<VertexDeclaration>(result->mAttributes);
+            result->mVertexRange = vertexRange;
+            result->mIndexRange = indexRange;
+            result->mVertexDeclaration = declaration;
 
             return result;
         }
@@ -368,17 +452,16 @@ namespace Mix {
     std::shared_ptr<Mesh> Mesh::Create(const std::vector<std::byte>& _vertexData,
                                        Flags<VertexAttribute> _attributeFlags,
                                        const std::vector<SubMesh>& _subMeshes) {
-        std::shared_ptr<Vulkan::Buffer> vertexBuffer;
-        std::shared_ptr<Vulkan::Buffer> indexBuffer;
+        auto declaration = std::make_shared<VertexDeclaration>(_attributeFlags);
+        std::shared_ptr<Vulkan::GeometryRange> vertexRange;
+        std::shared_ptr<Vulkan::GeometryRange> indexRange;
 
-        if (SendToGPU(_vertexData, nullptr, vertexBuffer, indexBuffer)) {
+        if (SendToGPU(*declaration, _vertexData, IndexFormat::UInt16, nullptr, vertexRange, indexRange)) {
             std::shared_ptr<Mesh> result = std::make_shared<Mesh>();
             result->mAttributes = _attributeFlags;
-            result->mHasIndex = indexBuffer == nullptr;
             result->mSubMeshes = _subMeshes;
-            result->mVertexBuffer = vertexBuffer;
-            result->mIndexBuffer = nullptr;
-            result->mVertexDeclaration = std::make_shared<VertexDeclaration>(result->mAttributes);
+            result->mVertexRange = vertexRange;
+            result->mVertexDeclaration = declaration;
 
             return result;
         }
@@ -386,6 +469,69 @@ namespace Mix {
         return nullptr;
     }
 
+    std::shared_ptr<Mesh> Mesh::Create(vk::DeviceSize _vertexByteSize,
+                                       Flags<VertexAttribute> _attributeFlags,
+                                       const std::function<void(std::byte*)>& _writeVertices,
+                                       vk::DeviceSize _indexByteSize,
+                                       IndexFormat _format,
+                                       const std::function<void(std::byte*)>& _writeIndices,
+                                       const std::vector<SubMesh>& _subMeshes,
+                                       float _uvDensity,
+                                       Flags<VertexCompression> _compression,
+                                       const PositionQuantization& _quantization) {
+        if (_vertexByteSize == 0)
+            return nullptr;
+
+        auto& uploader = Graphics::Get()->getRenderApi().getUploadManager();
+
+        std::shared_ptr<Mesh> result = std::make_shared<Mesh>();
+        result->mVertexDeclaration = std::make_shared<VertexDeclaration>(_attributeFlags, _compression);
+        if (!AllocateGeometry(*result->mVertexDeclaration, _vertexByteSize, _format, _indexByteSize, result->mVertexRange, result->mIndexRange))
+            return nullptr;
+
+        uploader.uploadBuffer(result->mVertexRange->getBuffer(), _vertexByteSize, _writeVertices, result->mVertexRange->byteOffset());
+        if (result->mIndexRange)
+            uploader.uploadBuffer(result->mIndexRange->getBuffer(), _indexByteSize, _writeIndices, result->mIndexRange->byteOffset());
+
+        result->mAttributes = _attributeFlags;
+        result->mIndexFormat = _format;
+        result->mSubMeshes = _subMeshes;
+        result->mCompression = _compression;
+        result->mVertexTransform = _compression.isSet(VertexCompression::Position) ? _quantization.dequantizeMatrix() : Matrix4::Identity;
+        result->mUVDensity = _uvDensity;
+        return result;
+    }
+
+    Mesh::PositionQuantization::PositionQuantization(const Vector3f& _min, const Vector3f& _max)
+        :center((_min + _max) * 0.5f) {
+        const auto halfSize = (_max - _min) * 0.5f;
+        extent = std::max({ halfSize.x, halfSize.y, halfSize.z });
+        // flat or single point meshes
+        if (extent <= 0.0f)
+            extent = 1.0f;
+    }
+
+    bool Mesh::MeshData::isSingleTriangleList() const {
+        return indexSet.has_value() && indexSet->size() == 1
+            && subMeshes.value()[0].baseVertex == 0 && subMeshes.value()[0].topology == MeshTopology::Triangles_List;
+    }
+
+    std::vector<uint32_t> Mesh::MeshData::getTriangles() const {
+        std::vector<uint32_t> result;
+        if (!indexSet.has_value())
+            return result;
+
+        for (size_t i = 0; i < indexSet->size(); ++i) {
+            const auto& subMesh = subMeshes.value()[i];
+            if (subMesh.topology != MeshTopology::Triangles_List)
+                continue;
+
+            for (auto index : indexSet.value()[i])
+                result.push_back(index + subMesh.baseVertex);
+        }
+        return result;
+    }
+
     void Mesh::MeshData::createIndicesAndSubMeshIfNotExist() {
         if (!indexSet.has_value())
             indexSet.emplace();
@@ -398,85 +544,157 @@ namespace Mix {
             mMeshData = std::make_shared<MeshData>();
     }
 
-    bool Mesh::SendToGPU(ArrayProxy<const std::byte, vk::DeviceSize> _vertexData,
-                         ArrayProxy<const std::byte, vk::DeviceSize> _indexData,
-                         std::shared_ptr<Vulkan::Buffer>& _outVertexBuffer,
-                         std::shared_ptr<Vulkan::Buffer>& _outIndexBuffer) {
-        const auto& vulkan = Graphics::Get()->getRenderApi();
-        const auto vkAllocator = vulkan.getAllocator();
-        const auto vkDevice = vulkan.getLogicalDevice();
-        Vulkan::CommandBufferHandle cmd(vulkan.getTransferCommandPool());
-
-        // upload vertex data
-        vk::DeviceSize byteSize = _vertexData.size();
-        const vk::BufferCopy vertexBufferCopy(0, 0, byteSize);
-
-        const auto vertexStaging = std::make_shared<Vulkan::Buffer>(vkAllocator,
-                                                                    vk::BufferUsageFlagBits::eTransferSrc,
-                                                                    vk::MemoryPropertyFlagBits::eHostVisible |
-                                                                    vk::MemoryPropertyFlagBits::eHostCoherent,
-                                                                    byteSize);
-
-        auto vertexBuffer = std::make_shared<Vulkan::Buffer>(vkAllocator,
-                                                             vk::BufferUsageFlagBits::eVertexBuffer |
-                                                             vk::BufferUsageFlagBits::eTransferDst,
-                                                             vk::MemoryPropertyFlagBits::eDeviceLocal,
-                                                             byteSize);
-
-        // Populate vertex buffer
-        std::byte* ptr = static_cast<std::byte*>(vertexStaging->rawPtr());
-        memcpy(ptr, _vertexData.data(), byteSize);
-
-        // upload index data if has
-        // use uint32_t when there are more than 65535 (max of uint16_t) vertices
-        if (!_indexData.empty()) {
-            byteSize = _indexData.size();
-            const vk::BufferCopy indexBufferCopy(0, 0, byteSize);
-
-            const auto indexStaging = std::make_shared<Vulkan::Buffer>(vkAllocator,
-                                                                       vk::BufferUsageFlagBits::eTransferSrc,
-                                                                       vk::MemoryPropertyFlagBits::eHostVisible |
-                                                                       vk::MemoryPropertyFlagBits::eHostCoherent,
-                                                                       byteSize);
-
-            auto indexBuffer = std::make_shared<Vulkan::Buffer>(vkAllocator,
-                                                                vk::BufferUsageFlagBits::eTransferDst |
-                                                                vk::BufferUsageFlagBits::eIndexBuffer,
-                                                                vk::MemoryPropertyFlagBits::eDeviceLocal,
-                                                                byteSize);
-
-      // populate index buffer
-            ptr = static_cast<std::byte*>(indexStaging->rawPtr());
-            memcpy(ptr, _indexData.data(), byteSize);
-
-
-            // send data to gpu
-            cmd.begin(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-
-            cmd.get().copyBuffer(vertexStaging->get(), vertexBuffer->get(), vertexBufferCopy);
-            cmd.get().copyBuffer(indexStaging->get(), indexBuffer->get(), indexBufferCopy);
-            cmd.end();
-
-            cmd.submit();
-            cmd.wait();
-
-            _outIndexBuffer = std::move(indexBuffer);
+    void Mesh::optimizeMeshData() {
+        if (!mMeshData->indexSet.has_value() || !mMeshData->subMeshes.has_value())
+            return;
+
+        auto& indexSet = mMeshData->indexSet.value();
+        auto& subMeshes = mMeshData->subMeshes.value();
+        const auto vertexCount = mMeshData->positions.size();
+
+        VertexCacheStatistics before;
+        VertexCacheStatistics after;
+        for (size_t i = 0; i < indexSet.size() && i < subMeshes.size(); ++i) {
+            if (subMeshes[i].topology != MeshTopology::Triangles_List || subMeshes[i].baseVertex >= vertexCount)
+                continue;
+
+            auto& indices = indexSet[i];
+            const ArrayProxy<const PositionType> positions(vertexCount - subMeshes[i].baseVertex, mMeshData->positions.data() + subMeshes[i].baseVertex);
+            if (std::any_of(indices.begin(), indices.end(), [&positions](uint32_t _index) { return _index >= positions.size(); }))
+                continue;
+
+            before += MeshUtils::AnalyzeVertexCache(indices, positions.size());
+            MeshUtils::OptimizeVertexCache(indices, positions.size());
+            MeshUtils::OptimizeOverdraw(indices, positions);
         }
-        else {
-            cmd.begin(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
 
-            cmd.get().copyBuffer(vertexStaging->get(), vertexBuffer->get(), vertexBufferCopy);
-            cmd.end();
+        // vertices may be shared by sub meshes, they are renumbered over the whole mesh
+        std::vector<uint32_t> indices;
+        for (size_t i = 0; i < indexSet.size() && i < subMeshes.size(); ++i) {
+            for (auto index : indexSet[i])
+                indices.push_back(subMeshes[i].baseVertex + index);
+        }
+        if (std::any_of(indices.begin(), indices.end(), [vertexCount](uint32_t _index) { return _index >= vertexCount; }))
+            return;
 
-            cmd.submit();
-            cmd.wait();
+        const auto remap = MeshUtils::OptimizeVertexFetch(indices, vertexCount);
+        MeshUtils::RemapVertices(mMeshData->positions, remap);
+        MeshUtils::RemapVertices(mMeshData->normals, remap);
+        MeshUtils::RemapVertices(mMeshData->tangents, remap);
+        MeshUtils::RemapVertices(mMeshData->uv0, remap);
+        MeshUtils::RemapVertices(mMeshData->uv1, remap);
+        MeshUtils::RemapVertices(mMeshData->colors, remap);
+
+        // base vertices move to the first vertex each sub mesh uses so indices stay positive
+        auto it = indices.begin();
+        for (size_t i = 0; i < indexSet.size() && i < subMeshes.size(); ++i) {
+            const auto end = it + indexSet[i].size();
+            const uint32_t baseVertex = it != end ? *std::min_element(it, end) : 0;
+            std::transform(it, end, indexSet[i].begin(), [baseVertex](uint32_t _index) { return _index - baseVertex; });
+            subMeshes[i].baseVertex = baseVertex;
+            it = end;
+
+            if (subMeshes[i].topology == MeshTopology::Triangles_List)
+                after += MeshUtils::AnalyzeVertexCache(indexSet[i], vertexCount - baseVertex);
         }
 
-        _outVertexBuffer = std::move(vertexBuffer);
+        if (before.triangleCount)
+            Log::Info("%1%: ACMR %2% -> %3%, ATVR %4% -> %5%", __FUNCTION__, before.acmr(), after.acmr(), before.atvr(), after.atvr());
+    }
+
+    float Mesh::CalculateUVDensity(const MeshData& _meshData) {
+        if (_meshData.uv0.size() != _meshData.positions.size() ||
+            !_meshData.indexSet.has_value() || !_meshData.subMeshes.has_value())
+            return 0.0f;
+
+        double surfaceArea = 0.0;
+        double uvArea = 0.0;
+
+        const auto& indexSet = _meshData.indexSet.value();
+        const auto& subMeshes = _meshData.subMeshes.value();
+        for (size_t i = 0; i < indexSet.size() && i < subMeshes.size(); ++i) {
+            if (subMeshes[i].topology != MeshTopology::Triangles_List)
+                continue;
+
+            const auto& indices = indexSet[i];
+            const auto baseVertex = subMeshes[i].baseVertex;
+            for (size_t j = 0; j + 2 < indices.size(); j += 3) {
+                const size_t a = baseVertex + indices[j];
+                const size_t b = baseVertex + indices[j + 1];
+                const size_t c = baseVertex + indices[j + 2];
+                if (a >= _meshData.positions.size() || b >= _meshData.positions.size() || c >= _meshData.positions.size())
+                    continue;
+
+                const auto& pa = _meshData.positions[a];
+                surfaceArea += 0.5 * (_meshData.positions[b] - pa).cross(_meshData.positions[c] - pa).length();
+
+                const auto& ua = _meshData.uv0[a];
+                const auto ub = _meshData.uv0[b] - ua;
+                const auto uc = _meshData.uv0[c] - ua;
+                uvArea += 0.5 * std::abs(ub.x * uc.y - ub.y * uc.x);
+            }
+        }
+
+        return surfaceArea > 0.0 ? static_cast<float>(std::sqrt(uvArea / surfaceArea)) : 0.0f;
+    }
+
+    bool Mesh::AllocateGeometry(const VertexDeclaration& _declaration,
+                                vk::DeviceSize _vertexByteSize,
+                                IndexFormat _format,
+                                vk::DeviceSize _indexByteSize,
+                                std::shared_ptr<Vulkan::GeometryRange>& _outVertexRange,
+                                std::shared_ptr<Vulkan::GeometryRange>& _outIndexRange) {
+        auto& pool = Graphics::Get()->getRenderApi().getGeometryPool();
+
+        const uint32_t stride = _declaration.getSizeOfStream(0);
+        if (stride == 0 || _vertexByteSize % stride != 0) {
+            Log::Error("%1%: Vertex data of %2% bytes doesn't match its layout", __FUNCTION__, _vertexByteSize);
+            return false;
+        }
+
+        const auto indexSize = _format == IndexFormat::UInt16 ? sizeof(Index16Type) : sizeof(Index32Type);
+        if (_indexByteSize % indexSize != 0) {
+            Log::Error("%1%: Index data of %2% bytes doesn't match its format", __FUNCTION__, _indexByteSize);
+            return false;
+        }
+
+        _outVertexRange = pool.allocateVertices(_declaration.hash(), stride, static_cast<uint32_t>(_vertexByteSize / stride));
+        _outIndexRange = pool.allocateIndices(_format == IndexFormat::UInt16 ? vk::IndexType::eUint16 : vk::IndexType::eUint32,
+                                              static_cast<uint32_t>(_indexByteSize / indexSize));
+        return _outVertexRange != nullptr;
+    }
+
+    bool Mesh::SendToGPU(const VertexDeclaration& _declaration,
+                         ArrayProxy<const std::byte, vk::DeviceSize> _vertexData,
+                         IndexFormat _format,
+                         ArrayProxy<const std::byte, vk::DeviceSize> _indexData,
+                         std::shared_ptr<Vulkan::GeometryRange>& _outVertexRange,
+                         std::shared_ptr<Vulkan::GeometryRange>& _outIndexRange) {
+        std::shared_ptr<Vulkan::GeometryRange> vertexRange;
+        std::shared_ptr<Vulkan::GeometryRange> indexRange;
+        if (!AllocateGeometry(_declaration, _vertexData.size(), _format, _indexData.size(), vertexRange, indexRange))
+            return false;
+
+        auto& uploader = Graphics::Get()->getRenderApi().getUploadManager();
+
+        // the copies are submitted with the uploads of the next frame
+        uploader.uploadBuffer(vertexRange->getBuffer(), _vertexData.data(), _vertexData.size(), vertexRange->byteOffset());
+        if (indexRange)
+            uploader.uploadBuffer(indexRange->getBuffer(), _indexData.data(), _indexData.size(), indexRange->byteOffset());
+
+        _outVertexRange = std::move(vertexRange);
+        _outIndexRange = std::move(indexRange);
         return true;
     }
 
     MeshTopology Mesh::getTopology(uint32_t _submesh) const {
         return mSubMeshes[_submesh].topology;
     }
+
+    const std::vector<Mesh::SubMesh>& Mesh::getSubMeshes() const {
+        // sub meshes set on a readable mesh only take effect on the next upload
+        if (mMeshData && mMeshData->subMeshes.has_value())
+            return mMeshData->subMeshes.value();
+        return mSubMeshes;
+    }
 }
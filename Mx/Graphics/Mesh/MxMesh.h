@@ -3,10 +3,13 @@
 #define MX_MESH_H_
 #include <memory>
 #include <vector>
+#include <functional>
 #include "../../Vulkan/Buffers/MxVkBuffer.h"
 #include "../../Resource/MxResourceBase.h"
 #include "../../Math/MxVector.h"
 #include "../../Math/MxColor.h"
+#include "../../Math/MxMatrix4.h"
+#include "../../Math/MxAABB.h"
 #include "../../Utils/MxArrayProxy.h"
 #include "../../Utils/MxFlags.h"
 #include "../../Definitions/MxCommonEnum.h"
@@ -15,6 +18,7 @@
 namespace Mix {
 	namespace Vulkan {
 		class ShaderBase;
+		class GeometryRange;
 	}
 
 	class Mesh :public ResourceBase {
@@ -37,6 +41,29 @@ namespace Mix {
 		using Index32Type = uint32_t;
 		using Index16Type = uint16_t;
 
+		/**
+		 * @brief Maps positions into the [-1, 1] range of 16 bit normalized positions.
+		 *        The scale is uniform so normal matrices derived from the model matrix stay valid.
+		 */
+		struct PositionQuantization {
+			Vector3f center;
+			float extent = 1.0f;
+
+			PositionQuantization() = default;
+
+			PositionQuantization(const Vector3f& _min, const Vector3f& _max);
+
+			Vector3f quantize(const Vector3f& _position) const { return (_position - center) / extent; }
+
+			Matrix4 dequantizeMatrix() const { return Matrix4::Translate(center) * Matrix4::Scale(Vector3f(extent)); }
+		};
+
+		/** @brief Triangles kept on the CPU for software occlusion culling, in the local space of the mesh */
+		struct Occluder {
+			std::vector<PositionType> positions;
+			std::vector<uint32_t> indices;
+		};
+
 		void setPositions(const std::vector<PositionType>& _vertices);
 		void setPositions(std::vector<PositionType>&& _vertices);
 		std::vector<PositionType>& getPositions();
@@ -71,10 +98,29 @@ namespace Mix {
 
         void recalculateTangents();
 
-		void uploadMeshData(bool _markNoLongerReadable);
+		/**
+		 * @param _optimize Reorder triangles and vertices of triangle lists for the vertex cache and overdraw first
+		 */
+		void uploadMeshData(bool _markNoLongerReadable, bool _optimize = false);
 
 		void markNoLongerReadable();
 
+		/**
+		 * @brief Keep a copy of the triangle lists, simplified to about @p _maxTriangles, as occluder.
+		 *        The copy outlives markNoLongerReadable(), the mesh has to be readable.
+		 */
+		void generateOccluder(size_t _maxTriangles = 512);
+
+		const std::shared_ptr<const Occluder>& getOccluder() const { return mOccluder; }
+
+		/** @brief Encodings of the vertex data uploaded by the next uploadMeshData() */
+		void setCompression(Flags<VertexCompression> _compression) { mCompression = _compression; }
+
+		Flags<VertexCompression> getCompression() const { return mCompression; }
+
+		/** @brief Transform from the uploaded vertex positions to local space, applied before the model matrix */
+		const Matrix4& getVertexTransform() const { return mVertexTransform; }
+
 		IndexFormat indexFormat() const { return mIndexFormat; }
 
 		bool isReadable() const { return mMeshData != nullptr; }
@@ -83,11 +129,26 @@ namespace Mix {
 
 		MeshTopology getTopology(uint32_t _submesh) const;
 
+		const std::vector<SubMesh>& getSubMeshes() const;
+
+		/** @brief Local space bounds of the positions, computed by uploadMeshData() */
+		const AABB& getBounds() const { return mBounds; }
+
+		void setBounds(const AABB& _bounds) { mBounds = _bounds; }
+
+		/**
+		 * @brief Square root of UV0 area per unit of surface area in local space,
+		 *        0 if unknown. Used to estimate the on-screen size of textures.
+		 */
+		float getUVDensity() const { return mUVDensity; }
+
 		void clear();
 
+		uint64_t memorySize() const override;
+
 		bool hasAttributes(Flags<VertexAttribute> _attributesMask) const { return mAttributes.isAllSet(_attributesMask); }
 
-		bool hasIndices() const { return mHasIndex; }
+		bool hasIndices() const { return mIndexRange != nullptr; }
 
 		Flags<VertexAttribute> getAttributesFlags() const { return mAttributes; }
 
@@ -110,6 +171,22 @@ namespace Mix {
 											Flags<VertexAttribute> _attributeFlags,
 											const std::vector<SubMesh>& _subMeshes);
 
+		/**
+		 * @brief Create a mesh whose data is written straight into staging memory, without a copy on the heap
+		 * @param _writeVertices Fills @p _vertexByteSize bytes of vertices interleaved in the order of VertexAttribute
+		 * @param _writeIndices Fills @p _indexByteSize bytes of indices of @p _format, unused when there are no indices
+		 */
+		static std::shared_ptr<Mesh> Create(vk::DeviceSize _vertexByteSize,
+											Flags<VertexAttribute> _attributeFlags,
+											const std::function<void(std::byte*)>& _writeVertices,
+											vk::DeviceSize _indexByteSize,
+											IndexFormat _format,
+											const std::function<void(std::byte*)>& _writeIndices,
+											const std::vector<SubMesh>& _subMeshes,
+											float _uvDensity = 0.0f,
+											Flags<VertexCompression> _compression = {},
+											const PositionQuantization& _quantization = {});
+
 	private:
 
 		struct MeshData {
@@ -124,29 +201,56 @@ namespace Mix {
 			std::optional<std::vector<SubMesh>> subMeshes;
 
 			void createIndicesAndSubMeshIfNotExist();
+
+			/** @brief Whether the indices of the only sub mesh can be used as they are */
+			bool isSingleTriangleList() const;
+
+			/** @brief Indices of all triangle list sub meshes, offset by their base vertex */
+			std::vector<uint32_t> getTriangles() const;
 		};
 
 		//----------- Private field ----------
 
 		Flags<VertexAttribute> mAttributes;
+		Flags<VertexCompression> mCompression;
+		Matrix4 mVertexTransform = Matrix4::Identity;
 		std::shared_ptr<VertexDeclaration> mVertexDeclaration;
-		std::shared_ptr<Vulkan::Buffer> mVertexBuffer;
-		bool mHasIndex = false;
+		// sub-allocated from the geometry pool, shared with the other meshes of the same layout
+		std::shared_ptr<Vulkan::GeometryRange> mVertexRange;
 		IndexFormat mIndexFormat = IndexFormat::UInt16;
-		std::shared_ptr<Vulkan::Buffer> mIndexBuffer;
+		std::shared_ptr<Vulkan::GeometryRange> mIndexRange;
 		std::shared_ptr<MeshData> mMeshData;
+		std::shared_ptr<const Occluder> mOccluder;
 		std::vector<SubMesh> mSubMeshes;
+		float mUVDensity = 0.0f;
+		AABB mBounds;
 
 		// ---------- Private method ----------
 
 		void createMeshDataIfNotExist();
 
+		void optimizeMeshData();
+
+		static float CalculateUVDensity(const MeshData& _meshData);
+
 		// ---------- static method ----------
 
-		static bool SendToGPU(ArrayProxy<const std::byte, vk::DeviceSize> _vertexData,
+		/**
+		 * @brief Allocate pool ranges for the vertices of @p _declaration and indices of @p _format, nullptr for a size of 0
+		 */
+		static bool AllocateGeometry(const VertexDeclaration& _declaration,
+									 vk::DeviceSize _vertexByteSize,
+									 IndexFormat _format,
+									 vk::DeviceSize _indexByteSize,
+									 std::shared_ptr<Vulkan::GeometryRange>& _outVertexRange,
+									 std::shared_ptr<Vulkan::GeometryRange>& _outIndexRange);
+
+		static bool SendToGPU(const VertexDeclaration& _declaration,
+							  ArrayProxy<const std::byte, vk::DeviceSize> _vertexData,
+							  IndexFormat _format,
 							  ArrayProxy<const std::byte, vk::DeviceSize> _indexData,
-							  std::shared_ptr<Vulkan::Buffer>& _outVertexBuffer,
-							  std::shared_ptr<Vulkan::Buffer>& _outIndexBuffer);
+							  std::shared_ptr<Vulkan::GeometryRange>& _outVertexRange,
+							  std::shared_ptr<Vulkan::GeometryRange>& _outIndexRange);
 	};
 
 }
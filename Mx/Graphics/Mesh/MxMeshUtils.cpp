@@ -1,25 +1,232 @@
 #include "MxMeshUtils.h"
+#include "../../Log/MxLog.h"
+#include "../../Utils/MxThreadPool.h"
+#include "../../Resource/MxResourceLoader.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <tuple>
+#include <unordered_map>
+#include <glm/gtc/packing.hpp>
 
 namespace Mix {
+    /**
+     * @brief Faces around every vertex, stored contiguously per vertex
+     */
     class VertexConnectivity {
     public:
 
-        VertexConnectivity(ArrayProxy<const uint32_t> _indices, size_t _vertexCount) {
-            faceOfVertex.resize(_vertexCount);
-            size_t faceCount = _indices.size() / 3;
+        VertexConnectivity(ArrayProxy<const uint32_t> _indices, size_t _vertexCount)
+            :mOffsets(_vertexCount + 1, 0) {
+            const size_t faceCount = _indices.size() / 3;
+            mFaces.resize(faceCount * 3);
 
-            for (size_t i = 0; i < faceCount; ++i) {
-                for (uint32_t j = 0; j < 3; ++j) {
-                    size_t vIdx = _indices[i * 3 + j];
-                    faceOfVertex[vIdx].push_back(i);
-                }
-            }
+            for (size_t i = 0; i < faceCount * 3; ++i)
+                ++mOffsets[_indices[i] + 1];
+            std::partial_sum(mOffsets.begin(), mOffsets.end(), mOffsets.begin());
+
+            std::vector<uint32_t> cursor(mOffsets.begin(), mOffsets.end() - 1);
+            for (size_t i = 0; i < faceCount * 3; ++i)
+                mFaces[cursor[_indices[i]]++] = static_cast<uint32_t>(i / 3);
         }
 
-        std::vector<std::vector<uint32_t>> faceOfVertex;
+        const uint32_t* facesBegin(size_t _vertex) const { return mFaces.data() + mOffsets[_vertex]; }
 
+        const uint32_t* facesEnd(size_t _vertex) const { return mFaces.data() + mOffsets[_vertex + 1]; }
+
+    private:
+        std::vector<uint32_t> mOffsets;
+        std::vector<uint32_t> mFaces;
     };
 
+    namespace {
+        // scoring of Tom Forsyth's linear-speed vertex cache optimisation
+        constexpr uint32_t MaxVertexCacheSize = 64;
+        constexpr float CacheDecayPower = 1.5f;
+        constexpr float LastTriangleScore = 0.75f;
+        constexpr float ValenceBoostScale = 2.0f;
+        constexpr float ValenceBoostPower = 0.5f;
+
+        float VertexScore(int _cachePosition, uint32_t _valence, uint32_t _cacheSize) {
+            // no triangle left to emit
+            if (_valence == 0)
+                return -1.0f;
+
+            float score = 0.0f;
+            if (_cachePosition >= 0) {
+                // the vertices of the last triangle get a fixed score so the next one doesn't simply reuse them
+                if (_cachePosition < 3)
+                    score = LastTriangleScore;
+                else
+                    score = std::pow(1.0f - static_cast<float>(_cachePosition - 3) / (_cacheSize - 3), CacheDecayPower);
+            }
+
+            // vertices with few triangles left are finished first
+            return score + ValenceBoostScale * std::pow(static_cast<float>(_valence), -ValenceBoostPower);
+        }
+
+        /**
+         * @brief FIFO cache simulation, the cache is cleared by reset()
+         */
+        class CacheSimulator {
+        public:
+            CacheSimulator(size_t _vertexCount, uint32_t _cacheSize)
+                :mTimestamps(_vertexCount, 0), mCacheSize(_cacheSize), mTime(_cacheSize + 1) {
+            }
+
+            /** @return Whether the vertex missed the cache */
+            bool access(uint32_t _index) {
+                if (mTime - mTimestamps[_index] <= mCacheSize)
+                    return false;
+                mTimestamps[_index] = mTime++;
+                return true;
+            }
+
+            uint32_t accessTriangle(const uint32_t* _triangle) {
+                return access(_triangle[0]) + access(_triangle[1]) + access(_triangle[2]);
+            }
+
+            void reset() { mTime += mCacheSize + 1; }
+
+        private:
+            std::vector<size_t> mTimestamps;
+            uint32_t mCacheSize;
+            size_t mTime;
+        };
+
+        // borders are kept much more strictly than the surface
+        constexpr double BorderWeight = 10.0;
+
+        /**
+         * @brief Sum of squared distances to a set of planes, each weighted by the area it came from
+         */
+        struct Quadric {
+            double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+            double b2 = 0.0, bc = 0.0, bd = 0.0;
+            double c2 = 0.0, cd = 0.0;
+            double d2 = 0.0;
+            double weight = 0.0;
+
+            Quadric() = default;
+
+            /** @param _normal Unit normal of the plane, which contains @p _point */
+            Quadric(const Vector3f& _normal, const Vector3f& _point, double _weight) {
+                const double a = _normal.x, b = _normal.y, c = _normal.z;
+                const double d = -_normal.dot(_point);
+                a2 = a * a * _weight; ab = a * b * _weight; ac = a * c * _weight; ad = a * d * _weight;
+                b2 = b * b * _weight; bc = b * c * _weight; bd = b * d * _weight;
+                c2 = c * c * _weight; cd = c * d * _weight;
+                d2 = d * d * _weight;
+                weight = _weight;
+            }
+
+            Quadric& operator+=(const Quadric& _other) {
+                a2 += _other.a2; ab += _other.ab; ac += _other.ac; ad += _other.ad;
+                b2 += _other.b2; bc += _other.bc; bd += _other.bd;
+                c2 += _other.c2; cd += _other.cd;
+                d2 += _other.d2;
+                weight += _other.weight;
+                return *this;
+            }
+
+            Quadric operator+(const Quadric& _other) const { return Quadric(*this) += _other; }
+
+            /** @brief Weighted mean of the squared distances of @p _point to the planes */
+            double error(const Vector3f& _point) const {
+                const double x = _point.x, y = _point.y, z = _point.z;
+                const double sum = a2 * x * x + b2 * y * y + c2 * z * z
+                    + 2.0 * (ab * x * y + ac * x * z + bc * y * z)
+                    + 2.0 * (ad * x + bd * y + cd * z)
+                    + d2;
+                return weight > 0.0 ? std::abs(sum) / weight : 0.0;
+            }
+        };
+
+        enum class VertexKind : uint8_t {
+            Manifold,
+            // on an edge used by a single triangle
+            Border,
+            // seam, non-manifold or otherwise fixed
+            Locked
+        };
+
+        uint64_t EdgeKey(uint32_t _a, uint32_t _b) {
+            return _a < _b ? (static_cast<uint64_t>(_a) << 32) | _b : (static_cast<uint64_t>(_b) << 32) | _a;
+        }
+
+        // items per parallel range of the normal and tangent passes
+        constexpr size_t FaceGrain = 16384;
+        constexpr size_t VertexGrain = 16384;
+
+        // loader jobs computing normals share the workers they run on, the pool is never oversubscribed
+        void ParallelFor(size_t _count, size_t _grain, const std::function<void(size_t, size_t)>& _func) {
+            ResourceLoader::Get()->getWorkers().parallelFor(_count, _grain, _func);
+        }
+
+        /**
+         * @brief Vectors stored as structure of arrays, the loops over them are vectorized by the compiler
+         */
+        struct Vector3Array {
+            std::vector<float> x;
+            std::vector<float> y;
+            std::vector<float> z;
+
+            explicit Vector3Array(size_t _size) :x(_size), y(_size), z(_size) {}
+
+            void set(size_t _i, const Vector3f& _vector) {
+                x[_i] = _vector.x;
+                y[_i] = _vector.y;
+                z[_i] = _vector.z;
+            }
+
+            Vector3f get(size_t _i) const { return Vector3f(x[_i], y[_i], z[_i]); }
+
+            /** @brief Normalize [_begin, _end), zero vectors stay zero */
+            void normalize(size_t _begin, size_t _end) {
+                float* px = x.data();
+                float* py = y.data();
+                float* pz = z.data();
+                for (size_t i = _begin; i < _end; ++i) {
+                    const float length = std::sqrt(px[i] * px[i] + py[i] * py[i] + pz[i] * pz[i]);
+                    const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+                    px[i] *= scale;
+                    py[i] *= scale;
+                    pz[i] *= scale;
+                }
+            }
+
+            /** @brief Sum the vectors of the faces around each vertex in [_begin, _end) into @p _result */
+            void gather(const VertexConnectivity& _connectivity, size_t _begin, size_t _end, Vector3Array& _result) const {
+                for (size_t v = _begin; v < _end; ++v) {
+                    float sx = 0.0f, sy = 0.0f, sz = 0.0f;
+                    for (auto face = _connectivity.facesBegin(v); face != _connectivity.facesEnd(v); ++face) {
+                        sx += x[*face];
+                        sy += y[*face];
+                        sz += z[*face];
+                    }
+                    _result.x[v] = sx;
+                    _result.y[v] = sy;
+                    _result.z[v] = sz;
+                }
+            }
+        };
+
+        /** @brief Unnormalized tangent and bitangent of a triangle, zero when its uvs are degenerate */
+        std::pair<Vector3f, Vector3f> FaceTangentAndBitangent(ArrayProxy<const Vector3f> _positions, ArrayProxy<const Vector2f> _uvs, const uint32_t* _triangle) {
+            const auto deltaPos1 = _positions[_triangle[1]] - _positions[_triangle[0]];
+            const auto deltaPos2 = _positions[_triangle[2]] - _positions[_triangle[0]];
+            const auto deltaUV1 = _uvs[_triangle[1]] - _uvs[_triangle[0]];
+            const auto deltaUV2 = _uvs[_triangle[2]] - _uvs[_triangle[0]];
+
+            const float determinant = deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y;
+            const float r = determinant != 0.0f ? 1.0f / determinant : 0.0f;
+            return { (deltaUV2.y * deltaPos1 - deltaUV1.y * deltaPos2) * r,
+                     (deltaUV1.x * deltaPos2 - deltaUV2.x * deltaPos1) * r };
+        }
+    }
+
     std::pair<std::vector<Vector3f>, std::vector<uint32_t>> MeshUtils::Sphere(float _radius, uint32_t _stacks, uint32_t _sectors) {
         assert(_radius > 0.0f && _stacks > 1 && _sectors > 2);
 
@@ -268,31 +475,29 @@ namespace Mix {
         if (!_normals)
             return;
 
-        auto vertexCount = _positions.size();
-        auto faceCount = _indices.size() / 3;
+        const size_t vertexCount = _positions.size();
+        const size_t faceCount = _indices.size() / 3;
 
-        std::vector<Vector3f> faceNormals;
-        faceNormals.reserve(faceCount);
-
-        // Calculate normals for each face
-        for (size_t i = 0; i < faceCount; ++i) {
-            uint32_t triangle[3] = { _indices[i * 3 + 0], _indices[i * 3 + 1], _indices[i * 3 + 2] };
-
-            Vector3f edgeA = _positions[triangle[1]] - _positions[triangle[0]];
-            Vector3f edgeB = _positions[triangle[2]] - _positions[triangle[0]];
-            faceNormals.push_back(edgeA.cross(edgeB).normalize());
-        }
-
-        VertexConnectivity connectivity(_indices, _positions.size());
-        for (size_t i = 0; i < _positions.size(); ++i) {
-
-            auto normal = Vector3f::Zero;
-            for (auto faceId : connectivity.faceOfVertex[i]) {
-                normal += faceNormals[faceId];
+        Vector3Array faceNormals(faceCount);
+        ParallelFor(faceCount, FaceGrain, [&](size_t _begin, size_t _end) {
+            for (size_t i = _begin; i < _end; ++i) {
+                const uint32_t* triangle = &_indices[i * 3];
+                const auto edgeA = _positions[triangle[1]] - _positions[triangle[0]];
+                const auto edgeB = _positions[triangle[2]] - _positions[triangle[0]];
+                faceNormals.set(i, edgeA.cross(edgeB));
             }
-
-            _normals[i] = normal.normalize();
-        }
+            faceNormals.normalize(_begin, _end);
+        });
+
+        // each vertex only reads its own faces, so vertex ranges are written without synchronization
+        const VertexConnectivity connectivity(_indices, vertexCount);
+        Vector3Array normals(vertexCount);
+        ParallelFor(vertexCount, VertexGrain, [&](size_t _begin, size_t _end) {
+            faceNormals.gather(connectivity, _begin, _end, normals);
+            normals.normalize(_begin, _end);
+            for (size_t v = _begin; v < _end; ++v)
+                _normals[v] = normals.get(v);
+        });
     }
 
     std::pair<std::vector<Vector3f>, std::vector<Vector3f>> MeshUtils::CalculateTangentsAndBitangents(ArrayProxy<const Vector3f> _positions, ArrayProxy<const uint32_t> _indices, ArrayProxy<const Vector3f> _normals, ArrayProxy<const Vector2f> _uvs) {
@@ -304,109 +509,704 @@ namespace Mix {
 
     void MeshUtils::CalculateTangentsAndBitangents(ArrayProxy<const Vector3f> _positions, ArrayProxy<const uint32_t> _indices, ArrayProxy<const Vector3f> _normals, ArrayProxy<const Vector2f> _uvs,
                                                    Vector3f* _tangents, Vector3f* _bitangents) {
-        size_t faceCount = _indices.size() / 3;
-        size_t vertexCount = _positions.size();
+        const size_t faceCount = _indices.size() / 3;
+        const size_t vertexCount = _positions.size();
+
+        Vector3Array faceTangents(faceCount);
+        Vector3Array faceBitangents(faceCount);
+        ParallelFor(faceCount, FaceGrain, [&](size_t _begin, size_t _end) {
+            for (size_t i = _begin; i < _end; ++i) {
+                const auto [tangent, bitangent] = FaceTangentAndBitangent(_positions, _uvs, &_indices[i * 3]);
+                faceTangents.set(i, tangent);
+                faceBitangents.set(i, bitangent);
+            }
+            faceTangents.normalize(_begin, _end);
+            faceBitangents.normalize(_begin, _end);
+        });
+
+        const VertexConnectivity connectivity(_indices, vertexCount);
+        Vector3Array tangents(vertexCount);
+        Vector3Array bitangents(vertexCount);
+        ParallelFor(vertexCount, VertexGrain, [&](size_t _begin, size_t _end) {
+            faceTangents.gather(connectivity, _begin, _end, tangents);
+            faceBitangents.gather(connectivity, _begin, _end, bitangents);
+            tangents.normalize(_begin, _end);
+            bitangents.normalize(_begin, _end);
+
+            // Orthonormalize
+            for (size_t v = _begin; v < _end; ++v) {
+                const auto& normal = _normals[v];
+                const float dot0 = normal.x * tangents.x[v] + normal.y * tangents.y[v] + normal.z * tangents.z[v];
+                tangents.x[v] -= dot0 * normal.x;
+                tangents.y[v] -= dot0 * normal.y;
+                tangents.z[v] -= dot0 * normal.z;
+            }
+            tangents.normalize(_begin, _end);
+
+            for (size_t v = _begin; v < _end; ++v) {
+                const auto& normal = _normals[v];
+                const float dot0 = normal.x * bitangents.x[v] + normal.y * bitangents.y[v] + normal.z * bitangents.z[v];
+                const float dot1 = tangents.x[v] * bitangents.x[v] + tangents.y[v] * bitangents.y[v] + tangents.z[v] * bitangents.z[v];
+                bitangents.x[v] -= dot0 * normal.x + dot1 * tangents.x[v];
+                bitangents.y[v] -= dot0 * normal.y + dot1 * tangents.y[v];
+                bitangents.z[v] -= dot0 * normal.z + dot1 * tangents.z[v];
+            }
+            bitangents.normalize(_begin, _end);
+
+            for (size_t v = _begin; v < _end; ++v) {
+                _tangents[v] = tangents.get(v);
+                _bitangents[v] = bitangents.get(v);
+            }
+        });
+    }
+
+    std::vector<Vector3f> MeshUtils::CalculateTangents(ArrayProxy<const Vector3f> _positions, ArrayProxy<const uint32_t> _indices, ArrayProxy<const Vector2f> _uvs) {
+        std::vector<Vector3f> tangents(_positions.size());
+        CalculateTangents(_positions, _indices, _uvs, tangents.data());
+        return tangents;
+    }
+
+    void MeshUtils::CalculateTangents(ArrayProxy<const Vector3f> _positions, ArrayProxy<const uint32_t> _indices, ArrayProxy<const Vector2f> _uvs, Vector3f* _tangents) {
+        const size_t faceCount = _indices.size() / 3;
+        const size_t vertexCount = _positions.size();
+
+        Vector3Array faceTangents(faceCount);
+        ParallelFor(faceCount, FaceGrain, [&](size_t _begin, size_t _end) {
+            for (size_t i = _begin; i < _end; ++i)
+                faceTangents.set(i, FaceTangentAndBitangent(_positions, _uvs, &_indices[i * 3]).first);
+            faceTangents.normalize(_begin, _end);
+        });
+
+        const VertexConnectivity connectivity(_indices, vertexCount);
+        Vector3Array tangents(vertexCount);
+        ParallelFor(vertexCount, VertexGrain, [&](size_t _begin, size_t _end) {
+            faceTangents.gather(connectivity, _begin, _end, tangents);
+            tangents.normalize(_begin, _end);
+            for (size_t v = _begin; v < _end; ++v)
+                _tangents[v] = tangents.get(v);
+        });
+    }
+
+    void MeshUtils::EncodeVertexElement(VertexElementType _type, const float* _values, std::byte* _dst) {
+        const auto normalize = [_values](uint32_t _i, float _max) {
+            return std::round(std::clamp(_values[_i], -1.0f, 1.0f) * _max);
+        };
+
+        switch (_type) {
+        case VertexElementType::Float1:
+        case VertexElementType::Float2:
+        case VertexElementType::Float3:
+        case VertexElementType::Float4:
+            std::memcpy(_dst, _values, VertexElement::GetElementTypeSize(_type));
+            break;
+        case VertexElementType::UByte4_Norm:
+        {
+            uint8_t result[4];
+            for (uint32_t i = 0; i < 4; ++i)
+                result[i] = static_cast<uint8_t>(std::round(std::clamp(_values[i], 0.0f, 1.0f) * 255.0f));
+            std::memcpy(_dst, result, sizeof(result));
+            break;
+        }
+        case VertexElementType::Byte4_Norm:
+        {
+            int8_t result[4];
+            for (uint32_t i = 0; i < 4; ++i)
+                result[i] = static_cast<int8_t>(normalize(i, 127.0f));
+            std::memcpy(_dst, result, sizeof(result));
+            break;
+        }
+        case VertexElementType::Short4_Norm:
+        {
+            int16_t result[4];
+            for (uint32_t i = 0; i < 4; ++i)
+                result[i] = static_cast<int16_t>(normalize(i, 32767.0f));
+            std::memcpy(_dst, result, sizeof(result));
+            break;
+        }
+        case VertexElementType::Half2:
+        {
+            const uint16_t result[2] = { glm::packHalf1x16(_values[0]), glm::packHalf1x16(_values[1]) };
+            std::memcpy(_dst, result, sizeof(result));
+            break;
+        }
+        default:
+            assert(false && "Unsupported vertex element type");
+        }
+    }
 
-        std::vector<Vector3f> faceTangents(faceCount);
-        std::vector<Vector3f> faceBitangents(faceCount);
-        for (size_t i = 0; i < faceCount; ++i) {
-            uint32_t triangle[3] = { _indices[i * 3 + 0], _indices[i * 3 + 1], _indices[i * 3 + 2] };
+    VertexCacheStatistics MeshUtils::AnalyzeVertexCache(ArrayProxy<const uint32_t> _indices, size_t _vertexCount, uint32_t _cacheSize) {
+        VertexCacheStatistics result;
+        result.triangleCount = _indices.size() / 3;
+
+        CacheSimulator cache(_vertexCount, _cacheSize);
+        std::vector<bool> used(_vertexCount, false);
+        for (size_t i = 0; i < result.triangleCount * 3; ++i) {
+            const auto index = _indices[i];
+            if (!used[index]) {
+                used[index] = true;
+                ++result.vertexCount;
+            }
+            if (cache.access(index))
+                ++result.transformedCount;
+        }
+        return result;
+    }
 
-            Vector3f p0 = _positions[triangle[0]];
-            Vector3f p1 = _positions[triangle[1]];
-            Vector3f p2 = _positions[triangle[2]];
+    void MeshUtils::OptimizeVertexCache(ArrayProxy<uint32_t> _indices, size_t _vertexCount, uint32_t _cacheSize) {
+        constexpr auto invalid = std::numeric_limits<size_t>::max();
 
-            Vector2f uv0 = _uvs[triangle[0]];
-            Vector2f uv1 = _uvs[triangle[1]];
-            Vector2f uv2 = _uvs[triangle[2]];
+        const size_t triangleCount = _indices.size() / 3;
+        if (triangleCount < 2)
+            return;
 
-            auto deltaPos1 = p1 - p0;
-            auto deltaPos2 = p2 - p0;
+        const uint32_t cacheSize = std::clamp<uint32_t>(_cacheSize, 4, MaxVertexCacheSize);
 
-            auto deltaUV1 = uv1 - uv0;
-            auto deltaUV2 = uv2 - uv0;
+        // triangles left to emit of each vertex, emitted ones are swapped behind the range of the vertex
+        std::vector<uint32_t> valence(_vertexCount, 0);
+        for (size_t i = 0; i < triangleCount * 3; ++i)
+            ++valence[_indices[i]];
 
-            float r = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-            faceTangents[i] = (deltaUV2.y * deltaPos1 - deltaUV1.y * deltaPos2) * r;
-            faceBitangents[i] = (deltaUV1.x * deltaPos2 - deltaUV2.x * deltaPos1) * r;
+        std::vector<uint32_t> offsets(_vertexCount + 1, 0);
+        std::partial_sum(valence.begin(), valence.end(), offsets.begin() + 1);
 
-            faceTangents[i] = faceTangents[i].normalize();
-            faceBitangents[i] = faceBitangents[i].normalize();
+        std::vector<uint32_t> adjacency(triangleCount * 3);
+        {
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < triangleCount * 3; ++i)
+                adjacency[fill[_indices[i]]++] = static_cast<uint32_t>(i / 3);
         }
 
-        VertexConnectivity connectivity(_indices, _positions.size());
-        for (uint32_t i = 0; i < vertexCount; ++i) {
-            auto& faces = connectivity.faceOfVertex[i];
+        std::vector<int> cachePositions(_vertexCount, -1);
+        std::vector<float> vertexScores(_vertexCount);
+        for (size_t v = 0; v < _vertexCount; ++v)
+            vertexScores[v] = VertexScore(-1, valence[v], cacheSize);
+
+        const auto triangleScore = [&](size_t _triangle) {
+            return vertexScores[_indices[_triangle * 3]] + vertexScores[_indices[_triangle * 3 + 1]] + vertexScores[_indices[_triangle * 3 + 2]];
+        };
+
+        std::vector<float> triangleScores(triangleCount);
+        for (size_t t = 0; t < triangleCount; ++t)
+            triangleScores[t] = triangleScore(t);
+
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> result;
+        result.reserve(triangleCount * 3);
+
+        uint32_t cache[MaxVertexCacheSize + 3];
+        uint32_t newCache[MaxVertexCacheSize + 3];
+        uint32_t cacheCount = 0;
+
+        size_t best = std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin();
+        size_t cursor = 0;
+
+        while (true) {
+            if (best == invalid) {
+                // nothing in the cache has triangles left, go on with the first remaining triangle
+                while (cursor < triangleCount && emitted[cursor])
+                    ++cursor;
+                if (cursor == triangleCount)
+                    break;
+                best = cursor;
+            }
+
+            emitted[best] = true;
+            const uint32_t triangle[3] = { _indices[best * 3], _indices[best * 3 + 1], _indices[best * 3 + 2] };
+
+            uint32_t newCount = 0;
+            for (auto v : triangle) {
+                result.push_back(v);
 
-            auto tangent = Vector3f::Zero;
-            auto bitangent = Vector3f::Zero;
+                const auto begin = adjacency.begin() + offsets[v];
+                const auto end = begin + valence[v];
+                std::iter_swap(std::find(begin, end, static_cast<uint32_t>(best)), end - 1);
+                --valence[v];
 
-            for (uint32_t j = 0; j < faces.size(); ++j) {
-                uint32_t faceIdx = faces[j];
-                tangent += faceTangents[faceIdx];
-                bitangent += faceBitangents[faceIdx];
+                // the vertices of the triangle move to the front of the cache
+                if (std::find(newCache, newCache + newCount, v) == newCache + newCount)
+                    newCache[newCount++] = v;
             }
 
-            tangent = tangent.normalize();
-            bitangent = bitangent.normalize();
+            for (uint32_t i = 0; i < cacheCount; ++i) {
+                if (std::find(triangle, triangle + 3, cache[i]) == triangle + 3)
+                    newCache[newCount++] = cache[i];
+            }
 
-            // Orthonormalize
-            auto& normal = _normals[i];
-            float dot0 = normal.dot(tangent);
-            _tangents[i] = (tangent - dot0 * normal).normalize();
+            // vertices pushed out of the cache are rescored as well
+            for (uint32_t i = 0; i < newCount; ++i) {
+                const auto v = newCache[i];
+                cachePositions[v] = i < cacheSize ? static_cast<int>(i) : -1;
+                vertexScores[v] = VertexScore(cachePositions[v], valence[v], cacheSize);
+            }
 
-            float dot1 = _tangents[i].dot(bitangent);
-            dot0 = normal.dot(bitangent);
-            _bitangents[i] = (bitangent - (dot0 * normal + dot1 * _tangents[i])).normalize();
+            best = invalid;
+            float bestScore = -std::numeric_limits<float>::max();
+            for (uint32_t i = 0; i < newCount; ++i) {
+                const auto v = newCache[i];
+                for (uint32_t j = offsets[v], end = offsets[v] + valence[v]; j < end; ++j) {
+                    const auto t = adjacency[j];
+                    triangleScores[t] = triangleScore(t);
+                    if (triangleScores[t] > bestScore) {
+                        bestScore = triangleScores[t];
+                        best = t;
+                    }
+                }
+            }
+
+            cacheCount = std::min(newCount, cacheSize);
+            std::copy(newCache, newCache + cacheCount, cache);
         }
+
+        std::copy(result.begin(), result.end(), _indices.begin());
     }
 
-    std::vector<Vector3f> MeshUtils::CalculateTangents(ArrayProxy<const Vector3f> _positions, ArrayProxy<const uint32_t> _indices, ArrayProxy<const Vector2f> _uvs) {
-        std::vector<Vector3f> tangents(_positions.size());
-        CalculateTangents(_positions, _indices, _uvs, tangents.data());
-        return tangents;
+    void MeshUtils::OptimizeOverdraw(ArrayProxy<uint32_t> _indices, ArrayProxy<const Vector3f> _positions, float _threshold) {
+        // same as the cache size of AnalyzeVertexCache()
+        constexpr uint32_t cacheSize = 16;
+
+        const size_t triangleCount = _indices.size() / 3;
+        if (triangleCount < 2)
+            return;
+
+        CacheSimulator cache(_positions.size(), cacheSize);
+
+        // a triangle missing all its vertices is where the cache optimisation jumped to another part of the mesh
+        std::vector<size_t> hardBoundaries = { 0 };
+        cache.accessTriangle(&_indices[0]);
+        for (size_t t = 1; t < triangleCount; ++t) {
+            if (cache.accessTriangle(&_indices[t * 3]) == 3)
+                hardBoundaries.push_back(t);
+        }
+        hardBoundaries.push_back(triangleCount);
+
+        // split further wherever the ACMR so far is within the threshold of the ACMR of the whole part
+        std::vector<size_t> clusters;
+        for (size_t h = 0; h + 1 < hardBoundaries.size(); ++h) {
+            const auto begin = hardBoundaries[h];
+            const auto end = hardBoundaries[h + 1];
+
+            cache.reset();
+            size_t misses = 0;
+            for (size_t t = begin; t < end; ++t)
+                misses += cache.accessTriangle(&_indices[t * 3]);
+            const float limit = static_cast<float>(misses) / (end - begin) * _threshold;
+
+            cache.reset();
+            size_t start = begin;
+            misses = 0;
+            for (size_t t = begin; t < end; ++t) {
+                misses += cache.accessTriangle(&_indices[t * 3]);
+                if (t + 1 < end && misses <= limit * (t + 1 - start)) {
+                    clusters.push_back(start);
+                    start = t + 1;
+                    misses = 0;
+                    cache.reset();
+                }
+            }
+            clusters.push_back(start);
+        }
+        clusters.push_back(triangleCount);
+
+        const auto triangleData = [&](size_t _triangle, Vector3f& _centroid, Vector3f& _normal) {
+            const auto& p0 = _positions[_indices[_triangle * 3]];
+            const auto& p1 = _positions[_indices[_triangle * 3 + 1]];
+            const auto& p2 = _positions[_indices[_triangle * 3 + 2]];
+            _centroid = (p0 + p1 + p2) / 3.0f;
+            // length is twice the area
+            _normal = (p1 - p0).cross(p2 - p0);
+        };
+
+        auto meshCentroid = Vector3f::Zero;
+        float meshArea = 0.0f;
+        for (size_t t = 0; t < triangleCount; ++t) {
+            Vector3f centroid, normal;
+            triangleData(t, centroid, normal);
+            const auto area = normal.length();
+            meshCentroid += centroid * area;
+            meshArea += area;
+        }
+        if (meshArea <= 0.0f)
+            return;
+        meshCentroid = meshCentroid / meshArea;
+
+        // clusters facing away from the center occlude the others, they are drawn first
+        const size_t clusterCount = clusters.size() - 1;
+        std::vector<float> keys(clusterCount);
+        float orientation = 0.0f;
+        for (size_t c = 0; c < clusterCount; ++c) {
+            auto clusterCentroid = Vector3f::Zero;
+            auto clusterNormal = Vector3f::Zero;
+            float clusterArea = 0.0f;
+            for (size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+                Vector3f centroid, normal;
+                triangleData(t, centroid, normal);
+                const auto area = normal.length();
+                clusterCentroid += centroid * area;
+                clusterNormal += normal;
+                clusterArea += area;
+                orientation += (centroid - meshCentroid).dot(normal);
+            }
+
+            if (clusterArea > 0.0f)
+                clusterCentroid = clusterCentroid / clusterArea;
+            const auto normalLength = clusterNormal.length();
+            keys[c] = normalLength > 0.0f ? (clusterCentroid - meshCentroid).dot(clusterNormal) / normalLength : 0.0f;
+        }
+
+        // the winding isn't known, the sign of the volume tells whether the normals point outwards
+        if (orientation < 0.0f) {
+            for (auto& key : keys)
+                key = -key;
+        }
+
+        std::vector<size_t> order(clusterCount);
+        std::iota(order.begin(), order.end(), size_t(0));
+        std::stable_sort(order.begin(), order.end(), [&keys](size_t _a, size_t _b) { return keys[_a] > keys[_b]; });
+
+        std::vector<uint32_t> result;
+        result.reserve(triangleCount * 3);
+        for (auto c : order)
+            result.insert(result.end(), _indices.data() + clusters[c] * 3, _indices.data() + clusters[c + 1] * 3);
+
+        std::copy(result.begin(), result.end(), _indices.begin());
     }
 
-    void MeshUtils::CalculateTangents(ArrayProxy<const Vector3f> _positions, ArrayProxy<const uint32_t> _indices, ArrayProxy<const Vector2f> _uvs, Vector3f* _tangents) {
-        size_t faceCount = _indices.size() / 3;
-        size_t vertexCount = _positions.size();
+    std::vector<uint32_t> MeshUtils::OptimizeVertexFetch(ArrayProxy<uint32_t> _indices, size_t _vertexCount) {
+        constexpr auto unused = std::numeric_limits<uint32_t>::max();
 
-        std::vector<Vector3f> faceTangents(faceCount);
-        for (size_t i = 0; i < faceCount; ++i) {
-            uint32_t triangle[3] = { _indices[i * 3 + 0], _indices[i * 3 + 1], _indices[i * 3 + 2] };
+        std::vector<uint32_t> remap(_vertexCount, unused);
+        uint32_t next = 0;
+        for (auto& index : _indices) {
+            if (remap[index] == unused)
+                remap[index] = next++;
+            index = remap[index];
+        }
 
-            Vector3f p0 = _positions[triangle[0]];
-            Vector3f p1 = _positions[triangle[1]];
-            Vector3f p2 = _positions[triangle[2]];
+        for (auto& index : remap) {
+            if (index == unused)
+                index = next++;
+        }
+        return remap;
+    }
 
-            Vector2f uv0 = _uvs[triangle[0]];
-            Vector2f uv1 = _uvs[triangle[1]];
-            Vector2f uv2 = _uvs[triangle[2]];
+    std::vector<uint32_t> MeshUtils::Simplify(ArrayProxy<const uint32_t> _indices,
+                                              ArrayProxy<const Vector3f> _positions,
+                                              size_t _targetIndexCount,
+                                              float _targetError,
+                                              float* _resultError) {
+        std::vector<uint32_t> result(_indices.begin(), _indices.end());
+        if (_resultError)
+            *_resultError = 0.0f;
+
+        const size_t vertexCount = _positions.size();
+        if (result.size() % 3 != 0 || result.size() <= _targetIndexCount)
+            return result;
+        if (std::any_of(result.begin(), result.end(), [vertexCount](uint32_t _index) { return _index >= vertexCount; }))
+            return result;
+
+        // errors are measured relative to the size of the mesh
+        std::vector<bool> referenced(vertexCount, false);
+        auto min = Vector3f(std::numeric_limits<float>::max());
+        auto max = Vector3f(std::numeric_limits<float>::lowest());
+        for (auto index : result) {
+            referenced[index] = true;
+            for (uint32_t c = 0; c < 3; ++c) {
+                min.linear[c] = std::min(min.linear[c], _positions[index].linear[c]);
+                max.linear[c] = std::max(max.linear[c], _positions[index].linear[c]);
+            }
+        }
+        const float extent = std::max({ max.x - min.x, max.y - min.y, max.z - min.z });
+        const float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+        std::vector<Vector3f> positions(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v)
+            positions[v] = (_positions[v] - min) * scale;
+
+        // vertices split for attribute seams share the id of their first copy
+        std::vector<uint32_t> positionIds(vertexCount);
+        std::vector<uint32_t> copies(vertexCount, 0);
+        {
+            std::vector<uint32_t> order(vertexCount);
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&](uint32_t _a, uint32_t _b) {
+                const auto& a = _positions[_a];
+                const auto& b = _positions[_b];
+                return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+            });
+
+            for (size_t i = 0; i < order.size(); ++i) {
+                const bool same = i > 0 && _positions[order[i]] == _positions[order[i - 1]];
+                positionIds[order[i]] = same ? positionIds[order[i - 1]] : order[i];
+                if (referenced[order[i]])
+                    ++copies[positionIds[order[i]]];
+            }
+        }
+
+        std::unordered_map<uint64_t, uint32_t> edgeUses;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (uint32_t k = 0; k < 3; ++k) {
+                const auto a = positionIds[result[i + k]];
+                const auto b = positionIds[result[i + (k + 1) % 3]];
+                if (a != b)
+                    ++edgeUses[EdgeKey(a, b)];
+            }
+        }
+
+        const auto isBorderEdge = [&](uint32_t _a, uint32_t _b) {
+            const auto it = edgeUses.find(EdgeKey(positionIds[_a], positionIds[_b]));
+            return it != edgeUses.end() && it->second == 1;
+        };
+
+        // collapsing a seam vertex would tear the attributes of one side of the seam
+        std::vector<VertexKind> kinds(vertexCount, VertexKind::Manifold);
+        for (size_t v = 0; v < vertexCount; ++v) {
+            if (copies[positionIds[v]] > 1)
+                kinds[v] = VertexKind::Locked;
+        }
+
+        std::vector<Quadric> quadrics(vertexCount);
+        for (size_t i = 0; i < result.size(); i += 3) {
+            const uint32_t triangle[3] = { result[i], result[i + 1], result[i + 2] };
+            auto normal = (positions[triangle[1]] - positions[triangle[0]]).cross(positions[triangle[2]] - positions[triangle[0]]);
+            const float area = normal.length();
+
+            Vector3f unitNormal;
+            if (area > 0.0f) {
+                unitNormal = normal / area;
+                const Quadric quadric(unitNormal, positions[triangle[0]], area * 0.5);
+                for (auto index : triangle)
+                    quadrics[index] += quadric;
+            }
+
+            for (uint32_t k = 0; k < 3; ++k) {
+                const auto a = triangle[k];
+                const auto b = triangle[(k + 1) % 3];
+                if (positionIds[a] == positionIds[b])
+                    continue;
+
+                const auto uses = edgeUses[EdgeKey(positionIds[a], positionIds[b])];
+                if (uses > 2) {
+                    kinds[a] = kinds[b] = VertexKind::Locked;
+                    continue;
+                }
+                if (uses != 1)
+                    continue;
+
+                kinds[a] = std::max(kinds[a], VertexKind::Border);
+                kinds[b] = std::max(kinds[b], VertexKind::Border);
+
+                // a plane through the border, perpendicular to the triangle
+                const auto edge = positions[b] - positions[a];
+                auto borderNormal = edge.cross(unitNormal);
+                const float length = borderNormal.length();
+                if (area > 0.0f && length > 0.0f) {
+                    const Quadric quadric(borderNormal / length, positions[a], edge.dot(edge) * BorderWeight);
+                    quadrics[a] += quadric;
+                    quadrics[b] += quadric;
+                }
+            }
+        }
+
+        struct Collapse {
+            uint32_t from;
+            uint32_t to;
+            double error;
+        };
+
+        const double maxError = static_cast<double>(_targetError) * _targetError;
+        double resultError = 0.0;
+
+        std::vector<Collapse> collapses;
+        std::vector<uint32_t> collapseTarget(vertexCount);
+        std::vector<bool> touched(vertexCount);
+        // triangles around each vertex, rebuilt every pass
+        std::vector<uint32_t> firstTriangle(vertexCount + 1);
+        std::vector<uint32_t> adjacency;
+
+        const auto flips = [&](uint32_t _from, uint32_t _to) {
+            for (uint32_t t = firstTriangle[_from]; t < firstTriangle[_from + 1]; ++t) {
+                const uint32_t* triangle = &result[adjacency[t] * 3];
+                if (triangle[0] == _to || triangle[1] == _to || triangle[2] == _to)
+                    continue;
+
+                Vector3f corners[3] = { positions[triangle[0]], positions[triangle[1]], positions[triangle[2]] };
+                const auto before = (corners[1] - corners[0]).cross(corners[2] - corners[0]);
+                for (uint32_t k = 0; k < 3; ++k) {
+                    if (triangle[k] == _from)
+                        corners[k] = positions[_to];
+                }
+                const auto after = (corners[1] - corners[0]).cross(corners[2] - corners[0]);
+                // large rotations are rejected too, several of them in a row could still fold the surface
+                if (before.dot(after) <= 0.25f * before.length() * after.length())
+                    return true;
+            }
+            return false;
+        };
+
+        // independent collapses are applied in passes, each vertex takes part in at most one collapse per pass
+        while (result.size() > _targetIndexCount) {
+            std::fill(firstTriangle.begin(), firstTriangle.end(), 0);
+            for (auto index : result)
+                ++firstTriangle[index + 1];
+            std::partial_sum(firstTriangle.begin(), firstTriangle.end(), firstTriangle.begin());
+
+            adjacency.resize(result.size());
+            {
+                std::vector<uint32_t> cursor(firstTriangle.begin(), firstTriangle.end() - 1);
+                for (size_t i = 0; i < result.size(); ++i)
+                    adjacency[cursor[result[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+
+            collapses.clear();
+            for (size_t i = 0; i < result.size(); i += 3) {
+                for (uint32_t k = 0; k < 3; ++k) {
+                    const auto a = result[i + k];
+                    const auto b = result[i + (k + 1) % 3];
+                    for (auto [from, to] : { std::make_pair(a, b), std::make_pair(b, a) }) {
+                        if (positionIds[from] == positionIds[to] || kinds[from] == VertexKind::Locked)
+                            continue;
+                        if (kinds[from] == VertexKind::Border && !isBorderEdge(from, to))
+                            continue;
+
+                        const double error = (quadrics[from] + quadrics[to]).error(positions[to]);
+                        if (error <= maxError)
+                            collapses.push_back({ from, to, error });
+                    }
+                }
+            }
+
+            // every edge is seen from both of its triangles
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& _a, const Collapse& _b) {
+                return std::tie(_a.error, _a.from, _a.to) < std::tie(_b.error, _b.from, _b.to);
+            });
+            collapses.erase(std::unique(collapses.begin(), collapses.end(), [](const Collapse& _a, const Collapse& _b) {
+                return _a.from == _b.from && _a.to == _b.to;
+            }), collapses.end());
+
+            std::iota(collapseTarget.begin(), collapseTarget.end(), 0);
+            std::fill(touched.begin(), touched.end(), false);
+
+            const size_t trianglesToRemove = (result.size() - _targetIndexCount) / 3;
+            size_t removed = 0;
+            bool collapsed = false;
+
+            for (auto& collapse : collapses) {
+                if (removed >= trianglesToRemove)
+                    break;
+                if (touched[collapse.from] || touched[collapse.to] || flips(collapse.from, collapse.to))
+                    continue;
+
+                // the whole neighbourhood is frozen so the flip test of later collapses stays valid
+                for (uint32_t t = firstTriangle[collapse.from]; t < firstTriangle[collapse.from + 1]; ++t) {
+                    const uint32_t* triangle = &result[adjacency[t] * 3];
+                    if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                        ++removed;
+                    for (uint32_t k = 0; k < 3; ++k)
+                        touched[triangle[k]] = true;
+                }
+
+                collapseTarget[collapse.from] = collapse.to;
+                quadrics[collapse.to] += quadrics[collapse.from];
+                resultError = std::max(resultError, collapse.error);
+                collapsed = true;
+            }
 
-            auto deltaPos1 = p1 - p0;
-            auto deltaPos2 = p2 - p0;
+            if (!collapsed)
+                break;
 
-            auto deltaUV1 = uv1 - uv0;
-            auto deltaUV2 = uv2 - uv0;
+            size_t count = 0;
+            for (size_t i = 0; i < result.size(); i += 3) {
+                const auto a = collapseTarget[result[i]];
+                const auto b = collapseTarget[result[i + 1]];
+                const auto c = collapseTarget[result[i + 2]];
+                if (a == b || b == c || a == c)
+                    continue;
 
-            float r = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-            faceTangents[i] = (deltaUV2.y * deltaPos1 - deltaUV1.y * deltaPos2) * r;
+                result[count++] = a;
+                result[count++] = b;
+                result[count++] = c;
+            }
+            result.resize(count);
+        }
 
-            faceTangents[i] = faceTangents[i].normalize();
+        if (_resultError)
+            *_resultError = static_cast<float>(std::sqrt(resultError));
+        return result;
+    }
+
+    std::vector<std::shared_ptr<Mesh>> MeshUtils::GenerateLODChain(Mesh& _mesh, uint32_t _lodCount, float _reduction, float _maxError) {
+        std::vector<std::shared_ptr<Mesh>> result;
+        if (!_mesh.isReadable()) {
+            Log::Warning("%1%: The mesh is not readable", __FUNCTION__);
+            return result;
         }
 
-        VertexConnectivity connectivity(_indices, _positions.size());
-        for (uint32_t i = 0; i < vertexCount; ++i) {
-            auto& faces = connectivity.faceOfVertex[i];
+        auto& positions = _mesh.getPositions();
+        const auto subMeshes = _mesh.getSubMeshes();
+
+        // indices of each level refer to the whole vertex array of _mesh
+        std::vector<std::vector<uint32_t>> indexSet(subMeshes.size());
+        size_t indexCount = 0;
+        for (uint32_t i = 0; i < subMeshes.size(); ++i) {
+            _mesh.getIndices(indexSet[i], i);
+            for (auto& index : indexSet[i])
+                index += subMeshes[i].baseVertex;
+            indexCount += indexSet[i].size();
+        }
 
-            auto tangent = Vector3f::Zero;
-            auto bitangent = Vector3f::Zero;
+        for (uint32_t lod = 0; lod < _lodCount; ++lod) {
+            size_t simplifiedCount = 0;
+            for (uint32_t i = 0; i < subMeshes.size(); ++i) {
+                if (subMeshes[i].topology == MeshTopology::Triangles_List) {
+                    const size_t target = static_cast<size_t>(indexSet[i].size() * _reduction) / 3 * 3;
+                    indexSet[i] = Simplify(indexSet[i], positions, target, _maxError);
+                }
+                simplifiedCount += indexSet[i].size();
+            }
+
+            // a level that barely shrinks isn't worth its memory
+            if (simplifiedCount == 0 || simplifiedCount > indexCount - static_cast<size_t>(indexCount * (1.0f - _reduction) * 0.5f))
+                break;
+            indexCount = simplifiedCount;
+
+            // only the vertices still referenced are kept, in the order the indices use them
+            std::vector<std::vector<uint32_t>> lodIndices = indexSet;
+            std::vector<uint32_t> merged;
+            merged.reserve(indexCount);
+            for (uint32_t i = 0; i < subMeshes.size(); ++i) {
+                if (subMeshes[i].topology == MeshTopology::Triangles_List)
+                    OptimizeVertexCache(lodIndices[i], positions.size());
+                merged.insert(merged.end(), lodIndices[i].begin(), lodIndices[i].end());
+            }
 
-            for (uint32_t j = 0; j < faces.size(); ++j) {
-                tangent += faceTangents[faces[j]];
+            const auto remap = OptimizeVertexFetch(merged, positions.size());
+            const size_t usedCount = merged.empty() ? 0 : *std::max_element(merged.begin(), merged.end()) + 1;
+
+            const auto compact = [&remap, usedCount](auto _data) {
+                RemapVertices(_data, remap);
+                _data.resize(std::min(_data.size(), usedCount));
+                return _data;
+            };
+
+            auto lodMesh = std::make_shared<Mesh>();
+            lodMesh->setPositions(compact(positions));
+            lodMesh->setNormals(compact(_mesh.getNormals()));
+            lodMesh->setTangents(compact(_mesh.getTangents()));
+            lodMesh->setUVs(UVChannel::UV0, compact(_mesh.getUVs(UVChannel::UV0)));
+            lodMesh->setUVs(UVChannel::UV1, compact(_mesh.getUVs(UVChannel::UV1)));
+            lodMesh->setColors(compact(_mesh.getColors()));
+
+            size_t offset = 0;
+            for (uint32_t i = 0; i < subMeshes.size(); ++i) {
+                std::vector<uint32_t> indices(merged.begin() + offset, merged.begin() + offset + lodIndices[i].size());
+                offset += indices.size();
+                lodMesh->setIndices(std::move(indices), subMeshes[i].topology, i);
             }
 
-            _tangents[i] = tangent.normalize();
+            lodMesh->setCompression(_mesh.getCompression());
+            lodMesh->uploadMeshData(true);
+            result.push_back(std::move(lodMesh));
         }
+        return result;
     }
 }
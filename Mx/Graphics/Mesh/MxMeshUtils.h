@@ -7,6 +7,30 @@
 #include "MxMesh.h"
 
 namespace Mix {
+    /**
+     * @brief Post-transform vertex cache efficiency of an index buffer, simulated with a FIFO cache
+     */
+    struct VertexCacheStatistics {
+        size_t triangleCount = 0;
+        // distinct vertices referenced by the indices
+        size_t vertexCount = 0;
+        // vertices the vertex shader runs for, i.e. cache misses
+        size_t transformedCount = 0;
+
+        /** @brief Average cache miss ratio, transformed vertices per triangle, 0.5 at best */
+        float acmr() const { return triangleCount ? static_cast<float>(transformedCount) / triangleCount : 0.0f; }
+
+        /** @brief Average transformed vertex ratio, 1.0 at best */
+        float atvr() const { return vertexCount ? static_cast<float>(transformedCount) / vertexCount : 0.0f; }
+
+        VertexCacheStatistics& operator+=(const VertexCacheStatistics& _other) {
+            triangleCount += _other.triangleCount;
+            vertexCount += _other.vertexCount;
+            transformedCount += _other.transformedCount;
+            return *this;
+        }
+    };
+
     class MeshUtils :GeneralBase::StaticBase {
     public:
 
@@ -31,6 +55,72 @@ namespace Mix {
 
         static void CalculateTangents(ArrayProxy<const Vector3f> _positions, ArrayProxy<const uint32_t> _indices, ArrayProxy<const Vector2f> _uvs,
                                       Vector3f* _tangents);
+
+        /**
+         * @brief Write one vertex attribute in the format of @p _type
+         * @param _values Four components, the ones @p _type doesn't have are ignored.
+         *        Normalized formats expect values in their range, they are clamped.
+         */
+        static void EncodeVertexElement(VertexElementType _type, const float* _values, std::byte* _dst);
+
+        /**
+         * @param _indices Triangle list
+         * @param _cacheSize Entries of the simulated FIFO cache, 16 is close to most hardware
+         */
+        static VertexCacheStatistics AnalyzeVertexCache(ArrayProxy<const uint32_t> _indices, size_t _vertexCount, uint32_t _cacheSize = 16);
+
+        /**
+         * @brief Reorder the triangles of a triangle list for post-transform vertex cache locality,
+         *        using Tom Forsyth's linear-speed vertex cache optimisation
+         */
+        static void OptimizeVertexCache(ArrayProxy<uint32_t> _indices, size_t _vertexCount, uint32_t _cacheSize = 32);
+
+        /**
+         * @brief Reorder clusters of an already cache optimized triangle list so that outward facing ones are drawn first
+         * @param _threshold Allowed ACMR increase, 1.05 allows clusters to be 5% less cache efficient
+         */
+        static void OptimizeOverdraw(ArrayProxy<uint32_t> _indices, ArrayProxy<const Vector3f> _positions, float _threshold = 1.05f);
+
+        /**
+         * @brief Renumber vertices in the order the indices first use them, which makes vertex fetch sequential
+         * @return The new index of every vertex, unreferenced vertices are moved to the end
+         */
+        static std::vector<uint32_t> OptimizeVertexFetch(ArrayProxy<uint32_t> _indices, size_t _vertexCount);
+
+        /**
+         * @brief Reduce a triangle list by quadric error edge collapses, vertices are kept and only referenced less
+         * @param _targetError Largest allowed deviation from the original surface, relative to the size of the mesh
+         * @param _resultError Receives the deviation of the result, relative to the size of the mesh
+         * @note Vertices split for attribute seams and non-manifold vertices stay in place,
+         *       border vertices only move along the border
+         */
+        static std::vector<uint32_t> Simplify(ArrayProxy<const uint32_t> _indices,
+                                              ArrayProxy<const Vector3f> _positions,
+                                              size_t _targetIndexCount,
+                                              float _targetError = 0.01f,
+                                              float* _resultError = nullptr);
+
+        /**
+         * @brief Simplify every triangle list of a readable mesh repeatedly
+         * @param _reduction Index count of a level relative to the previous one
+         * @return Up to @p _lodCount uploaded meshes with the sub meshes of @p _mesh, from fine to coarse.
+         *         The chain ends early when the error would exceed @p _maxError or a level barely shrinks.
+         */
+        static std::vector<std::shared_ptr<Mesh>> GenerateLODChain(Mesh& _mesh, uint32_t _lodCount, float _reduction = 0.5f, float _maxError = 0.05f);
+
+        /**
+         * @brief Move the vertex attributes of @p _data according to a remap table returned by OptimizeVertexFetch()
+         */
+        template<typename _Ty>
+        static void RemapVertices(std::vector<_Ty>& _data, ArrayProxy<const uint32_t> _remap) {
+            if (_data.size() != _remap.size())
+                return;
+
+            std::vector<_Ty> result(_data.size());
+            for (size_t i = 0; i < _data.size(); ++i)
+                result[_remap[i]] = _data[i];
+            _data = std::move(result);
+        }
     };
 }
 
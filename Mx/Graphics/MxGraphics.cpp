@@ -1,19 +1,41 @@
 #include "MxGraphics.h"
 #include "../../MixEngine.h"
 #include "../Vulkan/MxVulkan.h"
+#include "../Vulkan/Buffers/MxVkUploadManager.h"
 #include "../Vulkan/Shader/MxVkStandardShader.h"
 #include "../GameObject/MxGameObject.h"
 #include <queue>
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <cstring>
 #include "../Scene/MxSceneManager.h"
 #include "MxRenderQueue.h"
 #include "../Component/Renderer/MxRenderer.h"
 #include "../Component/MeshFilter/MxMeshFilter.h"
+#include "../Component/LODGroup/MxLODGroup.h"
 #include "../Component/Camera/MxCamera.h"
 #include "../Vulkan/Shader/MxVkPBRShader.h"
 #include "../Vulkan/Shader/MxVkUIRenderer.h"
+#include "../Vulkan/Query/MxVkFragmentQuery.h"
+#include "../Vulkan/RenderGraph/MxVkRenderGraph.h"
+#include "../Time/MxBenchmark.h"
+#include "Texture/MxTexture.h"
+
+// the only user of the png writer
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image/stb_image_write.h>
 
 
 namespace Mix {
+    namespace {
+        // overdraw of the opaque pass above which the automatic depth pre-pass is enabled, and below which it is dropped
+        const float PrePassEnableOverdraw = 2.5f;
+        const float PrePassDisableOverdraw = 1.8f;
+
+        // the pre-pass hides the overdraw, so while it is enabled automatically one frame in this many is measured without it
+        const uint32_t PrePassProbeInterval = 240;
+    }
 
     Graphics* Graphics::Get() {
         return MixEngine::Instance().getModule<Graphics>();
@@ -24,6 +46,11 @@ namespace Mix {
         mShaderNameMap.clear();
         mShaders.clear();
         mUiRenderer.reset();
+        mFragmentQuery.reset();
+        mRenderGraph.reset();
+        mOcclusionCuller.reset();
+        mLightClusterer.reset();
+        mTextureStreamer.reset();
         mVulkan.reset();
     }
 
@@ -39,6 +66,9 @@ namespace Mix {
     }
 
     void Graphics::render() {
+        // emplacing the next phase records the previous one
+        std::optional<Benchmark::Scope> phase(std::in_place, FramePhase::RenderGather);
+
         for (auto& shader : mShaders)
             shader.second->update();
 
@@ -52,9 +82,30 @@ namespace Mix {
         RenderQueue transparentQueue(RenderQueue::SortType_BackToFront);
         RenderQueue opaqueQueue(RenderQueue::SortType_FrontToBack);
 
+        // static objects with an occluder are rasterized on the cpu first,
+        // renderers entirely behind them never reach the render queues
+        mOcclusionCuller->begin(camera.getProjMat() * camera.getViewMat());
+        if (mOcclusionCuller->isEnabled()) {
+            for (auto& renderer : renderInfo.renderers) {
+                if (!renderer->getGameObject()->isStatic())
+                    continue;
+
+                auto meshFilter = renderer->getGameObject()->getComponent<MeshFilter>();
+                auto mesh = meshFilter ? meshFilter->getMesh() : nullptr;
+                if (mesh && mesh->getOccluder())
+                    mOcclusionCuller->addOccluder(mesh->getOccluder(), mesh->getBounds(), renderer->transform()->localToWorldMatrix());
+            }
+            mOcclusionCuller->rasterizeOccluders();
+        }
+
         for (auto& renderer : renderInfo.renderers) {
-            auto mesh = renderer->getGameObject()->getComponent<MeshFilter>()->getMesh();
-            if (mesh) {
+            // a LOD group replaces the mesh of the filter by the level matching the size on screen
+            std::shared_ptr<Mesh> mesh;
+            if (auto lodGroup = renderer->getGameObject()->getComponent<LODGroup>())
+                mesh = lodGroup->selectMesh(camera);
+            else
+                mesh = renderer->getGameObject()->getComponent<MeshFilter>()->getMesh();
+            if (mesh && mOcclusionCuller->isVisible(mesh->getBounds(), renderer->transform()->localToWorldMatrix())) {
                 auto& materials = renderer->getMaterials();
 
                 uint32_t count = std::min(mesh->subMeshCount(), static_cast<uint32_t>(materials.size()));
@@ -80,54 +131,221 @@ namespace Mix {
             }
         }
 
+        phase.emplace(FramePhase::RenderSort);
         transparentQueue.sort();
         opaqueQueue.sort();
+        phase.emplace(FramePhase::RenderGather);
+
+        mTextureStreamer->update(camera, renderElements);
+
+        // lights are binned on the cpu while the gpu may still work on the previous frame
+        mLightClusterer->build(camera, renderInfo.lights);
 
         auto& transparentElements = transparentQueue.getSortedElements();
         auto& opaqueElements = opaqueQueue.getSortedElements();
 
-        mVulkan->beginRender();
+        phase.emplace(FramePhase::RenderBegin);
+        mVulkan->beginFrame();
+        phase.emplace(FramePhase::RenderRecord);
 
-        // Render all opaque elements
-        if (!opaqueElements.empty()) {
-            uint32_t lastId = opaqueElements.front().shaderId;
+        const uint32_t frame = mVulkan->getCurrFrame();
+        auto& cmd = mVulkan->getCurrDrawCmd().get();
+
+        const bool depthPrePass = chooseDepthPrePass(renderInfo.depthPrePass);
+        for (auto& shader : mShaders) {
+            shader.second->setDepthPrePass(depthPrePass);
+            shader.second->prepareLights(*mLightClusterer);
+        }
+
+        // overdraw is measured on frames without the pre-pass
+        const bool measureOverdraw = mFragmentQuery && !depthPrePass;
+
+        // opaque elements of GPU driven shaders are culled by a compute pass and drawn indirectly
+        std::map<uint32_t, std::vector<RenderElement*>> culledElements;
+        for (auto& elem : opaqueElements) {
+            if (mShaders[elem.shaderId]->isGPUDriven())
+                culledElements[elem.shaderId].push_back(elem.element);
+        }
+
+        // runs _draw for the opaque elements that are not drawn by the culled path of their shader
+        const auto forEachOpaque = [&](const auto& _draw) {
+            std::optional<uint32_t> lastId;
 
-            mShaders[lastId]->beginRender(camera);
             for (auto& elem : opaqueElements) {
+                if (culledElements.count(elem.shaderId))
+                    continue;
+
                 if (lastId != elem.shaderId) {
-                    mShaders[lastId]->endRender();
+                    if (lastId)
+                        mShaders[lastId.value()]->endRender();
 
                     mShaders[elem.shaderId]->beginRender(camera);
+                    lastId = elem.shaderId;
                 }
-                mShaders[elem.shaderId]->render(*elem.element);
+                _draw(*mShaders[elem.shaderId], *elem.element);
             }
-            mShaders[lastId]->endRender();
+            if (lastId)
+                mShaders[lastId.value()]->endRender();
+        };
+
+        const auto extent = mVulkan->getFrameExtent();
+        const Vulkan::RenderGraphImageDesc depthDesc{ mVulkan->getDepthStencilFormat(), extent };
+        const vk::ClearDepthStencilValue depthClear(1.0f, 0);
+
+        // offscreen targets of headless mode are left readable by Texture::GetPixels, nothing waits for them
+        const bool headless = mVulkan->isHeadless();
+        mRenderGraph->reset();
+        const auto backBuffer = mRenderGraph->importImage("BackBuffer",
+                                                          mVulkan->getCurrColorImage(),
+                                                          mVulkan->getCurrColorImageView(),
+                                                          { mVulkan->getColorFormat(), extent },
+                                                          vk::ImageLayout::eUndefined,
+                                                          headless ? vk::ImageLayout::eShaderReadOnlyOptimal : vk::ImageLayout::ePresentSrcKHR,
+                                                          headless ? vk::PipelineStageFlagBits::eTopOfPipe : vk::PipelineStageFlagBits::eColorAttachmentOutput);
+        auto depth = Vulkan::InvalidRenderGraphResource;
+
+        // the culling writes buffers the graph doesn't track, it synchronizes them itself
+        mRenderGraph->addPass("Culling", [&](Vulkan::RenderGraphBuilder& _builder) {
+            _builder.setSideEffect();
+        }, [&](const vk::CommandBuffer& _cmd) {
+            if (measureOverdraw)
+                mFragmentQuery->reset(_cmd, frame);
+            for (auto& pair : culledElements)
+                mShaders[pair.first]->cull(camera, pair.second);
+        });
+
+        // Depth of all opaque elements first, shading then only runs for the frontmost surface
+        if (depthPrePass) {
+            mRenderGraph->addPass("DepthPrePass", [&](Vulkan::RenderGraphBuilder& _builder) {
+                depth = _builder.createImage("Depth", depthDesc);
+                _builder.writeDepth(depth, depthClear);
+            }, [&](const vk::CommandBuffer&) {
+                for (auto& pair : culledElements) {
+                    mShaders[pair.first]->beginRender(camera);
+                    mShaders[pair.first]->renderCulledDepth();
+                    mShaders[pair.first]->endRender();
+                }
+
+                forEachOpaque([](Shader& _shader, RenderElement& _element) {
+                    _shader.renderDepth(_element);
+                });
+            });
         }
 
+        mRenderGraph->addPass("Opaque", [&](Vulkan::RenderGraphBuilder& _builder) {
+            _builder.writeColor(backBuffer, vk::ClearColorValue(std::array<float, 4>{ 0.2f, 0.2f, 0.2f, 1.0f }));
+            if (depth == Vulkan::InvalidRenderGraphResource) {
+                depth = _builder.createImage("Depth", depthDesc);
+                _builder.writeDepth(depth, depthClear);
+            }
+            else
+                _builder.writeDepth(depth);
+        }, [&](const vk::CommandBuffer& _cmd) {
+            if (measureOverdraw)
+                mFragmentQuery->begin(_cmd, frame);
+
+            for (auto& pair : culledElements) {
+                mShaders[pair.first]->beginRender(camera);
+                mShaders[pair.first]->renderCulled();
+                mShaders[pair.first]->endRender();
+            }
+
+            forEachOpaque([](Shader& _shader, RenderElement& _element) {
+                _shader.render(_element);
+            });
+
+            if (measureOverdraw)
+                mFragmentQuery->end(_cmd, frame);
+        });
+
         // Render all transparent elements
         if (!transparentElements.empty()) {
-            uint32_t lastId = transparentElements.front().shaderId;
+            mRenderGraph->addPass("Transparent", [&](Vulkan::RenderGraphBuilder& _builder) {
+                _builder.writeColor(backBuffer);
+                _builder.writeDepth(depth);
+            }, [&](const vk::CommandBuffer&) {
+                uint32_t lastId = transparentElements.front().shaderId;
+
+                mShaders[lastId]->beginRender(camera);
+                for (auto& elem : transparentElements) {
+                    if (lastId != elem.shaderId) {
+                        mShaders[lastId]->endRender();
+
+                        mShaders[elem.shaderId]->beginRender(camera);
+                        lastId = elem.shaderId;
+                    }
+                    mShaders[elem.shaderId]->render(*elem.element);
+                }
+                mShaders[lastId]->endRender();
+            });
+        }
 
-            mShaders[lastId]->beginRender(camera);
-            for (auto& elem : transparentElements) {
-                if (lastId != elem.shaderId) {
-                    mShaders[lastId]->endRender();
+        // UI
+        GUI::UIRenderData renderData;
+        if (GUI::Get()->getRenderData(renderData)) {
+            mRenderGraph->addPass("UI", [&](Vulkan::RenderGraphBuilder& _builder) {
+                _builder.writeColor(backBuffer);
+            }, [&](const vk::CommandBuffer&) {
+                mUiRenderer->render(renderData);
+            });
+        }
 
-                    mShaders[elem.shaderId]->beginRender(camera);
-                }
-                mShaders[elem.shaderId]->render(*elem.element);
+        // the passes above share one render pass, the culling is recorded in front of it
+        mRenderGraph->execute(cmd);
+
+        phase.emplace(FramePhase::RenderSubmit);
+        mVulkan->endFrame();
+        mFrameRendered = true;
+    }
+
+    bool Graphics::saveFrame(const std::filesystem::path& _path) const {
+        if (!mVulkan->isHeadless() || !mFrameRendered) {
+            Log::Warning("%1%: Frames can only be saved in headless mode after one has been rendered", __FUNCTION__);
+            return false;
+        }
+
+        // the frame last begun is the one rendered last, it has been submitted by now
+        const auto& image = *mVulkan->getOffscreenImage(mVulkan->getCurrFrame());
+        const auto extent = mVulkan->getFrameExtent();
+        const auto pixels = Texture::GetPixels(image, 0, 0, extent.width, extent.height,
+                                               vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1));
+
+        const auto width = static_cast<int>(extent.width);
+        if (!stbi_write_png(_path.string().c_str(), width, static_cast<int>(extent.height), 4, pixels.data(), width * 4)) {
+            Log::Error("%1%: Failed to write the frame to %2%", __FUNCTION__, _path.string());
+            return false;
+        }
+        return true;
+    }
+
+    bool Graphics::chooseDepthPrePass(const DepthPrePassMode _mode) {
+        // the fence of the frame has been waited on, so its query has completed
+        if (mFragmentQuery) {
+            if (auto invocations = mFragmentQuery->getResult(mVulkan->getCurrFrame())) {
+                const auto extent = mVulkan->getFrameExtent();
+                mOverdraw = static_cast<float>(invocations.value()) / std::max(1u, extent.width * extent.height);
+
+                if (mOverdraw > PrePassEnableOverdraw)
+                    mAutoDepthPrePass = true;
+                else if (mOverdraw < PrePassDisableOverdraw)
+                    mAutoDepthPrePass = false;
             }
-            mShaders[lastId]->endRender();
         }
 
+        switch (_mode) {
+        case DepthPrePassMode::Off: return false;
+        case DepthPrePassMode::On: return true;
+        default:
+        case DepthPrePassMode::Auto: break;
+        }
 
-        // UI
-        GUI::UIRenderData renderData;
-        bool renderUi = GUI::Get()->getRenderData(renderData);
-        if (renderUi)
-            mUiRenderer->render(renderData);
+        if (!mFragmentQuery || !mAutoDepthPrePass)
+            return false;
 
-        mVulkan->endRender();
+        if (++mFramesSinceProbe < PrePassProbeInterval)
+            return true;
+        mFramesSinceProbe = 0;
+        return false;
     }
 
     std::shared_ptr<Shader> Graphics::findShader(const std::string& _name) {
@@ -140,10 +358,19 @@ namespace Mix {
         std::vector<const char*> instanceExtsReq = _window->getRequiredInstanceExts();
         instanceExtsReq.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
         std::vector<const char*> deviceExtsReq;
-        deviceExtsReq.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        if (!_window->isHeadless())
+            deviceExtsReq.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
+        // build machines running a cpu implementation rarely have the validation layers installed
         std::vector<const char*> layersReq;
-        layersReq.push_back("VK_LAYER_LUNARG_standard_validation");
+        const char* validationLayer = "VK_LAYER_LUNARG_standard_validation";
+        const auto supportedLayers = Vulkan::VulkanAPI::GetAllSupportedLayers();
+        if (std::any_of(supportedLayers.begin(), supportedLayers.end(), [&](const vk::LayerProperties& _layer) {
+            return std::strcmp(_layer.layerName, validationLayer) == 0;
+        }))
+            layersReq.push_back(validationLayer);
+        else
+            Log::Warning("%1%: %2% is not available, validation is disabled", __FUNCTION__, validationLayer);
 
         Vulkan::VulkanSettings settings;
         settings.appInfo.appName = "Demo";
@@ -156,10 +383,52 @@ namespace Mix {
 
         auto vulkan = std::make_unique<Vulkan::VulkanAPI>();
         vulkan->init();
+
+        // enable memory budget query when available
+        auto& extensions = vulkan->getAllPhysicalDeviceInfo()[settings.physicalDeviceIndex].extensions;
+        for (auto& ext : extensions) {
+            if (std::strcmp(ext.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0) {
+                settings.deviceExts.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+                break;
+            }
+        }
+
+        // GPU culling writes indirect draws that select their object by the first instance,
+        // the other features only make the submission cheaper
+        auto& features = vulkan->getAllPhysicalDeviceInfo()[settings.physicalDeviceIndex].features;
+        settings.enabledFeatures.drawIndirectFirstInstance = features.drawIndirectFirstInstance;
+        settings.enabledFeatures.multiDrawIndirect = features.multiDrawIndirect;
+        // counts fragment shader invocations to decide on the depth pre-pass
+        settings.enabledFeatures.pipelineStatisticsQuery = features.pipelineStatisticsQuery;
+        for (auto& ext : extensions) {
+            if (std::strcmp(ext.extensionName, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) == 0) {
+                settings.deviceExts.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+                break;
+            }
+        }
+
         vulkan->setTargetWindow(_window);
         vulkan->build(settings);
 
         mVulkan = std::move(vulkan);
+        if (Vulkan::FragmentQuery::IsSupported(*mVulkan->getLogicalDevice()))
+            mFragmentQuery = std::make_unique<Vulkan::FragmentQuery>(mVulkan->getLogicalDevice(), mVulkan->getFrameCount());
+        mTextureStreamer = std::make_unique<TextureStreamer>();
+        mOcclusionCuller = std::make_unique<OcclusionCuller>();
+        mLightClusterer = std::make_unique<LightClusterer>();
+        mRenderGraph = std::make_unique<Vulkan::RenderGraph>(mVulkan->getAllocator());
+    }
+
+    Vulkan::DefragmentationResult Graphics::defragmentMemory(const Vulkan::DefragmentationSettings& _settings) {
+        // moved resources may still be referenced by frames in flight or pending uploads
+        mVulkan->getUploadManager().flush(true);
+        mVulkan->waitDeviceIdle();
+        // resources are owned by the graphics family, copying them on the transfer queue would need ownership transfers
+        auto result = mVulkan->getAllocator()->defragment(mVulkan->getGraphicsCommandPool(), _settings);
+
+        Log::Info("Defragmentation moved %1% allocations (%2% bytes), released %3% chunks (%4% bytes)",
+                  result.movedAllocations, result.movedBytes, result.freedChunks, result.freedBytes);
+        return result;
     }
 
     void Graphics::loadShader() {
@@ -5,6 +5,12 @@
 #include "../Engine/MxModuleBase.h"
 #include "MxShader.h"
 #include "../Vulkan/MxVulkan.h"
+#include "../Vulkan/Memory/MxVkAllocator.h"
+#include "Texture/MxTextureStreamer.h"
+#include "Culling/MxOcclusionCuller.h"
+#include "Lighting/MxLightClusterer.h"
+#include "MxRenderInfo.h"
+#include <filesystem>
 
 namespace Mix {
     class Window;
@@ -13,6 +19,8 @@ namespace Mix {
     namespace Vulkan {
         class VulkanAPI;
         class UIRenderer;
+        class FragmentQuery;
+        class RenderGraph;
     }
 
     class Graphics :public ModuleBase {
@@ -27,12 +35,35 @@ namespace Mix {
 
         Vulkan::VulkanAPI& getRenderApi() const { return *mVulkan; }
 
+        TextureStreamer& getTextureStreamer() const { return *mTextureStreamer; }
+
+        OcclusionCuller& getOcclusionCuller() const { return *mOcclusionCuller; }
+
+        LightClusterer& getLightClusterer() const { return *mLightClusterer; }
+
+        /** @brief Graph the passes of a frame are recorded with, valid for the frame last rendered */
+        Vulkan::RenderGraph& getRenderGraph() const { return *mRenderGraph; }
+
         void update();
 
         void render();
 
         std::shared_ptr<Shader> findShader(const std::string& _name);
 
+        /**
+         * @brief Write the last rendered frame to a PNG file, only possible in headless mode.
+         *        Reads the offscreen image back through Texture::GetPixels, so the device is waited on.
+         */
+        bool saveFrame(const std::filesystem::path& _path) const;
+
+        /** @brief Fragment shader invocations per pixel of the last measured opaque pass, 0 when not measured */
+        float getOverdraw() const { return mOverdraw; }
+
+        /**
+         * @brief Run one incremental defragmentation pass, waits for the device to be idle.
+         */
+        Vulkan::DefragmentationResult defragmentMemory(const Vulkan::DefragmentationSettings& _settings = {});
+
     private:
         void initRenderAPI(Window* _window);
 
@@ -40,12 +71,26 @@ namespace Mix {
 
         void addShader(const std::string _name, const std::shared_ptr<Vulkan::ShaderBase>& _shader);
 
+        /** @brief Read the overdraw measured for the current frame and decide on the depth pre-pass */
+        bool chooseDepthPrePass(DepthPrePassMode _mode);
+
         std::unique_ptr<Vulkan::VulkanAPI> mVulkan;
+        std::unique_ptr<TextureStreamer> mTextureStreamer;
+        std::unique_ptr<OcclusionCuller> mOcclusionCuller;
+        std::unique_ptr<LightClusterer> mLightClusterer;
+        std::unique_ptr<Vulkan::RenderGraph> mRenderGraph;
 
         std::unordered_map<uint32_t, std::shared_ptr<Shader>> mShaders;
         std::unordered_map<std::string, uint32_t> mShaderNameMap;
 
         std::shared_ptr<Vulkan::UIRenderer> mUiRenderer;
+
+        // null without the pipelineStatisticsQuery feature
+        std::unique_ptr<Vulkan::FragmentQuery> mFragmentQuery;
+        float mOverdraw = 0.0f;
+        bool mAutoDepthPrePass = false;
+        uint32_t mFramesSinceProbe = 0;
+        bool mFrameRendered = false;
     };
 }
 
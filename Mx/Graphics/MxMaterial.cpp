@@ -1,117 +1,164 @@
 #include "MxMaterial.h"
 #include "../Vulkan/Descriptor/MxVkDescriptorSet.h"
 #include "../Graphics/Texture/MxTexture.h"
+#include <cstring>
 
 namespace Mix {
-    std::optional<int> MaterialPropertyBlock::getInt(const std::string& _name) const {
-        auto it = mPropertyMap.find(_name);
+    std::optional<int> MaterialPropertyBlock::getInt(const PropertyId _id) const {
+        auto it = mPropertyMap.find(_id);
         if (it != mPropertyMap.end() && it->second.type == MaterialPropertyType::INT)
             return std::any_cast<int>(it->second.value);
         return std::nullopt;
     }
 
-    std::optional<float> MaterialPropertyBlock::getFloat(const std::string& _name) const {
-        auto it = mPropertyMap.find(_name);
+    std::optional<float> MaterialPropertyBlock::getFloat(const PropertyId _id) const {
+        auto it = mPropertyMap.find(_id);
         if (it != mPropertyMap.end() && it->second.type == MaterialPropertyType::FLOAT)
             return std::any_cast<float>(it->second.value);
         return std::nullopt;
     }
 
-    std::optional<Matrix4> MaterialPropertyBlock::getMatrix(const std::string& _name) const {
-        auto it = mPropertyMap.find(_name);
+    std::optional<Matrix4> MaterialPropertyBlock::getMatrix(const PropertyId _id) const {
+        auto it = mPropertyMap.find(_id);
         if (it != mPropertyMap.end() && it->second.type == MaterialPropertyType::MATRIX)
             return std::any_cast<Matrix4>(it->second.value);
         return std::nullopt;
     }
 
-    std::optional<Vector4f> MaterialPropertyBlock::getVector(const std::string& _name) const {
-        auto it = mPropertyMap.find(_name);
+    std::optional<Vector4f> MaterialPropertyBlock::getVector(const PropertyId _id) const {
+        auto it = mPropertyMap.find(_id);
         if (it != mPropertyMap.end() && it->second.type == MaterialPropertyType::VECTOR)
             return std::any_cast<Vector4f>(it->second.value);
         return std::nullopt;
     }
 
-    std::shared_ptr<Texture> MaterialPropertyBlock::getTexture(const std::string& _name) const {
-        auto it = mPropertyMap.find(_name);
+    std::shared_ptr<Texture> MaterialPropertyBlock::getTexture(const PropertyId _id) const {
+        auto it = mPropertyMap.find(_id);
         if (it != mPropertyMap.end() && it->second.type == MaterialPropertyType::TEX_2D)
             return std::any_cast<std::shared_ptr<Texture>>(it->second.value);
         return nullptr;
     }
 
-    void MaterialPropertyBlock::setInt(const std::string& _name, int _value) {
-        mPropertyMap[_name] = Property{ MaterialPropertyType::INT, _value };
+    void MaterialPropertyBlock::setInt(const PropertyId _id, int _value) {
+        mPropertyMap[_id] = Property{ MaterialPropertyType::INT, _value };
     }
 
-    void MaterialPropertyBlock::setFloat(const std::string& _name, float _value) {
-        mPropertyMap[_name] = Property{ MaterialPropertyType::FLOAT, _value };
+    void MaterialPropertyBlock::setFloat(const PropertyId _id, float _value) {
+        mPropertyMap[_id] = Property{ MaterialPropertyType::FLOAT, _value };
     }
 
-    void MaterialPropertyBlock::setMatrix(const std::string& _name, const Matrix4& _value) {
-        mPropertyMap[_name] = Property{ MaterialPropertyType::MATRIX, _value };
+    void MaterialPropertyBlock::setMatrix(const PropertyId _id, const Matrix4& _value) {
+        mPropertyMap[_id] = Property{ MaterialPropertyType::MATRIX, _value };
     }
 
-    void MaterialPropertyBlock::setVector(const std::string& _name, const Vector4f& _value) {
-        mPropertyMap[_name] = Property{ MaterialPropertyType::VECTOR, _value };
+    void MaterialPropertyBlock::setVector(const PropertyId _id, const Vector4f& _value) {
+        mPropertyMap[_id] = Property{ MaterialPropertyType::VECTOR, _value };
     }
 
-    void MaterialPropertyBlock::setTexture(const std::string& _name, std::shared_ptr<Texture> _value) {
-        mPropertyMap[_name] = Property{ MaterialPropertyType::TEX_2D, _value };
+    void MaterialPropertyBlock::setTexture(const PropertyId _id, std::shared_ptr<Texture> _value) {
+        mPropertyMap[_id] = Property{ MaterialPropertyType::TEX_2D, _value };
     }
 
-    bool MaterialPropertyBlock::hasProperty(const std::string& _name) const {
-        return mPropertyMap.find(_name) != mPropertyMap.end();
+    bool MaterialPropertyBlock::hasProperty(const PropertyId _id) const {
+        return mPropertyMap.find(_id) != mPropertyMap.end();
     }
 
     Material::Material(const std::shared_ptr<Shader>& _shader)
         :mMaterialId(_shader->_newMaterial()),
         mShader(_shader),
+        mLayout(&_shader->getMaterialLayout()),
+        mParamBlock(mLayout->getDefaultBlock()),
+        mTextureRevisions(mLayout->propertyCount(), 0),
         mMaterialProperties(_shader->getMaterialPropertySet()),
         mRenderType(RenderType::Opaque) {
-        for (auto& property : mShader->getMaterialPropertySet()) {
-            mChangedList.insert(property.name);
-        }
+        // everything has to be written once
+        const uint32_t count = mLayout->propertyCount();
+        mDirtyMask = count < 64 ? (uint64_t(1) << count) - 1 : ~uint64_t(0);
     }
 
     Material::~Material() {
         mShader->_deleteMaterial(mMaterialId);
     }
 
-    void Material::setInt(const std::string& _name, int _value) {
-        if (mMaterialProperties.hasProperty(_name)) {
-            mMaterialProperties.setInt(_name, _value);
-            mChangedList.insert(_name);
+    template<typename _Ty>
+    void Material::changed(const MaterialLayout::Entry& _entry, const _Ty& _value) {
+        if (_entry.offset != MaterialLayout::NotPacked)
+            std::memcpy(mParamBlock.data() + _entry.offset, &_value, sizeof(_value));
+        mDirtyMask |= uint64_t(1) << _entry.slot;
+    }
+
+    void Material::setInt(const PropertyId _id, int _value) {
+        auto entry = mLayout->find(_id);
+        if (entry && entry->type == MaterialPropertyType::INT) {
+            mMaterialProperties.setInt(_id, _value);
+            changed(*entry, _value);
+        }
+    }
+
+    void Material::setFloat(const PropertyId _id, float _value) {
+        auto entry = mLayout->find(_id);
+        if (entry && entry->type == MaterialPropertyType::FLOAT) {
+            mMaterialProperties.setFloat(_id, _value);
+            changed(*entry, _value);
         }
     }
 
-    void Material::setFloat(const std::string& _name, float _value) {
-        if (mMaterialProperties.hasProperty(_name)) {
-            mMaterialProperties.setFloat(_name, _value);
-            mChangedList.insert(_name);
+    void Material::setMatrix(const PropertyId _id, const Matrix4& _value) {
+        auto entry = mLayout->find(_id);
+        if (entry && entry->type == MaterialPropertyType::MATRIX) {
+            mMaterialProperties.setMatrix(_id, _value);
+            changed(*entry, _value);
         }
     }
 
-    void Material::setMatrix(const std::string& _name, const Matrix4& _value) {
-        if (mMaterialProperties.hasProperty(_name)) {
-            mMaterialProperties.setMatrix(_name, _value);
-            mChangedList.insert(_name);
+    void Material::setVector(const PropertyId _id, const Vector4f& _value) {
+        auto entry = mLayout->find(_id);
+        if (entry && entry->type == MaterialPropertyType::VECTOR) {
+            mMaterialProperties.setVector(_id, _value);
+            changed(*entry, _value);
         }
     }
 
-    void Material::setVector(const std::string& _name, const Vector4f& _value) {
-        if (mMaterialProperties.hasProperty(_name)) {
-            mMaterialProperties.setVector(_name, _value);
-            mChangedList.insert(_name);
+    std::vector<std::shared_ptr<Texture>> Material::getTextures() const {
+        std::vector<std::shared_ptr<Texture>> result;
+        for (auto id : mLayout->getTextureProperties()) {
+            if (auto texture = getTexture(id))
+                result.push_back(std::move(texture));
         }
+        return result;
     }
 
-    void Material::setTexture(const std::string& _name, std::shared_ptr<Texture> _value) {
-        if (mMaterialProperties.hasProperty(_name)) {
-            mMaterialProperties.setTexture(_name, std::move(_value));
-            mChangedList.insert(_name);
+    void Material::setTexture(const PropertyId _id, std::shared_ptr<Texture> _value) {
+        auto entry = mLayout->find(_id);
+        if (entry && entry->type == MaterialPropertyType::TEX_2D) {
+            if (_value)
+                mTextureRevisions[entry->slot] = _value->revision();
+            mMaterialProperties.setTexture(_id, std::move(_value));
+            mDirtyMask |= uint64_t(1) << entry->slot;
         }
     }
 
+    bool Material::_isDirty(const PropertyId _id) const {
+        auto entry = mLayout->find(_id);
+        return entry && (mDirtyMask >> entry->slot & 1);
+    }
+
     void Material::_updated() {
-        mChangedList.clear();
+        mDirtyMask = 0;
+    }
+
+    void Material::_checkTextureRevisions() {
+        for (auto id : mLayout->getTextureProperties()) {
+            auto texture = getTexture(id);
+            if (!texture)
+                continue;
+
+            const auto entry = mLayout->find(id);
+            auto& revision = mTextureRevisions[entry->slot];
+            if (revision != texture->revision()) {
+                revision = texture->revision();
+                mDirtyMask |= uint64_t(1) << entry->slot;
+            }
+        }
     }
 }
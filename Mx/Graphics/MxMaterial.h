@@ -6,6 +6,9 @@
 #include "../Math/MxMatrix4.h"
 #include <string>
 #include <optional>
+#include <unordered_map>
+#include <vector>
+#include <cstddef>
 #include "../Definitions/MxCommonEnum.h"
 
 namespace Mix {
@@ -25,17 +28,20 @@ namespace Mix {
 
         ~Material();
 
-        std::optional<int>				getInt(const std::string& _name) const { return mMaterialProperties.getInt(_name); }
-        std::optional<float>			getFloat(const std::string& _name) const { return mMaterialProperties.getFloat(_name); }
-        std::optional<Matrix4>	        getMatrix(const std::string& _name)	const { return mMaterialProperties.getMatrix(_name); }
-        std::optional<Vector4f>	        getVector(const std::string& _name)	const { return mMaterialProperties.getVector(_name); }
-        std::shared_ptr<Texture>		getTexture(const std::string& _name) const { return mMaterialProperties.getTexture(_name); }
+        std::optional<int>				getInt(PropertyId _id) const { return mMaterialProperties.getInt(_id); }
+        std::optional<float>			getFloat(PropertyId _id) const { return mMaterialProperties.getFloat(_id); }
+        std::optional<Matrix4>	        getMatrix(PropertyId _id)	const { return mMaterialProperties.getMatrix(_id); }
+        std::optional<Vector4f>	        getVector(PropertyId _id)	const { return mMaterialProperties.getVector(_id); }
+        std::shared_ptr<Texture>		getTexture(PropertyId _id) const { return mMaterialProperties.getTexture(_id); }
 
-        void setInt(const std::string& _name, int _value);
-        void setFloat(const std::string& _name, float _value);
-        void setMatrix(const std::string& _name, const Matrix4& _value);
-        void setVector(const std::string& _name, const Vector4f& _value);
-        void setTexture(const std::string& _name, std::shared_ptr<Texture> _value);
+        /** @brief All textures currently assigned to this material */
+        std::vector<std::shared_ptr<Texture>> getTextures() const;
+
+        void setInt(PropertyId _id, int _value);
+        void setFloat(PropertyId _id, float _value);
+        void setMatrix(PropertyId _id, const Matrix4& _value);
+        void setVector(PropertyId _id, const Vector4f& _value);
+        void setTexture(PropertyId _id, std::shared_ptr<Texture> _value);
 
         void setRenderType(RenderType _mode) { mRenderType = _mode; }
 
@@ -43,17 +49,34 @@ namespace Mix {
 
         void _updated();
 
+        /** @brief Mark textures whose image view has been replaced (e.g. by streaming) as changed */
+        void _checkTextureRevisions();
+
         uint32_t _getMaterialId() const { return mMaterialId; }
 
-        const std::unordered_set<std::string>& _getChangedList() const { return mChangedList; }
+        /** @brief Properties changed since the last _updated(), bit i is the property in slot i of the MaterialLayout */
+        uint64_t _getDirtyMask() const { return mDirtyMask; }
+
+        bool _isDirty(PropertyId _id) const;
+
+        /** @brief Packed parameters laid out by the MaterialLayout of the shader */
+        const std::vector<std::byte>& _getParamBlock() const { return mParamBlock; }
 
         std::shared_ptr<Shader> getShader() const { return mShader; }
 
     private:
 
+        /** @brief Mark the property dirty and copy a packed value into the parameter block */
+        template<typename _Ty>
+        void changed(const MaterialLayout::Entry& _entry, const _Ty& _value);
+
         uint32_t mMaterialId;
         std::shared_ptr<Shader> mShader;
-        std::unordered_set<std::string> mChangedList;
+        const MaterialLayout* mLayout;
+        uint64_t mDirtyMask = 0;
+        std::vector<std::byte> mParamBlock;
+        // texture revisions by slot
+        std::vector<uint32_t> mTextureRevisions;
         MaterialPropertyBlock mMaterialProperties;
 
         RenderType mRenderType;
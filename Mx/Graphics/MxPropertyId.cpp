@@ -0,0 +1,42 @@
+#include "MxPropertyId.h"
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace Mix {
+    namespace {
+        struct NameTable {
+            std::mutex mutex;
+            std::unordered_map<std::string, uint32_t> ids;
+            // a deque never moves its elements, so returned names stay valid
+            std::deque<std::string> names;
+        };
+
+        NameTable& GetNameTable() {
+            static NameTable table;
+            return table;
+        }
+    }
+
+    PropertyId::PropertyId(const std::string& _name) {
+        auto& table = GetNameTable();
+        std::lock_guard<std::mutex> lock(table.mutex);
+
+        auto it = table.ids.find(_name);
+        if (it == table.ids.end()) {
+            it = table.ids.emplace(_name, static_cast<uint32_t>(table.names.size())).first;
+            table.names.push_back(_name);
+        }
+        mId = it->second;
+    }
+
+    const std::string& PropertyId::name() const {
+        static const std::string Empty;
+        if (!valid())
+            return Empty;
+
+        auto& table = GetNameTable();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        return table.names[mId];
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+#ifndef MX_PROPERTY_ID_H_
+#define MX_PROPERTY_ID_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace Mix {
+    /**
+     * @brief Interned name of a shader or material property.
+     *
+     * Names are looked up in a global table once, comparing and hashing the id afterwards is as cheap as
+     * for an integer. Keep ids of properties used every frame in static variables instead of passing strings.
+     */
+    class PropertyId {
+    public:
+        PropertyId() = default;
+
+        PropertyId(const std::string& _name);
+
+        PropertyId(const char* _name) :PropertyId(std::string(_name)) {}
+
+        uint32_t value() const { return mId; }
+
+        bool valid() const { return mId != Invalid; }
+
+        /** @brief The interned name, empty for an invalid id */
+        const std::string& name() const;
+
+        bool operator==(const PropertyId& _other) const { return mId == _other.mId; }
+
+        bool operator!=(const PropertyId& _other) const { return mId != _other.mId; }
+
+        bool operator<(const PropertyId& _other) const { return mId < _other.mId; }
+
+        struct Hash {
+            size_t operator()(const PropertyId& _id) const noexcept { return std::hash<uint32_t>()(_id.mId); }
+        };
+
+    private:
+        static constexpr uint32_t Invalid = ~0u;
+
+        uint32_t mId = Invalid;
+    };
+}
+
+#endif
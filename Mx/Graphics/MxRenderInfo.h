@@ -12,8 +12,19 @@ namespace Mix {
     class Material;
     class Renderer;
     class Camera;
+    class Light;
 
 
+    /**
+     * \brief Whether opaque geometry writes its depth in a pass of its own before it is shaded.
+     */
+    enum class DepthPrePassMode {
+        Off,
+        On,
+        // enabled while the measured overdraw of opaque geometry is high
+        Auto
+    };
+
     /**
      * \brief Information used to collect render information from scene.
      */
@@ -21,6 +32,10 @@ namespace Mix {
         Camera* camera = nullptr;
 
         std::vector<Renderer*> renderers;
+
+        std::vector<Light*> lights;
+
+        DepthPrePassMode depthPrePass = DepthPrePassMode::Off;
     };
 
 
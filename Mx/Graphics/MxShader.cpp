@@ -1,5 +1,8 @@
 #include "MxShader.h"
 #include "../Vulkan/Shader/MxVkShaderBase.h"
+#include "../Definitions/MxDefinitions.h"
+#include "../Math/MxMath.h"
+#include <cstring>
 
 namespace Mix {
     MaterialPropertyBlock::MaterialPropertyBlock(const MaterialPropertySet& _set) {
@@ -14,38 +17,95 @@ namespace Mix {
         }
     }
 
-    void Shader::setGlobalInt(const std::string& _name, int _value) {
-        if (mGlobalProperties.hasProperty(_name)) {
-            mGlobalProperties.setInt(_name, _value);
-            mChangedList.push_back(_name);
+    MaterialLayout::MaterialLayout(const MaterialPropertySet& _set, const std::vector<std::string>& _packed) {
+        MX_ASSERT(_set.size() <= MaxProperties && "The dirty bitmask of a material holds 64 properties");
+
+        uint32_t slot = 0;
+        for (auto& property : _set) {
+            const PropertyId id(property.name);
+            mEntries[id] = Entry{ slot++, property.type, NotPacked };
+            if (property.type == MaterialPropertyType::TEX_2D)
+                mTextures.push_back(id);
+        }
+
+        for (auto& name : _packed) {
+            auto it = mEntries.find(PropertyId(name));
+            if (it == mEntries.end() || it->second.offset != NotPacked)
+                continue;
+
+            uint32_t size = 0;
+            uint32_t alignment = 0;
+            switch (it->second.type) {
+            case MaterialPropertyType::INT:
+            case MaterialPropertyType::FLOAT: size = 4, alignment = 4; break;
+            case MaterialPropertyType::VECTOR: size = 16, alignment = 16; break;
+            case MaterialPropertyType::MATRIX: size = 64, alignment = 16; break;
+            default: continue;
+            }
+
+            it->second.offset = static_cast<uint32_t>(Math::Align(mBlockSize, alignment));
+            mBlockSize = it->second.offset + size;
+        }
+
+        mDefaultBlock.resize(mBlockSize);
+        for (auto& property : _set) {
+            const auto entry = find(PropertyId(property.name));
+            if (entry->offset == NotPacked)
+                continue;
+
+            std::byte* dst = mDefaultBlock.data() + entry->offset;
+            const auto write = [dst](const auto& _value) { std::memcpy(dst, &_value, sizeof(_value)); };
+            switch (property.type) {
+            case MaterialPropertyType::INT: write(std::any_cast<int>(property.defaultValue)); break;
+            case MaterialPropertyType::FLOAT: write(std::any_cast<float>(property.defaultValue)); break;
+            case MaterialPropertyType::VECTOR: write(std::any_cast<Vector4f>(property.defaultValue)); break;
+            case MaterialPropertyType::MATRIX: write(std::any_cast<Matrix4>(property.defaultValue)); break;
+            default: break;
+            }
+        }
+    }
+
+    const MaterialLayout::Entry* MaterialLayout::find(const PropertyId _id) const {
+        auto it = mEntries.find(_id);
+        return it != mEntries.end() ? &it->second : nullptr;
+    }
+
+    void Shader::buildMaterialLayout() {
+        mMaterialLayout = std::make_unique<MaterialLayout>(mPropertySet, mShader->getPackedMaterialProperties());
+    }
+
+    void Shader::setGlobalInt(PropertyId _id, int _value) {
+        if (mGlobalProperties.hasProperty(_id)) {
+            mGlobalProperties.setInt(_id, _value);
+            mChangedList.push_back(_id);
         }
     }
 
-    void Shader::setGlobalFloat(const std::string& _name, float _value) {
-        if (mGlobalProperties.hasProperty(_name)) {
-            mGlobalProperties.setFloat(_name, _value);
-            mChangedList.push_back(_name);
+    void Shader::setGlobalFloat(PropertyId _id, float _value) {
+        if (mGlobalProperties.hasProperty(_id)) {
+            mGlobalProperties.setFloat(_id, _value);
+            mChangedList.push_back(_id);
         }
     }
 
-    void Shader::setGlobalMatrix(const std::string& _name, const Matrix4& _value) {
-        if (mGlobalProperties.hasProperty(_name)) {
-            mGlobalProperties.setMatrix(_name, _value);
-            mChangedList.push_back(_name);
+    void Shader::setGlobalMatrix(PropertyId _id, const Matrix4& _value) {
+        if (mGlobalProperties.hasProperty(_id)) {
+            mGlobalProperties.setMatrix(_id, _value);
+            mChangedList.push_back(_id);
         }
     }
 
-    void Shader::setGlobalVector(const std::string& _name, const Vector4f& _value) {
-        if (mGlobalProperties.hasProperty(_name)) {
-            mGlobalProperties.setVector(_name, _value);
-            mChangedList.push_back(_name);
+    void Shader::setGlobalVector(PropertyId _id, const Vector4f& _value) {
+        if (mGlobalProperties.hasProperty(_id)) {
+            mGlobalProperties.setVector(_id, _value);
+            mChangedList.push_back(_id);
         }
     }
 
-    void Shader::setGlobalTexture(const std::string& _name, std::shared_ptr<Texture> _value) {
-        if (mGlobalProperties.hasProperty(_name)) {
-            mGlobalProperties.setTexture(_name, std::move(_value));
-            mChangedList.push_back(_name);
+    void Shader::setGlobalTexture(PropertyId _id, std::shared_ptr<Texture> _value) {
+        if (mGlobalProperties.hasProperty(_id)) {
+            mGlobalProperties.setTexture(_id, std::move(_value));
+            mChangedList.push_back(_id);
         }
     }
 
@@ -73,4 +133,36 @@ namespace Mix {
     void Shader::endRender() {
         mShader->endRender();
     }
+
+    bool Shader::isGPUDriven() const {
+        return mShader->isGPUDriven();
+    }
+
+    void Shader::cull(const Camera& _camera, ArrayProxy<RenderElement* const> _elements) {
+        mShader->cull(_camera, _elements);
+    }
+
+    void Shader::renderCulled() {
+        mShader->renderCulled();
+    }
+
+    bool Shader::hasDepthPass() const {
+        return mShader->hasDepthPass();
+    }
+
+    void Shader::renderDepth(RenderElement& _element) {
+        mShader->renderDepth(_element);
+    }
+
+    void Shader::renderCulledDepth() {
+        mShader->renderCulledDepth();
+    }
+
+    void Shader::setDepthPrePass(const bool _enable) {
+        mShader->setDepthPrePass(_enable);
+    }
+
+    void Shader::prepareLights(const LightClusterer& _lights) {
+        mShader->prepareLights(_lights);
+    }
 }
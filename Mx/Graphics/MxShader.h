@@ -8,10 +8,16 @@
 #include <utility>
 #include <any>
 #include <unordered_set>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <cstddef>
 #include "../Utils/MxArrayProxy.h"
+#include "MxPropertyId.h"
 
 namespace Mix {
     class Camera;
+    class LightClusterer;
     class Material;
     class Texture;
     struct SceneRenderInfo;
@@ -60,53 +66,96 @@ namespace Mix {
     public:
         explicit MaterialPropertyBlock(const MaterialPropertySet& _set);
 
-        std::optional<int>				getInt(const std::string& _name) const;
-        std::optional<float>			getFloat(const std::string& _name) const;
-        std::optional<Matrix4>	getMatrix(const std::string& _name)	const;
-        std::optional<Vector4f>	getVector(const std::string& _name)	const;
-        std::shared_ptr<Texture>		getTexture(const std::string& _name) const;
+        std::optional<int>				getInt(PropertyId _id) const;
+        std::optional<float>			getFloat(PropertyId _id) const;
+        std::optional<Matrix4>	getMatrix(PropertyId _id)	const;
+        std::optional<Vector4f>	getVector(PropertyId _id)	const;
+        std::shared_ptr<Texture>		getTexture(PropertyId _id) const;
 
-        void setInt(const std::string& _name, int _value);
-        void setFloat(const std::string& _name, float _value);
-        void setMatrix(const std::string& _name, const Matrix4& _value);
-        void setVector(const std::string& _name, const Vector4f& _value);
-        void setTexture(const std::string& _name, std::shared_ptr<Texture> _value);
+        void setInt(PropertyId _id, int _value);
+        void setFloat(PropertyId _id, float _value);
+        void setMatrix(PropertyId _id, const Matrix4& _value);
+        void setVector(PropertyId _id, const Vector4f& _value);
+        void setTexture(PropertyId _id, std::shared_ptr<Texture> _value);
 
         void clear() { mPropertyMap.clear(); }
 
         bool empty() const { return mPropertyMap.empty(); }
 
-        bool hasProperty(const std::string& _name) const;
+        bool hasProperty(PropertyId _id) const;
     private:
         struct Property {
             MaterialPropertyType type;
             std::any value;
         };
 
-        using PropertyMap = std::unordered_map<std::string, Property>;
+        using PropertyMap = std::unordered_map<PropertyId, Property, PropertyId::Hash>;
         PropertyMap mPropertyMap;
     };
 
+    /**
+     * @brief Slot of every material property of a shader and its offset in the packed parameter block.
+     *
+     * Slots number the properties for the dirty bitmask of a Material. Packed properties are laid out in
+     * the given order with std140 alignment, vectors and matrices on 16 bytes and scalars on 4, so a block
+     * can be copied into a uniform buffer or push constant range declared with the same members.
+     */
+    class MaterialLayout {
+    public:
+        static constexpr uint32_t MaxProperties = 64;
+        static constexpr uint32_t NotPacked = ~0u;
+
+        struct Entry {
+            uint32_t slot;
+            MaterialPropertyType type;
+            // offset in the parameter block, NotPacked for textures and properties left out of it
+            uint32_t offset;
+        };
+
+        /** @param _packed Properties of @p _set to pack, in the order of the shader block */
+        MaterialLayout(const MaterialPropertySet& _set, const std::vector<std::string>& _packed);
+
+        /** @return nullptr when the shader has no such property */
+        const Entry* find(PropertyId _id) const;
+
+        uint32_t propertyCount() const { return static_cast<uint32_t>(mEntries.size()); }
+
+        uint32_t blockSize() const { return mBlockSize; }
+
+        /** @brief Default values of the packed properties */
+        const std::vector<std::byte>& getDefaultBlock() const { return mDefaultBlock; }
+
+        const std::vector<PropertyId>& getTextureProperties() const { return mTextures; }
+
+    private:
+        std::unordered_map<PropertyId, Entry, PropertyId::Hash> mEntries;
+        std::vector<PropertyId> mTextures;
+        uint32_t mBlockSize = 0;
+        std::vector<std::byte> mDefaultBlock;
+    };
+
     class Shader {
         friend class Vulkan::ShaderBase;
         friend class Graphics;
     public:
-        std::optional<int>				getGlobalInt(const std::string& _name) const { return mGlobalProperties.getInt(_name); }
-        std::optional<float>			getGlobalFloat(const std::string& _name) const { return mGlobalProperties.getFloat(_name); }
-        std::optional<Matrix4>	getGlobalMatrix(const std::string& _name) const { return mGlobalProperties.getMatrix(_name); }
-        std::optional<Vector4f>	getGlobalVector(const std::string& _name) const { return mGlobalProperties.getVector(_name); }
-        std::shared_ptr<Texture>		getGlobalTexture(const std::string& _name) const { return mGlobalProperties.getTexture(_name); }
-
-        void setGlobalInt(const std::string& _name, int _value);
-        void setGlobalFloat(const std::string& _name, float _value);
-        void setGlobalMatrix(const std::string& _name, const Matrix4& _value);
-        void setGlobalVector(const std::string& _name, const Vector4f& _value);
-        void setGlobalTexture(const std::string& _name, std::shared_ptr<Texture> _value);
+        std::optional<int>				getGlobalInt(PropertyId _id) const { return mGlobalProperties.getInt(_id); }
+        std::optional<float>			getGlobalFloat(PropertyId _id) const { return mGlobalProperties.getFloat(_id); }
+        std::optional<Matrix4>	getGlobalMatrix(PropertyId _id) const { return mGlobalProperties.getMatrix(_id); }
+        std::optional<Vector4f>	getGlobalVector(PropertyId _id) const { return mGlobalProperties.getVector(_id); }
+        std::shared_ptr<Texture>		getGlobalTexture(PropertyId _id) const { return mGlobalProperties.getTexture(_id); }
+
+        void setGlobalInt(PropertyId _id, int _value);
+        void setGlobalFloat(PropertyId _id, float _value);
+        void setGlobalMatrix(PropertyId _id, const Matrix4& _value);
+        void setGlobalVector(PropertyId _id, const Vector4f& _value);
+        void setGlobalTexture(PropertyId _id, std::shared_ptr<Texture> _value);
 
         const std::string& name() const { return mName; }
 
         const auto& getMaterialPropertySet() const { return mPropertySet; }
 
+        const MaterialLayout& getMaterialLayout() const { return *mMaterialLayout; }
+
         void update();
 
         uint32_t getId() const { return mShaderId; }
@@ -121,6 +170,22 @@ namespace Mix {
 
         void endRender();
 
+        bool isGPUDriven() const;
+
+        void cull(const Camera& _camera, ArrayProxy<RenderElement* const> _elements);
+
+        void renderCulled();
+
+        bool hasDepthPass() const;
+
+        void renderDepth(RenderElement& _element);
+
+        void renderCulledDepth();
+
+        void setDepthPrePass(bool _enable);
+
+        void prepareLights(const LightClusterer& _lights);
+
 
     private:
         Shader(std::shared_ptr<Vulkan::ShaderBase> _shader, uint32_t _id, std::string _name, const MaterialPropertySet& _shaerPropertySet, const MaterialPropertySet& _materialPropertySet)
@@ -129,6 +194,7 @@ namespace Mix {
             mName(std::move(_name)),
             mGlobalProperties(_shaerPropertySet),
             mPropertySet(_materialPropertySet) {
+            buildMaterialLayout();
         }
 
         Shader(std::shared_ptr<Vulkan::ShaderBase> _shader, uint32_t _id, std::string _name, const MaterialPropertySet& _shaerPropertySet, MaterialPropertySet&& _materialPropertySet)
@@ -137,14 +203,18 @@ namespace Mix {
             mName(std::move(_name)),
             mGlobalProperties(_shaerPropertySet),
             mPropertySet(std::move(_materialPropertySet)) {
+            buildMaterialLayout();
         }
 
+        void buildMaterialLayout();
+
         std::shared_ptr<Vulkan::ShaderBase> mShader;
         uint32_t mShaderId;
         const std::string mName;
-        std::vector<std::string> mChangedList;
+        std::vector<PropertyId> mChangedList;
         MaterialPropertyBlock mGlobalProperties;
         MaterialPropertySet mPropertySet;
+        std::unique_ptr<MaterialLayout> mMaterialLayout;
     };
 }
 
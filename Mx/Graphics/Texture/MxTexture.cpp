@@ -3,8 +3,10 @@
 #include "../../Vulkan/Buffers/MxVkBufferTransfer.h"
 #include "../../Vulkan/CommandBuffer/MxVkCommanddBufferHandle.h"
 #include "../../Vulkan/Buffers/MxVkBuffer.h"
+#include "../../Vulkan/Buffers/MxVkUploadManager.h"
 #include "../MxGraphics.h"
 #include "../../Vulkan/MxVulkan.h"
+#include "../../Vulkan/Image/MxVkMipmapGenerator.h"
 
 namespace Mix {
     Texture::~Texture() {
@@ -28,62 +30,28 @@ namespace Mix {
         if (mTransfers.empty())
             return;
 
-        auto& vulkan = Graphics::Get()->getRenderApi();
-        Vulkan::CommandBufferHandle handle(vulkan.getTransferCommandPool());
-
-        handle.begin(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-
-        vk::ImageMemoryBarrier barrier;
-        barrier.image = mImage->get();
-        barrier.subresourceRange.levelCount = 1;
-        barrier.subresourceRange.layerCount = 1;
+        auto& uploader = Graphics::Get()->getRenderApi().getUploadManager();
 
         vk::BufferImageCopy copy;
         copy.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
         copy.imageSubresource.layerCount = 1;
 
         for (auto& pair : mTransfers) {
-            barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-            barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
-            barrier.oldLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-            barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
-            barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-            barrier.subresourceRange.baseMipLevel = pair.first.mipLevel;
-            barrier.subresourceRange.baseArrayLayer = pair.first.layer;
-
-            handle.get().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
-                                         vk::PipelineStageFlagBits::eTransfer,
-                                         vk::DependencyFlags(),
-                                         nullptr, nullptr, barrier);
-
-            copy.imageSubresource.mipLevel = pair.first.mipLevel;
+            // the finest mips may not be resident
+            if (pair.first.mipLevel < mFirstResidentMip)
+                continue;
+
+            copy.imageSubresource.mipLevel = pair.first.mipLevel - mFirstResidentMip;
             copy.imageSubresource.baseArrayLayer = pair.first.layer;
             copy.imageOffset = vk::Offset3D(pair.first.offset.x, pair.first.offset.y, 0);
             copy.imageExtent = vk::Extent3D(pair.first.extent.x, pair.first.extent.y, 1);
 
-
-
-            handle.get().copyBufferToImage(pair.second->get(),
-                                           mImage->get(), vk::ImageLayout::eTransferDstOptimal,
-                                           copy);
-
-            barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-            barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
-            barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-            barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-
-            handle.get().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
-                                         vk::PipelineStageFlagBits::eTransfer,
-                                         vk::DependencyFlags(),
-                                         nullptr, nullptr, barrier);
+            uploader.uploadImage(mImage, pair.second.data(), pair.second.size(), copy);
         }
 
+        // generated on the graphics queue together with every other texture of the batch
         if (_updateMipmaps && mipLevels() != 1)
-            GenMipMap(handle.get(), *mImage, 0);
-
-        handle.end();
-        handle.submit();
-        handle.wait();
+            Graphics::Get()->getRenderApi().getMipmapGenerator().add(mImage);
 
         mTransfers.clear();
     }
@@ -97,11 +65,11 @@ namespace Mix {
     }
 
     Vector2i Texture::extent(uint32_t _mipLevel) const {
-        return GetMipmapExtent(mImage->extent().width, mImage->extent().height, _mipLevel);
+        return GetMipmapExtent(mImageInfo.extent.width, mImageInfo.extent.height, _mipLevel);
     }
 
     TextureFormat Texture::format() const {
-        return FromVkFormat(mImage->format());
+        return FromVkFormat(mImageInfo.format);
     }
 
     uint32_t Texture::GetMipmapLevel(uint32_t _width, uint32_t _height) {
@@ -120,9 +88,9 @@ namespace Mix {
                      uint32_t _width, uint32_t _height, uint32_t _depth,
                      TextureFormat _format,
                      uint32_t _mipLevel, uint32_t _layer,
-                     SamplerInfo _samplerInfo) : mType(_type) {
+                     SamplerInfo _samplerInfo,
+                     uint32_t _firstResidentMip) : mSamplerInfo(_samplerInfo), mType(_type) {
         auto& vulkan = Graphics::Get()->getRenderApi();
-        auto& device = *vulkan.getLogicalDevice();
 
         // Calculate the appropriate mipLevel value
         // when _mipLevel is zero,
@@ -130,40 +98,28 @@ namespace Mix {
             _mipLevel = static_cast<uint32_t>(std::floor(std::log2(std::max(_width, _height)))) + 1;
 
         // vk::Image
-        vk::ImageCreateInfo imageInfo;
-        imageInfo.format = ToVkFormat(_format);
-        imageInfo.extent = vk::Extent3D(_width, _height, _depth);
-        imageInfo.mipLevels = _mipLevel;
-        imageInfo.arrayLayers = _layer;
-        imageInfo.usage = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
-
-
-        // vk::ImageView
-        vk::ImageViewCreateInfo viewInfo;
-        viewInfo.format = ToVkFormat(_format);
-        viewInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-        viewInfo.subresourceRange.baseMipLevel = 0;
-        viewInfo.subresourceRange.levelCount = _mipLevel;
-        viewInfo.subresourceRange.baseArrayLayer = 0;
-        viewInfo.subresourceRange.layerCount = _layer;
+        mImageInfo.format = ToVkFormat(_format);
+        mImageInfo.extent = vk::Extent3D(_width, _height, _depth);
+        mImageInfo.mipLevels = _mipLevel;
+        mImageInfo.arrayLayers = _layer;
+        mImageInfo.usage = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+        if (_mipLevel > 1 && vulkan.getMipmapGenerator().requiresStorage(mImageInfo.format))
+            mImageInfo.usage |= vk::ImageUsageFlagBits::eStorage;
 
         switch (mType) {
         case TextureType::Tex_2D:
-            imageInfo.imageType = vk::ImageType::e2D;
-            viewInfo.viewType = vk::ImageViewType::e2D;
+            mImageInfo.imageType = vk::ImageType::e2D;
+            mViewType = vk::ImageViewType::e2D;
             break;
 
         case TextureType::Cube:
-            imageInfo.imageType = vk::ImageType::e2D;
-            imageInfo.flags = vk::ImageCreateFlagBits::eCubeCompatible;
-            viewInfo.viewType = vk::ImageViewType::eCube;
+            mImageInfo.imageType = vk::ImageType::e2D;
+            mImageInfo.flags = vk::ImageCreateFlagBits::eCubeCompatible;
+            mViewType = vk::ImageViewType::eCube;
             break;
         }
 
-        mImage = std::make_shared<Vulkan::Image>(vulkan.getAllocator(), imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal);
-
-        viewInfo.image = mImage->get();
-        mImageView = device.getVkHandle().createImageView(viewInfo);
+        createImage(std::min(_firstResidentMip, _mipLevel - 1));
 
         // Create vk::Sampler
         vk::SamplerCreateInfo samplerInfo;
@@ -179,29 +135,129 @@ namespace Mix {
         samplerInfo.maxLod = static_cast<float>(_mipLevel);
 
         mSampler = vulkan.getLogicalDevice()->getVkHandle().createSampler(samplerInfo);
+    }
 
-        vk::ImageSubresourceRange subresourceRange;
-        subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-        subresourceRange.baseMipLevel = 0;
-        subresourceRange.levelCount = _mipLevel;
-        subresourceRange.baseArrayLayer = 0;
-        subresourceRange.layerCount = _layer;
+    void Texture::setFirstResidentMip(uint32_t _mipLevel) {
+        _mipLevel = std::min(_mipLevel, mipLevels() - 1);
+        if (_mipLevel == mFirstResidentMip)
+            return;
 
-        Vulkan::CommandBufferHandle handle(vulkan.getTransferCommandPool());
-        handle.begin(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-        Vulkan::Image::TransferVkImageLayout(handle.get(), mImage->get(),
-                                             vk::ImageLayout::eUndefined,
-                                             vk::ImageLayout::eShaderReadOnlyOptimal,
-                                             subresourceRange);
-        handle.end();
-        handle.submit();
-        handle.wait();
+        // frames in flight may still sample the old image
+        auto& vulkan = Graphics::Get()->getRenderApi();
+        auto device = vulkan.getLogicalDevice();
+        auto oldImage = mImage;
+        auto oldView = mImageView;
+        vulkan.getUploadManager().deferRelease(std::shared_ptr<void>(nullptr, [device, oldImage, oldView](void*) {
+            device->getVkHandle().destroyImageView(oldView);
+        }));
+
+        const auto oldFirstMip = mFirstResidentMip;
+        createImage(_mipLevel);
+        ++mRevision;
+
+        // mips held by both images are copied on the gpu instead of being uploaded again
+        std::vector<vk::ImageCopy> regions;
+        for (auto mip = std::max(oldFirstMip, _mipLevel); mip < mipLevels(); ++mip) {
+            const auto extent = GetMipmapExtent(mImageInfo.extent.width, mImageInfo.extent.height, mip);
+
+            vk::ImageCopy region;
+            region.srcSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, mip - oldFirstMip, 0, mImageInfo.arrayLayers);
+            region.dstSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, mip - _mipLevel, 0, mImageInfo.arrayLayers);
+            region.extent = vk::Extent3D(extent.x, extent.y, mImageInfo.extent.depth);
+            regions.push_back(region);
+        }
+
+        auto newImage = mImage;
+        vulkan.getUploadManager().addGraphicsCommand([oldImage, newImage, regions](const vk::CommandBuffer& _cmd) {
+            const auto levelCount = static_cast<uint32_t>(regions.size());
+            const auto barrier = [levelCount](const Vulkan::Image& _image, uint32_t _baseLevel,
+                                              vk::ImageLayout _oldLayout, vk::ImageLayout _newLayout,
+                                              vk::AccessFlags _srcAccess, vk::AccessFlags _dstAccess) {
+                vk::ImageMemoryBarrier result;
+                result.image = _image.get();
+                result.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, _baseLevel, levelCount, 0, _image.arrayLevels());
+                result.oldLayout = _oldLayout;
+                result.newLayout = _newLayout;
+                result.srcAccessMask = _srcAccess;
+                result.dstAccessMask = _dstAccess;
+                result.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                result.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                return result;
+            };
+
+            const auto srcLevel = regions.front().srcSubresource.mipLevel;
+            const auto dstLevel = regions.front().dstSubresource.mipLevel;
+
+            const vk::ImageMemoryBarrier before[] = {
+                barrier(*oldImage, srcLevel, vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferSrcOptimal,
+                        vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eTransferRead),
+                barrier(*newImage, dstLevel, vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferDstOptimal,
+                        vk::AccessFlags(), vk::AccessFlagBits::eTransferWrite)
+            };
+            _cmd.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eTransfer,
+                                 vk::DependencyFlags(), nullptr, nullptr, before);
+
+            _cmd.copyImage(oldImage->get(), vk::ImageLayout::eTransferSrcOptimal,
+                           newImage->get(), vk::ImageLayout::eTransferDstOptimal,
+                           regions);
+
+            // frames recorded before the descriptors are rewritten may still sample the old image
+            const vk::ImageMemoryBarrier after[] = {
+                barrier(*oldImage, srcLevel, vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                        vk::AccessFlags(), vk::AccessFlagBits::eShaderRead),
+                barrier(*newImage, dstLevel, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                        vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead)
+            };
+            _cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands,
+                                 vk::DependencyFlags(), nullptr, nullptr, after);
+        });
+    }
+
+    void Texture::createImage(uint32_t _firstResidentMip) {
+        auto& vulkan = Graphics::Get()->getRenderApi();
+
+        auto imageInfo = mImageInfo;
+        const auto extent = GetMipmapExtent(mImageInfo.extent.width, mImageInfo.extent.height, _firstResidentMip);
+        imageInfo.extent = vk::Extent3D(extent.x, extent.y, mImageInfo.extent.depth);
+        imageInfo.mipLevels = mImageInfo.mipLevels - _firstResidentMip;
+
+        mImage = std::make_shared<Vulkan::Image>(vulkan.getAllocator(), imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+        // vk::ImageView
+        vk::ImageViewCreateInfo viewInfo;
+        viewInfo.image = mImage->get();
+        viewInfo.viewType = mViewType;
+        viewInfo.format = imageInfo.format;
+        viewInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = imageInfo.mipLevels;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = imageInfo.arrayLayers;
+
+        mImageView = vulkan.getLogicalDevice()->getVkHandle().createImageView(viewInfo);
+        mFirstResidentMip = _firstResidentMip;
+
+        vulkan.getUploadManager().initializeImage(mImage, viewInfo.subresourceRange);
+    }
+
+    bool Texture::IsFormatSupported(TextureFormat _format) {
+        const auto format = ToVkFormat(_format);
+        if (format == vk::Format::eUndefined)
+            return false;
+
+        return Graphics::Get()->getRenderApi().getPhysicalDevice()->checkFormatFeatureSupport(format, vk::ImageTiling::eOptimal,
+                                                                                               vk::FormatFeatureFlagBits::eSampledImage |
+                                                                                               vk::FormatFeatureFlagBits::eSampledImageFilterLinear);
     }
 
     vk::Format Texture::ToVkFormat(TextureFormat _format) {
         switch (_format) {
         case TextureFormat::R8G8B8A8_Unorm: return vk::Format::eR8G8B8A8Unorm;
         case TextureFormat::B8G8R8A8_Unorm: return vk::Format::eB8G8R8A8Unorm;
+        case TextureFormat::BC1_RGBA_Unorm: return vk::Format::eBc1RgbaUnormBlock;
+        case TextureFormat::BC3_Unorm: return vk::Format::eBc3UnormBlock;
+        case TextureFormat::BC5_Unorm: return vk::Format::eBc5UnormBlock;
+        case TextureFormat::BC7_Unorm: return vk::Format::eBc7UnormBlock;
         default:return vk::Format::eUndefined;
         }
     }
@@ -210,6 +266,10 @@ namespace Mix {
         switch (_format) {
         case vk::Format::eR8G8B8A8Unorm:return TextureFormat::R8G8B8A8_Unorm;
         case vk::Format::eB8G8R8A8Unorm:return TextureFormat::B8G8R8A8_Unorm;
+        case vk::Format::eBc1RgbaUnormBlock:return TextureFormat::BC1_RGBA_Unorm;
+        case vk::Format::eBc3UnormBlock:return TextureFormat::BC3_Unorm;
+        case vk::Format::eBc5UnormBlock:return TextureFormat::BC5_Unorm;
+        case vk::Format::eBc7UnormBlock:return TextureFormat::BC7_Unorm;
         default: return TextureFormat::Unknown;
         }
     }
@@ -244,7 +304,12 @@ namespace Mix {
                                          uint32_t _width, uint32_t _height,
                                          const vk::ImageSubresourceLayers& _subresource) {
         auto& vulkan = Graphics::Get()->getRenderApi();
-        Vulkan::CommandBufferHandle handle(vulkan.getTransferCommandPool());
+        // pending uploads have to land before the read back
+        vulkan.getUploadManager().flush(true);
+        vulkan.waitDeviceIdle();
+
+        // the image is owned by the graphics family, e.g. the offscreen target rendered there
+        Vulkan::CommandBufferHandle handle(vulkan.getGraphicsCommandPool());
 
         vk::ImageCreateInfo stagingCreateInfo;
         stagingCreateInfo.imageType = vk::ImageType::e2D;
@@ -324,194 +389,24 @@ namespace Mix {
         handle.submit();
         handle.wait();
 
-        std::vector<char> result(staging.size());
-        memcpy(result.data(), staging.rawPtr(), staging.size());
-        return result;
-    }
-
-    void Texture::GenMipMap(const vk::CommandBuffer& _cmd, const Vulkan::Image& _image, uint32_t _layer) {
-        auto& vulkan = Graphics::Get()->getRenderApi();
-        auto support = vulkan.getPhysicalDevice()->checkFormatFeatureSupport(_image.format(), vk::ImageTiling::eOptimal,
-                                                                             vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear);
-
-        if (!support)
-            return;
-
-        vk::ImageMemoryBarrier barrier;
-        barrier.image = _image.get();
-        barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-        barrier.subresourceRange.baseArrayLayer = _layer;
-        barrier.subresourceRange.layerCount = 1;
-        barrier.subresourceRange.levelCount = 1;
-        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-
-        auto mipWidth = _image.extent().width;
-        auto mipHeight = _image.extent().height;
-
-        // ImageLayout of each mipLevel is ShaderReadOnlyOptimal
-
-        // change ImageLayout of mipLevel 0 to TransferSrcOptimal
-        barrier.subresourceRange.baseMipLevel = 0;
-        barrier.oldLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-        barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
-        barrier.srcAccessMask = vk::AccessFlagBits::eShaderRead;
-        barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
-
-        _cmd.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader,
-                             vk::PipelineStageFlagBits::eTransfer,
-                             vk::DependencyFlags(),
-                             nullptr, nullptr, barrier);
-
-        uint32_t i = 1;
-        for (; i < _image.mipLevels() - 1; ++i) {
-            // MipLevel		ImageLayout
-            //		i-1		TransferSrc
-            //	>	i		 ShaderRead  ->TransferDst
-            //		i+1		 ShaderRead
-
-            barrier.subresourceRange.baseMipLevel = i;
-            barrier.oldLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-            barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
-            barrier.srcAccessMask = vk::AccessFlagBits::eShaderRead;
-            barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
-
-            _cmd.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader,
-                                 vk::PipelineStageFlagBits::eTransfer,
-                                 vk::DependencyFlags(),
-                                 nullptr, nullptr, barrier);
-
-            vk::ImageBlit blit;
-            blit.srcOffsets[0] = vk::Offset3D{ 0, 0, 0 };
-            blit.srcOffsets[1] = vk::Offset3D{ static_cast<int32_t>(mipWidth), static_cast<int32_t>(mipHeight), 1 };
-            blit.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-            blit.srcSubresource.mipLevel = i - 1;
-            blit.srcSubresource.baseArrayLayer = _layer;
-            blit.srcSubresource.layerCount = 1;
-
-            blit.dstOffsets[0] = vk::Offset3D{ 0, 0, 0 };
-            blit.dstOffsets[1] = vk::Offset3D{ static_cast<int32_t>(mipWidth > 1 ? mipWidth >>= 1 : 1),
-                                               static_cast<int32_t>(mipHeight > 1 ? mipHeight >>= 1 : 1),
-                                               1 };
-            blit.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-            blit.dstSubresource.mipLevel = i;
-            blit.dstSubresource.baseArrayLayer = _layer;
-            blit.dstSubresource.layerCount = 1;
-
-            _cmd.blitImage(_image.get(), vk::ImageLayout::eTransferSrcOptimal,
-                           _image.get(), vk::ImageLayout::eTransferDstOptimal,
-                           blit, vk::Filter::eLinear);
-
-            // MipLevel		ImageLayout
-            //		i-1		TransferSrc  ->ShaderRead
-            //	>	i		TransferDst
-            //		i+1		 ShaderRead
-
-            barrier.subresourceRange.baseMipLevel = i - 1;
-            barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
-            barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-            barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
-            barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-
-            _cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
-                                 vk::PipelineStageFlagBits::eFragmentShader,
-                                 vk::DependencyFlags(),
-                                 nullptr, nullptr, barrier);
-
-            // MipLevel		ImageLayout
-            //		i-1		 ShaderRead
-            //	>	i		TransferDst  ->TransferSrc
-            //		i+1		 ShaderRead
-
-            barrier.subresourceRange.baseMipLevel = i;
-            barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-            barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
-            barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-            barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
-
-            _cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
-                                 vk::PipelineStageFlagBits::eTransfer,
-                                 vk::DependencyFlags(),
-                                 nullptr, nullptr, barrier);
-
-            // MipLevel		ImageLayout
-            //		i-1		 ShaderRead
-            //	>	i		TransferSrc
-            //		i+1		 ShaderRead
+        // rows of the linear image may be padded, gli formats share the values of Vulkan formats
+        const auto format = static_cast<gli::format>(_image.format());
+        const auto blockExtent = gli::block_extent(format);
+        const size_t rowSize = static_cast<size_t>((_width + blockExtent.x - 1) / blockExtent.x) * gli::block_size(format);
+        const uint32_t rowCount = (_height + blockExtent.y - 1) / blockExtent.y;
+
+        std::vector<char> result(rowSize * rowCount * _subresource.layerCount);
+        const auto& device = vulkan.getLogicalDevice()->getVkHandle();
+        for (uint32_t layer = 0; layer < _subresource.layerCount; ++layer) {
+            const auto layout = device.getImageSubresourceLayout(staging.get(),
+                                                                 vk::ImageSubresource(vk::ImageAspectFlagBits::eColor, 0, layer));
+            for (uint32_t row = 0; row < rowCount; ++row) {
+                memcpy(result.data() + (static_cast<size_t>(layer) * rowCount + row) * rowSize,
+                       staging.rawPtr() + layout.offset + row * layout.rowPitch,
+                       rowSize);
+            }
         }
-
-        // MipLevel		ImageLayout
-        //      ...		 ShaderRead
-        //		n-2		TransferSrc
-        //	>	n-1		 ShaderRead  ->TransferDst
-
-        barrier.subresourceRange.baseMipLevel = i;
-        barrier.oldLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-        barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
-        barrier.srcAccessMask = vk::AccessFlagBits::eShaderRead;
-        barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
-
-        _cmd.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader,
-                             vk::PipelineStageFlagBits::eTransfer,
-                             vk::DependencyFlags(),
-                             nullptr, nullptr, barrier);
-
-        vk::ImageBlit blit;
-        blit.srcOffsets[0] = vk::Offset3D{ 0, 0, 0 };
-        blit.srcOffsets[1] = vk::Offset3D{ static_cast<int32_t>(mipWidth), static_cast<int32_t>(mipHeight), 1 };
-        blit.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-        blit.srcSubresource.mipLevel = i - 1;
-        blit.srcSubresource.baseArrayLayer = _layer;
-        blit.srcSubresource.layerCount = 1;
-
-        blit.dstOffsets[0] = vk::Offset3D{ 0, 0, 0 };
-        blit.dstOffsets[1] = vk::Offset3D{ static_cast<int32_t>(mipWidth > 1 ? mipWidth >>= 1 : 1),
-                                           static_cast<int32_t>(mipHeight > 1 ? mipHeight >>= 1 : 1),
-                                           1 };
-        blit.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-        blit.dstSubresource.mipLevel = i;
-        blit.dstSubresource.baseArrayLayer = _layer;
-        blit.dstSubresource.layerCount = 1;
-
-        _cmd.blitImage(_image.get(), vk::ImageLayout::eTransferSrcOptimal,
-                       _image.get(), vk::ImageLayout::eTransferDstOptimal,
-                       blit, vk::Filter::eLinear);
-
-        // MipLevel		ImageLayout
-        //      ...		 ShaderRead
-        //		n-2		TransferSrc  ->ShaderRead
-        //	>	n-1		TransferDst
-
-        barrier.subresourceRange.baseMipLevel = i - 1;
-        barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
-        barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-        barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
-        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-
-        _cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
-                             vk::PipelineStageFlagBits::eFragmentShader,
-                             vk::DependencyFlags(),
-                             nullptr, nullptr, barrier);
-
-        // MipLevel		ImageLayout
-        //      ...		 ShaderRead
-        //		n-2		 ShaderRead
-        //	>	n-1		TransferDst  ->ShaderRead
-        barrier.subresourceRange.baseMipLevel = i;
-        barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-        barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-
-        _cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
-                             vk::PipelineStageFlagBits::eFragmentShader,
-                             vk::DependencyFlags(),
-                             nullptr, nullptr, barrier);
-
-        // MipLevel		ImageLayout
-        //		  0		 ShaderRead
-        //		...		 ShaderRead
-        //		n-1		 ShaderRead
+        return result;
     }
 
     Texture2D::Texture2D(uint32_t _width,
@@ -522,6 +417,15 @@ namespace Mix {
         Texture(TextureType::Tex_2D, _width, _height, 1, _format, _mipLevel, 1, _samplerInfo) {
     }
 
+    Texture2D::Texture2D(uint32_t _width,
+                         uint32_t _height,
+                         TextureFormat _format,
+                         uint32_t _mipLevel,
+                         SamplerInfo _samplerInfo,
+                         uint32_t _firstResidentMip) :
+        Texture(TextureType::Tex_2D, _width, _height, 1, _format, _mipLevel, 1, _samplerInfo, _firstResidentMip) {
+    }
+
     void Texture2D::setPixels(const void* _pixels, uint64_t _size, uint32_t _mipLevel) {
         if (_mipLevel < mipLevels()) {
             auto extent = GetMipmapExtent(width(), height(), _mipLevel);
@@ -537,22 +441,20 @@ namespace Mix {
                               uint32_t _height,
                               uint32_t _mipLevel) {
         if (_mipLevel < mipLevels()) {
-            auto src = std::make_shared<Vulkan::Buffer>(mImage->getAllocator(), vk::BufferUsageFlagBits::eTransferSrc,
-                                                        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-                                                        _size, _pixels);
+            const auto* bytes = static_cast<const char*>(_pixels);
 
             mTransfers.emplace_back(std::piecewise_construct,
                                     std::forward_as_tuple(CopyToDstImageInfo{ _mipLevel, 0,Vector2ui(_x,_y),Vector2ui(_width,_height) }),
-                                    std::forward_as_tuple(src));
+                                    std::forward_as_tuple(bytes, bytes + _size));
         }
     }
 
     std::vector<char> Texture2D::getPixels(uint32_t _mipLevel) {
-        if (_mipLevel >= mipLevels())
+        if (_mipLevel >= mipLevels() || _mipLevel < mFirstResidentMip)
             return {};
 
         auto extent = GetMipmapExtent(width(), height(), _mipLevel);
-        return GetPixels(*mImage, 0, 0, extent.x, extent.y, vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, _mipLevel, 0, 1));
+        return GetPixels(*mImage, 0, 0, extent.x, extent.y, vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, _mipLevel - mFirstResidentMip, 0, 1));
     }
 
     std::vector<char> Texture2D::getPixels(uint32_t _x,
@@ -560,10 +462,10 @@ namespace Mix {
                                            uint32_t _width,
                                            uint32_t _height,
                                            uint32_t _mipLevel) const {
-        if (_mipLevel >= mipLevels())
+        if (_mipLevel >= mipLevels() || _mipLevel < mFirstResidentMip)
             return {};
 
-        return GetPixels(*mImage, _x, _y, _width, _height, vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, _mipLevel, 0, 1));
+        return GetPixels(*mImage, _x, _y, _width, _height, vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, _mipLevel - mFirstResidentMip, 0, 1));
     }
 
     CubeMap::CubeMap(uint32_t _width,
@@ -589,13 +491,11 @@ namespace Mix {
                             uint32_t _width, uint32_t _height,
                             CubeMapFace _face, uint32_t _mipLevel) {
         if (_mipLevel < mipLevels()) {
-            auto src = std::make_shared<Vulkan::Buffer>(mImage->getAllocator(), vk::BufferUsageFlagBits::eTransferSrc,
-                                                        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-                                                        _size, _pixels);
+            const auto* bytes = static_cast<const char*>(_pixels);
 
             mTransfers.emplace_back(std::piecewise_construct,
                                     std::forward_as_tuple(CopyToDstImageInfo{ _mipLevel,GetFaceLayerIndex(_face),Vector2ui(_x,_y),Vector2ui(_width,_height) }),
-                                    std::forward_as_tuple(src));
+                                    std::forward_as_tuple(bytes, bytes + _size));
         }
     }
 
@@ -627,15 +527,4 @@ namespace Mix {
         default:return 0;
         }
     }
-
-    void CubeMap::genMipmaps(const vk::CommandBuffer& _cmd) const {
-        auto& vulkan = Graphics::Get()->getRenderApi();
-        auto support = vulkan.getPhysicalDevice()->checkFormatFeatureSupport(mImage->format(), vk::ImageTiling::eOptimal,
-                                                                             vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear);
-        if (support) {
-            for (uint32_t face = 0; face < 6; ++face) {
-                GenMipMap(_cmd, *mImage, face);
-            }
-        }
-    }
 }
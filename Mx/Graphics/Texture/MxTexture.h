@@ -15,6 +15,8 @@ namespace Mix {
 		class Buffer;
 	}
 
+	class TextureStreamer;
+
 	struct SamplerInfo {
 		TextureFilterMode minFilter = TextureFilterMode::Nearest;
 		TextureFilterMode magFilter = TextureFilterMode::Nearest;
@@ -26,6 +28,7 @@ namespace Mix {
 	};
 
 	class Texture :public ResourceBase, public Vulkan::Descriptor, public GeneralBase::NoCopyBase {
+		friend class TextureStreamer;
 	public:
         virtual ~Texture();
 
@@ -47,14 +50,22 @@ namespace Mix {
 
 		Vector2i extent(uint32_t _mipLevel = 0) const;
 
-		uint32_t mipLevels() const { return mImage->mipLevels(); }
+		uint32_t mipLevels() const { return mImageInfo.mipLevels; }
+
+		uint32_t arrayLevels() const { return mImageInfo.arrayLayers; }
+
+		/** @brief Finest mip level held by the GPU image, mip 0 of getImage() is this level */
+		uint32_t firstResidentMip() const { return mFirstResidentMip; }
 
-		uint32_t arrayLevels() const { return mImage->arrayLevels(); }
+		/** @brief Changes whenever the image view is replaced, descriptors referencing the old view have to be rewritten */
+		uint32_t revision() const { return mRevision; }
 
 		TextureFormat format() const;
 
 		TextureType type() const { return mType; }
 
+		uint64_t memorySize() const override { return mImage ? mImage->size() : 0; }
+
 		TextureWrapMode wrapModeU() const { return mSamplerInfo.wrapModeU; }
 		TextureWrapMode wrapModeV() const { return mSamplerInfo.wrapModeV; }
 		TextureWrapMode wrapModeW() const { return mSamplerInfo.wrapModeW; }
@@ -63,12 +74,28 @@ namespace Mix {
 
 		static Vector2ui GetMipmapExtent(uint32_t _width, uint32_t _height, uint32_t _mipLevel);
 
+		/** @brief Whether the device can sample textures of @p _format */
+		static bool IsFormatSupported(TextureFormat _format);
+
+		/**
+		 * @brief Read a region of @p _image back to the cpu, waits for the device to be idle.
+		 *        The image has to be in shader read only layout and is left in it, rows are returned tightly packed.
+		 */
+		static std::vector<char> GetPixels(const Vulkan::Image& _image, uint32_t _x, uint32_t _y, uint32_t _width, uint32_t _height, const vk::ImageSubresourceLayers& _subresource);
+
 	protected:
 		Texture(TextureType _type,
 				uint32_t _width, uint32_t _height, uint32_t _depth,
 				TextureFormat _format,
 				uint32_t _mipLevel = 1, uint32_t _layer = 1,
-				SamplerInfo _samplerInfo = {});
+				SamplerInfo _samplerInfo = {},
+				uint32_t _firstResidentMip = 0);
+
+		/**
+		 * @brief Recreate the image holding only the mips from @p _mipLevel on.
+		 *        Mips the old image holds as well are copied on the gpu, the finer ones are undefined until they are uploaded.
+		 */
+		void setFirstResidentMip(uint32_t _mipLevel);
 
 		std::shared_ptr<Vulkan::Image> mImage;
 		vk::ImageView mImageView;
@@ -77,6 +104,12 @@ namespace Mix {
 		TextureType mType;
 		bool mChanged = false;
 
+		// describes the full mip chain, the image itself may omit the finest mips
+		vk::ImageCreateInfo mImageInfo;
+		vk::ImageViewType mViewType = vk::ImageViewType::e2D;
+		uint32_t mFirstResidentMip = 0;
+		uint32_t mRevision = 0;
+
 		struct CopyToDstImageInfo {
 			uint32_t mipLevel;
 			uint32_t layer;
@@ -84,7 +117,8 @@ namespace Mix {
 			Vector2ui extent;
 		};
 
-		std::vector<std::pair<CopyToDstImageInfo, std::shared_ptr<Vulkan::Buffer>>> mTransfers;
+		// pixels are handed to the upload manager by apply()
+		std::vector<std::pair<CopyToDstImageInfo, std::vector<char>>> mTransfers;
 
 		static vk::Format ToVkFormat(TextureFormat _format);
 
@@ -96,9 +130,8 @@ namespace Mix {
 
 		static vk::SamplerAddressMode ToVkSamplerAddressMode(TextureWrapMode _wrapMode);
 
-		static std::vector<char> GetPixels(const Vulkan::Image& _image, uint32_t _x, uint32_t _y, uint32_t _width, uint32_t _height, const vk::ImageSubresourceLayers& _subresource);
-
-		static void GenMipMap(const vk::CommandBuffer& _cmd, const Vulkan::Image& _image, uint32_t _layer);
+	private:
+		void createImage(uint32_t _firstResidentMip);
 	};
 
 	class Texture2D final :public Texture {
@@ -109,6 +142,14 @@ namespace Mix {
 				  uint32_t _mipLevel = 1,
 				  SamplerInfo _samplerInfo = {});
 
+		/** @brief Create a texture whose GPU image starts at @p _firstResidentMip, used by TextureStreamer */
+		Texture2D(uint32_t _width,
+				  uint32_t _height,
+				  TextureFormat _format,
+				  uint32_t _mipLevel,
+				  SamplerInfo _samplerInfo,
+				  uint32_t _firstResidentMip);
+
 		// void apply(bool _updateMipmaps = true) override;
 
 		void setPixels(const void* _pixels, uint64_t _size, uint32_t _mipLevel = 0);
@@ -139,16 +180,26 @@ namespace Mix {
 
 	private:
 		static uint32_t GetFaceLayerIndex(CubeMapFace _face);
-
-		void genMipmaps(const vk::CommandBuffer& _cmd) const;
 	};
 
 
 	// ---------------- Texture Additional Param-----------------
 
+	enum class TextureContent {
+		Color,
+		// tangent space normals in RG, B is reconstructed
+		Normal
+	};
+
 	struct TextureParam {
 		uint32_t mipLevel = 1;
 		SamplerInfo samplerInfo;
+
+		TextureContent content = TextureContent::Color;
+
+		// block compressed format png and jpg images are transcoded to,
+		// Unknown picks BC7 for colors and BC5 for normals, R8G8B8A8_Unorm disables transcoding
+		TextureFormat compression = TextureFormat::Unknown;
 	};
 
 	template<>
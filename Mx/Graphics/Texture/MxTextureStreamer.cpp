@@ -0,0 +1,333 @@
+#include "MxTextureStreamer.h"
+#include "../MxGraphics.h"
+#include "../MxMaterial.h"
+#include "../MxRenderInfo.h"
+#include "../Mesh/MxMesh.h"
+#include "../../Component/Camera/MxCamera.h"
+#include "../../Component/Transform/MxTransform.h"
+#include "../../Vulkan/MxVulkan.h"
+#include "../../Vulkan/Buffers/MxVkUploadManager.h"
+#include "../../Resource/MxResourceLoader.h"
+#include "../../Utils/MxThreadPool.h"
+#include "../../Log/MxLog.h"
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+
+namespace Mix {
+    uint64_t TextureStreamer::Entry::residentSize(uint32_t _firstMip) const {
+        uint64_t size = 0;
+        for (auto mip = _firstMip; mip < mipSizes.size(); ++mip)
+            size += mipSizes[mip];
+        return size;
+    }
+
+    std::shared_ptr<Texture2D> TextureStreamer::createTexture(uint32_t _width,
+                                                              uint32_t _height,
+                                                              TextureFormat _format,
+                                                              MipChain _mips,
+                                                              MipSource _source,
+                                                              const SamplerInfo& _samplerInfo) {
+        const auto mipCount = std::max(static_cast<uint32_t>(_mips.size()), 1u);
+
+        // without a source evicted mips could not come back
+        if (!mSettings.enabled || mipCount == 1 || !_source) {
+            auto texture = std::make_shared<Texture2D>(_width, _height, _format, mipCount, _samplerInfo);
+            for (uint32_t mip = 0; mip < _mips.size(); ++mip)
+                texture->setPixels(_mips[mip].data(), _mips[mip].size(), mip);
+            texture->apply(false);
+            return texture;
+        }
+
+        uint32_t tailMip = 0;
+        while (tailMip + 1 < mipCount) {
+            const auto extent = Texture::GetMipmapExtent(_width, _height, tailMip);
+            if (std::max(extent.x, extent.y) <= mSettings.mipTailSize)
+                break;
+            ++tailMip;
+        }
+
+        auto texture = std::make_shared<Texture2D>(_width, _height, _format, mipCount, _samplerInfo, tailMip);
+
+        Entry entry;
+        entry.texture = texture;
+        entry.source = std::move(_source);
+        for (auto& mip : _mips)
+            entry.mipSizes.push_back(mip.size());
+        entry.tailMip = entry.wantedMip = entry.targetMip = tailMip;
+        entry.lastUsedFrame = mFrame;
+
+        // the tail makes the texture usable before the camera has seen it
+        Upload(*texture, MipChain(std::make_move_iterator(_mips.begin() + tailMip), std::make_move_iterator(_mips.end())), tailMip);
+
+        mEntries.push_back(std::move(entry));
+        return texture;
+    }
+
+    void TextureStreamer::update(const Camera& _camera, const std::vector<RenderElement>& _elements) {
+        ++mFrame;
+
+        mEntries.erase(std::remove_if(mEntries.begin(), mEntries.end(), [](const Entry& _entry) {
+                           return _entry.texture.expired();
+                       }),
+                       mEntries.end());
+
+        if (!mSettings.enabled || mEntries.empty())
+            return;
+
+        std::unordered_map<const Texture*, Entry*> lookup;
+        for (auto& entry : mEntries) {
+            lookup[entry.texture.lock().get()] = &entry;
+            entry.wantedMip = entry.tailMip;
+        }
+
+        // ---------- wanted mips ----------
+
+        const Vector3f cameraPos = _camera.transform()->getPosition();
+        // pixels covered by one world unit at a distance of one unit
+        const float pixelsPerUnit = _camera.getExtent().y / (2.0f * std::tan(Math::Radians(_camera.getFov()) * 0.5f));
+
+        for (auto& element : _elements) {
+            if (!element.mesh || !element.material)
+                continue;
+
+            const auto scale = element.transform->getLossyScale();
+            const float maxScale = std::max({ std::abs(scale.x), std::abs(scale.y), std::abs(scale.z), Math::Constants::Epsilon });
+            const float distance = std::max((element.transform->getPosition() - cameraPos).length(), 0.1f);
+
+            // meshes without UV0 are assumed to map the texture once per unit
+            float uvDensity = element.mesh->getUVDensity();
+            if (uvDensity <= 0.0f)
+                uvDensity = 1.0f;
+
+            // texels of a texture with a size of one covered by a pixel
+            const float texelsPerPixel = uvDensity / maxScale * distance / pixelsPerUnit;
+
+            for (auto& texture : element.material->getTextures()) {
+                auto it = lookup.find(texture.get());
+                if (it == lookup.end())
+                    continue;
+
+                auto& entry = *it->second;
+                const float size = static_cast<float>(std::max(texture->width(), texture->height()));
+                const float mip = std::log2(std::max(size * texelsPerPixel, 1.0f)) + mSettings.mipBias;
+
+                entry.wantedMip = std::min(entry.wantedMip, static_cast<uint32_t>(std::max(mip, 0.0f)));
+                entry.lastUsedFrame = mFrame;
+            }
+        }
+
+        // ---------- targets, finer mips are evicted with a delay ----------
+
+        for (auto& entry : mEntries) {
+            const auto resident = entry.texture.lock()->firstResidentMip();
+
+            // without a source evicted mips would be lost for good
+            if (!entry.source) {
+                entry.targetMip = resident;
+                continue;
+            }
+
+            if (entry.wantedMip < resident) {
+                entry.targetMip = entry.wantedMip;
+                entry.coarserSince = 0;
+            }
+            else if (entry.wantedMip > resident) {
+                if (entry.coarserSince == 0)
+                    entry.coarserSince = mFrame;
+                entry.targetMip = mFrame - entry.coarserSince >= mSettings.evictionDelay ? entry.wantedMip : resident;
+            }
+            else {
+                entry.targetMip = resident;
+                entry.coarserSince = 0;
+            }
+        }
+
+        applyBudget();
+
+        // ---------- residency changes ----------
+
+        std::vector<Entry*> changes;
+        for (auto& entry : mEntries) {
+            const auto resident = entry.texture.lock()->firstResidentMip();
+            if (entry.targetMip != resident)
+                changes.push_back(&entry);
+
+            // a load that is no longer needed only holds memory, its worker drops the result
+            if (entry.load && entry.targetMip >= resident)
+                entry.load.reset();
+        }
+
+        // evictions first since they free memory, then the textures missing the most mips
+        std::sort(changes.begin(), changes.end(), [](const Entry* _a, const Entry* _b) {
+            const int missingA = static_cast<int>(_a->texture.lock()->firstResidentMip()) - static_cast<int>(_a->targetMip);
+            const int missingB = static_cast<int>(_b->texture.lock()->firstResidentMip()) - static_cast<int>(_b->targetMip);
+            if ((missingA < 0) != (missingB < 0))
+                return missingA < 0;
+            return missingA > missingB;
+        });
+
+        uint64_t uploaded = 0;
+        for (auto entry : changes) {
+            auto texture = entry->texture.lock();
+            const auto resident = texture->firstResidentMip();
+
+            // the remaining mips are copied from the current image, nothing is uploaded
+            if (entry->targetMip > resident) {
+                texture->setFirstResidentMip(entry->targetMip);
+                continue;
+            }
+
+            if (entry->load) {
+                finishLoad(*entry, *texture);
+                continue;
+            }
+
+            // the limit is applied when a load starts, its result is uploaded whenever it is ready
+            const auto size = entry->residentSize(entry->targetMip) - entry->residentSize(resident);
+            if (uploaded != 0 && uploaded + size > mSettings.maxUploadBytesPerFrame)
+                continue;
+
+            startLoad(*entry, entry->targetMip);
+            uploaded += size;
+        }
+    }
+
+    TextureStreamingStatistics TextureStreamer::getStatistics() const {
+        TextureStreamingStatistics result;
+        for (auto& entry : mEntries) {
+            auto texture = entry.texture.lock();
+            if (!texture)
+                continue;
+
+            ++result.textureCount;
+            if (entry.targetMip != texture->firstResidentMip())
+                ++result.pendingCount;
+            result.residentSize += entry.residentSize(texture->firstResidentMip());
+            result.wantedSize += entry.residentSize(entry.wantedMip);
+        }
+        return result;
+    }
+
+    void TextureStreamer::applyBudget() {
+        uint64_t total = 0;
+        for (auto& entry : mEntries)
+            total += entry.residentSize(entry.targetMip);
+
+        while (total > mSettings.budget) {
+            Entry* victim = nullptr;
+            for (auto& entry : mEntries) {
+                if (entry.targetMip >= entry.tailMip || !entry.source)
+                    continue;
+
+                // textures not seen this frame go first, then the largest mip
+                const bool unused = entry.lastUsedFrame != mFrame;
+                if (!victim) {
+                    victim = &entry;
+                    continue;
+                }
+
+                const bool victimUnused = victim->lastUsedFrame != mFrame;
+                if (unused != victimUnused) {
+                    if (unused)
+                        victim = &entry;
+                }
+                else if (entry.mipSizes[entry.targetMip] > victim->mipSizes[victim->targetMip])
+                    victim = &entry;
+            }
+
+            if (!victim)
+                break;
+
+            total -= victim->mipSizes[victim->targetMip];
+            ++victim->targetMip;
+        }
+    }
+
+    void TextureStreamer::startLoad(Entry& _entry, uint32_t _firstMip) {
+        auto load = std::make_shared<MipLoad>();
+        load->firstMip = _firstMip;
+        load->lastMip = _entry.texture.lock()->firstResidentMip();
+        _entry.load = load;
+
+        ResourceLoader::Get()->getWorkers().enqueue([load, source = _entry.source] {
+            load->mips = source(load->firstMip, load->lastMip);
+            load->done.store(true, std::memory_order_release);
+        });
+    }
+
+    void TextureStreamer::finishLoad(Entry& _entry, Texture2D& _texture) {
+        if (!_entry.load->done.load(std::memory_order_acquire))
+            return;
+
+        const auto load = std::move(_entry.load);
+        if (load->lastMip != _texture.firstResidentMip())
+            return;
+
+        bool valid = load->mips.size() == load->lastMip - load->firstMip;
+        for (size_t i = 0; valid && i < load->mips.size(); ++i)
+            valid = load->mips[i].size() == _entry.mipSizes[load->firstMip + i];
+
+        if (!valid) {
+            // the source changed or is gone, the texture keeps the mips it has
+            Log::Warning("%1%: Failed to load mips %2% to %3% of a streamed texture", __FUNCTION__, load->firstMip, load->lastMip - 1);
+            _entry.source = nullptr;
+            return;
+        }
+
+        _texture.setFirstResidentMip(load->firstMip);
+        Upload(_texture, load->mips, load->firstMip);
+    }
+
+    void TextureStreamer::Upload(Texture2D& _texture, const MipChain& _mips, uint32_t _firstMip) {
+        auto& uploader = Graphics::Get()->getRenderApi().getUploadManager();
+        for (uint32_t i = 0; i < _mips.size(); ++i) {
+            const auto mip = _firstMip + i;
+            const auto extent = Texture::GetMipmapExtent(_texture.width(), _texture.height(), mip);
+
+            vk::BufferImageCopy copy;
+            copy.imageSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, mip - _texture.firstResidentMip(), 0, 1);
+            copy.imageExtent = vk::Extent3D(extent.x, extent.y, 1);
+
+            uploader.uploadImage(_texture.mImage, _mips[i].data(), _mips[i].size(), copy);
+        }
+    }
+
+    TextureStreamer::MipChain TextureStreamer::GenerateMipChain(const char* _pixels, uint32_t _width, uint32_t _height) {
+        MipChain result;
+        result.emplace_back(_pixels, _pixels + static_cast<size_t>(_width) * _height * 4);
+
+        while (_width > 1 || _height > 1) {
+            const uint32_t width = std::max(_width >> 1, 1u);
+            const uint32_t height = std::max(_height >> 1, 1u);
+            std::vector<char> level(static_cast<size_t>(width) * height * 4);
+
+            const auto src = reinterpret_cast<const uint8_t*>(result.back().data());
+            auto dst = reinterpret_cast<uint8_t*>(level.data());
+
+            for (uint32_t y = 0; y < height; ++y) {
+                const uint32_t y0 = std::min(y * 2, _height - 1);
+                const uint32_t y1 = std::min(y * 2 + 1, _height - 1);
+
+                for (uint32_t x = 0; x < width; ++x) {
+                    const uint32_t x0 = std::min(x * 2, _width - 1);
+                    const uint32_t x1 = std::min(x * 2 + 1, _width - 1);
+
+                    for (uint32_t c = 0; c < 4; ++c) {
+                        const uint32_t sum = src[(y0 * _width + x0) * 4 + c] +
+                            src[(y0 * _width + x1) * 4 + c] +
+                            src[(y1 * _width + x0) * 4 + c] +
+                            src[(y1 * _width + x1) * 4 + c];
+                        dst[(y * width + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+                    }
+                }
+            }
+
+            result.push_back(std::move(level));
+            _width = width;
+            _height = height;
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,137 @@
+#pragma once
+#ifndef MX_TEXTURE_STREAMER_H_
+#define MX_TEXTURE_STREAMER_H_
+
+#include "MxTexture.h"
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <memory>
+
+namespace Mix {
+	class Camera;
+	struct RenderElement;
+
+	struct TextureStreamingSettings {
+		bool enabled = true;
+
+		// GPU memory the streamed textures may occupy
+		uint64_t budget = 256 * 1024 * 1024;
+
+		// mips whose larger side is not above this size are always resident
+		uint32_t mipTailSize = 64;
+
+		// bytes uploaded per frame for residency changes, at least one texture is updated per frame
+		uint64_t maxUploadBytesPerFrame = 16 * 1024 * 1024;
+
+		// frames a texture has to be wanted at a coarser mip before its finer mips are evicted
+		uint32_t evictionDelay = 120;
+
+		// added to the computed mip level, positive values trade sharpness for memory
+		float mipBias = 0.0f;
+	};
+
+	struct TextureStreamingStatistics {
+		uint32_t textureCount = 0;
+		uint32_t pendingCount = 0;
+		uint64_t residentSize = 0;
+		// size all textures would need at the mips wanted by the camera
+		uint64_t wantedSize = 0;
+	};
+
+	/**
+	 * @brief Keeps only the mips of a texture resident that the renderers using it need.
+	 *
+	 * A streamed texture starts with its mip tail, so it can be used right away. Each frame the
+	 * finest needed mip is estimated from the camera distance and the UV density of the meshes
+	 * using the texture, and textures are recreated with more or fewer mips under the budget.
+	 * Only the GPU holds the pixels: mips that stay resident are copied into the recreated image,
+	 * missing ones are loaded from the source of the texture again on the resource workers.
+	 */
+	class TextureStreamer :public GeneralBase::NoCopyBase {
+	public:
+		/** @brief Pixels of every level of a mip chain, finest first */
+		using MipChain = std::vector<std::vector<char>>;
+
+		/**
+		 * @brief Load the levels [_firstMip, _lastMip) of a texture again, e.g. from its file.
+		 *        Runs on a worker thread, an empty result keeps the texture at its current mips.
+		 */
+		using MipSource = std::function<MipChain(uint32_t _firstMip, uint32_t _lastMip)>;
+
+		/**
+		 * @brief Create a streamed texture, only the mip tail of @p _mips is uploaded and kept.
+		 *        Falls back to a regular texture holding every mip when streaming is disabled or there is no @p _source.
+		 */
+		std::shared_ptr<Texture2D> createTexture(uint32_t _width,
+												 uint32_t _height,
+												 TextureFormat _format,
+												 MipChain _mips,
+												 MipSource _source,
+												 const SamplerInfo& _samplerInfo = {});
+
+		/**
+		 * @brief Compute the wanted mip of every streamed texture and start residency changes.
+		 *        Called once per frame before rendering.
+		 */
+		void update(const Camera& _camera, const std::vector<RenderElement>& _elements);
+
+		void setSettings(const TextureStreamingSettings& _settings) { mSettings = _settings; }
+
+		const TextureStreamingSettings& getSettings() const { return mSettings; }
+
+		bool isEnabled() const { return mSettings.enabled; }
+
+		TextureStreamingStatistics getStatistics() const;
+
+		/**
+		 * @brief Build a box filtered mip chain from 8 bit, 4 channel pixels.
+		 */
+		static MipChain GenerateMipChain(const char* _pixels, uint32_t _width, uint32_t _height);
+
+	private:
+		struct MipLoad {
+			uint32_t firstMip = 0;
+			uint32_t lastMip = 0;
+			MipChain mips;
+			std::atomic<bool> done{ false };
+		};
+
+		struct Entry {
+			std::weak_ptr<Texture2D> texture;
+			MipSource source;
+			// bytes of every level, the pixels are only held by the GPU
+			std::vector<uint64_t> mipSizes;
+			uint32_t tailMip = 0;
+			// finer mips being loaded on a worker
+			std::shared_ptr<MipLoad> load;
+
+			// mip the camera asked for this frame
+			uint32_t wantedMip = 0;
+			// mip the texture is being recreated with
+			uint32_t targetMip = 0;
+			uint64_t lastUsedFrame = 0;
+			// first frame in which a coarser mip than the resident one was wanted
+			uint64_t coarserSince = 0;
+
+			uint64_t residentSize(uint32_t _firstMip) const;
+		};
+
+		void applyBudget();
+
+		/** @brief Load the mips from @p _firstMip up to the resident ones on a worker */
+		void startLoad(Entry& _entry, uint32_t _firstMip);
+
+		/** @brief Recreate the texture with the loaded mips once the load has finished */
+		void finishLoad(Entry& _entry, Texture2D& _texture);
+
+		/** @brief Upload @p _mips into the resident image, the first one is level @p _firstMip */
+		static void Upload(Texture2D& _texture, const MipChain& _mips, uint32_t _firstMip);
+
+		TextureStreamingSettings mSettings;
+		std::vector<Entry> mEntries;
+		uint64_t mFrame = 0;
+	};
+}
+
+#endif
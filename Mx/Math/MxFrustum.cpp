@@ -0,0 +1,51 @@
+#include "MxFrustum.h"
+
+namespace Mix {
+    Frustum::Frustum(const Matrix4& _viewProj) {
+        const auto r0 = _viewProj.getRow(0);
+        const auto r1 = _viewProj.getRow(1);
+        const auto r2 = _viewProj.getRow(2);
+        const auto r3 = _viewProj.getRow(3);
+
+        // Gribb-Hartmann extraction, -w <= x, y <= w and 0 <= z <= w
+        for (uint32_t i = 0; i < 4; ++i) {
+            mPlanes[Left][i] = r3[i] + r0[i];
+            mPlanes[Right][i] = r3[i] - r0[i];
+            mPlanes[Bottom][i] = r3[i] + r1[i];
+            mPlanes[Top][i] = r3[i] - r1[i];
+            mPlanes[Near][i] = r2[i];
+            mPlanes[Far][i] = r3[i] - r2[i];
+        }
+
+        for (auto& plane : mPlanes) {
+            const float length = Vector3f(plane.x, plane.y, plane.z).length();
+            if (length > 0.0f) {
+                for (uint32_t i = 0; i < 4; ++i)
+                    plane[i] /= length;
+            }
+        }
+    }
+
+    bool Frustum::intersects(const Vector3f& _center, float _radius) const {
+        for (auto& plane : mPlanes) {
+            if (plane.x * _center.x + plane.y * _center.y + plane.z * _center.z + plane.w < -_radius)
+                return false;
+        }
+        return true;
+    }
+
+    bool Frustum::intersects(const AABB& _box) const {
+        const auto& min = _box.getMin();
+        const auto& max = _box.getMax();
+
+        for (auto& plane : mPlanes) {
+            // the corner furthest along the plane normal
+            const Vector3f corner(plane.x >= 0.0f ? max.x : min.x,
+                                  plane.y >= 0.0f ? max.y : min.y,
+                                  plane.z >= 0.0f ? max.z : min.z);
+            if (plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0.0f)
+                return false;
+        }
+        return true;
+    }
+}
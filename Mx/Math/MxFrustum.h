@@ -0,0 +1,49 @@
+#pragma once
+#ifndef MX_FRUSTUM_H_
+#define MX_FRUSTUM_H_
+#include "MxVector3.h"
+#include "MxVector4.h"
+#include "MxMatrix4.h"
+#include "MxAABB.h"
+
+namespace Mix {
+
+    /**
+     * @brief Six planes bounding the space visible through a view projection matrix.
+     *        Plane normals point inwards and are normalized, a point p is inside a plane when dot(n, p) + w >= 0.
+     */
+    class Frustum {
+    public:
+        enum Plane {
+            Left = 0,
+            Right,
+            Bottom,
+            Top,
+            Near,
+            Far,
+            PlaneCount
+        };
+
+        Frustum() = default;
+
+        /**
+         * @param _viewProj Projection times view, with the zero to one depth range of Camera
+         */
+        explicit Frustum(const Matrix4& _viewProj);
+
+        const Vector4f& getPlane(Plane _plane) const { return mPlanes[_plane]; }
+
+        const Vector4f* getPlanes() const { return mPlanes; }
+
+        /** @brief Whether a sphere is at least partially inside */
+        bool intersects(const Vector3f& _center, float _radius) const;
+
+        /** @brief Whether a box in the same space as the frustum is at least partially inside, conservative near edges */
+        bool intersects(const AABB& _box) const;
+
+    private:
+        Vector4f mPlanes[PlaneCount];
+    };
+}
+
+#endif
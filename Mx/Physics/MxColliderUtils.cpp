@@ -6,7 +6,10 @@
 namespace Mix::Physics {
     CompoundCollider createColliderFromFile(const std::string& _path,
                                             std::vector<ConvexHullCollider>& _children) {
-        auto model = ResourceLoader::Get()->load<Model>(_path);
+        // hulls are built from the vertex positions
+        ModelParam param;
+        param.readable = true;
+        auto model = ResourceLoader::Get()->load<Model>(_path, &param);
         if(!model)
             return nullptr;
 
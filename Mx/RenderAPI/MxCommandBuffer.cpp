@@ -1,11 +1,18 @@
 #include "MxCommandBuffer.h"
 #include "MxRenderAPI.h"
+#include "MxGPUParams.h"
 
 namespace Mix {
     std::shared_ptr<CommandBuffer> CommandBuffer::Create(GPUQueueType _type, uint32_t _queueIdx, bool _secondary) {
         return RenderAPI::Get()->createCommandBuffer(_type, _queueIdx, _secondary);
     }
 
+    void CommandBuffer::setGPUParams(const std::shared_ptr<GPUParams>& _gpuParams) {
+        if (_gpuParams)
+            _gpuParams->flushParamBlocks(mQueueIdx);
+        setGPUParamsInternal(_gpuParams);
+    }
+
     CommandBuffer::CommandBuffer(GPUQueueType _type, uint32_t _queueIdx, bool _secondary) :
         mType(_type),
         mQueueIdx(_queueIdx),
@@ -46,7 +46,8 @@ namespace Mix {
 
         virtual void setGraphicsPipeline(const std::shared_ptr<GraphicsPipelineState>& _pipeline) = 0;
 
-        virtual void setGPUParams(const std::shared_ptr<GPUParams>& _gpuParams) = 0;
+        /** \brief Upload the dirty param blocks of _gpuParams on the queue of this command buffer and bind it. */
+        void setGPUParams(const std::shared_ptr<GPUParams>& _gpuParams);
 
         virtual void setVertexBuffer(uint32 _index, ArrayProxy<const std::shared_ptr<VertexBuffer>> _buffers) = 0;
 
@@ -76,6 +77,8 @@ namespace Mix {
     protected:
         CommandBuffer(GPUQueueType _type, uint32_t _queueIdx, bool _secondary);
 
+        virtual void setGPUParamsInternal(const std::shared_ptr<GPUParams>& _gpuParams) = 0;
+
         GPUQueueType mType;
         uint32_t mQueueIdx;
         bool mIsSecondary;
@@ -160,14 +160,22 @@ namespace Mix {
 
     class GPUParams;
 
+    /**
+     * \brief Typed handle to a data parameter.
+     *
+     * The param block the parameter lives in is resolved to its unique index once, when the handle
+     * is created by GPUParams::resolveParam(), so set() and get() only index an array and copy into
+     * the cached block. Keep handles around instead of setting parameters by name every draw.
+     */
     template<typename _Ty>
     class TGPUParamData {
     public:
         TGPUParamData() = default;
 
-        TGPUParamData(GPUParamDataDesc* _paramDesc, GPUParams* _parent) :
+        TGPUParamData(GPUParamDataDesc* _paramDesc, GPUParams* _parent, uint32 _blockIndex) :
             mParent(_parent),
-            mParamDesc(_paramDesc) {
+            mParamDesc(_paramDesc),
+            mBlockIndex(_blockIndex) {
         }
 
 
@@ -188,6 +196,8 @@ namespace Mix {
     private:
         GPUParams* mParent = nullptr;
         GPUParamDataDesc* mParamDesc = nullptr;
+        /** Index of the param block among the param blocks of mParent */
+        uint32 mBlockIndex = uint32(-1);
     };
 
     template <typename _Ty>
@@ -195,7 +205,7 @@ namespace Mix {
         if (mParent == nullptr)
             return;
 
-        auto paramBlock = mParent->getParamBlockBuffer(mParamDesc->paramBlockSet, mParamDesc->paramBlockBinding);
+        auto* paramBlock = mParent->_getParamBlockBuffer(mBlockIndex);
         if (paramBlock == nullptr)
             return;
 
@@ -206,9 +216,8 @@ namespace Mix {
         }
 #endif
         auto size = std::min(mParamDesc->sizeInByte, uint32(sizeof(_Ty)));
+        // the block records the written range itself, the descriptors of the params are unchanged
         paramBlock->setData(&_value, mParamDesc->cpuMemOffset + _arrayIdx * mParamDesc->arrayElementStrideInByte, size);
-
-        mParent->_markDirty();
     }
 
     template <typename _Ty>
@@ -216,14 +225,14 @@ namespace Mix {
         if (mParent == nullptr)
             return _Ty();
 
-        auto paramBlock = mParent->getParamBlockBuffer(mParamDesc->paramBlockSet, mParamDesc->paramBlockBinding);
+        auto* paramBlock = mParent->_getParamBlockBuffer(mBlockIndex);
         if (paramBlock == nullptr)
-            return;
+            return _Ty();
 
 #ifdef MX_DEBUG_MODE
         if (_arrayIdx >= mParamDesc->arraySize) {
             MX_LOG_ERROR("Array index out of range.");
-            return;
+            return _Ty();
         }
 #endif
         _Ty value;
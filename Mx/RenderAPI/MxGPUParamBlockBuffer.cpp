@@ -6,7 +6,7 @@
 namespace Mix {
 
     GPUParamBlockBuffer::GPUParamBlockBuffer(uint32 _size, GPUBufferUsage _usage) :
-        mUsage(_usage), mSize(_size), mBuffer(nullptr) {
+        mUsage(_usage), mSize(_size), mDirtyBegin(_size), mBuffer(nullptr) {
         MX_ASSERT(_size > 0 && "Size of param block buffer should be positive");
 
         mCachedBuffer = new std::byte[mSize];
@@ -25,7 +25,7 @@ namespace Mix {
 
 #   endif
 
-        memcpy(static_cast<std::byte*>(_dst) + _offset, mCachedBuffer, _size);
+        memcpy(_dst, mCachedBuffer + _offset, _size);
     }
 
     void GPUParamBlockBuffer::setData(void const* const _src, uint32_t _offset, uint32_t _size) {
@@ -40,8 +40,8 @@ namespace Mix {
 
 #   endif
 
-        memcpy(static_cast<std::byte*>(mCachedBuffer) + _offset, _src, _size);
-        markDirty();
+        memcpy(mCachedBuffer + _offset, _src, _size);
+        markDirty(_offset, _size);
     }
 
     void GPUParamBlockBuffer::setZero(uint32 _offset, uint32 _size) {
@@ -55,12 +55,16 @@ namespace Mix {
 #   endif
 
         memset(mCachedBuffer + _offset, 0, _size);
-        markDirty();
+        markDirty(_offset, _size);
     }
 
     void GPUParamBlockBuffer::flushToGPU(uint32 _queueIdx) {
-        mBuffer->setData(mCachedBuffer, 0, mSize, _queueIdx);
-        mDirty = false;
+        if (!dirty())
+            return;
+
+        mBuffer->setData(mCachedBuffer + mDirtyBegin, mDirtyBegin, mDirtyEnd - mDirtyBegin, _queueIdx);
+        mDirtyBegin = mSize;
+        mDirtyEnd = 0;
     }
 
     std::shared_ptr<GPUParamBlockBuffer> GPUParamBlockBuffer::Create(uint32 _size, GPUBufferUsage _usage) {
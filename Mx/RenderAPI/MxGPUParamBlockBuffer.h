@@ -3,6 +3,7 @@
 #define MX_PARAM_BLOCK_BUFFER_H_
 #include "../Definitions/MxTypes.h"
 #include "MxGPUProgram.h"
+#include <algorithm>
 
 namespace Mix {
 
@@ -29,10 +30,13 @@ namespace Mix {
 
         std::byte* data() const { return mCachedBuffer; }
 
-        bool dirty() const { return mDirty; }
+        bool dirty() const { return mDirtyEnd > mDirtyBegin; }
+
+        /** \brief Byte range [begin, end) written since the last flush, empty when the buffer is clean. */
+        std::pair<uint32, uint32> dirtyRange() const { return { mDirtyBegin, mDirtyEnd }; }
 
         /**
-         * \brief Flush all cached data to GPU buffer.
+         * \brief Flush the dirty range of the cached data to GPU buffer.
          *
          * \note Manual use of this operation is not recommended, if you do, the synchronization will be up to you.
          */
@@ -43,12 +47,17 @@ namespace Mix {
     protected:
         GPUParamBlockBuffer(uint32 _size, GPUBufferUsage _usage);
 
-        void markDirty() { mDirty = false; }
+        /** \brief Grow the dirty range to cover [_offset, _offset + _size), writes of a frame are uploaded as one range. */
+        void markDirty(uint32 _offset, uint32 _size) {
+            mDirtyBegin = std::min(mDirtyBegin, _offset);
+            mDirtyEnd = std::max(mDirtyEnd, _offset + _size);
+        }
 
         GPUBufferUsage mUsage;
         std::byte* mCachedBuffer;
-        bool mDirty = false;
         uint32 mSize;
+        uint32 mDirtyBegin;
+        uint32 mDirtyEnd = 0;
         std::shared_ptr<GPUBuffer> mBuffer;
     };
 
@@ -1,5 +1,6 @@
 ﻿#include "MxGPUParams.h"
 #include "MxRenderStateManager.h"
+#include "MxGPUParamBlockBuffer.h"
 #include "../Log/MxLog.h"
 #include <numeric>
 
@@ -452,6 +453,13 @@ namespace Mix {
         _markDirty();
     }
 
+    void GPUParams::flushParamBlocks(uint32 _queueIdx) {
+        for (auto& paramBlock : mParamBlockBuffers) {
+            if (paramBlock && paramBlock->dirty())
+                paramBlock->flushToGPU(_queueIdx);
+        }
+    }
+
     void GPUParams::_markDirty() {
     }
 
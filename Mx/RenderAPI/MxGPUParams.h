@@ -119,6 +119,15 @@ namespace Mix {
 
         bool hasParamBlock(GPUProgramType _type, const std::string& _name) const;
 
+        /**
+         * \brief Look up a data parameter once and return a handle to it.
+         *
+         * Setting through the handle writes straight into the cached param block without any lookup,
+         * resolve parameters when the params are created and keep the handles for per draw updates.
+         * The returned handle is null when the parameter doesn't exist.
+         */
+        template<typename _Ty> TGPUParamData<_Ty> resolveParam(GPUProgramType _program, const std::string& _name) const;
+
         template<typename _Ty> void getParam(GPUProgramType _program, const std::string& _name, TGPUParamData<_Ty>& _output) const;
 
         void getStructParam(GPUProgramType _program, const std::string& _name, GPUParamStruct& _output) const;
@@ -129,6 +138,7 @@ namespace Mix {
 
         void getSamplerParam(GPUProgramType _program, const std::string& _name, GPUParamSampler& _output) const;
 
+        /** \brief Set a data parameter by name, which looks it up on every call. \see resolveParam() */
         template<typename _Ty>
         void setParam(GPUProgramType _program, const std::string& _name, const _Ty& _input);
 
@@ -154,8 +164,21 @@ namespace Mix {
 
         virtual void setSampler(uint32 _set, uint32 _binding, const SamplerDesc& _sampler);
 
+        /**
+         * \brief Upload the dirty range of every param block to GPU.
+         *
+         * Parameter writes only touch the cached blocks, CommandBuffer::setGPUParams() calls this
+         * before the params are bound.
+         */
+        void flushParamBlocks(uint32 _queueIdx);
+
         virtual void _markDirty();
 
+        /** \brief Param block by its unique index, used by parameter handles. */
+        GPUParamBlockBuffer* _getParamBlockBuffer(uint32 _index) const {
+            return _index < mParamBlockBuffers.size() ? mParamBlockBuffers[_index].get() : nullptr;
+        }
+
         static std::shared_ptr<GPUParams> Create(const std::shared_ptr<GPUPipelineParamsInfo>& _info);
 
     protected:
@@ -172,29 +195,31 @@ namespace Mix {
     };
 
     template <typename _Ty>
-    void GPUParams::getParam(GPUProgramType _program, const std::string& _name, TGPUParamData<_Ty>& _output) const {
+    TGPUParamData<_Ty> GPUParams::resolveParam(GPUProgramType _program, const std::string& _name) const {
         auto params = mParamsInfo->getProgramParamDesc(_program);
         if (params == nullptr) {
-            _output = TGPUParamData<_Ty>(nullptr, nullptr);
             MX_LOG_WARNING("Cannot find parameter named [%1%]", _name);
-            return;
+            return TGPUParamData<_Ty>();
         }
 
         auto it = params->paramDatas.find(_name);
         if (it == params->paramDatas.end()) {
-            _output = TGPUParamData<_Ty>(nullptr, nullptr);
             MX_LOG_WARNING("Cannot find parameter named [%1%]", _name);
-            return;
+            return TGPUParamData<_Ty>();
         }
 
-        _output = TGPUParamData<_Ty>(&it->second, const_cast<GPUParams*>(this));
+        auto blockIndex = mParamsInfo->getUniqueIndex(GPUParamType::ParamBlock, it->second.paramBlockSet, it->second.paramBlockBinding);
+        return TGPUParamData<_Ty>(&it->second, const_cast<GPUParams*>(this), blockIndex);
+    }
+
+    template <typename _Ty>
+    void GPUParams::getParam(GPUProgramType _program, const std::string& _name, TGPUParamData<_Ty>& _output) const {
+        _output = resolveParam<_Ty>(_program, _name);
     }
 
     template <typename _Ty>
     void GPUParams::setParam(GPUProgramType _program, const std::string& _name, const _Ty& _input) {
-        TGPUParamData<_Ty> param;
-        getParam(_program, _name, param);
-        param.set(_input);
+        resolveParam<_Ty>(_program, _name).set(_input);
     }
 }
 
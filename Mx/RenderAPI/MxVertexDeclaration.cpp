@@ -33,7 +33,7 @@ namespace Mix {
         mHash = Hash(*this);
     }
 
-    VertexElement::VertexElement(uint16_t _streamIndex, uint32_t _location, uint32_t _offset, VertexAttribute _vertexAttri)
+    VertexElement::VertexElement(uint16_t _streamIndex, uint32_t _location, uint32_t _offset, VertexAttribute _vertexAttri, Flags<VertexCompression> _compression)
         :mStreamIndex(_streamIndex),
         mLocation(_location),
         mOffset(_offset),
@@ -48,7 +48,8 @@ namespace Mix {
         default:;
         }
 
-        mType = GetDefaultTypeForSemantic(mSemantic);
+        mType = GetCompressedTypeForSemantic(mSemantic, _compression);
+        mHash = Hash(*this);
     }
 
     uint16_t VertexElement::getComponentCount() const {
@@ -74,6 +75,9 @@ namespace Mix {
         case VertexElementType::UShort3: return 3;
         case VertexElementType::UShort4: return 4;
         case VertexElementType::UByte4_Norm:	return 4;
+        case VertexElementType::Byte4_Norm:	return 4;
+        case VertexElementType::Short4_Norm:	return 4;
+        case VertexElementType::Half2:	return 2;
         default: return 0;
         }
     }
@@ -93,6 +97,20 @@ namespace Mix {
         }
     }
 
+    VertexElementType VertexElement::GetCompressedTypeForSemantic(VertexElementSemantic _semantic, Flags<VertexCompression> _compression) {
+        // the 4th component of positions, normals and tangents is padding
+        switch (_semantic) {
+        case VertexElementSemantic::Position:
+            return _compression.isSet(VertexCompression::Position) ? VertexElementType::Short4_Norm : VertexElementType::Float3;
+        case VertexElementSemantic::Normal:
+        case VertexElementSemantic::Tangent:
+            return _compression.isSet(VertexCompression::Normal) ? VertexElementType::Byte4_Norm : VertexElementType::Float3;
+        case VertexElementSemantic::TexCoord:
+            return _compression.isSet(VertexCompression::UV) ? VertexElementType::Half2 : VertexElementType::Float2;
+        default: return GetDefaultTypeForSemantic(_semantic);
+        }
+    }
+
     size_t VertexElement::Hash(const VertexElement& _ve) {
         size_t result = 0;
         Utils::HashCombine(result, _ve.mStreamIndex);
@@ -109,7 +127,7 @@ namespace Mix {
         mHash = Hash(*this);
     }
 
-    VertexDeclaration::VertexDeclaration(Flags<VertexAttribute> _vertexAttri) {
+    VertexDeclaration::VertexDeclaration(Flags<VertexAttribute> _vertexAttri, Flags<VertexCompression> _compression) {
         static std::array<VertexAttribute, 6> allAttributes = {
             VertexAttribute::Position,
             VertexAttribute::Normal,
@@ -125,7 +143,7 @@ namespace Mix {
             if (!_vertexAttri.isSet(attribute))
                 continue;
 
-            VertexElement ve(0, location, offset, attribute);
+            VertexElement ve(0, location, offset, attribute, _compression);
             ++location;
             offset += VertexElement::GetElementTypeSize(ve.getType());
             mElements.insert(ve);
@@ -248,6 +266,9 @@ namespace Mix {
         case VertexElementType::UShort3: return sizeof(uint16_t) * 3;
         case VertexElementType::UShort4: return sizeof(uint16_t) * 4;
         case VertexElementType::UByte4_Norm: return sizeof(uint8_t) * 4;
+        case VertexElementType::Byte4_Norm: return sizeof(int8_t) * 4;
+        case VertexElementType::Short4_Norm: return sizeof(int16_t) * 4;
+        case VertexElementType::Half2: return sizeof(uint16_t) * 2;
         default: return 0;
         }
     }
@@ -43,7 +43,10 @@ namespace Mix {
         UShort2,
         UShort3,
         UShort4,
-        UByte4_Norm
+        UByte4_Norm,
+        Byte4_Norm,
+        Short4_Norm,
+        Half2
     };
 
 
@@ -58,7 +61,7 @@ namespace Mix {
                       VertexElementSemantic _semantic,
                       uint16_t _index);
 
-        VertexElement(uint16_t _streamIndex, uint32_t _location, uint32_t _offset, VertexAttribute _vertexAttri);
+        VertexElement(uint16_t _streamIndex, uint32_t _location, uint32_t _offset, VertexAttribute _vertexAttri, Flags<VertexCompression> _compression = {});
 
         uint16_t getStreamIndex() const { return mStreamIndex; }
 
@@ -92,6 +95,8 @@ namespace Mix {
 
         static VertexElementType GetDefaultTypeForSemantic(VertexElementSemantic _semantic);
 
+        static VertexElementType GetCompressedTypeForSemantic(VertexElementSemantic _semantic, Flags<VertexCompression> _compression);
+
         static size_t Hash(const VertexElement& _ve);
 
     private:
@@ -109,7 +114,7 @@ namespace Mix {
     public:
         explicit VertexDeclaration(ArrayProxy<const VertexElement> _elements);
 
-        explicit VertexDeclaration(Flags<VertexAttribute> _vertexAttri);
+        explicit VertexDeclaration(Flags<VertexAttribute> _vertexAttri, Flags<VertexCompression> _compression = {});
 
         uint32_t elementCount() const { return static_cast<uint32_t>(mElements.size()); }
 
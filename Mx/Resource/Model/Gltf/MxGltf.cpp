@@ -3,6 +3,13 @@
 #include "../../../Math/MxPtrMake.h"
 #include "../../../Math/MxMatrix4.h"
 #include "../../../Graphics/Texture/MxTexture.h"
+#include "../../../Graphics/Texture/MxTextureStreamer.h"
+#include "../../../Graphics/MxGraphics.h"
+#include "../../../Graphics/Mesh/MxMeshUtils.h"
+#include "../../../Utils/MxMappedFile.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include <numeric>
 
 #define TINYGLTF_IMPLEMENTATION
@@ -15,13 +22,12 @@
 
 namespace Mix {
     std::shared_ptr<ResourceBase> Gltf::load(const std::filesystem::path& _path, const ResourceType _type, void* _additionalParam) {
-        std::shared_ptr<Model> model;
         if (_type == ResourceType::GLTF_BIN)
-            model = loadFromGlb(_path);
-        else if (_type == ResourceType::GLTF_ASCII)
-            model = loadFromJson(_path);
-        model->setName(_path.filename().generic_string());
-        return model;
+            return decode(_path, "glb", _additionalParam)();
+        if (_type == ResourceType::GLTF_ASCII)
+            return decode(_path, "gltf", _additionalParam)();
+
+        return nullptr;
     }
 
     std::shared_ptr<ResourceBase> Gltf::load(const std::filesystem::path& _path, const std::string& _ext, void* _additionalParam) {
@@ -33,31 +39,42 @@ namespace Mix {
         return nullptr;
     }
 
-    std::shared_ptr<Model> Gltf::loadFromGlb(const std::filesystem::path& _glb) {
-        tinygltf::Model gltfModel;
-        std::string err;
-        std::string warn;
-        const bool  success = mLoader.LoadBinaryFromFile(&gltfModel, &err, &warn, _glb.generic_string());
+    ResourceParserBase::Finalizer Gltf::decode(const std::filesystem::path& _path, const std::string& _ext, void* _additionalParam) {
+        auto file = std::make_shared<MappedFile>(_path);
 
-        if (!warn.empty())
-            std::cerr << "Warning : " << warn << std::endl;
+        // vertices are read straight from the mapped BIN chunk when the meshes are created
+        auto gltfModel = std::make_shared<tinygltf::Model>();
+        ArrayProxy<const std::byte> bin = nullptr;
+        if (_ext == "glb" && ParseGlb(file->view(), *gltfModel, bin))
+            return createFinalizer(gltfModel, bin, file, _path, _additionalParam);
 
-        if (!err.empty())
-            std::cerr << "Error : " << err << std::endl;
+        return decodeData(_path, file->view(), _ext, _additionalParam);
+    }
 
-        if (!success) {
-            std::cerr << "Error : " << "Failed to load GLTF [" << _glb << "]" << std::endl;
-            return nullptr;
-        }
+    ResourceParserBase::Finalizer Gltf::decodeData(const std::filesystem::path& _path, ArrayProxy<const std::byte> _data, const std::string& _ext, void* _additionalParam) {
+        auto gltfModel = std::make_shared<tinygltf::Model>();
 
-        return loadModel(gltfModel);
-    }
+        ArrayProxy<const std::byte> bin = nullptr;
+        if (_ext == "glb" && ParseGlb(_data, *gltfModel, bin)) {
+            // _data is only valid during this call
+            auto copy = std::make_shared<std::vector<std::byte>>(bin.begin(), bin.end());
+            return createFinalizer(gltfModel, ArrayProxy<const std::byte>(copy->size(), copy->data()), copy, _path, _additionalParam);
+        }
 
-    std::shared_ptr<Model> Gltf::loadFromJson(const std::filesystem::path& _glb) {
-        tinygltf::Model gltfModel;
         std::string err;
         std::string warn;
-        const bool  success = mLoader.LoadASCIIFromFile(&gltfModel, &err, &warn, _glb.generic_string());
+
+        // external buffers and images of .gltf files are resolved against the directory of the file
+        const auto baseDir = _path.parent_path().generic_string();
+        const auto size = static_cast<unsigned int>(_data.size());
+
+        // a loader per call since decoding runs on several worker threads
+        tinygltf::TinyGLTF loader;
+        bool success = false;
+        if (_ext == "glb")
+            success = loader.LoadBinaryFromMemory(gltfModel.get(), &err, &warn, reinterpret_cast<const unsigned char*>(_data.data()), size, baseDir);
+        else if (_ext == "gltf")
+            success = loader.LoadASCIIFromString(gltfModel.get(), &err, &warn, reinterpret_cast<const char*>(_data.data()), size, baseDir);
 
         if (!warn.empty())
             std::cerr << "Warning : " << warn << std::endl;
@@ -66,34 +83,72 @@ namespace Mix {
             std::cerr << "Error : " << err << std::endl;
 
         if (!success) {
-            std::cerr << "Error : " << "Failed to load GLTF [" << _glb << "]" << std::endl;
-            return nullptr;
+            std::cerr << "Error : " << "Failed to load GLTF [" << _path << "]" << std::endl;
+            return [] { return nullptr; };
         }
 
-        return loadModel(gltfModel);
+        return createFinalizer(gltfModel, nullptr, nullptr, _path, _additionalParam);
     }
 
-    std::shared_ptr<Model> Gltf::loadModel(const tinygltf::Model& _gltfModel) {
+    uint64_t Gltf::hashParam(const void* _additionalParam) const {
+        if (!_additionalParam)
+            return 0;
+
+        const auto param = static_cast<const ModelParam*>(_additionalParam);
+        return (param->readable ? 1 : 0) | (param->optimize ? 2 : 0)
+            | static_cast<uint64_t>(static_cast<uint32_t>(param->compression)) << 2
+            | static_cast<uint64_t>(param->lodCount) << 8
+            | static_cast<uint64_t>(param->occluderTriangles) << 32;
+    }
+
+    ResourceParserBase::Finalizer Gltf::createFinalizer(std::shared_ptr<tinygltf::Model> _gltfModel,
+                                                         ArrayProxy<const std::byte> _bin,
+                                                         std::shared_ptr<const void> _binOwner,
+                                                         const std::filesystem::path& _path,
+                                                         const void* _additionalParam) {
+        const auto param = _additionalParam ? *static_cast<const ModelParam*>(_additionalParam) : ModelParam();
+
+        // meshes are created and uploaded on the main thread
+        return [this, _gltfModel, _bin, _binOwner, param, name = _path.filename().generic_string()]() -> std::shared_ptr<ResourceBase> {
+            auto model = loadModel(*_gltfModel, _bin, param);
+            if (model)
+                model->setName(name);
+            return model;
+        };
+    }
+
+    std::shared_ptr<Model> Gltf::loadModel(const tinygltf::Model& _gltfModel, ArrayProxy<const std::byte> _bin, const ModelParam& _param) {
         mTempData.emplace();
-        loadMeshes(_gltfModel);
+        loadMeshes(_gltfModel, _bin, _param);
         // loadTextures(_gltfModel);
 
         std::shared_ptr<Model> model = std::make_shared<Model>();
 
-        const tinygltf::Scene& scene = _gltfModel.scenes[_gltfModel.defaultScene > -1 ? _gltfModel.defaultScene : 0];
-        for (auto i : scene.nodes) {
-            processNode(_gltfModel, _gltfModel.nodes[i], model->getRootNode());
+        if (!_gltfModel.scenes.empty()) {
+            const tinygltf::Scene& scene = _gltfModel.scenes[_gltfModel.defaultScene > -1 ? _gltfModel.defaultScene : 0];
+            for (auto i : scene.nodes) {
+                processNode(_gltfModel, _gltfModel.nodes[i], model->getRootNode());
+            }
         }
 
+        for (size_t i = 0; i < mTempData->lods.size(); ++i)
+            model->setMeshLODs(i, std::move(mTempData->lods[i]));
         model->setMeshes(std::move(mTempData->meshes));
         mTempData.reset();
         return model;
     }
 
 
-    void Gltf::loadMeshes(const tinygltf::Model& _gltfModel) {
+    void Gltf::loadMeshes(const tinygltf::Model& _gltfModel, ArrayProxy<const std::byte> _bin, const ModelParam& _param) {
         mTempData->meshes.reserve(_gltfModel.meshes.size());
+        mTempData->lods.resize(_gltfModel.meshes.size());
         for (auto& gltfMesh : _gltfModel.meshes) {
+            // levels and occluders are simplified from the vertex data on the cpu
+            if (!_param.readable && _param.lodCount == 0 && _param.occluderTriangles == 0) {
+                mTempData->meshes.push_back(CreateMesh(_gltfModel, gltfMesh, _bin, _param));
+                continue;
+            }
+
             size_t vertexCount = 0;
             {
                 auto f = [&](size_t _sum, const tinygltf::Primitive& _p) {
@@ -123,10 +178,544 @@ namespace Mix {
                 meshData.vertCount.resize(gltfMesh.primitives.size());
             }
 
-            PopulateMeshAttributeData(meshData, _gltfModel, gltfMesh);
+            PopulateMeshAttributeData(meshData, _gltfModel, gltfMesh, _bin);
             mTempData->meshes.emplace_back(std::make_shared<Mesh>());
-            ConstructMesh(*mTempData->meshes.back(), meshData);
+            auto& mesh = *mTempData->meshes.back();
+            ConstructMesh(mesh, meshData, _param);
+
+            if (_param.occluderTriangles > 0)
+                mesh.generateOccluder(_param.occluderTriangles);
+            if (_param.lodCount > 0)
+                mTempData->lods[mTempData->meshes.size() - 1] = MeshUtils::GenerateLODChain(mesh, _param.lodCount);
+            if (!_param.readable)
+                mesh.markNoLongerReadable();
+        }
+    }
+
+    std::shared_ptr<Mesh> Gltf::CreateMesh(const tinygltf::Model& _gltfModel, const tinygltf::Mesh& _gltfMesh, ArrayProxy<const std::byte> _bin, const ModelParam& _param) {
+        constexpr uint32_t attributeCount = 6;
+
+        if (_gltfMesh.primitives.empty())
+            return nullptr;
+
+        // like the readable path, the attributes of the first primitive are used by the whole mesh
+        Flags<VertexAttribute> attributeFlags;
+        bool present[attributeCount] = {};
+        for (uint32_t a = 0; a < attributeCount; ++a) {
+            const auto attribute = static_cast<GltfAttribute>(a);
+            present[a] = _gltfMesh.primitives[0].attributes.count(GetGltfAttributeString(attribute)) != 0;
+            if (present[a])
+                attributeFlags |= GetVertexAttribute(attribute);
+        }
+
+        if (!present[static_cast<uint32_t>(GltfAttribute::POSITION)]) {
+            std::cerr << "Error : Mesh must contain at least position attribute" << std::endl;
+            return nullptr;
+        }
+
+        // elements are ordered like VertexAttribute, which GltfAttribute follows
+        const VertexDeclaration declaration(attributeFlags, _param.compression);
+        const uint32_t stride = declaration.getSizeOfStream(0);
+        uint32_t offsets[attributeCount] = {};
+        VertexElementType types[attributeCount] = {};
+        {
+            auto element = declaration.getElements().begin();
+            for (uint32_t a = 0; a < attributeCount; ++a) {
+                if (!present[a])
+                    continue;
+                offsets[a] = element->getOffset();
+                types[a] = element->getType();
+                ++element;
+            }
+        }
+
+        struct Primitive {
+            AccessorView attributes[attributeCount];
+            AccessorView indices;
+            // filled when optimized, indices are read from the accessor and vertices written in order otherwise
+            std::vector<uint32_t> optimizedIndices;
+            std::vector<uint32_t> remap;
+        };
+
+        std::vector<Primitive> primitives(_gltfMesh.primitives.size());
+        std::vector<Mesh::SubMesh> subMeshes(_gltfMesh.primitives.size());
+        size_t vertexCount = 0;
+        size_t indexCount = 0;
+        size_t maxVertexCount = 0;
+
+        for (size_t i = 0; i < primitives.size(); ++i) {
+            auto& gltfPrimitive = _gltfMesh.primitives[i];
+            for (uint32_t a = 0; a < attributeCount; ++a) {
+                const auto it = gltfPrimitive.attributes.find(GetGltfAttributeString(static_cast<GltfAttribute>(a)));
+                if (present[a] && it != gltfPrimitive.attributes.end())
+                    primitives[i].attributes[a] = GetAccessorView(_gltfModel, it->second, _bin);
+            }
+            primitives[i].indices = GetAccessorView(_gltfModel, gltfPrimitive.indices, _bin);
+
+            const auto count = primitives[i].attributes[static_cast<uint32_t>(GltfAttribute::POSITION)].count;
+            subMeshes[i].baseVertex = static_cast<uint32_t>(vertexCount);
+            subMeshes[i].firstIndex = static_cast<uint32_t>(indexCount);
+            subMeshes[i].indexCount = static_cast<uint32_t>(primitives[i].indices.valid() ? primitives[i].indices.count : count);
+            subMeshes[i].topology = GetMeshTopology(gltfPrimitive.mode);
+
+            vertexCount += count;
+            indexCount += subMeshes[i].indexCount;
+            maxVertexCount = std::max(maxVertexCount, count);
+        }
+
+        auto min = Vector3f(std::numeric_limits<float>::max());
+        auto max = Vector3f(std::numeric_limits<float>::lowest());
+        for (auto& primitive : primitives) {
+            auto& positions = primitive.attributes[static_cast<uint32_t>(GltfAttribute::POSITION)];
+            for (size_t v = 0; v < positions.count; ++v) {
+                Vector3f position;
+                ReadFloats(positions, v, position.linear, 3);
+                position.x = -position.x;
+                for (uint32_t c = 0; c < 3; ++c) {
+                    min.linear[c] = std::min(min.linear[c], position.linear[c]);
+                    max.linear[c] = std::max(max.linear[c], position.linear[c]);
+                }
+            }
+        }
+        if (!vertexCount)
+            min = max = Vector3f::Zero;
+
+        Mesh::PositionQuantization quantization;
+        const bool quantizePositions = _param.compression.isSet(VertexCompression::Position);
+        if (quantizePositions)
+            quantization = Mesh::PositionQuantization(min, max);
+
+        // triangles are reordered on a copy of the indices, vertices are then written at their remapped position
+        if (_param.optimize) {
+            VertexCacheStatistics before;
+            VertexCacheStatistics after;
+            for (size_t i = 0; i < primitives.size(); ++i) {
+                auto& primitive = primitives[i];
+                auto& positionView = primitive.attributes[static_cast<uint32_t>(GltfAttribute::POSITION)];
+                if (subMeshes[i].topology != MeshTopology::Triangles_List || !positionView.valid())
+                    continue;
+
+                auto& indices = primitive.optimizedIndices;
+                indices.resize(subMeshes[i].indexCount);
+                for (uint32_t j = 0; j < subMeshes[i].indexCount; ++j)
+                    indices[j] = primitive.indices.valid() ? ReadIndex(primitive.indices, j) : j;
+
+                if (std::any_of(indices.begin(), indices.end(), [&positionView](uint32_t _index) { return _index >= positionView.count; })) {
+                    indices.clear();
+                    continue;
+                }
+
+                std::vector<Vector3f> positions(positionView.count);
+                for (size_t v = 0; v < positions.size(); ++v)
+                    ReadFloats(positionView, v, positions[v].linear, 3);
+
+                before += MeshUtils::AnalyzeVertexCache(indices, positions.size());
+                MeshUtils::OptimizeVertexCache(indices, positions.size());
+                MeshUtils::OptimizeOverdraw(indices, positions);
+                primitive.remap = MeshUtils::OptimizeVertexFetch(indices, positions.size());
+                after += MeshUtils::AnalyzeVertexCache(indices, positions.size());
+            }
+
+            if (before.triangleCount)
+                Log::Info("%1%: [%2%] ACMR %3% -> %4%, ATVR %5% -> %6%", __FUNCTION__, _gltfMesh.name, before.acmr(), after.acmr(), before.atvr(), after.atvr());
+        }
+
+        // indices are relative to the base vertex of their primitive
+        const auto indexFormat = maxVertexCount > size_t(std::numeric_limits<uint16_t>::max()) + 1 ? IndexFormat::UInt32 : IndexFormat::UInt16;
+        const size_t indexSize = indexFormat == IndexFormat::UInt16 ? sizeof(Mesh::Index16Type) : sizeof(Mesh::Index32Type);
+
+        const auto writeVertices = [&](std::byte* _dst) {
+            for (size_t i = 0; i < primitives.size(); ++i) {
+                auto& primitive = primitives[i];
+                const auto count = primitive.attributes[static_cast<uint32_t>(GltfAttribute::POSITION)].count;
+                for (size_t v = 0; v < count; ++v) {
+                    const size_t target = primitive.remap.empty() ? v : primitive.remap[v];
+                    const auto vertex = _dst + (subMeshes[i].baseVertex + target) * stride;
+
+                    for (uint32_t a = 0; a < attributeCount; ++a) {
+                        if (!present[a])
+                            continue;
+
+                        // same conversions to the left handed system as ConstructMesh()
+                        float values[4] = {};
+                        if (primitive.attributes[a].valid())
+                            ReadFloats(primitive.attributes[a], v, values, 4);
+
+                        switch (static_cast<GltfAttribute>(a)) {
+                        case GltfAttribute::POSITION:
+                            values[0] = -values[0];
+                            if (quantizePositions) {
+                                const auto position = quantization.quantize(Vector3f(values[0], values[1], values[2]));
+                                std::copy_n(position.linear, 3, values);
+                            }
+                            break;
+                        case GltfAttribute::NORMAL:
+                            values[0] = -values[0];
+                            break;
+                        case GltfAttribute::TEXCOORD_0:
+                        case GltfAttribute::TEXCOORD_1:
+                            values[1] = 1.0f - values[1];
+                            break;
+                        case GltfAttribute::COLOR:
+                        {
+                            const auto color = ReadColor(primitive.attributes[a], v);
+                            std::memcpy(vertex + offsets[a], &color, sizeof(color));
+                            continue;
+                        }
+                        default:
+                            break;
+                        }
+
+                        MeshUtils::EncodeVertexElement(types[a], values, vertex + offsets[a]);
+                    }
+                }
+            }
+        };
+
+        const auto writeIndices = [&](std::byte* _dst) {
+            for (size_t i = 0; i < primitives.size(); ++i) {
+                auto& indices = primitives[i].indices;
+                const auto dst = _dst + subMeshes[i].firstIndex * indexSize;
+
+                auto& optimized = primitives[i].optimizedIndices;
+
+                for (uint32_t j = 0; j < subMeshes[i].indexCount; ++j) {
+                    const uint32_t index = !optimized.empty() ? optimized[j] : indices.valid() ? ReadIndex(indices, j) : j;
+                    if (indexFormat == IndexFormat::UInt16) {
+                        const auto value = static_cast<Mesh::Index16Type>(index);
+                        std::memcpy(dst + j * indexSize, &value, indexSize);
+                    }
+                    else
+                        std::memcpy(dst + j * indexSize, &index, indexSize);
+                }
+            }
+        };
+
+        // same estimate as Mesh::getUVDensity(), which readable meshes compute from their data
+        double surfaceArea = 0.0;
+        double uvArea = 0.0;
+        for (size_t i = 0; i < primitives.size(); ++i) {
+            auto& positions = primitives[i].attributes[static_cast<uint32_t>(GltfAttribute::POSITION)];
+            auto& uvs = primitives[i].attributes[static_cast<uint32_t>(GltfAttribute::TEXCOORD_0)];
+            if (!uvs.valid() || uvs.count != positions.count || subMeshes[i].topology != MeshTopology::Triangles_List)
+                continue;
+
+            for (uint32_t j = 0; j + 2 < subMeshes[i].indexCount; j += 3) {
+                Vector3f p[3];
+                Vector2f uv[3];
+                bool valid = true;
+                for (uint32_t k = 0; k < 3; ++k) {
+                    const uint32_t index = primitives[i].indices.valid() ? ReadIndex(primitives[i].indices, j + k) : j + k;
+                    valid = valid && index < positions.count;
+                    if (!valid)
+                        break;
+                    ReadFloats(positions, index, p[k].linear, 3);
+                    ReadFloats(uvs, index, uv[k].linear, 2);
+                }
+                if (!valid)
+                    continue;
+
+                surfaceArea += 0.5 * (p[1] - p[0]).cross(p[2] - p[0]).length();
+                const auto ub = uv[1] - uv[0];
+                const auto uc = uv[2] - uv[0];
+                uvArea += 0.5 * std::abs(ub.x * uc.y - ub.y * uc.x);
+            }
+        }
+        const float uvDensity = surfaceArea > 0.0 ? static_cast<float>(std::sqrt(uvArea / surfaceArea)) : 0.0f;
+
+        auto mesh = Mesh::Create(vertexCount * stride, attributeFlags, writeVertices,
+                                 indexCount * indexSize, indexFormat, writeIndices,
+                                 subMeshes, uvDensity, _param.compression, quantization);
+        if (mesh)
+            mesh->setBounds(AABB(min, max));
+        return mesh;
+    }
+
+    Gltf::AccessorView Gltf::GetAccessorView(const tinygltf::Model& _gltfModel, int _accessor, ArrayProxy<const std::byte> _bin) {
+        AccessorView result;
+        if (_accessor < 0 || static_cast<size_t>(_accessor) >= _gltfModel.accessors.size())
+            return result;
+
+        const auto& accessor = _gltfModel.accessors[_accessor];
+        if (accessor.bufferView < 0 || static_cast<size_t>(accessor.bufferView) >= _gltfModel.bufferViews.size())
+            return result;
+
+        const auto& bufferView = _gltfModel.bufferViews[accessor.bufferView];
+
+        // data parsed by tinygltf lives in its buffers
+        auto data = _bin;
+        if (data.empty() && bufferView.buffer >= 0 && static_cast<size_t>(bufferView.buffer) < _gltfModel.buffers.size()) {
+            auto& buffer = _gltfModel.buffers[bufferView.buffer].data;
+            data = ArrayProxy<const std::byte>(buffer.size(), reinterpret_cast<const std::byte*>(buffer.data()));
         }
+
+        const int componentSize = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+        const int components = tinygltf::GetNumComponentsInType(accessor.type);
+        if (componentSize <= 0 || components <= 0)
+            return result;
+
+        const size_t elementSize = static_cast<size_t>(componentSize) * components;
+        const size_t stride = bufferView.byteStride ? bufferView.byteStride : elementSize;
+
+        // interleaved views are read element by element, every element has to be inside the view
+        const size_t viewEnd = bufferView.byteOffset + bufferView.byteLength;
+        const size_t begin = bufferView.byteOffset + accessor.byteOffset;
+        if (viewEnd > data.size() || (accessor.count && begin + (accessor.count - 1) * stride + elementSize > viewEnd))
+            return result;
+
+        result.data = data.data() + begin;
+        result.stride = stride;
+        result.count = accessor.count;
+        result.componentType = accessor.componentType;
+        result.componentSize = static_cast<uint32_t>(componentSize);
+        result.components = static_cast<uint32_t>(components);
+        result.normalized = accessor.normalized;
+        return result;
+    }
+
+    void Gltf::ReadFloats(const AccessorView& _view, size_t _index, float* _out, uint32_t _count) {
+        const auto element = _view.data + _index * _view.stride;
+
+        uint32_t c = 0;
+        for (; c < _count && c < _view.components; ++c) {
+            const auto component = element + c * _view.componentSize;
+            switch (_view.componentType) {
+            case TINYGLTF_COMPONENT_TYPE_FLOAT:
+                std::memcpy(&_out[c], component, sizeof(float));
+                break;
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+            {
+                const auto value = static_cast<float>(*reinterpret_cast<const uint8_t*>(component));
+                _out[c] = _view.normalized ? value / 255.0f : value;
+                break;
+            }
+            case TINYGLTF_COMPONENT_TYPE_BYTE:
+            {
+                const auto value = static_cast<float>(*reinterpret_cast<const int8_t*>(component));
+                _out[c] = _view.normalized ? std::max(value / 127.0f, -1.0f) : value;
+                break;
+            }
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+            {
+                uint16_t value;
+                std::memcpy(&value, component, sizeof(value));
+                _out[c] = _view.normalized ? value / 65535.0f : static_cast<float>(value);
+                break;
+            }
+            case TINYGLTF_COMPONENT_TYPE_SHORT:
+            {
+                int16_t value;
+                std::memcpy(&value, component, sizeof(value));
+                _out[c] = _view.normalized ? std::max(value / 32767.0f, -1.0f) : static_cast<float>(value);
+                break;
+            }
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+            {
+                uint32_t value;
+                std::memcpy(&value, component, sizeof(value));
+                _out[c] = static_cast<float>(value);
+                break;
+            }
+            default:
+                _out[c] = 0.0f;
+            }
+        }
+
+        // missing components default to (0, 0, 0, 1), e.g. RGB colors get an opaque alpha
+        for (; c < _count; ++c)
+            _out[c] = c == 3 ? 1.0f : 0.0f;
+    }
+
+    uint32_t Gltf::ReadIndex(const AccessorView& _view, size_t _index) {
+        const auto element = _view.data + _index * _view.stride;
+        switch (_view.componentType) {
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+            return *reinterpret_cast<const uint8_t*>(element);
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        {
+            uint16_t value;
+            std::memcpy(&value, element, sizeof(value));
+            return value;
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+        {
+            uint32_t value;
+            std::memcpy(&value, element, sizeof(value));
+            return value;
+        }
+        default:
+            return 0;
+        }
+    }
+
+    Mesh::ColorType Gltf::ReadColor(const AccessorView& _view, size_t _index) {
+        if (!_view.valid())
+            return Mesh::ColorType(0, 0, 0, 0);
+
+        float color[4];
+        ReadFloats(_view, _index, color, 4);
+
+        const auto toByte = [](float _value) { return static_cast<char>(static_cast<uint8_t>(std::clamp(_value, 0.0f, 1.0f) * 255.0f + 0.5f)); };
+        return Mesh::ColorType(toByte(color[0]), toByte(color[1]), toByte(color[2]), toByte(color[3]));
+    }
+
+    bool Gltf::ParseGlb(ArrayProxy<const std::byte> _glb, tinygltf::Model& _gltfModel, ArrayProxy<const std::byte>& _bin) {
+        constexpr uint32_t glbMagic = 0x46546C67;
+        constexpr uint32_t jsonChunk = 0x4E4F534A;
+        constexpr uint32_t binChunk = 0x004E4942;
+
+        uint32_t header[3];
+        if (_glb.size() < sizeof(header))
+            return false;
+
+        std::memcpy(header, _glb.data(), sizeof(header));
+        if (header[0] != glbMagic || header[1] != 2 || header[2] > _glb.size())
+            return false;
+
+        ArrayProxy<const std::byte> jsonData = nullptr;
+        _bin = nullptr;
+        for (size_t offset = sizeof(header); offset + 8 <= header[2];) {
+            uint32_t chunk[2];
+            std::memcpy(chunk, _glb.data() + offset, sizeof(chunk));
+            offset += sizeof(chunk);
+            if (chunk[0] > header[2] - offset)
+                return false;
+
+            if (chunk[1] == jsonChunk && jsonData.empty())
+                jsonData = ArrayProxy<const std::byte>(chunk[0], _glb.data() + offset);
+            else if (chunk[1] == binChunk && _bin.empty())
+                _bin = ArrayProxy<const std::byte>(chunk[0], _glb.data() + offset);
+            offset += chunk[0];
+        }
+
+        if (jsonData.empty())
+            return false;
+
+        using nlohmann::json;
+        const auto begin = reinterpret_cast<const char*>(jsonData.data());
+        const auto document = json::parse(begin, begin + jsonData.size(), nullptr, false);
+        if (document.is_discarded() || !document.is_object())
+            return false;
+
+        try {
+            if (ParseGlbDocument(document, _gltfModel))
+                return true;
+        }
+        catch (const json::exception&) {
+            // malformed fields are reported by tinygltf
+        }
+
+        // tinygltf starts over with an empty model
+        _gltfModel = tinygltf::Model();
+        return false;
+    }
+
+    bool Gltf::ParseGlbDocument(const nlohmann::json& _document, tinygltf::Model& _gltfModel) {
+        using nlohmann::json;
+        // required extensions (compression, sparse data, external buffers ...) are left to tinygltf
+        if (_document.find("extensionsRequired") != _document.end())
+            return false;
+
+        const auto buffers = _document.value("buffers", json::array());
+        if (buffers.size() > 1 || (buffers.size() == 1 && buffers[0].find("uri") != buffers[0].end()))
+            return false;
+
+        for (auto& item : _document.value("bufferViews", json::array())) {
+            tinygltf::BufferView bufferView;
+            bufferView.buffer = item.value("buffer", -1);
+            bufferView.byteOffset = item.value("byteOffset", size_t(0));
+            bufferView.byteLength = item.value("byteLength", size_t(0));
+            bufferView.byteStride = item.value("byteStride", size_t(0));
+            if (bufferView.buffer != 0)
+                return false;
+            _gltfModel.bufferViews.push_back(std::move(bufferView));
+        }
+
+        static const std::pair<const char*, int> types[] = {
+            { "SCALAR", TINYGLTF_TYPE_SCALAR },
+            { "VEC2", TINYGLTF_TYPE_VEC2 },
+            { "VEC3", TINYGLTF_TYPE_VEC3 },
+            { "VEC4", TINYGLTF_TYPE_VEC4 },
+            { "MAT2", TINYGLTF_TYPE_MAT2 },
+            { "MAT3", TINYGLTF_TYPE_MAT3 },
+            { "MAT4", TINYGLTF_TYPE_MAT4 }
+        };
+
+        for (auto& item : _document.value("accessors", json::array())) {
+            if (item.find("sparse") != item.end())
+                return false;
+
+            tinygltf::Accessor accessor;
+            accessor.bufferView = item.value("bufferView", -1);
+            accessor.byteOffset = item.value("byteOffset", size_t(0));
+            accessor.componentType = item.value("componentType", -1);
+            accessor.count = item.value("count", size_t(0));
+            accessor.normalized = item.value("normalized", false);
+
+            const auto type = item.value("type", std::string());
+            accessor.type = -1;
+            for (auto& pair : types) {
+                if (type == pair.first)
+                    accessor.type = pair.second;
+            }
+            _gltfModel.accessors.push_back(std::move(accessor));
+        }
+
+        for (auto& item : _document.value("meshes", json::array())) {
+            tinygltf::Mesh mesh;
+            mesh.name = item.value("name", std::string());
+            for (auto& primitiveItem : item.value("primitives", json::array())) {
+                tinygltf::Primitive primitive;
+                const auto attributes = primitiveItem.value("attributes", json::object());
+                for (auto& attribute : attributes.items())
+                    primitive.attributes[attribute.key()] = attribute.value().get<int>();
+                primitive.indices = primitiveItem.value("indices", -1);
+                primitive.mode = primitiveItem.value("mode", TINYGLTF_MODE_TRIANGLES);
+                primitive.material = primitiveItem.value("material", -1);
+                mesh.primitives.push_back(std::move(primitive));
+            }
+            _gltfModel.meshes.push_back(std::move(mesh));
+        }
+
+        for (auto& item : _document.value("nodes", json::array())) {
+            tinygltf::Node node;
+            node.name = item.value("name", std::string());
+            node.mesh = item.value("mesh", -1);
+            node.children = item.value("children", std::vector<int>());
+            node.matrix = item.value("matrix", std::vector<double>());
+            node.translation = item.value("translation", std::vector<double>());
+            node.rotation = item.value("rotation", std::vector<double>());
+            node.scale = item.value("scale", std::vector<double>());
+            _gltfModel.nodes.push_back(std::move(node));
+        }
+
+        for (auto& item : _document.value("scenes", json::array())) {
+            tinygltf::Scene scene;
+            scene.name = item.value("name", std::string());
+            scene.nodes = item.value("nodes", std::vector<int>());
+            _gltfModel.scenes.push_back(std::move(scene));
+        }
+        _gltfModel.defaultScene = _document.value("scene", -1);
+
+        // indices are used without further checks when the model is built
+        for (auto& node : _gltfModel.nodes) {
+            if (node.mesh >= static_cast<int>(_gltfModel.meshes.size()))
+                return false;
+            for (auto child : node.children) {
+                if (child < 0 || child >= static_cast<int>(_gltfModel.nodes.size()))
+                    return false;
+            }
+        }
+        for (auto& scene : _gltfModel.scenes) {
+            for (auto node : scene.nodes) {
+                if (node < 0 || node >= static_cast<int>(_gltfModel.nodes.size()))
+                    return false;
+            }
+        }
+        if (_gltfModel.defaultScene >= static_cast<int>(_gltfModel.scenes.size()))
+            return false;
+
+        return true;
     }
 
     void Gltf::loadTextures(const tinygltf::Model& _gltfModel) {
@@ -168,9 +757,14 @@ namespace Mix {
                 buffer = gltfImage.image.data();
             }
 
-            auto tex = std::make_shared<Texture2D>(gltfImage.width, gltfImage.height, TextureFormat::R8G8B8A8_Unorm);
-            tex->setPixels(buffer, pixelCount * 4);
-            tex->apply();
+            // embedded images have no file to load evicted mips from, so every mip stays resident
+            auto tex = Graphics::Get()->getTextureStreamer().createTexture(gltfImage.width, gltfImage.height,
+                                                                           TextureFormat::R8G8B8A8_Unorm,
+                                                                           TextureStreamer::GenerateMipChain(reinterpret_cast<const char*>(buffer),
+                                                                                                             gltfImage.width,
+                                                                                                             gltfImage.height),
+                                                                           nullptr,
+                                                                           samplerInfo);
             mTempData->textures.push_back(tex);
 
             if (shouldDelete)
@@ -218,73 +812,43 @@ namespace Mix {
         _parentNode.addChildNode(std::move(node));
     }
 
-    std::pair<const std::byte*, size_t> Gltf::GetGltfAttributePtr(const tinygltf::Model& _gltfModel, const tinygltf::Primitive& _primitive,
-                                                                  GltfAttribute _attribute) {
-        const tinygltf::Accessor& accessor = _gltfModel.accessors[_primitive.attributes.find(GetGltfAttributeString(_attribute))->second];
-        const tinygltf::BufferView& bufferView = _gltfModel.bufferViews[accessor.bufferView];
-        return { reinterpret_cast<const std::byte*>(&_gltfModel.buffers[bufferView.buffer].data[accessor.byteOffset + bufferView.byteOffset]),accessor.count };
-    }
+    void Gltf::PopulateMeshAttributeData(MixMeshData& _meshData, const tinygltf::Model& _gltfModel, const tinygltf::Mesh& _gltfMesh, ArrayProxy<const std::byte> _bin) {
+        // accessors are read element by element since attributes may be interleaved in their buffer view
+        const auto readAttribute = [&](const tinygltf::Primitive& _primitive, GltfAttribute _attribute, auto& _data, size_t _offset, uint32_t _components) {
+            const auto it = _primitive.attributes.find(GetGltfAttributeString(_attribute));
+            if (!_data.has_value() || it == _primitive.attributes.end())
+                return size_t(0);
+
+            const auto view = GetAccessorView(_gltfModel, it->second, _bin);
+            const auto count = std::min(view.count, _data->size() - _offset);
+            for (size_t v = 0; v < count; ++v)
+                ReadFloats(view, v, reinterpret_cast<float*>(&(*_data)[_offset + v]), _components);
+            return view.count;
+        };
 
-    void Gltf::PopulateMeshAttributeData(MixMeshData& _meshData, const tinygltf::Model& _gltfModel, const tinygltf::Mesh& _gltfMesh) {
         size_t vertOffset = 0;
         for (uint32_t i = 0; i < _gltfMesh.primitives.size(); ++i) {
-            uint32_t vertCount = 0;
-            if (_gltfMesh.primitives[i].attributes.count(GetGltfAttributeString(GltfAttribute::POSITION))) {
-                auto[ptr, count] = GetGltfAttributePtr(_gltfModel, _gltfMesh.primitives[i], GltfAttribute::POSITION);
-                memcpy(_meshData.positions->data() + vertOffset, ptr, count * sizeof(MixMeshData::PositionType));
-                vertCount = count;
-            }
-            if (_gltfMesh.primitives[i].attributes.count(GetGltfAttributeString(GltfAttribute::NORMAL))) {
-                auto[ptr, count] = GetGltfAttributePtr(_gltfModel, _gltfMesh.primitives[i], GltfAttribute::NORMAL);
-                memcpy(_meshData.normals->data() + vertOffset, ptr, count * sizeof(MixMeshData::NormalType));
-            }
-            if (_gltfMesh.primitives[i].attributes.count(GetGltfAttributeString(GltfAttribute::TANGENT))) {
-                auto[ptr, count] = GetGltfAttributePtr(_gltfModel, _gltfMesh.primitives[i], GltfAttribute::TANGENT);
-                // Note that tangents in GLTF are stored as vec4(Float4), where w is used to indicate handedness 
-                auto p = reinterpret_cast<const Vector4f*>(ptr);
-                std::transform(p, p + count, reinterpret_cast<Vector3f*>(_meshData.tangents->data()), [](const Vector4f& _v) {return Vector3f(_v); });
-            }
-            if (_gltfMesh.primitives[i].attributes.count(GetGltfAttributeString(GltfAttribute::TEXCOORD_0))) {
-                auto[ptr, count] = GetGltfAttributePtr(_gltfModel, _gltfMesh.primitives[i], GltfAttribute::TEXCOORD_0);
-                memcpy(_meshData.uv0->data() + vertOffset, ptr, count * sizeof(MixMeshData::UVType));
-            }
-            if (_gltfMesh.primitives[i].attributes.count(GetGltfAttributeString(GltfAttribute::TEXCOORD_1))) {
-                auto[ptr, count] = GetGltfAttributePtr(_gltfModel, _gltfMesh.primitives[i], GltfAttribute::TEXCOORD_1);
-                memcpy(_meshData.uv1->data() + vertOffset, ptr, count * sizeof(MixMeshData::UVType));
-            }
-            if (_gltfMesh.primitives[i].attributes.count(GetGltfAttributeString(GltfAttribute::COLOR))) {
-                auto[ptr, count] = GetGltfAttributePtr(_gltfModel, _gltfMesh.primitives[i], GltfAttribute::COLOR);
-                memcpy(_meshData.colors->data() + vertOffset, ptr, count * sizeof(MixMeshData::ColorType));
+            auto& primitive = _gltfMesh.primitives[i];
+            const auto vertCount = static_cast<uint32_t>(readAttribute(primitive, GltfAttribute::POSITION, _meshData.positions, vertOffset, 3));
+            readAttribute(primitive, GltfAttribute::NORMAL, _meshData.normals, vertOffset, 3);
+            // Note that tangents in GLTF are stored as vec4(Float4), where w is used to indicate handedness
+            readAttribute(primitive, GltfAttribute::TANGENT, _meshData.tangents, vertOffset, 3);
+            readAttribute(primitive, GltfAttribute::TEXCOORD_0, _meshData.uv0, vertOffset, 2);
+            readAttribute(primitive, GltfAttribute::TEXCOORD_1, _meshData.uv1, vertOffset, 2);
+
+            const auto colorIt = primitive.attributes.find(GetGltfAttributeString(GltfAttribute::COLOR));
+            if (_meshData.colors.has_value() && colorIt != primitive.attributes.end()) {
+                const auto view = GetAccessorView(_gltfModel, colorIt->second, _bin);
+                const auto count = std::min(view.count, _meshData.colors->size() - vertOffset);
+                for (size_t v = 0; v < count; ++v)
+                    (*_meshData.colors)[vertOffset + v] = ReadColor(view, v);
             }
 
-            if (_gltfMesh.primitives[i].indices != -1) {
-                const tinygltf::Accessor& accessor = _gltfModel.accessors[_gltfMesh.primitives[i].indices];
-                const tinygltf::BufferView& bufferView = _gltfModel.bufferViews[accessor.bufferView];
-                const tinygltf::Buffer& buffer = _gltfModel.buffers[bufferView.buffer];
-                const void* dataPtr = &buffer.data[accessor.byteOffset + bufferView.byteOffset];
-                _meshData.indices.value()[i].resize(accessor.count);
-
-                switch (accessor.componentType) {
-                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
-                {
-                    memcpy(_meshData.indices.value()[i].data(), dataPtr, sizeof(MixMeshData::IndexType)*accessor.count);
-                    break;
-                }
-                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-                {
-                    const auto* buf = static_cast<const unsigned short*>(dataPtr);
-                    std::copy(buf, buf + accessor.count, _meshData.indices.value()[i].data());
-                    break;
-                }
-                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
-                {
-                    const auto* buf = static_cast<const unsigned char*>(dataPtr);
-                    std::copy(buf, buf + accessor.count, _meshData.indices.value()[i].data());
-                    break;
-                }
-                default:
-                    std::cerr << "Index component type" << accessor.componentType << "not supported" << std::endl;
-                }
+            const auto indices = GetAccessorView(_gltfModel, primitive.indices, _bin);
+            if (indices.valid()) {
+                _meshData.indices.value()[i].resize(indices.count);
+                for (size_t j = 0; j < indices.count; ++j)
+                    _meshData.indices.value()[i][j] = ReadIndex(indices, j);
             }
             else {
                 std::vector<MixMeshData::IndexType> indices(vertCount);
@@ -386,7 +950,7 @@ namespace Mix {
         }
     }
 
-    void Gltf::ConstructMesh(Mesh& _mesh, MixMeshData& _meshData) {
+    void Gltf::ConstructMesh(Mesh& _mesh, MixMeshData& _meshData, const ModelParam& _param) {
         // to left hand
         if (_meshData.positions.has_value()) {
             for (auto& vertex : _meshData.positions.value())
@@ -418,7 +982,8 @@ namespace Mix {
             _mesh.setIndices(std::move(_meshData.indices.value()[i]), _meshData.topologys[i], i, baseVertex);
             baseVertex += _meshData.vertCount[i];
         }
-        _mesh.uploadMeshData(false);
+        _mesh.setCompression(_param.compression);
+        _mesh.uploadMeshData(false, _param.optimize);
     //for (const auto& gltfPrimitive : gltfMesh.primitives) {
         //	bufferPos = nullptr;
         //	bufferNormals = nullptr;
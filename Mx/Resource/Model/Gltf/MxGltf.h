@@ -27,6 +27,12 @@ namespace Mix {
 		std::shared_ptr<ResourceBase> load(const std::filesystem::path& _path, const ResourceType _type, void* _additionalParam) override;
 
 		std::shared_ptr<ResourceBase> load(const std::filesystem::path& _path, const std::string& _ext, void* _additionalParam) override;
+
+		Finalizer decode(const std::filesystem::path& _path, const std::string& _ext, void* _additionalParam) override;
+
+		Finalizer decodeData(const std::filesystem::path& _path, ArrayProxy<const std::byte> _data, const std::string& _ext, void* _additionalParam) override;
+
+		uint64_t hashParam(const void* _additionalParam) const override;
 	private:
 		enum class GltfAttribute {
 			POSITION,
@@ -62,28 +68,70 @@ namespace Mix {
 		static TextureFilterMode GetTexFilterMode(int _gltfFilter);
 		static TextureWrapMode GetTexWrapMode(int _gltfWrap);
 
-		std::shared_ptr<Model> loadFromGlb(const std::filesystem::path& _glb);
-		std::shared_ptr<Model> loadFromJson(const std::filesystem::path& _glb);
+		/** @brief Element access to the data of an accessor, whatever its component type and stride */
+		struct AccessorView {
+			const std::byte* data = nullptr;
+			size_t stride = 0;
+			size_t count = 0;
+			int componentType = -1;
+			uint32_t componentSize = 0;
+			uint32_t components = 0;
+			bool normalized = false;
+
+			bool valid() const { return data != nullptr; }
+		};
 
-		std::shared_ptr<Model> loadModel(const tinygltf::Model& _gltfModel);
-		void loadMeshes(const tinygltf::Model& _gltfModel);
+		/**
+		 * @brief Parse the JSON chunk of a .glb without touching its BIN chunk
+		 * @param _bin The BIN chunk, a view of @p _glb
+		 * @return False when the file needs the full tinygltf loader, e.g. for external buffers or required extensions
+		 */
+		static bool ParseGlb(ArrayProxy<const std::byte> _glb, tinygltf::Model& _gltfModel, ArrayProxy<const std::byte>& _bin);
+
+		/**
+		 * @brief Fill @p _gltfModel from the JSON chunk of a .glb
+		 * @throw nlohmann::json::exception When a field has an unexpected type
+		 */
+		static bool ParseGlbDocument(const nlohmann::json& _document, tinygltf::Model& _gltfModel);
+
+		/**
+		 * @param _bin Data of buffer 0, the buffers of @p _gltfModel are used when empty
+		 * @return An invalid view when the accessor is missing or out of its buffer
+		 */
+		static AccessorView GetAccessorView(const tinygltf::Model& _gltfModel, int _accessor, ArrayProxy<const std::byte> _bin);
+		static void ReadFloats(const AccessorView& _view, size_t _index, float* _out, uint32_t _count);
+		static uint32_t ReadIndex(const AccessorView& _view, size_t _index);
+		static Mesh::ColorType ReadColor(const AccessorView& _view, size_t _index);
+
+		/**
+		 * @param _binOwner Keeps @p _bin alive until the finalizer has run
+		 */
+		Finalizer createFinalizer(std::shared_ptr<tinygltf::Model> _gltfModel,
+								  ArrayProxy<const std::byte> _bin,
+								  std::shared_ptr<const void> _binOwner,
+								  const std::filesystem::path& _path,
+								  const void* _additionalParam);
+
+		std::shared_ptr<Model> loadModel(const tinygltf::Model& _gltfModel, ArrayProxy<const std::byte> _bin, const ModelParam& _param);
+		void loadMeshes(const tinygltf::Model& _gltfModel, ArrayProxy<const std::byte> _bin, const ModelParam& _param);
 		void loadTextures(const tinygltf::Model& _gltfModel);
 
 		void processNode(const tinygltf::Model& _gltfModel, const tinygltf::Node&  _gltfNode, Model::Node& _parentNode) const;
 
-		static  std::pair<const std::byte*, size_t> GetGltfAttributePtr(const tinygltf::Model& _gltfModel, const tinygltf::Primitive& _primitive, GltfAttribute _attribute);
-		static void PopulateMeshAttributeData(MixMeshData& _meshData, const tinygltf::Model& _gltfModel, const tinygltf::Mesh& _gltfMesh);
-		static void ConstructMesh(Mesh& _mesh, MixMeshData& _meshData);
+		/** @brief Interleave the vertices of a non readable mesh straight into staging memory */
+		static std::shared_ptr<Mesh> CreateMesh(const tinygltf::Model& _gltfModel, const tinygltf::Mesh& _gltfMesh, ArrayProxy<const std::byte> _bin, const ModelParam& _param);
+		static void PopulateMeshAttributeData(MixMeshData& _meshData, const tinygltf::Model& _gltfModel, const tinygltf::Mesh& _gltfMesh, ArrayProxy<const std::byte> _bin);
+		static void ConstructMesh(Mesh& _mesh, MixMeshData& _meshData, const ModelParam& _param);
 
 		static void ConvertTransformToLeftHanded(Vector3f& _translation, Quaternion& _rotation, Vector3f& _scale);
 
 		struct TempData {
 			std::vector<std::shared_ptr<Mesh>> meshes;
+			// coarser levels of each mesh, empty when none were generated
+			std::vector<std::vector<std::shared_ptr<Mesh>>> lods;
 			std::vector<std::shared_ptr<Texture>> textures;
 		};
 		std::optional<TempData> mTempData;
-
-		tinygltf::TinyGLTF mLoader;
 	};
 }
 
@@ -1,6 +1,7 @@
 #include "MxModel.h"
 #include "../../GameObject/MxGameObject.h"
 #include "../../Component/MeshFilter/MxMeshFilter.h"
+#include "../../Component/LODGroup/MxLODGroup.h"
 #include "../../Scene/MxSceneManager.h"
 
 namespace Mix {
@@ -22,6 +23,17 @@ namespace Mix {
         }
     }
 
+    void Model::setMeshLODs(size_t _mesh, std::vector<std::shared_ptr<Mesh>> _lods) {
+        if (mMeshLODs.size() <= _mesh)
+            mMeshLODs.resize(_mesh + 1);
+        mMeshLODs[_mesh] = std::move(_lods);
+    }
+
+    const std::vector<std::shared_ptr<Mesh>>& Model::getMeshLODs(size_t _mesh) const {
+        static const std::vector<std::shared_ptr<Mesh>> empty;
+        return _mesh < mMeshLODs.size() ? mMeshLODs[_mesh] : empty;
+    }
+
     HGameObject Model::genAllGameObjects(const std::string& _name,
                                          const Tag& _tag,
                                          const LayerIndex _layerIndex,
@@ -69,6 +81,13 @@ namespace Mix {
         if (_node.getMeshRef() > -1) {
             auto filter = _obj->addComponent<MeshFilter>();
             filter->setMesh(mMeshes[_node.getMeshRef()]);
+
+            auto& lods = getMeshLODs(_node.getMeshRef());
+            if (!lods.empty()) {
+                std::vector<std::shared_ptr<Mesh>> meshes = { mMeshes[_node.getMeshRef()] };
+                meshes.insert(meshes.end(), lods.begin(), lods.end());
+                _obj->addComponent<LODGroup>()->setLODs(meshes);
+            }
         }
 
         // if node has children
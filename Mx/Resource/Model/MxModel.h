@@ -95,6 +95,24 @@ namespace Mix {
 
         size_t meshCount() const { return mMeshes.size(); }
 
+        /**
+         * \brief Coarser levels of mesh @p _mesh from fine to coarse, see MeshUtils::GenerateLODChain()
+         */
+        void setMeshLODs(size_t _mesh, std::vector<std::shared_ptr<Mesh>> _lods);
+
+        const std::vector<std::shared_ptr<Mesh>>& getMeshLODs(size_t _mesh) const;
+
+        uint64_t memorySize() const override {
+            uint64_t result = 0;
+            for (auto& mesh : mMeshes)
+                result += mesh ? mesh->memorySize() : 0;
+            for (auto& lods : mMeshLODs) {
+                for (auto& lod : lods)
+                    result += lod ? lod->memorySize() : 0;
+            }
+            return result;
+        }
+
         HGameObject genAllGameObjects(const std::string& _name,
                                       const Tag& _tag               = "",
                                       LayerIndex _layerIndex  = 0,
@@ -121,8 +139,30 @@ namespace Mix {
         std::string mName;
         Node mRootNode;
         std::vector<std::shared_ptr<Mesh>> mMeshes;
+        std::vector<std::vector<std::shared_ptr<Mesh>>> mMeshLODs;
 
         void recurBuildGameObj(const std::shared_ptr<Scene>& _scene, const HGameObject& _obj, const Node& _node) const;
     };
+
+    struct ModelParam {
+        // keep vertex data of the meshes on the cpu, e.g. for collision,
+        // otherwise vertices are written straight into staging memory
+        bool readable = false;
+
+        // reorder triangles and vertices for the vertex cache and overdraw, see MeshUtils
+        bool optimize = false;
+
+        // reduced precision vertex encodings, see Mesh::setCompression()
+        Flags<VertexCompression> compression;
+
+        // coarser levels generated per mesh, game objects of the model get a LODGroup
+        uint32_t lodCount = 0;
+
+        // triangles of the occluder kept per mesh for occlusion culling, 0 for none, see Mesh::generateOccluder()
+        uint32_t occluderTriangles = 0;
+    };
+
+    template<>
+    inline auto GetAdditionalParam<Model>() { return ModelParam(); }
 }
 #endif
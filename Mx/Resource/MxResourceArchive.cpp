@@ -0,0 +1,196 @@
+#include "MxResourceArchive.h"
+#include "../Log/MxLog.h"
+#include "../Utils/MxLz4.h"
+#include "../Utils/MxUtils.h"
+#include <boost/algorithm/string.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace Mix {
+	bool ResourceArchive::open(const std::filesystem::path& _archive, const std::filesystem::path& _root) {
+		close();
+
+		mFile = MappedFile(_archive);
+		if (!mFile.isOpen())
+			return false;
+
+		const auto size = mFile.size();
+		const auto header = reinterpret_cast<const Header*>(mFile.data());
+		if (size < sizeof(Header) || std::memcmp(header->magic, Magic, sizeof(Magic)) != 0 || header->version != Version) {
+			Log::Warning("%1%: [%2%] is not a resource archive of version %3%", __FUNCTION__, _archive.generic_string(), Version);
+			close();
+			return false;
+		}
+
+		if (header->tocOffset > size || header->entryCount > (size - header->tocOffset) / sizeof(TocEntry) || header->pathsOffset > size) {
+			Log::Warning("%1%: [%2%] is truncated", __FUNCTION__, _archive.generic_string());
+			close();
+			return false;
+		}
+
+		mHeader = header;
+		mToc = reinterpret_cast<const TocEntry*>(mFile.data() + header->tocOffset);
+
+		// keys are compared against lower case paths, see Utils::GetGenericPath()
+		mRoot = Utils::GetGenericPath(_root.generic_string()).lexically_normal();
+		if (!mRoot.has_filename())
+			mRoot = mRoot.parent_path();
+		return true;
+	}
+
+	void ResourceArchive::close() {
+		mFile.close();
+		mHeader = nullptr;
+		mToc = nullptr;
+	}
+
+	const ResourceArchive::TocEntry* ResourceArchive::find(const std::filesystem::path& _path) const {
+		if (!mHeader)
+			return nullptr;
+
+		const auto key = getKey(_path);
+		const auto hash = HashPath(key);
+
+		const auto end = mToc + mHeader->entryCount;
+		auto it = std::lower_bound(mToc, end, hash, [](const TocEntry& _entry, uint64_t _hash) { return _entry.pathHash < _hash; });
+
+		// paths are stored to resolve hash collisions
+		for (; it != end && it->pathHash == hash; ++it) {
+			if (getPath(*it) == key)
+				return it;
+		}
+		return nullptr;
+	}
+
+	std::optional<ResourceArchive::Data> ResourceArchive::read(const std::filesystem::path& _path) const {
+		const auto entry = find(_path);
+		if (!entry)
+			return std::nullopt;
+
+		if (entry->offset > mFile.size() || entry->storedSize > mFile.size() - entry->offset) {
+			Log::Warning("%1%: Entry [%2%] is out of the archive", __FUNCTION__, _path.generic_string());
+			return std::nullopt;
+		}
+
+		Data result;
+		const auto stored = mFile.view(entry->offset, entry->storedSize);
+
+		if (!(entry->flags & Lz4Compressed)) {
+			result.mView = stored;
+			return result;
+		}
+
+		result.mStorage.resize(entry->size);
+		if (!Lz4::Decompress(stored, result.mStorage)) {
+			Log::Warning("%1%: Entry [%2%] is corrupted", __FUNCTION__, _path.generic_string());
+			return std::nullopt;
+		}
+		return result;
+	}
+
+	bool ResourceArchive::Build(const std::filesystem::path& _directory,
+								const std::filesystem::path& _root,
+								const std::filesystem::path& _output,
+								bool _compress,
+								uint32_t _alignment) {
+		auto root = std::filesystem::absolute(_root).lexically_normal();
+		if (!root.has_filename())
+			root = root.parent_path();
+
+		std::vector<std::filesystem::path> files;
+		for (auto& item : std::filesystem::recursive_directory_iterator(_directory)) {
+			if (item.is_regular_file())
+				files.push_back(item.path());
+		}
+
+		std::ofstream out(_output, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			return false;
+
+		const auto pad = [&out, _alignment] {
+			const auto position = static_cast<uint64_t>(out.tellp());
+			const auto padding = (_alignment - position % _alignment) % _alignment;
+			static const char zeros[256] = {};
+			for (auto left = padding; left > 0; left -= std::min<uint64_t>(left, sizeof(zeros)))
+				out.write(zeros, std::min<uint64_t>(left, sizeof(zeros)));
+		};
+
+		Header header = {};
+		std::memcpy(header.magic, Magic, sizeof(Magic));
+		header.version = Version;
+		header.alignment = _alignment;
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		std::vector<TocEntry> toc;
+		std::string paths;
+		toc.reserve(files.size());
+
+		for (auto& file : files) {
+			const auto key = boost::to_lower_copy(std::filesystem::absolute(file).lexically_normal().lexically_relative(root).generic_string());
+
+			MappedFile source(file);
+			const auto content = source.view();
+
+			TocEntry entry = {};
+			entry.pathHash = HashPath(key);
+			entry.size = content.size();
+			entry.pathOffset = static_cast<uint32_t>(paths.size());
+			entry.pathLength = static_cast<uint32_t>(key.size());
+			paths += key;
+
+			std::vector<std::byte> compressed;
+			if (_compress && !content.empty())
+				compressed = Lz4::Compress(content);
+
+			pad();
+			entry.offset = static_cast<uint64_t>(out.tellp());
+
+			// already compressed formats like png barely shrink, they are kept as they are
+			if (!compressed.empty() && compressed.size() <= content.size() - content.size() / 8) {
+				entry.flags |= Lz4Compressed;
+				entry.storedSize = compressed.size();
+				out.write(reinterpret_cast<const char*>(compressed.data()), compressed.size());
+			}
+			else {
+				entry.storedSize = content.size();
+				out.write(reinterpret_cast<const char*>(content.data()), content.size());
+			}
+
+			toc.push_back(entry);
+		}
+
+		std::sort(toc.begin(), toc.end(), [](const TocEntry& _a, const TocEntry& _b) { return _a.pathHash < _b.pathHash; });
+
+		pad();
+		header.entryCount = static_cast<uint32_t>(toc.size());
+		header.tocOffset = static_cast<uint64_t>(out.tellp());
+		out.write(reinterpret_cast<const char*>(toc.data()), toc.size() * sizeof(TocEntry));
+
+		header.pathsOffset = static_cast<uint64_t>(out.tellp());
+		out.write(paths.data(), paths.size());
+
+		out.seekp(0);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		return out.good();
+	}
+
+	uint64_t ResourceArchive::HashPath(const std::string& _path) {
+		uint64_t result = 14695981039346656037ull;
+		for (const auto c : _path)
+			result = (result ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+		return result;
+	}
+
+	std::string ResourceArchive::getKey(const std::filesystem::path& _path) const {
+		return _path.lexically_normal().lexically_relative(mRoot).generic_string();
+	}
+
+	std::string_view ResourceArchive::getPath(const TocEntry& _entry) const {
+		const auto pathsSize = mFile.size() - mHeader->pathsOffset;
+		if (static_cast<uint64_t>(_entry.pathOffset) + _entry.pathLength > pathsSize)
+			return {};
+
+		return { reinterpret_cast<const char*>(mFile.data() + mHeader->pathsOffset + _entry.pathOffset), _entry.pathLength };
+	}
+}
@@ -0,0 +1,117 @@
+#pragma once
+#ifndef MX_RESOURCE_ARCHIVE_H_
+#define MX_RESOURCE_ARCHIVE_H_
+
+#include "../Utils/MxMappedFile.h"
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+namespace Mix {
+	/**
+	 * \brief Read-only pack of resource files, memory mapped as a whole.
+	 *
+	 * Layout: a Header, the entry data, each entry starting at a multiple of Header::alignment,
+	 * then the table of contents sorted by path hash and the paths it refers to.
+	 * Entries are looked up by their path relative to the root the archive was mounted with,
+	 * uncompressed entries are handed out as views of the mapping without any copy.
+	 */
+	class ResourceArchive :GeneralBase::NoCopyBase {
+	public:
+		static constexpr char Magic[4] = { 'M', 'X', 'P', 'K' };
+		static constexpr uint32_t Version = 1;
+		static constexpr uint32_t DefaultAlignment = 64;
+
+		struct Header {
+			char magic[4];
+			uint32_t version;
+			uint32_t entryCount;
+			uint32_t alignment;
+			uint64_t tocOffset;
+			uint64_t pathsOffset;
+		};
+
+		enum EntryFlag : uint32_t {
+			Lz4Compressed = 1 << 0
+		};
+
+		struct TocEntry {
+			uint64_t pathHash;
+			uint64_t offset;
+			// bytes in the archive, differs from size when compressed
+			uint64_t storedSize;
+			uint64_t size;
+			uint32_t pathOffset;
+			uint32_t pathLength;
+			uint32_t flags;
+			uint32_t reserved;
+		};
+
+		/**
+		 * \brief Content of an entry, views the mapping or owns the decompressed bytes
+		 */
+		class Data {
+		public:
+			ArrayProxy<const std::byte> view() const { return mStorage.empty() ? mView : ArrayProxy<const std::byte>(mStorage); }
+
+		private:
+			friend class ResourceArchive;
+
+			ArrayProxy<const std::byte> mView = nullptr;
+			std::vector<std::byte> mStorage;
+		};
+
+		ResourceArchive() = default;
+
+		/**
+		 * \brief Map @p _archive, paths of entries are relative to @p _root
+		 * \return Whether the archive is valid
+		 */
+		bool open(const std::filesystem::path& _archive, const std::filesystem::path& _root);
+
+		void close();
+
+		bool isOpen() const { return mFile.isOpen(); }
+
+		uint32_t entryCount() const { return mHeader ? mHeader->entryCount : 0; }
+
+		/**
+		 * \param _path Absolute lower case path as returned by Utils::GetGenericPath()
+		 */
+		const TocEntry* find(const std::filesystem::path& _path) const;
+
+		bool contains(const std::filesystem::path& _path) const { return find(_path) != nullptr; }
+
+		/**
+		 * \brief Content of the entry of @p _path, decompressed if needed
+		 * \note Thread safe, the archive has to stay open while the returned view is used
+		 */
+		std::optional<Data> read(const std::filesystem::path& _path) const;
+
+		/**
+		 * \brief Pack every file under @p _directory, keyed by its lower case path relative to @p _root
+		 * \param _compress Store entries LZ4 compressed when that saves at least an eighth of their size
+		 * \return Whether the archive was written
+		 */
+		static bool Build(const std::filesystem::path& _directory,
+						  const std::filesystem::path& _root,
+						  const std::filesystem::path& _output,
+						  bool _compress = true,
+						  uint32_t _alignment = DefaultAlignment);
+
+		/** \brief 64 bit FNV-1a of the entry path */
+		static uint64_t HashPath(const std::string& _path);
+
+	private:
+		std::string getKey(const std::filesystem::path& _path) const;
+
+		std::string_view getPath(const TocEntry& _entry) const;
+
+		MappedFile mFile;
+		std::filesystem::path mRoot;
+		const Header* mHeader = nullptr;
+		const TocEntry* mToc = nullptr;
+	};
+}
+
+#endif
@@ -63,6 +63,11 @@ namespace Mix {
     public:
         ResourceBase() = default;
         virtual ~ResourceBase() = default;
+
+        /**
+         * \brief Bytes of CPU and GPU memory held by this resource, used for memory reports
+         */
+        virtual uint64_t memorySize() const { return 0; }
     };
 
 
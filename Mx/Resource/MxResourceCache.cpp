@@ -0,0 +1,79 @@
+#include "MxResourceCache.h"
+#include "../Log/MxLog.h"
+#include <typeinfo>
+
+namespace Mix {
+	ResourceCache::Key ResourceCache::MakeKey(const std::filesystem::path& _path, std::string _parser, uint64_t _paramHash) {
+		// "a/../a/b.png" and "a/b.png" refer to the same file
+		return { _path.lexically_normal().generic_string(), std::move(_parser), _paramHash };
+	}
+
+	std::shared_ptr<ResourceBase> ResourceCache::find(const Key& _key) {
+		const auto it = mEntries.find(_key);
+		if (it == mEntries.end())
+			return nullptr;
+
+		auto resource = it->second.lock();
+		if (!resource)
+			mEntries.erase(it);
+		return resource;
+	}
+
+	void ResourceCache::add(const Key& _key, const std::shared_ptr<ResourceBase>& _resource) {
+		if (!_resource)
+			return;
+
+		mEntries[_key] = _resource;
+
+		// drop freed entries once in a while so the map doesn't grow with every loaded file
+		if (++mAddedCount >= 64)
+			purge();
+	}
+
+	void ResourceCache::purge() {
+		for (auto it = mEntries.begin(); it != mEntries.end();) {
+			if (it->second.expired())
+				it = mEntries.erase(it);
+			else
+				++it;
+		}
+		mAddedCount = 0;
+	}
+
+	void ResourceCache::clear() {
+		mEntries.clear();
+		mPinned.clear();
+		mAddedCount = 0;
+	}
+
+	std::map<std::string, ResourceCache::MemoryUsage> ResourceCache::getMemoryUsage() const {
+		std::map<std::string, MemoryUsage> result;
+
+		for (auto& entry : mEntries) {
+			const auto resource = entry.second.lock();
+			if (!resource)
+				continue;
+
+			auto& usage = result[typeid(*resource).name()];
+			++usage.count;
+			usage.bytes += resource->memorySize();
+		}
+		return result;
+	}
+
+	void ResourceCache::logMemoryUsage() const {
+		uint64_t total = 0;
+		for (auto& usage : getMemoryUsage()) {
+			Log::Info("%1%: %2% resources, %3% KB", usage.first, usage.second.count, usage.second.bytes / 1024);
+			total += usage.second.bytes;
+		}
+		Log::Info("Cached resources: %1% KB, %2% pinned", total / 1024, mPinned.size());
+	}
+
+	size_t ResourceCache::KeyHash::operator()(const Key& _key) const {
+		auto result = std::hash<std::string>()(_key.path);
+		result ^= std::hash<std::string>()(_key.parser) + 0x9e3779b9 + (result << 6) + (result >> 2);
+		result ^= std::hash<uint64_t>()(_key.paramHash) + 0x9e3779b9 + (result << 6) + (result >> 2);
+		return result;
+	}
+}
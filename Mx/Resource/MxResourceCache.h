@@ -0,0 +1,88 @@
+#pragma once
+#ifndef MX_RESOURCE_CACHE_H_
+#define MX_RESOURCE_CACHE_H_
+
+#include "MxResourceBase.h"
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Mix {
+	/**
+	 * \brief Resources loaded by ResourceLoader, keyed by path, extension and additional param.
+	 * \note Entries are weak references, a resource is freed once nothing but the cache refers to it
+	 *       unless it has been pinned. Only accessed on the main thread.
+	 */
+	class ResourceCache {
+	public:
+		struct Key {
+			std::string path;
+			// extension of the file
+			std::string parser;
+			uint64_t paramHash = 0;
+
+			bool operator==(const Key& _other) const {
+				return paramHash == _other.paramHash && path == _other.path && parser == _other.parser;
+			}
+		};
+
+		struct KeyHash {
+			size_t operator()(const Key& _key) const;
+		};
+
+		struct MemoryUsage {
+			uint32_t count = 0;
+			uint64_t bytes = 0;
+		};
+
+		static Key MakeKey(const std::filesystem::path& _path, std::string _parser, uint64_t _paramHash);
+
+		/**
+		 * \brief The resource loaded with @p _key, null if it has not been loaded or has been freed
+		 */
+		std::shared_ptr<ResourceBase> find(const Key& _key);
+
+		void add(const Key& _key, const std::shared_ptr<ResourceBase>& _resource);
+
+		/**
+		 * \brief Keep @p _resource alive while nothing else refers to it
+		 */
+		void pin(const std::shared_ptr<ResourceBase>& _resource) { mPinned.insert(_resource); }
+
+		void unpin(const std::shared_ptr<ResourceBase>& _resource) { mPinned.erase(_resource); }
+
+		void unpinAll() { mPinned.clear(); }
+
+		bool isPinned(const std::shared_ptr<ResourceBase>& _resource) const { return mPinned.count(_resource); }
+
+		/**
+		 * \brief Remove entries whose resource has been freed
+		 */
+		void purge();
+
+		/**
+		 * \brief Drop all entries and pins, resources still referenced elsewhere stay alive
+		 */
+		void clear();
+
+		/**
+		 * \brief Number and ResourceBase::memorySize() of the living resources per resource class
+		 */
+		std::map<std::string, MemoryUsage> getMemoryUsage() const;
+
+		void logMemoryUsage() const;
+
+		size_t size() const { return mEntries.size(); }
+
+	private:
+		std::unordered_map<Key, std::weak_ptr<ResourceBase>, KeyHash> mEntries;
+		std::unordered_set<std::shared_ptr<ResourceBase>> mPinned;
+
+		// entries added since the last purge
+		uint32_t mAddedCount = 0;
+	};
+}
+
+#endif
@@ -8,12 +8,23 @@
 #include "Texture/MxImageParser.h"
 #include "Model/Gltf/MxGltf.h"
 #include "../../MixEngine.h"
+#include "../Utils/MxThreadPool.h"
 
 namespace Mix {
+	namespace {
+		const std::filesystem::path DefaultArchive = "Resource.mxpak";
+	}
+
 	ResourceLoader* ResourceLoader::Get() {
 		return MixEngine::Instance().getModule<ResourceLoader>();
 	}
 
+	ResourceLoader::ResourceLoader() = default;
+
+	ResourceLoader::~ResourceLoader() {
+		mWorkers.reset();
+	}
+
 	void ResourceLoader::load() {
 		mLoaderRegister = std::make_shared<ParserRegister>();
 
@@ -21,13 +32,67 @@ namespace Mix {
 		mLoaderRegister->registerParser(std::make_shared<GliParser>());
 		mLoaderRegister->registerParser(std::make_shared<ShaderParser>());
 		mLoaderRegister->registerParser(std::make_shared<ImageParser>());
+
+		mWorkers = std::make_unique<ThreadPool>();
+
+		// built by the packer from Resource/, loose files are used when it doesn't exist
+		if (std::filesystem::is_regular_file(DefaultArchive))
+			mountArchive(DefaultArchive);
+	}
+
+	bool ResourceLoader::mountArchive(const std::filesystem::path& _archive, const std::filesystem::path& _root) {
+		if (!mArchive.open(_archive, _root)) {
+			Log::Warning("%1%: Failed to mount [%2%]", __FUNCTION__, _archive.generic_string());
+			return false;
+		}
+
+		Log::Info("Mounted [%1%] with %2% files", _archive.generic_string(), mArchive.entryCount());
+		return true;
+	}
+
+	std::vector<std::byte> ResourceLoader::readFile(const std::filesystem::path& _path) const {
+		if (auto data = mArchive.read(_path)) {
+			const auto view = data->view();
+			return std::vector<std::byte>(view.begin(), view.end());
+		}
+
+		const MappedFile file(_path);
+		return std::vector<std::byte>(file.view().begin(), file.view().end());
+	}
+
+	ResourceParserBase::Finalizer ResourceLoader::decode(ResourceParserBase& _loader, const std::filesystem::path& _path, const std::string& _ext, void* _additionalParam) const {
+		if (auto data = mArchive.read(_path))
+			return _loader.decodeData(_path, data->view(), _ext, _additionalParam);
+
+		return _loader.decode(_path, _ext, _additionalParam);
+	}
+
+	ResourceCache::Key ResourceLoader::MakeKey(const std::filesystem::path& _path, ResourceParserBase& _loader, void* _additionalParam) {
+		const auto extension = _path.has_extension() ? _path.extension().string().substr(1) : std::string();
+		return ResourceCache::MakeKey(_path, extension, _loader.hashParam(_additionalParam));
+	}
+
+	std::shared_ptr<ResourceBase> ResourceLoader::findLoaded(const ResourceCache::Key& _key) {
+		if (auto cached = mCache.find(_key))
+			return cached;
+
+		// the file is being decoded for loadAsync(), share its result instead of decoding it again
+		const auto waiting = mWaiting.find(_key);
+		if (waiting == mWaiting.end())
+			return nullptr;
+
+		auto state = std::make_shared<AsyncLoadState>();
+		++mPendingCount;
+		waiting->second.push_back(state);
+		wait(*state);
+		return state->resource;
 	}
 
-	std::shared_ptr<ResourceBase> ResourceLoader::load(const std::string& _file, void* _additionalParam) const {
+	std::shared_ptr<ResourceBase> ResourceLoader::load(const std::string& _file, void* _additionalParam) {
 		// get lower case absolute file path
 		const auto path = Utils::GetGenericPath(_file);
 
-		if (!std::filesystem::is_regular_file(path)) {
+		if (!mArchive.contains(path) && !std::filesystem::is_regular_file(path)) {
 			Log::Warning("%s: Failed to load [%s]", __FUNCTION__, _file.c_str());
 			return nullptr;
 		}
@@ -38,7 +103,6 @@ namespace Mix {
 			return nullptr;
 		}
 
-		// chech if file has already been loaded
 		const auto extension = path.extension().string().substr(1);
 		const auto loader = mLoaderRegister->findLoaderByExt(extension);
 		if (loader == nullptr) {
@@ -46,7 +110,14 @@ namespace Mix {
 			return nullptr;
 		}
 
-		return loader->load(path, extension, _additionalParam);
+		// check if file has already been loaded
+		const auto key = MakeKey(path, *loader, _additionalParam);
+		if (auto loaded = findLoaded(key))
+			return loaded;
+
+		auto result = mArchive.contains(path) ? decode(*loader, path, extension, _additionalParam)() : loader->load(path, extension, _additionalParam);
+		mCache.add(key, result);
+		return result;
 	}
 
 
@@ -55,17 +126,126 @@ namespace Mix {
 		const auto path = Utils::GetGenericPath(_file);
 
 		if (!std::filesystem::is_regular_file(path)) {
-			Log::Warning("%s: Failed to load [%s]", __FUNCTION__, _file);
+			Log::Warning("%1%: Failed to load [%2%]", __FUNCTION__, _file);
 			return nullptr;
 		}
 
 		const auto loader = mLoaderRegister->findLoaderByType(_type);
 		if (loader == nullptr) {
-			Log::Warning("%s: No loader support extenxion [ %d ].", __FUNCTION__, ToString(_type));
+			Log::Warning("%1%: No loader support type [%2%]", __FUNCTION__, ToString(_type));
 			return nullptr;
 		}
 
-		return loader->load(path, _type, _additionalParam);
+		// keyed like the loads by extension so all of them share the resource
+		const auto key = MakeKey(path, *loader, _additionalParam);
+		if (auto loaded = findLoaded(key))
+			return loaded;
+
+		auto result = loader->load(path, _type, _additionalParam);
+		mCache.add(key, result);
+		return result;
 	}
 
+	std::shared_ptr<AsyncLoadState> ResourceLoader::loadAsyncInternal(const std::string& _file, std::shared_ptr<void> _param) {
+		auto state = std::make_shared<AsyncLoadState>();
+		state->param = std::move(_param);
+		++mPendingCount;
+
+		const auto path = Utils::GetGenericPath(_file);
+		const auto extension = path.has_extension() ? path.extension().string().substr(1) : std::string();
+		const auto loader = extension.empty() ? nullptr : mLoaderRegister->findLoaderByExt(extension);
+
+		if (!loader || (!mArchive.contains(path) && !std::filesystem::is_regular_file(path))) {
+			Log::Warning("%s: Failed to load [%s]", __FUNCTION__, _file.c_str());
+
+			// completes with a null resource in the next update()
+			std::lock_guard<std::mutex> lock(mDecodedMutex);
+			mDecoded.push_back({ state, nullptr });
+			return state;
+		}
+
+		auto key = MakeKey(path, *loader, state->param.get());
+		if (auto cached = mCache.find(key)) {
+			std::lock_guard<std::mutex> lock(mDecodedMutex);
+			mDecoded.push_back({ state, [cached] { return cached; } });
+			return state;
+		}
+
+		// the same file is already being decoded
+		const auto waiting = mWaiting.find(key);
+		if (waiting != mWaiting.end()) {
+			waiting->second.push_back(state);
+			return state;
+		}
+		mWaiting.emplace(key, std::vector<std::shared_ptr<AsyncLoadState>>());
+
+		mWorkers->enqueue([this, state, loader, path, extension, key = std::move(key)] {
+			// a failed decode still has to complete the load and the loads waiting for it
+			ResourceParserBase::Finalizer finalizer;
+			try {
+				finalizer = decode(*loader, path, extension, state->param.get());
+			}
+			catch (const std::exception& _e) {
+				Log::Error("Failed to decode [%1%]: %2%", path.generic_string(), _e.what());
+			}
+			catch (...) {
+				Log::Error("Failed to decode [%1%]", path.generic_string());
+			}
+			{
+				std::lock_guard<std::mutex> lock(mDecodedMutex);
+				mDecoded.push_back({ state, std::move(finalizer), std::move(key) });
+			}
+			mDecodedCondition.notify_all();
+		});
+
+		return state;
+	}
+
+	void ResourceLoader::complete(AsyncLoadState& _state, std::shared_ptr<ResourceBase> _resource) {
+		_state.resource = std::move(_resource);
+		_state.done = true;
+		_state.param.reset();
+		--mPendingCount;
+
+		if (_state.callback)
+			_state.callback(_state.resource);
+		_state.callback = nullptr;
+	}
+
+	void ResourceLoader::update() {
+		std::vector<Decoded> decoded;
+		{
+			std::lock_guard<std::mutex> lock(mDecodedMutex);
+			decoded.swap(mDecoded);
+		}
+
+		for (auto& item : decoded) {
+			auto resource = item.finalizer ? item.finalizer() : nullptr;
+
+			if (item.key) {
+				mCache.add(*item.key, resource);
+
+				const auto waiting = mWaiting.find(*item.key);
+				if (waiting != mWaiting.end()) {
+					auto states = std::move(waiting->second);
+					mWaiting.erase(waiting);
+					for (auto& state : states)
+						complete(*state, resource);
+				}
+			}
+
+			complete(*item.state, std::move(resource));
+		}
+	}
+
+	void ResourceLoader::wait(const AsyncLoadState& _state) {
+		update();
+		while (!_state.done) {
+			{
+				std::unique_lock<std::mutex> lock(mDecodedMutex);
+				mDecodedCondition.wait(lock, [this] { return !mDecoded.empty(); });
+			}
+			update();
+		}
+	}
 }
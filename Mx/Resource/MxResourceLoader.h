@@ -4,15 +4,71 @@
 
 #include "MxResourceParserBase.hpp"
 #include "MxParserRegister.hpp"
+#include "MxResourceCache.h"
+#include "MxResourceArchive.h"
 #include "../Engine/MxModuleBase.h"
+#include <condition_variable>
+#include <type_traits>
+#include <mutex>
+#include <optional>
 
 namespace Mix {
 	class ResourceBase;
+	class ThreadPool;
+
+	/**
+	 * \brief Shared state of an asynchronous load
+	 */
+	struct AsyncLoadState {
+		// only accessed on the main thread
+		bool done = false;
+		std::shared_ptr<ResourceBase> resource;
+		std::function<void(const std::shared_ptr<ResourceBase>&)> callback;
+
+		// copy of the additional param, alive until the resource is created
+		std::shared_ptr<void> param;
+	};
+
+	/**
+	 * \brief Handle of a resource loaded by ResourceLoader::loadAsync()
+	 */
+	template<typename _Ty>
+	class AsyncLoad {
+	public:
+		AsyncLoad() = default;
+
+		explicit AsyncLoad(std::shared_ptr<AsyncLoadState> _state) :mState(std::move(_state)) {}
+
+		bool valid() const { return mState != nullptr; }
+
+		/**
+		 * \brief Whether the resource has been created, which happens in the ResourceLoader::update() after decoding
+		 */
+		bool isReady() const { return mState && mState->done; }
+
+		/**
+		 * \brief The loaded resource, null while the load is in progress or when it failed
+		 */
+		std::shared_ptr<_Ty> get() const { return isReady() ? std::dynamic_pointer_cast<_Ty>(mState->resource) : nullptr; }
+
+		/**
+		 * \brief Block until the resource has been created
+		 * \note Must be called on the main thread
+		 */
+		std::shared_ptr<_Ty> wait() const;
+
+	private:
+		std::shared_ptr<AsyncLoadState> mState;
+	};
 
 	class ResourceLoader : public ModuleBase {
 	public:
 		static ResourceLoader* Get();
 
+		ResourceLoader();
+
+		~ResourceLoader();
+
 		/**
 		 * \brief Initialize the Resources
 		 */
@@ -20,6 +76,9 @@ namespace Mix {
 
 		void init() override {}
 
+		/** \brief Worker threads decoding resources, also used by parallel loops of the engine */
+		ThreadPool& getWorkers() const { return *mWorkers; }
+
 
 		/**
 		 * \brief Return the ParserRegister
@@ -28,35 +87,127 @@ namespace Mix {
 			return mLoaderRegister;
 		}
 
+		/**
+		 * \brief Read files from @p _archive before looking for loose files
+		 * \param _root Directory the paths of the archive are relative to
+		 */
+		bool mountArchive(const std::filesystem::path& _archive, const std::filesystem::path& _root = ".");
+
+		const ResourceArchive& getArchive() const { return mArchive; }
+
+		/**
+		 * \brief Content of @p _path from the mounted archive, from disk when the archive doesn't hold it
+		 * \return Empty when the file doesn't exist
+		 * \note Thread safe
+		 */
+		std::vector<std::byte> readFile(const std::filesystem::path& _path) const;
+
+		/**
+		 * \brief Resources loaded so far, used to share resources loaded more than once
+		 */
+		ResourceCache& getCache() const { return mCache; }
+
 		/**
 		* \brief Load file from disk
 		* \note This function will infer the file type from the extension of the file
 		*       and will return null shared_ptr when there is no extension.
 		* \param _file The path of the file
-		* \return The object referring to the resource
+		* \return The object referring to the resource, shared with other loads of the same file and param
+		* \note Waits for a loadAsync() of the same file and param that is in progress
 		*/
-		std::shared_ptr<ResourceBase> load(const std::string& _file, void* _additionalParam = nullptr) const;
+		std::shared_ptr<ResourceBase> load(const std::string& _file, void* _additionalParam = nullptr);
 
 		template<typename _Ty>
-		std::shared_ptr<_Ty> load(const std::string& _file, void* _additionalParam = nullptr) const;
+		std::shared_ptr<_Ty> load(const std::string& _file, void* _additionalParam = nullptr);
 
 		/**
 		* \brief Load file from disk, parse it using loader that supports specified type
+		* \note Always reads loose files, entries of the mounted archive are parsed by extension
 		* \param _file The path of the file
 		* \param _type
-		* \return The object referring to the resource
+		* \return The object referring to the resource, shared with other loads of the same file and param
+		* \note Waits for a loadAsync() of the same file and param that is in progress
 		*/
 		std::shared_ptr<ResourceBase> load(const std::string& _file, const ResourceType _type, void* _additionalParam = nullptr);
 
 		template<typename _Ty>
 		std::shared_ptr<_Ty> load(const std::string& _file, const ResourceType _type, void* _additionalParam = nullptr);
 
+		/**
+		 * \brief Load file on a worker thread
+		 * \note File I/O and decoding run on the worker pool, the resource is created and @p _callback is
+		 *       called on the main thread in update(). Resources created in the same update() share one upload batch.
+		 *       Cached resources and loads already in progress are shared instead of being decoded again.
+		 * \param _param Additional param of the parser, copied
+		 */
+		template<typename _Ty, typename _Param, typename = std::enable_if_t<!std::is_invocable_v<_Param, std::shared_ptr<_Ty>>>>
+		AsyncLoad<_Ty> loadAsync(const std::string& _file, _Param _param, std::function<void(std::shared_ptr<_Ty>)> _callback = nullptr);
+
+		template<typename _Ty>
+		AsyncLoad<_Ty> loadAsync(const std::string& _file, std::function<void(std::shared_ptr<_Ty>)> _callback = nullptr);
+
+		/**
+		 * \brief Create the resources whose decoding has finished and call their callbacks, called once per frame
+		 */
+		void update();
+
+		/**
+		 * \brief Block until the load of @p _state has finished, creating finished resources in the meantime
+		 */
+		void wait(const AsyncLoadState& _state);
+
+		/**
+		 * \brief Number of asynchronous loads whose resource has not been created yet
+		 */
+		uint32_t pendingCount() const { return mPendingCount; }
+
 	private:
+		struct Decoded {
+			std::shared_ptr<AsyncLoadState> state;
+			ResourceParserBase::Finalizer finalizer;
+			// set when the result has to be cached and handed to the loads waiting for it
+			std::optional<ResourceCache::Key> key;
+		};
+
+		void complete(AsyncLoadState& _state, std::shared_ptr<ResourceBase> _resource);
+
+		std::shared_ptr<AsyncLoadState> loadAsyncInternal(const std::string& _file, std::shared_ptr<void> _param);
+
+		/**
+		 * \brief Cache key of @p _path, the same for every kind of load
+		 */
+		static ResourceCache::Key MakeKey(const std::filesystem::path& _path, ResourceParserBase& _loader, void* _additionalParam);
+
+		/**
+		 * \brief The cached resource of @p _key, waits for the async load of @p _key if one is in progress
+		 */
+		std::shared_ptr<ResourceBase> findLoaded(const ResourceCache::Key& _key);
+
 		std::shared_ptr<ParserRegister> mLoaderRegister;
+
+		/**
+		 * \brief Parse @p _path from the archive if it holds the file, from disk otherwise
+		 */
+		ResourceParserBase::Finalizer decode(ResourceParserBase& _loader, const std::filesystem::path& _path, const std::string& _ext, void* _additionalParam) const;
+
+		ResourceArchive mArchive;
+
+		mutable ResourceCache mCache;
+
+		// loads sharing a key with a load that is being decoded, completed along with it
+		std::unordered_map<ResourceCache::Key, std::vector<std::shared_ptr<AsyncLoadState>>, ResourceCache::KeyHash> mWaiting;
+
+		std::vector<Decoded> mDecoded;
+		std::mutex mDecodedMutex;
+		std::condition_variable mDecodedCondition;
+		uint32_t mPendingCount = 0;
+
+		// declared last so workers are joined before anything they use is destroyed
+		std::unique_ptr<ThreadPool> mWorkers;
 	};
 
 	template <typename _Ty>
-	std::shared_ptr<_Ty> ResourceLoader::load(const std::string& _file, void* _additionalParam) const {
+	std::shared_ptr<_Ty> ResourceLoader::load(const std::string& _file, void* _additionalParam) {
 		return std::dynamic_pointer_cast<_Ty>(load(_file, _additionalParam));
 	}
 
@@ -64,6 +215,37 @@ namespace Mix {
 	std::shared_ptr<_Ty> ResourceLoader::load(const std::string& _file, const ResourceType _type, void* _additionalParam) {
 		return std::dynamic_pointer_cast<_Ty>(load(_file, _type, _additionalParam));
 	}
+
+	template <typename _Ty, typename _Param, typename>
+	AsyncLoad<_Ty> ResourceLoader::loadAsync(const std::string& _file, _Param _param, std::function<void(std::shared_ptr<_Ty>)> _callback) {
+		auto state = loadAsyncInternal(_file, std::make_shared<_Param>(std::move(_param)));
+		if (_callback) {
+			state->callback = [callback = std::move(_callback)](const std::shared_ptr<ResourceBase>& _resource) {
+				callback(std::dynamic_pointer_cast<_Ty>(_resource));
+			};
+		}
+		return AsyncLoad<_Ty>(std::move(state));
+	}
+
+	template <typename _Ty>
+	AsyncLoad<_Ty> ResourceLoader::loadAsync(const std::string& _file, std::function<void(std::shared_ptr<_Ty>)> _callback) {
+		auto state = loadAsyncInternal(_file, nullptr);
+		if (_callback) {
+			state->callback = [callback = std::move(_callback)](const std::shared_ptr<ResourceBase>& _resource) {
+				callback(std::dynamic_pointer_cast<_Ty>(_resource));
+			};
+		}
+		return AsyncLoad<_Ty>(std::move(state));
+	}
+
+	template <typename _Ty>
+	std::shared_ptr<_Ty> AsyncLoad<_Ty>::wait() const {
+		if (!mState)
+			return nullptr;
+
+		ResourceLoader::Get()->wait(*mState);
+		return get();
+	}
 }
 
 #endif
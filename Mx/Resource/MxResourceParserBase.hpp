@@ -3,14 +3,21 @@
 #define MX_RESOURCE_PARSER_BASE_H_
 
 #include "MxResourceBase.h"
+#include "../Utils/MxArrayProxy.h"
 
 #include <set>
 #include <unordered_set>
 #include <filesystem>
+#include <functional>
 
 namespace Mix {
 	class ResourceParserBase {
 	public:
+		/**
+		 * \brief Creates the resource from decoded data, called on the main thread
+		 */
+		using Finalizer = std::function<std::shared_ptr<ResourceBase>()>;
+
 		ResourceParserBase(const ResourceParserBase& _other) = default;
 
 		ResourceParserBase(ResourceParserBase&& _other) noexcept = default;
@@ -29,6 +36,33 @@ namespace Mix {
 		 */
 		virtual std::shared_ptr<ResourceBase> load(const std::filesystem::path& _path, const std::string& _ext, void* _additionalParam = nullptr) = 0;
 
+		/**
+		 * \brief CPU side of a load (file I/O and decoding), called on a worker thread by ResourceLoader::loadAsync()
+		 * \return The step that creates the resource on the main thread
+		 * \note Parsers that don't split their load run all of it on the main thread
+		 */
+		virtual Finalizer decode(const std::filesystem::path& _path, const std::string& _ext, void* _additionalParam) {
+			return [this, _path, _ext, _additionalParam] { return load(_path, _ext, _additionalParam); };
+		}
+
+		/**
+		 * \brief CPU side of a load from a file already in memory, such as an entry of a ResourceArchive
+		 * \param _path Path the data was stored under, used for names and relative references
+		 * \note @p _data is only valid during the call, the finalizer must not refer to it.
+		 *       Parsers that don't read from memory load the file from @p _path instead
+		 */
+		virtual Finalizer decodeData(const std::filesystem::path& _path, ArrayProxy<const std::byte> _data, const std::string& _ext, void* _additionalParam) {
+			return decode(_path, _ext, _additionalParam);
+		}
+
+		/**
+		 * \brief Hash of the additional param, loads with the same path and hash share one resource
+		 * \note Parsers taking a param have to hash every field that changes the result
+		 */
+		virtual uint64_t hashParam(const void* _additionalParam) const {
+			return 0;
+		}
+
 		virtual ~ResourceParserBase() = default;
 
 		/**
@@ -1,17 +1,85 @@
 #include "MxShaderParser.h"
 #include "../../Log/MxLog.h"
 #include "../../Math/MxMath.h"
-#include "MxShaderParser.h"
+#include "../../Utils/MxMappedFile.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
 
 namespace Mix {
+	namespace {
+		/** @brief Resolves #include "file" relative to the directory of the including shader */
+		class FileIncluder :public shaderc::CompileOptions::IncluderInterface {
+		public:
+			shaderc_include_result* GetInclude(const char* _requestedSource,
+											   shaderc_include_type _type,
+											   const char* _requestingSource,
+											   size_t _includeDepth) override {
+				auto include = new Include();
+				const auto path = std::filesystem::path(_requestingSource).parent_path() / _requestedSource;
+
+				std::ifstream file(path, std::ios::binary);
+				if (file) {
+					include->name = path.generic_string();
+					include->content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+				}
+				else {
+					// an empty name reports the failure, the content is the error message
+					include->content = "Cannot open " + path.generic_string();
+				}
+
+				include->result = { include->name.c_str(), include->name.size(),
+									include->content.c_str(), include->content.size(),
+									include };
+				return &include->result;
+			}
+
+			void ReleaseInclude(shaderc_include_result* _data) override {
+				delete static_cast<Include*>(_data->user_data);
+			}
+
+		private:
+			struct Include {
+				std::string name;
+				std::string content;
+				shaderc_include_result result;
+			};
+		};
+	}
+
 	std::shared_ptr<ResourceBase> ShaderParser::load(const std::filesystem::path& _path, const ResourceType _type, void* _additionalParam) {
-		std::ifstream inFile(_path, std::ios_base::binary);
-		auto open = inFile.is_open();
-		const size_t size = std::filesystem::file_size(_path);
+		const MappedFile file(_path);
+		return createSource(file.view(), _type, _path.generic_string());
+	}
+
+	std::shared_ptr<ResourceBase> ShaderParser::load(const std::filesystem::path& _path, const std::string& _ext, void* _additionalParam) {
+		const auto type = GetType(_ext);
+		if (type == ResourceType::Unknown) {
+			Log::Error("Unknown shader file extension");
+			return nullptr;
+		}
+
+		return load(_path, type, _additionalParam);
+	}
+
+	ResourceParserBase::Finalizer ShaderParser::decode(const std::filesystem::path& _path, const std::string& _ext, void* _additionalParam) {
+		auto result = load(_path, _ext, _additionalParam);
+		return [result] { return result; };
+	}
+
+	ResourceParserBase::Finalizer ShaderParser::decodeData(const std::filesystem::path& _path, ArrayProxy<const std::byte> _data, const std::string& _ext, void* _additionalParam) {
+		const auto type = GetType(_ext);
+		if (type == ResourceType::Unknown) {
+			Log::Error("Unknown shader file extension");
+			return [] { return nullptr; };
+		}
+
+		auto result = createSource(_data, type, _path.generic_string());
+		return [result] { return result; };
+	}
 
-		std::vector<uint32_t> fileData(Math::Align(size, 4) / 4);
-		inFile.read(reinterpret_cast<char*>(fileData.data()), size);
-		inFile.close();
+	std::shared_ptr<ShaderSource> ShaderParser::createSource(ArrayProxy<const std::byte> _data, const ResourceType _type, const std::string& _name) const {
+		const size_t size = _data.size();
 
 		if (IsGlsl(_type)) {
 			shaderc_shader_kind kind;
@@ -38,10 +106,10 @@ namespace Mix {
 				return nullptr;
 			}
 
-			auto spvCode = compileGlslToSpv(reinterpret_cast<const char*>(fileData.data()),
+			auto spvCode = compileGlslToSpv(reinterpret_cast<const char*>(_data.data()),
 											size,
 											kind,
-											_path.filename().string());
+											_name);
 
 			return std::make_shared<ShaderSource>(std::move(spvCode), stage);
 		}
@@ -65,32 +133,30 @@ namespace Mix {
 				return nullptr;
 			}
 
-			return std::make_shared<ShaderSource>(std::move(fileData), stage);
+			// copied since the data may not be aligned to 4 bytes
+			std::vector<uint32_t> code(Math::Align(size, 4) / 4);
+			std::memcpy(code.data(), _data.data(), size);
+
+			return std::make_shared<ShaderSource>(std::move(code), stage);
 		}
 	}
 
-	std::shared_ptr<ResourceBase> ShaderParser::load(const std::filesystem::path& _path, const std::string& _ext, void* _additionalParam) {
-		ResourceType type;
-		if (_ext == RESOURCE_GLSL_VERT_EXT) type = ResourceType::GLSL_VERT;
-		else if (_ext == RESOURCE_GLSL_FRAG_EXT) type = ResourceType::GLSL_FRAG;
-		else if (_ext == RESOURCE_GLSL_GEOM_EXT) type = ResourceType::GLSL_GEOMETRY;
-		else if (_ext == RESOURCE_GLSL_TESC_EXT) type = ResourceType::GLSL_TESS_CTRL;
-		else if (_ext == RESOURCE_GLSL_TESE_EXT) type = ResourceType::GLSL_TESS_EVLT;
-		else if (_ext == RESOURCE_GLSL_COMP_EXT) type = ResourceType::GLSL_COMPUTE;
-
-		else if (_ext == RESOURCE_SPRV_VERT_EXT) type = ResourceType::SPIRV_VERT;
-		else if (_ext == RESOURCE_SPRV_FRAG_EXT) type = ResourceType::SPIRV_FRAG;
-		else if (_ext == RESOURCE_SPRV_GEOM_EXT) type = ResourceType::SPIRV_GEOMETRY;
-		else if (_ext == RESOURCE_SPRV_TESC_EXT) type = ResourceType::SPIRV_TESS_CTRL;
-		else if (_ext == RESOURCE_SPRV_TESE_EXT) type = ResourceType::SPIRV_TESS_EVLT;
-		else if (_ext == RESOURCE_SPRV_COMP_EXT) type = ResourceType::SPIRV_COMPUTE;
+	ResourceType ShaderParser::GetType(const std::string& _ext) {
+		if (_ext == RESOURCE_GLSL_VERT_EXT) return ResourceType::GLSL_VERT;
+		if (_ext == RESOURCE_GLSL_FRAG_EXT) return ResourceType::GLSL_FRAG;
+		if (_ext == RESOURCE_GLSL_GEOM_EXT) return ResourceType::GLSL_GEOMETRY;
+		if (_ext == RESOURCE_GLSL_TESC_EXT) return ResourceType::GLSL_TESS_CTRL;
+		if (_ext == RESOURCE_GLSL_TESE_EXT) return ResourceType::GLSL_TESS_EVLT;
+		if (_ext == RESOURCE_GLSL_COMP_EXT) return ResourceType::GLSL_COMPUTE;
 
-		else {
-			Log::Error("Unknown shader file extension");
-			return nullptr;
-		}
+		if (_ext == RESOURCE_SPRV_VERT_EXT) return ResourceType::SPIRV_VERT;
+		if (_ext == RESOURCE_SPRV_FRAG_EXT) return ResourceType::SPIRV_FRAG;
+		if (_ext == RESOURCE_SPRV_GEOM_EXT) return ResourceType::SPIRV_GEOMETRY;
+		if (_ext == RESOURCE_SPRV_TESC_EXT) return ResourceType::SPIRV_TESS_CTRL;
+		if (_ext == RESOURCE_SPRV_TESE_EXT) return ResourceType::SPIRV_TESS_EVLT;
+		if (_ext == RESOURCE_SPRV_COMP_EXT) return ResourceType::SPIRV_COMPUTE;
 
-		return load(_path, type, _additionalParam);
+		return ResourceType::Unknown;
 	}
 
 	std::vector<uint32_t> ShaderParser::compileGlslToSpv(const char* _data,
@@ -100,8 +166,9 @@ namespace Mix {
 		shaderc::CompileOptions option;
 		option.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_1);
 		option.SetSourceLanguage(shaderc_source_language_glsl);
+		option.SetIncluder(std::make_unique<FileIncluder>());
 
-		auto compileResult = mCompiler.CompileGlslToSpv(_data, _size, _kind, _name.c_str());
+		auto compileResult = mCompiler.CompileGlslToSpv(_data, _size, _kind, _name.c_str(), option);
 		if (compileResult.GetCompilationStatus() != shaderc_compilation_status_success) {
 			Log::Error(compileResult.GetErrorMessage());
 			return {};
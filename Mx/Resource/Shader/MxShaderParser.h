@@ -60,15 +60,27 @@ namespace Mix {
 
 		std::shared_ptr<ResourceBase> load(const std::filesystem::path& _path, const std::string& _ext, void* _additionalParam) override;
 
+		/**
+		 * @brief Shader sources hold no GPU objects, so compilation runs entirely on the worker
+		 */
+		Finalizer decode(const std::filesystem::path& _path, const std::string& _ext, void* _additionalParam) override;
+
+		Finalizer decodeData(const std::filesystem::path& _path, ArrayProxy<const std::byte> _data, const std::string& _ext, void* _additionalParam) override;
+
 	private:
 		shaderc::Compiler mCompiler;
 
+		std::shared_ptr<ShaderSource> createSource(ArrayProxy<const std::byte> _data, const ResourceType _type, const std::string& _name) const;
+
 		std::vector<uint32_t> compileGlslToSpv(
 			const char* _data,
 			const size_t _size,
 			const shaderc_shader_kind _kind, const std::string& _name) const;
 
 		bool static IsGlsl(const ResourceType _type);
+
+		/** @brief ResourceType of a shader file extension, Unknown if it isn't one */
+		static ResourceType GetType(const std::string& _ext);
 	};
 }
 
@@ -27,6 +27,8 @@ namespace Mix {
 
 		size_t getSprvDataSize() const { return mData.size() * 4; }
 
+		uint64_t memorySize() const override { return getSprvDataSize(); }
+
 	private:
 		std::vector<uint32_t> mData;
 		vk::ShaderStageFlagBits mStage;
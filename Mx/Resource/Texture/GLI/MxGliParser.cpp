@@ -2,6 +2,11 @@
 #include <gli/gli.hpp>
 #include "../../../../MixEngine.h"
 #include "../../../Graphics/Texture/MxTexture.h"
+#include "../../../Graphics/Texture/MxTextureStreamer.h"
+#include "../../../Graphics/MxGraphics.h"
+#include "../MxTextureTranscoder.h"
+#include "../../../Utils/MxMappedFile.h"
+#include "../../MxResourceLoader.h"
 
 namespace Mix {
 
@@ -13,56 +18,90 @@ namespace Mix {
 		else if (_type == ResourceType::DDS)
 			texture = gli::load_dds(_path.generic_string());
 
-		return GliToTexture(texture);
+		return GliToTexture(texture, reinterpret_cast<TextureParam*>(_additionalParam), _path);
 	}
 
 	std::shared_ptr<ResourceBase> GliParser::load(const std::filesystem::path& _path, const std::string& _ext, void* _additionalParam) {
+		return decode(_path, _ext, _additionalParam)();
+	}
+
+	ResourceParserBase::Finalizer GliParser::decode(const std::filesystem::path& _path, const std::string& _ext, void* _additionalParam) {
+		const MappedFile file(_path);
+		return decodeData(_path, file.view(), _ext, _additionalParam);
+	}
+
+	ResourceParserBase::Finalizer GliParser::decodeData(const std::filesystem::path& _path, ArrayProxy<const std::byte> _data, const std::string& _ext, void* _additionalParam) {
 		gli::texture texture;
 
+		const auto data = reinterpret_cast<const char*>(_data.data());
 		if (_ext == "ktx")
-			texture = gli::load_ktx(_path.generic_string());
+			texture = gli::load_ktx(data, _data.size());
 		else if (_ext == "dds")
-			texture = gli::load_dds(_path.generic_string());
+			texture = gli::load_dds(data, _data.size());
 
-		return GliToTexture(texture);
+		const auto param = _additionalParam ? *reinterpret_cast<TextureParam*>(_additionalParam) : TextureParam();
+		return [texture = std::move(texture), param, _path] {
+			return GliToTexture(texture, &param, _path);
+		};
 	}
 
-	std::shared_ptr<ResourceBase> GliParser::GliToTexture(const gli::texture& _texture) {
+	std::shared_ptr<ResourceBase> GliParser::GliToTexture(const gli::texture& _texture, const TextureParam* _param, const std::filesystem::path& _source) {
+		const auto samplerInfo = _param ? _param->samplerInfo : SamplerInfo();
+
 		switch (_texture.target()) {
-		case gli::TARGET_2D: return ToTexture2D(_texture);
-		case gli::TARGET_CUBE: return ToCubeMap(_texture);
+		case gli::TARGET_2D: return ToTexture2D(_texture, samplerInfo, _source);
+		case gli::TARGET_CUBE: return ToCubeMap(_texture, samplerInfo);
 		default: return nullptr;
 		}
 	}
 
-	std::shared_ptr<ResourceBase> GliParser::ToTexture2D(const gli::texture& _texture) {
-		auto result = std::make_shared<Texture2D>(_texture.extent().x, _texture.extent().y, GliFormatToTextureFormat(_texture.format()), _texture.levels());
+	std::shared_ptr<ResourceBase> GliParser::ToTexture2D(const gli::texture& _texture, const SamplerInfo& _samplerInfo, const std::filesystem::path& _source) {
+		const auto fileFormat = GliFormatToTextureFormat(_texture.format());
+		auto format = fileFormat;
+		TextureStreamer::MipChain mips(_texture.levels());
+		for (uint32_t mip = 0; mip < mips.size(); ++mip)
+			mips[mip] = GetLevel(_texture, 0, 0, mip, fileFormat);
+
+		if (TextureTranscoder::IsBlockCompressed(format) && !Texture::IsFormatSupported(format))
+			format = TextureFormat::R8G8B8A8_Unorm;
+
+		auto& streamer = Graphics::Get()->getTextureStreamer();
+		if (streamer.isEnabled() && _texture.levels() > 1) {
+			TextureStreamer::MipSource source;
+			if (!_source.empty()) {
+				source = [_source, fileFormat](uint32_t _firstMip, uint32_t _lastMip) {
+					const auto data = ResourceLoader::Get()->readFile(_source);
+					const auto texture = gli::load(reinterpret_cast<const char*>(data.data()), data.size());
+					if (texture.empty() || texture.levels() < _lastMip)
+						return TextureStreamer::MipChain();
+
+					TextureStreamer::MipChain result;
+					for (auto mip = _firstMip; mip < _lastMip; ++mip)
+						result.push_back(GetLevel(texture, 0, 0, mip, fileFormat));
+					return result;
+				};
+			}
+			return streamer.createTexture(_texture.extent().x, _texture.extent().y, format, std::move(mips), std::move(source), _samplerInfo);
+		}
 
-		const char* data = reinterpret_cast<const char*>(_texture.data());
-		gli::texture::size_type offset = 0;
-		auto mipLevel = _texture.levels();
+		auto result = std::make_shared<Texture2D>(_texture.extent().x, _texture.extent().y, format, _texture.levels(), _samplerInfo);
 
-		for (uint32_t mip = 0; mip < mipLevel; ++mip) {
-			result->setPixels(data + offset, _texture.size(mip), mip);
-			offset += _texture.size(mip);
-		}
+		for (uint32_t mip = 0; mip < mips.size(); ++mip)
+			result->setPixels(mips[mip].data(), mips[mip].size(), mip);
 		result->apply(false);
 
 		return result;
 	}
 
-	std::shared_ptr<ResourceBase> GliParser::ToCubeMap(const gli::texture& _texture) {
-		const auto& cubeMap = static_cast<const gli::texture_cube&>(_texture);
-		auto result = std::make_shared<CubeMap>(cubeMap.extent().x, GliFormatToTextureFormat(cubeMap.format()), cubeMap.levels());
-
-		const char* data = reinterpret_cast<const char*>(cubeMap.data());
-		gli::texture::size_type offset = 0;
-		auto mipLevel = cubeMap.levels();
+	std::shared_ptr<ResourceBase> GliParser::ToCubeMap(const gli::texture& _texture, const SamplerInfo& _samplerInfo) {
+		auto format = GliFormatToTextureFormat(_texture.format());
+		const bool decode = TextureTranscoder::IsBlockCompressed(format) && !Texture::IsFormatSupported(format);
+		auto result = std::make_shared<CubeMap>(_texture.extent().x, decode ? TextureFormat::R8G8B8A8_Unorm : format, _texture.levels(), _samplerInfo);
 
 		for (uint32_t face = 0; face < 6; ++face) {
-			for (uint32_t mip = 0; mip < mipLevel; ++mip) {
-				result->setPixels(data + offset, cubeMap[face][mip].size(), static_cast<CubeMapFace>(face), mip);
-				offset += cubeMap[face][mip].size();
+			for (uint32_t mip = 0; mip < _texture.levels(); ++mip) {
+				auto pixels = GetLevel(_texture, face, 0, mip, format);
+				result->setPixels(pixels.data(), pixels.size(), static_cast<CubeMapFace>(face), mip);
 			}
 		}
 
@@ -71,6 +110,17 @@ namespace Mix {
 		return result;
 	}
 
+	std::vector<char> GliParser::GetLevel(const gli::texture& _texture, uint32_t _face, uint32_t _layer, uint32_t _mip, TextureFormat _format) {
+		const char* data = reinterpret_cast<const char*>(_texture.data(_layer, _face, _mip));
+		const auto extent = _texture.extent(_mip);
+
+		// decoded on the cpu when the device can't sample the block compressed format
+		if (TextureTranscoder::IsBlockCompressed(_format) && !Texture::IsFormatSupported(_format))
+			return TextureTranscoder::Decode(data, extent.x, extent.y, _format);
+
+		return std::vector<char>(data, data + TextureTranscoder::GetLevelSize(_format, extent.x, extent.y));
+	}
+
 	TextureFormat GliParser::GliFormatToTextureFormat(const gli::format _format) {
 		switch (_format) {
 		case gli::FORMAT_RGBA8_UNORM_PACK8:
@@ -78,6 +128,14 @@ namespace Mix {
 			return TextureFormat::R8G8B8A8_Unorm;
 		case gli::FORMAT_BGRA8_UNORM_PACK8:
 			return TextureFormat::B8G8R8A8_Unorm;
+		case gli::FORMAT_RGBA_DXT1_UNORM_BLOCK8:
+			return TextureFormat::BC1_RGBA_Unorm;
+		case gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16:
+			return TextureFormat::BC3_Unorm;
+		case gli::FORMAT_RG_ATI2N_UNORM_BLOCK16:
+			return TextureFormat::BC5_Unorm;
+		case gli::FORMAT_RGBA_BP_UNORM_BLOCK16:
+			return TextureFormat::BC7_Unorm;
 		default:
 			return TextureFormat::Unknown;
 		}
@@ -19,10 +19,22 @@ namespace Mix {
 
 		std::shared_ptr<ResourceBase> load(const std::filesystem::path& _path, const std::string& _ext, void* _additionalParam) override;
 
+		Finalizer decode(const std::filesystem::path& _path, const std::string& _ext, void* _additionalParam) override;
+
+		Finalizer decodeData(const std::filesystem::path& _path, ArrayProxy<const std::byte> _data, const std::string& _ext, void* _additionalParam) override;
+
+		/**
+		 * @brief Create a texture from a loaded file, only the sampler of @p _param is used
+		 * @param _source The KTX or DDS file of @p _texture, streamed textures read evicted mips from it again
+		 */
+		static std::shared_ptr<ResourceBase> GliToTexture(const gli::texture& _texture, const TextureParam* _param, const std::filesystem::path& _source = {});
+
 	private:
-		static std::shared_ptr<ResourceBase> GliToTexture(const gli::texture& _texture);
-		static std::shared_ptr<ResourceBase> ToTexture2D(const gli::texture& _texture);
-		static std::shared_ptr<ResourceBase> ToCubeMap(const gli::texture& _texture);
+		static std::shared_ptr<ResourceBase> ToTexture2D(const gli::texture& _texture, const SamplerInfo& _samplerInfo, const std::filesystem::path& _source);
+		static std::shared_ptr<ResourceBase> ToCubeMap(const gli::texture& _texture, const SamplerInfo& _samplerInfo);
+
+		/** @brief Pixels of one level, block compressed levels are decoded to RGBA8 when the device lacks support */
+		static std::vector<char> GetLevel(const gli::texture& _texture, uint32_t _face, uint32_t _layer, uint32_t _mip, TextureFormat _format);
 
 		static TextureFormat GliFormatToTextureFormat(const gli::format _format);
 
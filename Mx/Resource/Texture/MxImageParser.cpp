@@ -2,38 +2,152 @@
 #include "../../Log/MxLog.h"
 #include <stb_image/stb_image.h>
 #include "../../Graphics/Texture/MxTexture.h"
+#include "../../Graphics/Texture/MxTextureStreamer.h"
+#include "../../Graphics/MxGraphics.h"
+#include "GLI/MxGliParser.h"
+#include "MxTextureTranscoder.h"
+#include "../../Utils/MxMappedFile.h"
+#include "../MxResourceLoader.h"
+#include <cstring>
 
 namespace Mix {
-	std::shared_ptr<ResourceBase> ImageParser::load(const std::filesystem::path& _path, const ResourceType _type, void* _additionalParam) {
-		int width, height, channel;
-		stbi_set_flip_vertically_on_load(true);
-		auto data = stbi_load(_path.generic_string().c_str(), &width, &height, &channel, 4);
-		if (data) {
-			uint64_t size = width * height * 4;
-			std::shared_ptr<Texture2D> result;
-
-			if (_additionalParam) {
-				TextureParam* param = reinterpret_cast<TextureParam*>(_additionalParam);
-				result = std::make_shared<Texture2D>(width, height, TextureFormat::R8G8B8A8_Unorm, param->mipLevel, param->samplerInfo);
-			}
-			else
-				result = std::make_shared<Texture2D>(width, height, TextureFormat::R8G8B8A8_Unorm);
+	namespace {
+		/**
+		 * @brief Decode to 8 bit, 4 channel pixels with the first row at the bottom.
+		 * @note Rows are flipped here since stbi_set_flip_vertically_on_load() is global state shared by all threads
+		 */
+		std::vector<char> DecodePixels(ArrayProxy<const std::byte> _data, int& _width, int& _height) {
+			int channel;
+			auto data = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(_data.data()), static_cast<int>(_data.size()), &_width, &_height, &channel, 4);
+			if (!data)
+				return {};
 
-			result->setPixels(reinterpret_cast<const char*>(data), size);
-			result->apply(true);
+			const size_t rowSize = static_cast<size_t>(_width) * 4;
+			std::vector<char> result(rowSize * _height);
+			for (int y = 0; y < _height; ++y)
+				std::memcpy(result.data() + rowSize * y, data + rowSize * (_height - 1 - y), rowSize);
 
 			stbi_image_free(data);
 			return result;
 		}
-		else {
-			Log::Error("Failed to load image: %s", _path.generic_string().c_str());
-			return nullptr;
+
+		/** @brief Decode @p _path again when a streamed texture needs its finer mips back */
+		TextureStreamer::MipSource ImageMipSource(const std::filesystem::path& _path) {
+			return [_path](uint32_t _firstMip, uint32_t _lastMip) {
+				const auto data = ResourceLoader::Get()->readFile(_path);
+
+				int width, height;
+				auto pixels = DecodePixels(data, width, height);
+				if (pixels.empty())
+					return TextureStreamer::MipChain();
+
+				auto mips = TextureStreamer::GenerateMipChain(pixels.data(), width, height);
+				if (_lastMip > mips.size())
+					return TextureStreamer::MipChain();
+
+				return TextureStreamer::MipChain(std::make_move_iterator(mips.begin() + _firstMip),
+												 std::make_move_iterator(mips.begin() + _lastMip));
+			};
 		}
 	}
 
+	std::shared_ptr<ResourceBase> ImageParser::load(const std::filesystem::path& _path, const ResourceType _type, void* _additionalParam) {
+		return decode(_path, std::string(), _additionalParam)();
+	}
+
 	std::shared_ptr<ResourceBase> ImageParser::load(const std::filesystem::path& _path, const std::string& _ext, void* _additionalParam) {
 		// we don't use paramater _ext and don't care about type
 		return load(_path, ResourceType::Unknown, _additionalParam);
 	}
 
+	ResourceParserBase::Finalizer ImageParser::decode(const std::filesystem::path& _path, const std::string& _ext, void* _additionalParam) {
+		const MappedFile file(_path);
+		return decodeData(_path, file.view(), _ext, _additionalParam);
+	}
+
+	ResourceParserBase::Finalizer ImageParser::decodeData(const std::filesystem::path& _path, ArrayProxy<const std::byte> _data, const std::string& _ext, void* _additionalParam) {
+		const bool hasParam = _additionalParam != nullptr;
+		const auto param = hasParam ? *reinterpret_cast<TextureParam*>(_additionalParam) : TextureParam();
+
+		if (hasParam) {
+			std::filesystem::path cachePath;
+			auto compressed = decodeCompressed(_data, param, cachePath);
+			if (!compressed.empty()) {
+				return [compressed = std::move(compressed), param, cachePath] {
+					return GliParser::GliToTexture(compressed, &param, cachePath);
+				};
+			}
+		}
+
+		int width, height;
+		auto pixels = DecodePixels(_data, width, height);
+		if (pixels.empty()) {
+			Log::Error("Failed to load image: %s", _path.generic_string().c_str());
+			return [] { return nullptr; };
+		}
+
+		if (hasParam && param.mipLevel != 1) {
+			// mips are built on the cpu so the finer ones can be streamed in later
+			auto mips = TextureStreamer::GenerateMipChain(pixels.data(), width, height);
+			if (param.mipLevel != 0 && param.mipLevel < mips.size())
+				mips.resize(param.mipLevel);
+
+			return [mips = std::move(mips), width, height, param, path = _path]() mutable -> std::shared_ptr<ResourceBase> {
+				auto& streamer = Graphics::Get()->getTextureStreamer();
+				if (streamer.isEnabled())
+					return streamer.createTexture(width, height, TextureFormat::R8G8B8A8_Unorm, std::move(mips), ImageMipSource(path), param.samplerInfo);
+
+				auto result = std::make_shared<Texture2D>(width, height, TextureFormat::R8G8B8A8_Unorm, param.mipLevel, param.samplerInfo);
+				result->setPixels(mips.front().data(), mips.front().size());
+				result->apply(true);
+				return result;
+			};
+		}
+
+		return [pixels = std::move(pixels), width, height, param, hasParam]() -> std::shared_ptr<ResourceBase> {
+			std::shared_ptr<Texture2D> result;
+			if (hasParam)
+				result = std::make_shared<Texture2D>(width, height, TextureFormat::R8G8B8A8_Unorm, param.mipLevel, param.samplerInfo);
+			else
+				result = std::make_shared<Texture2D>(width, height, TextureFormat::R8G8B8A8_Unorm);
+
+			result->setPixels(pixels.data(), pixels.size());
+			result->apply(true);
+			return result;
+		};
+	}
+
+	gli::texture ImageParser::decodeCompressed(ArrayProxy<const std::byte> _data, const TextureParam& _param, std::filesystem::path& _cachePath) {
+		auto format = _param.compression;
+		if (format == TextureFormat::Unknown)
+			format = _param.content == TextureContent::Normal ? TextureFormat::BC5_Unorm : TextureFormat::BC7_Unorm;
+
+		// without device support the image is uploaded uncompressed
+		if (_data.empty() || !TextureTranscoder::IsBlockCompressed(format) || !Texture::IsFormatSupported(format))
+			return gli::texture();
+
+		// the key covers everything the encoded file depends on
+		const uint32_t settings[] = { TextureTranscoder::Version, static_cast<uint32_t>(format), _param.mipLevel };
+		const auto hash = TextureTranscoder::Hash(settings, sizeof(settings), TextureTranscoder::Hash(_data.data(), _data.size()));
+		const auto cachePath = TextureTranscoder::GetCachePath(hash);
+		_cachePath = cachePath;
+
+		if (!std::filesystem::is_regular_file(cachePath)) {
+			int width, height;
+			auto pixels = DecodePixels(_data, width, height);
+			if (pixels.empty())
+				return gli::texture();
+
+			auto mips = TextureStreamer::GenerateMipChain(pixels.data(), width, height);
+			if (_param.mipLevel != 0 && _param.mipLevel < mips.size())
+				mips.resize(_param.mipLevel);
+
+			if (!TextureTranscoder::WriteKtx(cachePath, width, height, format, mips)) {
+				Log::Warning("%1%: Failed to write [%2%], loading uncompressed", __FUNCTION__, cachePath.generic_string());
+				return gli::texture();
+			}
+		}
+
+		return gli::load_ktx(cachePath.generic_string());
+	}
 }
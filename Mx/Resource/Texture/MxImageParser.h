@@ -3,6 +3,7 @@
 #ifndef MX_IMGAE_PARSER_H_
 #define MX_IMAGE_PARSER_H_
 #include "MxTextureParserBase.hpp"
+#include "../../Graphics/Texture/MxTexture.h"
 
 namespace Mix {
 	class ImageParser :public TextureParserBase {
@@ -18,6 +19,19 @@ namespace Mix {
 		std::shared_ptr<ResourceBase> load(const std::filesystem::path& _path, const ResourceType _type, void* _additionalParam) override;
 
 		std::shared_ptr<ResourceBase> load(const std::filesystem::path& _path, const std::string& _ext, void* _additionalParam) override;
+
+		Finalizer decode(const std::filesystem::path& _path, const std::string& _ext, void* _additionalParam) override;
+
+		Finalizer decodeData(const std::filesystem::path& _path, ArrayProxy<const std::byte> _data, const std::string& _ext, void* _additionalParam) override;
+
+	private:
+		/**
+		 * @brief Load the image transcoded to the block compressed format selected by @p _param,
+		 *        the KTX file is built on the first load and cached by the content hash of the image.
+		 * @param _cachePath Receives the path of the KTX file
+		 * @return An empty texture when the image has to be loaded uncompressed
+		 */
+		static gli::texture decodeCompressed(ArrayProxy<const std::byte> _data, const TextureParam& _param, std::filesystem::path& _cachePath);
 	};
 }
 
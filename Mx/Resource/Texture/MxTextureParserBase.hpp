@@ -3,9 +3,35 @@
 #define MX_TEXTURE_PARSER_BASE_H_
 
 #include "../MxResourceParserBase.hpp"
+#include "../../Graphics/Texture/MxTexture.h"
 
 namespace Mix {
 	class TextureParserBase :public ResourceParserBase {
+	public:
+		uint64_t hashParam(const void* _additionalParam) const override {
+			if (!_additionalParam)
+				return 0;
+
+			auto& param = *static_cast<const TextureParam*>(_additionalParam);
+			const uint32_t fields[] = {
+				param.mipLevel,
+				static_cast<uint32_t>(param.samplerInfo.minFilter),
+				static_cast<uint32_t>(param.samplerInfo.magFilter),
+				static_cast<uint32_t>(param.samplerInfo.mipFilter),
+				static_cast<uint32_t>(param.samplerInfo.wrapModeU),
+				static_cast<uint32_t>(param.samplerInfo.wrapModeV),
+				static_cast<uint32_t>(param.samplerInfo.wrapModeW),
+				static_cast<uint32_t>(param.content),
+				static_cast<uint32_t>(param.compression)
+			};
+
+			// 0 is kept for loads without a param
+			uint64_t result = 14695981039346656037ull;
+			for (auto field : fields)
+				result = (result ^ field) * 1099511628211ull;
+			return result;
+		}
+
 	protected:
 		TextureParserBase() = default;
 	};
@@ -0,0 +1,538 @@
+#include "MxTextureTranscoder.h"
+#include "../../Log/MxLog.h"
+#include <gli/gli.hpp>
+#include <array>
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <thread>
+
+namespace Mix {
+	std::filesystem::path TextureTranscoder::CacheDirectory = "Cache/Textures";
+
+	namespace {
+		// 4x4 texels, blocks on the border repeat the last row and column
+		using Block = std::array<std::array<uint8_t, 4>, 16>;
+
+		const int BC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		class BitWriter {
+		public:
+			explicit BitWriter(uint8_t* _data) :mData(_data) {}
+
+			void write(uint32_t _value, uint32_t _bits) {
+				for (uint32_t bit = 0; bit < _bits; ++bit, ++mPos) {
+					if ((_value >> bit) & 1)
+						mData[mPos >> 3] |= static_cast<uint8_t>(1 << (mPos & 7));
+				}
+			}
+
+		private:
+			uint8_t* mData;
+			uint32_t mPos = 0;
+		};
+
+		class BitReader {
+		public:
+			explicit BitReader(const uint8_t* _data) :mData(_data) {}
+
+			uint32_t read(uint32_t _bits) {
+				uint32_t value = 0;
+				for (uint32_t bit = 0; bit < _bits; ++bit, ++mPos)
+					value |= ((mData[mPos >> 3] >> (mPos & 7)) & 1u) << bit;
+				return value;
+			}
+
+		private:
+			const uint8_t* mData;
+			uint32_t mPos = 0;
+		};
+
+		Block FetchBlock(const uint8_t* _pixels, uint32_t _width, uint32_t _height, uint32_t _bx, uint32_t _by) {
+			Block block;
+			for (uint32_t y = 0; y < 4; ++y) {
+				const uint32_t py = std::min(_by * 4 + y, _height - 1);
+				for (uint32_t x = 0; x < 4; ++x) {
+					const uint32_t px = std::min(_bx * 4 + x, _width - 1);
+					std::memcpy(block[y * 4 + x].data(), _pixels + (static_cast<size_t>(py) * _width + px) * 4, 4);
+				}
+			}
+			return block;
+		}
+
+		void StoreBlock(const Block& _block, uint8_t* _pixels, uint32_t _width, uint32_t _height, uint32_t _bx, uint32_t _by) {
+			for (uint32_t y = 0; y < 4 && _by * 4 + y < _height; ++y) {
+				for (uint32_t x = 0; x < 4 && _bx * 4 + x < _width; ++x)
+					std::memcpy(_pixels + (static_cast<size_t>(_by * 4 + y) * _width + _bx * 4 + x) * 4, _block[y * 4 + x].data(), 4);
+			}
+		}
+
+		/** @brief Extremes of the block along its principal axis in the first @p _channels channels */
+		void FindEndpoints(const Block& _block, uint32_t _channels, float _min[4], float _max[4]) {
+			float mean[4] = {};
+			for (auto& texel : _block) {
+				for (uint32_t c = 0; c < _channels; ++c)
+					mean[c] += texel[c];
+			}
+			for (uint32_t c = 0; c < _channels; ++c)
+				mean[c] /= 16.0f;
+
+			float covariance[4][4] = {};
+			for (auto& texel : _block) {
+				for (uint32_t i = 0; i < _channels; ++i) {
+					for (uint32_t j = 0; j < _channels; ++j)
+						covariance[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+				}
+			}
+
+			// power iteration
+			float axis[4] = {};
+			for (uint32_t c = 0; c < _channels; ++c)
+				axis[c] = 1.0f;
+
+			for (uint32_t iteration = 0; iteration < 8; ++iteration) {
+				float next[4] = {};
+				float length = 0.0f;
+				for (uint32_t i = 0; i < _channels; ++i) {
+					for (uint32_t j = 0; j < _channels; ++j)
+						next[i] += covariance[i][j] * axis[j];
+					length = std::max(length, std::abs(next[i]));
+				}
+
+				// uniform block
+				if (length < 1e-6f)
+					break;
+
+				for (uint32_t c = 0; c < _channels; ++c)
+					axis[c] = next[c] / length;
+			}
+
+			float length = 0.0f;
+			for (uint32_t c = 0; c < _channels; ++c)
+				length += axis[c] * axis[c];
+			length = std::sqrt(length);
+			for (uint32_t c = 0; c < _channels; ++c)
+				axis[c] /= length;
+
+			float low = FLT_MAX, high = -FLT_MAX;
+			for (auto& texel : _block) {
+				float distance = 0.0f;
+				for (uint32_t c = 0; c < _channels; ++c)
+					distance += (texel[c] - mean[c]) * axis[c];
+				low = std::min(low, distance);
+				high = std::max(high, distance);
+			}
+
+			for (uint32_t c = 0; c < _channels; ++c) {
+				_min[c] = std::clamp(mean[c] + axis[c] * low, 0.0f, 255.0f);
+				_max[c] = std::clamp(mean[c] + axis[c] * high, 0.0f, 255.0f);
+			}
+		}
+
+		template<size_t _Size>
+		uint32_t FindNearest(const std::array<uint8_t, 4>& _texel, const int (&_palette)[_Size][4], uint32_t _channels) {
+			uint32_t best = 0;
+			int bestError = INT_MAX;
+			for (uint32_t i = 0; i < _Size; ++i) {
+				int error = 0;
+				for (uint32_t c = 0; c < _channels; ++c)
+					error += (_texel[c] - _palette[i][c]) * (_texel[c] - _palette[i][c]);
+				if (error < bestError) {
+					bestError = error;
+					best = i;
+				}
+			}
+			return best;
+		}
+
+		// ---------- BC1 ----------
+
+		uint16_t To565(const float _color[4]) {
+			const auto r = static_cast<uint16_t>(std::lround(_color[0] * 31.0f / 255.0f));
+			const auto g = static_cast<uint16_t>(std::lround(_color[1] * 63.0f / 255.0f));
+			const auto b = static_cast<uint16_t>(std::lround(_color[2] * 31.0f / 255.0f));
+			return static_cast<uint16_t>(r << 11 | g << 5 | b);
+		}
+
+		void From565(uint16_t _color, int _result[4]) {
+			const int r = (_color >> 11) & 31, g = (_color >> 5) & 63, b = _color & 31;
+			_result[0] = r << 3 | r >> 2;
+			_result[1] = g << 2 | g >> 4;
+			_result[2] = b << 3 | b >> 2;
+			_result[3] = 255;
+		}
+
+		void EncodeBC1(const Block& _block, uint8_t* _out) {
+			float low[4], high[4];
+			FindEndpoints(_block, 3, low, high);
+
+			uint16_t color0 = To565(high), color1 = To565(low);
+			if (color0 < color1)
+				std::swap(color0, color1);
+
+			// equal endpoints select the three color mode, index 0 is still color0
+			uint32_t indices = 0;
+			if (color0 != color1) {
+				int palette[4][4];
+				From565(color0, palette[0]);
+				From565(color1, palette[1]);
+				for (uint32_t c = 0; c < 3; ++c) {
+					palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+					palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+				}
+
+				for (uint32_t i = 0; i < 16; ++i)
+					indices |= FindNearest(_block[i], palette, 3) << (i * 2);
+			}
+
+			std::memcpy(_out, &color0, 2);
+			std::memcpy(_out + 2, &color1, 2);
+			std::memcpy(_out + 4, &indices, 4);
+		}
+
+		void DecodeBC1(const uint8_t* _in, Block& _block, bool _alwaysFourColors) {
+			uint16_t color0, color1;
+			uint32_t indices;
+			std::memcpy(&color0, _in, 2);
+			std::memcpy(&color1, _in + 2, 2);
+			std::memcpy(&indices, _in + 4, 4);
+
+			int palette[4][4];
+			From565(color0, palette[0]);
+			From565(color1, palette[1]);
+			for (uint32_t c = 0; c < 3; ++c) {
+				if (color0 > color1 || _alwaysFourColors) {
+					palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+					palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+				}
+				else {
+					palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+					palette[3][c] = 0;
+				}
+			}
+			palette[2][3] = 255;
+			palette[3][3] = color0 > color1 || _alwaysFourColors ? 255 : 0;
+
+			for (uint32_t i = 0; i < 16; ++i) {
+				const auto index = (indices >> (i * 2)) & 3;
+				for (uint32_t c = 0; c < 4; ++c)
+					_block[i][c] = static_cast<uint8_t>(palette[index][c]);
+			}
+		}
+
+		// ---------- BC4, one channel of BC3 and BC5 ----------
+
+		void EncodeBC4(const Block& _block, uint32_t _channel, uint8_t* _out) {
+			uint8_t low = 255, high = 0;
+			for (auto& texel : _block) {
+				low = std::min(low, texel[_channel]);
+				high = std::max(high, texel[_channel]);
+			}
+
+			_out[0] = high;
+			_out[1] = low;
+
+			uint64_t indices = 0;
+			if (high != low) {
+				int palette[8][4] = {};
+				palette[0][0] = high;
+				palette[1][0] = low;
+				for (int i = 1; i < 7; ++i)
+					palette[i + 1][0] = ((7 - i) * high + i * low + 3) / 7;
+
+				for (uint32_t i = 0; i < 16; ++i) {
+					const std::array<uint8_t, 4> value = { _block[i][_channel] };
+					indices |= static_cast<uint64_t>(FindNearest(value, palette, 1)) << (i * 3);
+				}
+			}
+
+			for (uint32_t byte = 0; byte < 6; ++byte)
+				_out[2 + byte] = static_cast<uint8_t>(indices >> (byte * 8));
+		}
+
+		void DecodeBC4(const uint8_t* _in, Block& _block, uint32_t _channel) {
+			const int value0 = _in[0], value1 = _in[1];
+
+			int palette[8] = { value0, value1 };
+			if (value0 > value1) {
+				for (int i = 1; i < 7; ++i)
+					palette[i + 1] = ((7 - i) * value0 + i * value1 + 3) / 7;
+			}
+			else {
+				for (int i = 1; i < 5; ++i)
+					palette[i + 1] = ((5 - i) * value0 + i * value1 + 2) / 5;
+				palette[6] = 0;
+				palette[7] = 255;
+			}
+
+			uint64_t indices = 0;
+			for (uint32_t byte = 0; byte < 6; ++byte)
+				indices |= static_cast<uint64_t>(_in[2 + byte]) << (byte * 8);
+
+			for (uint32_t i = 0; i < 16; ++i)
+				_block[i][_channel] = static_cast<uint8_t>(palette[(indices >> (i * 3)) & 7]);
+		}
+
+		// ---------- BC7 ----------
+
+		/** @brief Quantize an endpoint to 7 bits per channel and the p-bit with the lower error */
+		void QuantizeBC7(const float _color[4], uint8_t _quantized[4], uint8_t& _pBit) {
+			float bestError = FLT_MAX;
+			for (uint8_t pBit = 0; pBit < 2; ++pBit) {
+				uint8_t quantized[4];
+				float error = 0.0f;
+				for (uint32_t c = 0; c < 4; ++c) {
+					quantized[c] = static_cast<uint8_t>(std::clamp(std::lround((_color[c] - pBit) / 2.0f), 0l, 127l));
+					const float value = static_cast<float>(quantized[c] << 1 | pBit);
+					error += (value - _color[c]) * (value - _color[c]);
+				}
+
+				if (error < bestError) {
+					bestError = error;
+					_pBit = pBit;
+					std::memcpy(_quantized, quantized, 4);
+				}
+			}
+		}
+
+		void EncodeBC7(const Block& _block, uint8_t* _out) {
+			float low[4], high[4];
+			FindEndpoints(_block, 4, low, high);
+
+			uint8_t quantized[2][4], pBits[2];
+			QuantizeBC7(low, quantized[0], pBits[0]);
+			QuantizeBC7(high, quantized[1], pBits[1]);
+
+			int palette[16][4];
+			for (uint32_t i = 0; i < 16; ++i) {
+				for (uint32_t c = 0; c < 4; ++c) {
+					const int endpoint0 = quantized[0][c] << 1 | pBits[0];
+					const int endpoint1 = quantized[1][c] << 1 | pBits[1];
+					palette[i][c] = ((64 - BC7Weights4[i]) * endpoint0 + BC7Weights4[i] * endpoint1 + 32) >> 6;
+				}
+			}
+
+			uint32_t indices[16];
+			for (uint32_t i = 0; i < 16; ++i)
+				indices[i] = FindNearest(_block[i], palette, 4);
+
+			// the most significant bit of the first index is implicitly zero
+			if (indices[0] & 8) {
+				std::swap(quantized[0], quantized[1]);
+				std::swap(pBits[0], pBits[1]);
+				for (auto& index : indices)
+					index = 15 - index;
+			}
+
+			std::memset(_out, 0, 16);
+			BitWriter writer(_out);
+			writer.write(1 << 6, 7);
+			for (uint32_t c = 0; c < 4; ++c) {
+				writer.write(quantized[0][c], 7);
+				writer.write(quantized[1][c], 7);
+			}
+			writer.write(pBits[0], 1);
+			writer.write(pBits[1], 1);
+			writer.write(indices[0], 3);
+			for (uint32_t i = 1; i < 16; ++i)
+				writer.write(indices[i], 4);
+		}
+
+		bool DecodeBC7(const uint8_t* _in, Block& _block) {
+			BitReader reader(_in);
+			if (reader.read(7) != 1 << 6) {
+				for (auto& texel : _block)
+					texel = { 255, 0, 255, 255 };
+				return false;
+			}
+
+			uint32_t endpoints[2][4];
+			for (uint32_t c = 0; c < 4; ++c) {
+				endpoints[0][c] = reader.read(7) << 1;
+				endpoints[1][c] = reader.read(7) << 1;
+			}
+			const auto pBit0 = reader.read(1), pBit1 = reader.read(1);
+			for (uint32_t c = 0; c < 4; ++c) {
+				endpoints[0][c] |= pBit0;
+				endpoints[1][c] |= pBit1;
+			}
+
+			for (uint32_t i = 0; i < 16; ++i) {
+				const auto weight = BC7Weights4[reader.read(i == 0 ? 3 : 4)];
+				for (uint32_t c = 0; c < 4; ++c)
+					_block[i][c] = static_cast<uint8_t>(((64 - weight) * endpoints[0][c] + weight * endpoints[1][c] + 32) >> 6);
+			}
+			return true;
+		}
+
+		gli::format ToGliFormat(TextureFormat _format) {
+			switch (_format) {
+			case TextureFormat::BC1_RGBA_Unorm: return gli::FORMAT_RGBA_DXT1_UNORM_BLOCK8;
+			case TextureFormat::BC3_Unorm: return gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16;
+			case TextureFormat::BC5_Unorm: return gli::FORMAT_RG_ATI2N_UNORM_BLOCK16;
+			case TextureFormat::BC7_Unorm: return gli::FORMAT_RGBA_BP_UNORM_BLOCK16;
+			case TextureFormat::R8G8B8A8_Unorm: return gli::FORMAT_RGBA8_UNORM_PACK8;
+			case TextureFormat::B8G8R8A8_Unorm: return gli::FORMAT_BGRA8_UNORM_PACK8;
+			default: return gli::FORMAT_UNDEFINED;
+			}
+		}
+	}
+
+	bool TextureTranscoder::IsBlockCompressed(TextureFormat _format) {
+		switch (_format) {
+		case TextureFormat::BC1_RGBA_Unorm:
+		case TextureFormat::BC3_Unorm:
+		case TextureFormat::BC5_Unorm:
+		case TextureFormat::BC7_Unorm:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	uint64_t TextureTranscoder::GetLevelSize(TextureFormat _format, uint32_t _width, uint32_t _height) {
+		if (!IsBlockCompressed(_format))
+			return static_cast<uint64_t>(_width) * _height * 4;
+
+		const uint64_t blocks = static_cast<uint64_t>((_width + 3) / 4) * ((_height + 3) / 4);
+		return blocks * (_format == TextureFormat::BC1_RGBA_Unorm ? 8 : 16);
+	}
+
+	std::vector<char> TextureTranscoder::Encode(const char* _pixels, uint32_t _width, uint32_t _height, TextureFormat _format) {
+		std::vector<char> result(GetLevelSize(_format, _width, _height));
+		if (!IsBlockCompressed(_format)) {
+			std::memcpy(result.data(), _pixels, result.size());
+			return result;
+		}
+
+		const auto pixels = reinterpret_cast<const uint8_t*>(_pixels);
+		const uint32_t blockSize = _format == TextureFormat::BC1_RGBA_Unorm ? 8 : 16;
+		auto out = reinterpret_cast<uint8_t*>(result.data());
+
+		for (uint32_t by = 0; by < (_height + 3) / 4; ++by) {
+			for (uint32_t bx = 0; bx < (_width + 3) / 4; ++bx, out += blockSize) {
+				const auto block = FetchBlock(pixels, _width, _height, bx, by);
+
+				switch (_format) {
+				case TextureFormat::BC1_RGBA_Unorm:
+					EncodeBC1(block, out);
+					break;
+				case TextureFormat::BC3_Unorm:
+					EncodeBC4(block, 3, out);
+					EncodeBC1(block, out + 8);
+					break;
+				case TextureFormat::BC5_Unorm:
+					EncodeBC4(block, 0, out);
+					EncodeBC4(block, 1, out + 8);
+					break;
+				case TextureFormat::BC7_Unorm:
+					EncodeBC7(block, out);
+					break;
+				default:
+					break;
+				}
+			}
+		}
+
+		return result;
+	}
+
+	std::vector<char> TextureTranscoder::Decode(const char* _blocks, uint32_t _width, uint32_t _height, TextureFormat _format) {
+		std::vector<char> result(static_cast<size_t>(_width) * _height * 4);
+		if (!IsBlockCompressed(_format)) {
+			std::memcpy(result.data(), _blocks, result.size());
+			return result;
+		}
+
+		auto pixels = reinterpret_cast<uint8_t*>(result.data());
+		const uint32_t blockSize = _format == TextureFormat::BC1_RGBA_Unorm ? 8 : 16;
+		auto in = reinterpret_cast<const uint8_t*>(_blocks);
+		bool unsupported = false;
+
+		for (uint32_t by = 0; by < (_height + 3) / 4; ++by) {
+			for (uint32_t bx = 0; bx < (_width + 3) / 4; ++bx, in += blockSize) {
+				Block block;
+
+				switch (_format) {
+				case TextureFormat::BC1_RGBA_Unorm:
+					DecodeBC1(in, block, false);
+					break;
+				case TextureFormat::BC3_Unorm:
+					DecodeBC1(in + 8, block, true);
+					DecodeBC4(in, block, 3);
+					break;
+				case TextureFormat::BC5_Unorm:
+					DecodeBC4(in, block, 0);
+					DecodeBC4(in + 8, block, 1);
+					for (auto& texel : block) {
+						const float x = texel[0] / 127.5f - 1.0f;
+						const float y = texel[1] / 127.5f - 1.0f;
+						const float z = std::sqrt(std::max(1.0f - x * x - y * y, 0.0f));
+						texel[2] = static_cast<uint8_t>(std::lround((z + 1.0f) * 127.5f));
+						texel[3] = 255;
+					}
+					break;
+				case TextureFormat::BC7_Unorm:
+					unsupported |= !DecodeBC7(in, block);
+					break;
+				default:
+					break;
+				}
+
+				StoreBlock(block, pixels, _width, _height, bx, by);
+			}
+		}
+
+		if (unsupported)
+			Log::Warning("%1%: Only mode 6 BC7 blocks can be decoded", __FUNCTION__);
+
+		return result;
+	}
+
+	bool TextureTranscoder::WriteKtx(const std::filesystem::path& _path,
+									 uint32_t _width,
+									 uint32_t _height,
+									 TextureFormat _format,
+									 const TextureStreamer::MipChain& _mips) {
+		gli::texture2d texture(ToGliFormat(_format), gli::extent2d(_width, _height), _mips.size());
+
+		for (uint32_t mip = 0; mip < _mips.size(); ++mip) {
+			const auto extent = Texture::GetMipmapExtent(_width, _height, mip);
+			const auto blocks = Encode(_mips[mip].data(), extent.x, extent.y, _format);
+			if (blocks.size() != texture.size(mip))
+				return false;
+
+			std::memcpy(texture.data(0, 0, mip), blocks.data(), blocks.size());
+		}
+
+		std::error_code error;
+		std::filesystem::create_directories(_path.parent_path(), error);
+
+		// written under a temporary name so an interrupted or concurrent write is never picked up
+		auto temporary = _path;
+		temporary += "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+		if (!gli::save_ktx(texture, temporary.generic_string()))
+			return false;
+
+		std::filesystem::rename(temporary, _path, error);
+		return !error;
+	}
+
+	uint64_t TextureTranscoder::Hash(const void* _data, size_t _size, uint64_t _seed) {
+		auto bytes = static_cast<const uint8_t*>(_data);
+		for (size_t i = 0; i < _size; ++i) {
+			_seed ^= bytes[i];
+			_seed *= 1099511628211ull;
+		}
+		return _seed;
+	}
+
+	std::filesystem::path TextureTranscoder::GetCachePath(uint64_t _hash) {
+		char name[17];
+		std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(_hash));
+		return CacheDirectory / (std::string(name) + ".ktx");
+	}
+}
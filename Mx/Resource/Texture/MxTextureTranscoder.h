@@ -0,0 +1,61 @@
+#pragma once
+#ifndef MX_TEXTURE_TRANSCODER_H_
+#define MX_TEXTURE_TRANSCODER_H_
+
+#include "../../Graphics/Texture/MxTextureStreamer.h"
+#include <filesystem>
+
+namespace Mix {
+	/**
+	 * @brief CPU encoders and decoders of the BC formats.
+	 *
+	 * Source images are transcoded once into mipmapped KTX files stored in the cache directory under
+	 * a hash of their content, later loads read the KTX file directly.
+	 */
+	class TextureTranscoder {
+	public:
+		/** @brief Changing the encoders requires a new version so cached files are rebuilt */
+		static constexpr uint32_t Version = 1;
+
+		static bool IsBlockCompressed(TextureFormat _format);
+
+		/** @brief Bytes of a mip level of @p _format */
+		static uint64_t GetLevelSize(TextureFormat _format, uint32_t _width, uint32_t _height);
+
+		/**
+		 * @brief Encode 8 bit, 4 channel pixels.
+		 *        BC1 drops alpha, BC5 keeps R and G, BC7 uses a single subset with 7 bit endpoints (mode 6).
+		 */
+		static std::vector<char> Encode(const char* _pixels, uint32_t _width, uint32_t _height, TextureFormat _format);
+
+		/**
+		 * @brief Decode blocks into 8 bit, 4 channel pixels, used when the device can't sample the format.
+		 *        B of BC5 is reconstructed as the z of a unit normal. Only mode 6 BC7 blocks are supported.
+		 */
+		static std::vector<char> Decode(const char* _blocks, uint32_t _width, uint32_t _height, TextureFormat _format);
+
+		/**
+		 * @brief Encode every level of @p _mips and write them as a KTX file.
+		 * @return Whether the file was written
+		 */
+		static bool WriteKtx(const std::filesystem::path& _path,
+							 uint32_t _width,
+							 uint32_t _height,
+							 TextureFormat _format,
+							 const TextureStreamer::MipChain& _mips);
+
+		/** @brief 64 bit FNV-1a, stable across runs and platforms unlike std::hash */
+		static uint64_t Hash(const void* _data, size_t _size, uint64_t _seed = 14695981039346656037ull);
+
+		static std::filesystem::path GetCachePath(uint64_t _hash);
+
+		static void SetCacheDirectory(const std::filesystem::path& _directory) { CacheDirectory = _directory; }
+
+		static const std::filesystem::path& GetCacheDirectory() { return CacheDirectory; }
+
+	private:
+		static std::filesystem::path CacheDirectory;
+	};
+}
+
+#endif
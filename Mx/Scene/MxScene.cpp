@@ -3,6 +3,7 @@
 #include "../Log/MxLog.h"
 #include "../Component/Renderer/MxRenderer.h"
 #include "../Component/Camera/MxCamera.h"
+#include "../Component/Light/MxLight.h"
 #include "../Window/MxWindow.h"
 
 namespace Mix {
@@ -231,6 +232,7 @@ namespace Mix {
 
         // Set camera
         info.camera = mMainCamera.get().get();
+        info.depthPrePass = mDepthPrePass;
 
         // Get all enabled Renderer
         for (auto& gameObject : mRootObjects) {
@@ -245,6 +247,10 @@ namespace Mix {
         if (renderer != nullptr && renderer->getGameObject()->activeInHierarchy())
             _info.renderers.push_back(renderer.get().get());
 
+        auto light = _object->getComponent<Light>();
+        if (light != nullptr && light->getGameObject()->activeInHierarchy())
+            _info.lights.push_back(light.get().get());
+
         for (auto& child : _object->getAllChildren()) {
             FindRendererRecur(_info, child);
         }
@@ -54,6 +54,14 @@ namespace Mix {
         /** \brief Check if the scene has been loaded. */
         bool isLoaded() const { return mIsLoaded; }
 
+        /**
+         *\brief Set whether opaque geometry of the scene is drawn to depth first and then shaded with an EQUAL depth test.
+         *\note  The pre-pass pays off with expensive shading and high overdraw, Auto measures the overdraw to decide.
+         */
+        void setDepthPrePass(const DepthPrePassMode _mode) { mDepthPrePass = _mode; }
+
+        DepthPrePassMode getDepthPrePass() const { return mDepthPrePass; }
+
         /** \brief Get all root GameObjects in the scene. */
         std::vector<HGameObject> getRootGameObjects() const;
 
@@ -140,6 +148,8 @@ namespace Mix {
         std::vector<HCamera> mRegisteredCamera;
         HCamera mMainCamera;
 
+        DepthPrePassMode mDepthPrePass = DepthPrePassMode::Off;
+
         uint32_t mIndex = 0;
         bool mIsActive = false;
 
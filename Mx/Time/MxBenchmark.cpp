@@ -0,0 +1,94 @@
+#include "MxBenchmark.h"
+#include "../Log/MxLog.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+
+namespace Mix {
+    bool Benchmark::sActive = false;
+    uint32_t Benchmark::sWarmupFrames = 0;
+    std::array<Benchmark::Duration, Benchmark::PhaseCount> Benchmark::sCurrent = {};
+    std::array<std::vector<float>, Benchmark::PhaseCount> Benchmark::sSamples;
+
+    void Benchmark::Start(const uint32_t _warmupFrames) {
+        sActive = true;
+        sWarmupFrames = _warmupFrames;
+        sCurrent.fill(Duration::zero());
+        for (auto& samples : sSamples)
+            samples.clear();
+    }
+
+    void Benchmark::NextFrame() {
+        if (!sActive)
+            return;
+
+        if (sWarmupFrames > 0)
+            --sWarmupFrames;
+        else {
+            for (size_t i = 0; i < PhaseCount; ++i)
+                sSamples[i].push_back(std::chrono::duration<float, std::milli>(sCurrent[i]).count());
+        }
+        sCurrent.fill(Duration::zero());
+    }
+
+    bool Benchmark::Write(const std::filesystem::path& _path, const BenchmarkInfo& _info) {
+        nlohmann::json result;
+        result["scene"] = _info.scene;
+        result["frames"] = FrameCount();
+        result["warmupFrames"] = _info.warmupFrames;
+        result["seed"] = _info.seed;
+        result["frameStep"] = _info.frameStep;
+        result["headless"] = _info.headless;
+        result["unit"] = "ms";
+
+        auto& phases = result["phases"];
+        for (size_t i = 0; i < PhaseCount; ++i) {
+            auto samples = sSamples[i];
+            auto& phase = phases[PhaseName(static_cast<FramePhase>(i))];
+            if (samples.empty()) {
+                phase = nullptr;
+                continue;
+            }
+
+            std::sort(samples.begin(), samples.end());
+            const auto percentile = [&samples](const double _p) {
+                const auto rank = static_cast<size_t>(std::ceil(_p / 100.0 * samples.size()));
+                return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+            };
+
+            phase["mean"] = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+            phase["min"] = samples.front();
+            phase["p50"] = percentile(50.0);
+            phase["p95"] = percentile(95.0);
+            phase["p99"] = percentile(99.0);
+            phase["max"] = samples.back();
+        }
+
+        std::ofstream out(_path, std::ios::trunc);
+        if (!out) {
+            Log::Error("%1%: Failed to open %2%", __FUNCTION__, _path.string());
+            return false;
+        }
+        out << result.dump(4) << std::endl;
+        return true;
+    }
+
+    const char* Benchmark::PhaseName(const FramePhase _phase) {
+        switch (_phase) {
+        case FramePhase::Update: return "update";
+        case FramePhase::FixedUpdate: return "fixedUpdate";
+        case FramePhase::Physics: return "physics";
+        case FramePhase::LateUpdate: return "lateUpdate";
+        case FramePhase::RenderGather: return "renderGather";
+        case FramePhase::RenderSort: return "renderSort";
+        case FramePhase::RenderBegin: return "renderBegin";
+        case FramePhase::RenderRecord: return "renderRecord";
+        case FramePhase::RenderSubmit: return "renderSubmit";
+        case FramePhase::PostRender: return "postRender";
+        case FramePhase::Frame: return "frame";
+        default: return "unknown";
+        }
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#ifndef MX_BENCHMARK_H_
+#define MX_BENCHMARK_H_
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace Mix {
+    /** @brief Parts of a frame whose cpu time is recorded separately */
+    enum class FramePhase {
+        Update,
+        FixedUpdate,
+        Physics,
+        LateUpdate,
+        /** @brief GUI and collecting the render elements, culling, lights and texture streaming */
+        RenderGather,
+        RenderSort,
+        /** @brief Waiting for the gpu to release the frame, acquiring its image and recording the uploads */
+        RenderBegin,
+        RenderRecord,
+        RenderSubmit,
+        PostRender,
+        /** @brief Whole frame, includes everything above */
+        Frame,
+        Count
+    };
+
+    /** @brief Settings of a benchmark run, written to the result alongside the statistics */
+    struct BenchmarkInfo {
+        std::string scene;
+        uint32_t frames = 0;
+        uint32_t warmupFrames = 0;
+        uint32_t seed = 0;
+        float frameStep = 0.0f;
+        bool headless = false;
+    };
+
+    /**
+     * @brief Records the cpu time of each FramePhase per frame and writes their percentiles to json.
+     *
+     * Only Start() makes the recording active, otherwise a Scope costs a single branch. Phases entered
+     * several times in a frame, e.g. physics of each fixed step, add up to one sample of that frame.
+     */
+    class Benchmark final {
+        using Clock = std::chrono::steady_clock;
+        using Duration = Clock::duration;
+        using TimePoint = std::chrono::time_point<Clock>;
+
+    public:
+        Benchmark() = delete;
+
+        Benchmark(const Benchmark&) = delete;
+
+        /** @brief Adds the time until it is destroyed to @p _phase of the current frame */
+        class Scope {
+        public:
+            explicit Scope(const FramePhase _phase) : mPhase(_phase), mActive(sActive) {
+                if (mActive)
+                    mStart = Clock::now();
+            }
+
+            Scope(const Scope&) = delete;
+
+            Scope& operator=(const Scope&) = delete;
+
+            ~Scope() {
+                if (mActive)
+                    sCurrent[static_cast<size_t>(mPhase)] += Clock::now() - mStart;
+            }
+
+        private:
+            FramePhase mPhase;
+            bool mActive;
+            TimePoint mStart;
+        };
+
+        /** @brief Begin recording, the first @p _warmupFrames frames are dropped, e.g. while pipelines are created */
+        static void Start(uint32_t _warmupFrames);
+
+        static bool IsActive() noexcept { return sActive; }
+
+        /** @brief Close the sample of the current frame */
+        static void NextFrame();
+
+        /** @brief Frames recorded after the warm up */
+        static size_t FrameCount() noexcept { return sSamples[0].size(); }
+
+        /**
+         * @brief Write mean, minimum, p50, p95, p99 and maximum of every phase in milliseconds to @p _path.
+         *        Percentiles use the nearest rank, so they are times of actual frames.
+         */
+        static bool Write(const std::filesystem::path& _path, const BenchmarkInfo& _info);
+
+        static const char* PhaseName(FramePhase _phase);
+
+    private:
+        static constexpr size_t PhaseCount = static_cast<size_t>(FramePhase::Count);
+
+        static bool sActive;
+        static uint32_t sWarmupFrames;
+        static std::array<Duration, PhaseCount> sCurrent;
+        // milliseconds per frame, one list per phase
+        static std::array<std::vector<float>, PhaseCount> sSamples;
+    };
+}
+
+#endif
@@ -8,7 +8,8 @@ namespace Mix {
         Time::sFixedDeltaTime = 1.0f / 60,
         Time::sFixedTime = 0.0f,
         Time::sMaximumDeltaTime = 1.0f / 3,
-        Time::sSmoothingFactor = 0.0f;
+        Time::sSmoothingFactor = 0.0f,
+        Time::sCaptureDeltaTime = 0.0f;
 
     unsigned Time::sFixedClampedSteps = 0;
 
@@ -21,7 +22,7 @@ namespace Mix {
     }
 
     void Time::Awake() noexcept {
-        sDeltaTime = sTime = sFixedTime = sSmoothingFactor = 0.0f;
+        sDeltaTime = sTime = sFixedTime = sSmoothingFactor = sCaptureDeltaTime = 0.0f;
         sFixedDeltaTime = 1.0f / 60;
         sMaximumDeltaTime = 1.0f / 3;
         sFixedClampedSteps = 0;
@@ -30,8 +31,14 @@ namespace Mix {
 
     void Time::Tick() noexcept {
         sCurr = Clock::now();
-        sDeltaTime = DurationToSecond(sCurr - sPrev);
-        sTime = DurationToSecond(sCurr - sStart);
+        if (sCaptureDeltaTime > 0.0f) {
+            sDeltaTime = sCaptureDeltaTime;
+            sTime += sCaptureDeltaTime;
+        }
+        else {
+            sDeltaTime = DurationToSecond(sCurr - sPrev);
+            sTime = DurationToSecond(sCurr - sStart);
+        }
 
         const int steps = static_cast<int>(std::floor((sTime - sFixedTime) / sFixedDeltaTime));
         const int maxSteps = static_cast<int>(std::floor((sMaximumDeltaTime - sDeltaTime) / sFixedDeltaTime));
@@ -38,6 +38,13 @@ namespace Mix {
 
         static auto FixedClampedSteps() noexcept { return sFixedClampedSteps; }
 
+        /**
+         *  @brief When larger than 0, every frame advances the time by this step regardless of the real time passed,
+         *  so runs are reproducible. RealTime() is not affected.
+         *  @note Equivalent to Time.captureDeltaTime of Unity.
+         */
+        static auto& CaptureDeltaTime() noexcept { return sCaptureDeltaTime; }
+
     private:
         using Clock = std::chrono::steady_clock;
         using Duration = Clock::duration;
@@ -49,6 +56,7 @@ namespace Mix {
         static float sFixedTime;
         static float sMaximumDeltaTime;
         static float sSmoothingFactor;
+        static float sCaptureDeltaTime;
 
         static unsigned sFixedClampedSteps;
 
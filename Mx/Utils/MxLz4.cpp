@@ -0,0 +1,162 @@
+#include "MxLz4.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace Mix {
+	namespace {
+		// format limits of the block format
+		constexpr size_t MinMatch = 4;
+		constexpr size_t LastLiterals = 5;
+		constexpr size_t MatchSafeDistance = 12;
+		constexpr size_t MaxOffset = 65535;
+
+		constexpr uint32_t HashBits = 16;
+
+		uint32_t Read32(const uint8_t* _ptr) {
+			uint32_t result;
+			std::memcpy(&result, _ptr, sizeof(result));
+			return result;
+		}
+
+		uint32_t Hash(uint32_t _sequence) {
+			return (_sequence * 2654435761u) >> (32 - HashBits);
+		}
+
+		void WriteLength(std::vector<std::byte>& _dst, size_t _length) {
+			for (; _length >= 255; _length -= 255)
+				_dst.push_back(std::byte{ 255 });
+			_dst.push_back(static_cast<std::byte>(_length));
+		}
+
+		void WriteSequence(std::vector<std::byte>& _dst, const uint8_t* _literals, size_t _literalCount, size_t _offset, size_t _matchLength) {
+			const size_t matchCode = _matchLength ? _matchLength - MinMatch : 0;
+			const auto token = static_cast<uint8_t>((std::min<size_t>(_literalCount, 15) << 4) | std::min<size_t>(matchCode, 15));
+			_dst.push_back(static_cast<std::byte>(token));
+
+			if (_literalCount >= 15)
+				WriteLength(_dst, _literalCount - 15);
+
+			const auto literals = reinterpret_cast<const std::byte*>(_literals);
+			_dst.insert(_dst.end(), literals, literals + _literalCount);
+
+			// the last sequence has no match
+			if (!_matchLength)
+				return;
+
+			_dst.push_back(static_cast<std::byte>(_offset & 0xFF));
+			_dst.push_back(static_cast<std::byte>(_offset >> 8));
+
+			if (matchCode >= 15)
+				WriteLength(_dst, matchCode - 15);
+		}
+
+		bool ReadLength(const uint8_t*& _src, const uint8_t* _srcEnd, size_t& _length) {
+			uint8_t value;
+			do {
+				if (_src == _srcEnd)
+					return false;
+				value = *_src++;
+				_length += value;
+			} while (value == 255);
+			return true;
+		}
+	}
+
+	std::vector<std::byte> Lz4::Compress(ArrayProxy<const std::byte> _src) {
+		std::vector<std::byte> result;
+		result.reserve(CompressBound(_src.size()));
+
+		const auto begin = reinterpret_cast<const uint8_t*>(_src.data());
+		const auto end = begin + _src.size();
+
+		const uint8_t* anchor = begin;
+		if (_src.size() > MatchSafeDistance) {
+			// positions + 1 so 0 marks an empty slot
+			std::vector<uint32_t> table(size_t(1) << HashBits, 0);
+
+			const auto matchLimit = end - LastLiterals;
+			const auto searchEnd = end - MatchSafeDistance;
+
+			const uint8_t* ip = begin;
+			while (ip < searchEnd) {
+				const auto sequence = Read32(ip);
+				auto& slot = table[Hash(sequence)];
+				const uint8_t* candidate = slot ? begin + slot - 1 : nullptr;
+				slot = static_cast<uint32_t>(ip - begin) + 1;
+
+				if (!candidate || static_cast<size_t>(ip - candidate) > MaxOffset || Read32(candidate) != sequence) {
+					++ip;
+					continue;
+				}
+
+				// extend backwards over literals that also match
+				while (ip > anchor && candidate > begin && ip[-1] == candidate[-1]) {
+					--ip;
+					--candidate;
+				}
+
+				const uint8_t* matchEnd = ip + MinMatch;
+				const uint8_t* candidateEnd = candidate + MinMatch;
+				while (matchEnd < matchLimit && *matchEnd == *candidateEnd) {
+					++matchEnd;
+					++candidateEnd;
+				}
+
+				WriteSequence(result, anchor, ip - anchor, ip - candidate, matchEnd - ip);
+				ip = anchor = matchEnd;
+			}
+		}
+
+		WriteSequence(result, anchor, end - anchor, 0, 0);
+		return result;
+	}
+
+	bool Lz4::Decompress(ArrayProxy<const std::byte> _src, ArrayProxy<std::byte> _dst) {
+		auto src = reinterpret_cast<const uint8_t*>(_src.data());
+		const auto srcEnd = src + _src.size();
+		auto dst = reinterpret_cast<uint8_t*>(_dst.data());
+		const auto dstBegin = dst;
+		const auto dstEnd = dst + _dst.size();
+
+		while (src < srcEnd) {
+			const uint8_t token = *src++;
+
+			size_t literalCount = token >> 4;
+			if (literalCount == 15 && !ReadLength(src, srcEnd, literalCount))
+				return false;
+
+			if (literalCount > static_cast<size_t>(srcEnd - src) || literalCount > static_cast<size_t>(dstEnd - dst))
+				return false;
+
+			std::memcpy(dst, src, literalCount);
+			src += literalCount;
+			dst += literalCount;
+
+			// the last sequence ends after its literals
+			if (src == srcEnd)
+				break;
+
+			if (srcEnd - src < 2)
+				return false;
+			const size_t offset = src[0] | (src[1] << 8);
+			src += 2;
+
+			size_t matchLength = token & 0x0F;
+			if (matchLength == 15 && !ReadLength(src, srcEnd, matchLength))
+				return false;
+			matchLength += MinMatch;
+
+			if (offset == 0 || offset > static_cast<size_t>(dst - dstBegin) || matchLength > static_cast<size_t>(dstEnd - dst))
+				return false;
+
+			// byte by byte since the match may overlap the output
+			const uint8_t* match = dst - offset;
+			for (size_t i = 0; i < matchLength; ++i)
+				dst[i] = match[i];
+			dst += matchLength;
+		}
+
+		return dst == dstEnd;
+	}
+}
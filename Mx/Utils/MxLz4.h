@@ -0,0 +1,30 @@
+#pragma once
+#ifndef MX_LZ4_H_
+#define MX_LZ4_H_
+
+#include <cstddef>
+#include "MxArrayProxy.h"
+#include <vector>
+
+namespace Mix {
+	/**
+	 * @brief Compressor and decompressor of the LZ4 block format.
+	 *        The output is readable by the reference LZ4_decompress_safe() and vice versa.
+	 */
+	class Lz4 {
+	public:
+		/** @brief Greedy single pass compression, favors speed over ratio like LZ4's default level */
+		static std::vector<std::byte> Compress(ArrayProxy<const std::byte> _src);
+
+		/**
+		 * @brief Decompress a block into @p _dst, whose size has to be the exact size of the original data.
+		 * @return False when the block is malformed or doesn't decompress to exactly @p _dst size() bytes
+		 */
+		static bool Decompress(ArrayProxy<const std::byte> _src, ArrayProxy<std::byte> _dst);
+
+		/** @brief Size of the worst case output of Compress() */
+		static size_t CompressBound(size_t _size) { return _size + _size / 255 + 16; }
+	};
+}
+
+#endif
@@ -0,0 +1,120 @@
+#include "MxMappedFile.h"
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Mix {
+#ifdef _WIN32
+	MappedFile::MappedFile(const std::filesystem::path& _path) {
+		const auto file = CreateFileW(_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return;
+		mFile = file;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+			close();
+			return;
+		}
+
+		mMapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mMapping) {
+			close();
+			return;
+		}
+
+		mData = static_cast<const std::byte*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+		if (!mData) {
+			close();
+			return;
+		}
+		mSize = static_cast<size_t>(size.QuadPart);
+	}
+
+	void MappedFile::close() {
+		if (mData)
+			UnmapViewOfFile(mData);
+		if (mMapping)
+			CloseHandle(mMapping);
+		if (mFile)
+			CloseHandle(mFile);
+
+		mData = nullptr;
+		mSize = 0;
+		mMapping = nullptr;
+		mFile = nullptr;
+	}
+
+	MappedFile::MappedFile(MappedFile&& _other) noexcept
+		:mData(std::exchange(_other.mData, nullptr)),
+		mSize(std::exchange(_other.mSize, 0)),
+		mFile(std::exchange(_other.mFile, nullptr)),
+		mMapping(std::exchange(_other.mMapping, nullptr)) {
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& _other) noexcept {
+		if (this != &_other) {
+			close();
+			mData = std::exchange(_other.mData, nullptr);
+			mSize = std::exchange(_other.mSize, 0);
+			mFile = std::exchange(_other.mFile, nullptr);
+			mMapping = std::exchange(_other.mMapping, nullptr);
+		}
+		return *this;
+	}
+#else
+	MappedFile::MappedFile(const std::filesystem::path& _path) {
+		const int file = open(_path.c_str(), O_RDONLY);
+		if (file < 0)
+			return;
+
+		struct stat info;
+		if (fstat(file, &info) == 0 && info.st_size > 0) {
+			void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+			if (data != MAP_FAILED) {
+				mData = static_cast<const std::byte*>(data);
+				mSize = static_cast<size_t>(info.st_size);
+			}
+		}
+
+		// the mapping stays valid after the descriptor is closed
+		::close(file);
+	}
+
+	void MappedFile::close() {
+		if (mData)
+			munmap(const_cast<std::byte*>(mData), mSize);
+
+		mData = nullptr;
+		mSize = 0;
+	}
+
+	MappedFile::MappedFile(MappedFile&& _other) noexcept
+		:mData(std::exchange(_other.mData, nullptr)),
+		mSize(std::exchange(_other.mSize, 0)) {
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& _other) noexcept {
+		if (this != &_other) {
+			close();
+			mData = std::exchange(_other.mData, nullptr);
+			mSize = std::exchange(_other.mSize, 0);
+		}
+		return *this;
+	}
+#endif
+
+	MappedFile::~MappedFile() {
+		close();
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#ifndef MX_MAPPED_FILE_H_
+#define MX_MAPPED_FILE_H_
+
+#include <cstddef>
+#include "MxGeneralBase.hpp"
+#include "MxArrayProxy.h"
+#include <filesystem>
+
+namespace Mix {
+	/**
+	 * @brief Read-only view of a whole file mapped into memory.
+	 *        Pages are read on first access, so mapping is cheap even for large files.
+	 */
+	class MappedFile :GeneralBase::NoCopyBase {
+	public:
+		MappedFile() = default;
+
+		explicit MappedFile(const std::filesystem::path& _path);
+
+		MappedFile(MappedFile&& _other) noexcept;
+
+		MappedFile& operator=(MappedFile&& _other) noexcept;
+
+		~MappedFile();
+
+		/** @brief Whether the file has been mapped, empty files are never mapped */
+		bool isOpen() const { return mData != nullptr; }
+
+		const std::byte* data() const { return mData; }
+
+		size_t size() const { return mSize; }
+
+		ArrayProxy<const std::byte> view() const { return { mSize, mData }; }
+
+		ArrayProxy<const std::byte> view(size_t _offset, size_t _size) const { return { _size, mData + _offset }; }
+
+		void close();
+
+	private:
+		const std::byte* mData = nullptr;
+		size_t mSize = 0;
+
+#ifdef _WIN32
+		void* mFile = nullptr;
+		void* mMapping = nullptr;
+#endif
+	};
+}
+
+#endif
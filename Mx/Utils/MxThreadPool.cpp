@@ -0,0 +1,117 @@
+#include "MxThreadPool.h"
+#include "../Log/MxLog.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace Mix {
+	ThreadPool::ThreadPool(uint32_t _threadCount) {
+		if (_threadCount == 0)
+			_threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+		mThreads.reserve(_threadCount);
+		for (uint32_t i = 0; i < _threadCount; ++i)
+			mThreads.emplace_back(&ThreadPool::work, this);
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStop = true;
+			mJobs.clear();
+		}
+		mCondition.notify_all();
+
+		for (auto& thread : mThreads)
+			thread.join();
+	}
+
+	void ThreadPool::enqueue(std::function<void()> _job) {
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mJobs.push_back(std::move(_job));
+		}
+		mCondition.notify_one();
+	}
+
+	void ThreadPool::parallelFor(size_t _count, size_t _grain, const std::function<void(size_t, size_t)>& _func) {
+		_grain = std::max<size_t>(_grain, 1);
+		const size_t threadCount = std::min<size_t>(mThreads.size() + 1, (_count + _grain - 1) / _grain);
+		if (threadCount <= 1) {
+			if (_count)
+				_func(0, _count);
+			return;
+		}
+
+		// helpers may only start after the call returned, so what they touch is shared with them
+		struct State {
+			std::atomic<size_t> next{ 0 };
+			size_t done = 0;
+			std::exception_ptr exception;
+			std::mutex mutex;
+			std::condition_variable condition;
+		};
+		auto state = std::make_shared<State>();
+
+		// a few ranges per thread even out ranges that take longer than others
+		const size_t rangeCount = std::min(threadCount * 4, (_count + _grain - 1) / _grain);
+		const size_t rangeSize = (_count + rangeCount - 1) / rangeCount;
+
+		// _func is only called for ranges taken before the last one is done, while the caller still waits
+		const auto run = [state, rangeCount, rangeSize, _count, &_func] {
+			for (size_t range = state->next++; range < rangeCount; range = state->next++) {
+				std::exception_ptr exception;
+				try {
+					const size_t begin = range * rangeSize;
+					if (begin < _count)
+						_func(begin, std::min(begin + rangeSize, _count));
+				}
+				catch (...) {
+					exception = std::current_exception();
+				}
+
+				std::lock_guard<std::mutex> lock(state->mutex);
+				if (exception && !state->exception)
+					state->exception = exception;
+				if (++state->done == rangeCount)
+					state->condition.notify_all();
+			}
+		};
+
+		for (size_t i = 1; i < threadCount; ++i)
+			enqueue(run);
+		run();
+
+		std::unique_lock<std::mutex> lock(state->mutex);
+		state->condition.wait(lock, [&] { return state->done == rangeCount; });
+		if (state->exception)
+			std::rethrow_exception(state->exception);
+	}
+
+	void ThreadPool::work() {
+		while (true) {
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mCondition.wait(lock, [this] { return mStop || !mJobs.empty(); });
+				if (mStop)
+					return;
+
+				job = std::move(mJobs.front());
+				mJobs.pop_front();
+			}
+
+			// an escaping exception would terminate the program
+			try {
+				job();
+			}
+			catch (const std::exception& e) {
+				Log::Error("%1%: Job failed with %2%", __FUNCTION__, e.what());
+			}
+			catch (...) {
+				Log::Error("%1%: Job failed with an unknown exception", __FUNCTION__);
+			}
+		}
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#ifndef MX_THREAD_POOL_H_
+#define MX_THREAD_POOL_H_
+
+#include "MxGeneralBase.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Mix {
+	/**
+	 * @brief Fixed number of worker threads running jobs in submission order.
+	 */
+	class ThreadPool :GeneralBase::NoCopyAndMoveBase {
+	public:
+		/** @param _threadCount 0 leaves one hardware thread for the main thread */
+		explicit ThreadPool(uint32_t _threadCount = 0);
+
+		/** @brief Jobs that have not started are dropped, running jobs are finished */
+		~ThreadPool();
+
+		void enqueue(std::function<void()> _job);
+
+		uint32_t threadCount() const { return static_cast<uint32_t>(mThreads.size()); }
+
+		/**
+		 * @brief Split [0, @p _count) into ranges of at least @p _grain items and run @p _func on them in parallel.
+		 *        The ranges are jobs of the workers, the calling thread takes ranges as well and returns when every
+		 *        range is done. It never waits for a range nobody started, so this may be called from a job.
+		 * @param _func Called with the begin and end of a range, ranges never overlap.
+		 *        The first exception thrown by it is rethrown once all ranges are done
+		 */
+		void parallelFor(size_t _count, size_t _grain, const std::function<void(size_t, size_t)>& _func);
+
+	private:
+		void work();
+
+		std::vector<std::thread> mThreads;
+		std::deque<std::function<void()>> mJobs;
+		std::mutex mMutex;
+		std::condition_variable mCondition;
+		bool mStop = false;
+	};
+}
+
+#endif
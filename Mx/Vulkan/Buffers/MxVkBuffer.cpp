@@ -3,6 +3,7 @@
 #include "../CommandBuffer/MxVkCommanddBufferHandle.h"
 #include "../MxVulkan.h"
 #include "../../Graphics/MxGraphics.h"
+#include "../../Log/MxLog.h"
 
 namespace Mix {
 	namespace Vulkan {
@@ -27,6 +28,7 @@ namespace Mix {
 			mSize = _size;
 			mUsages = _usage;
 			mMemoryProperty = _memoryProperty;
+			mSharingMode = _sharingMode;
 
 			// copy data to the buffer
 			if (_data) {
@@ -42,10 +44,24 @@ namespace Mix {
 			swap(mMemory, _other.mMemory);
 			swap(mUsages, _other.mUsages);
 			swap(mMemoryProperty, _other.mMemoryProperty);
+			swap(mSharingMode, _other.mSharingMode);
 			swap(mAllocator, _other.mAllocator);
+			swap(mRelocatable, _other.mRelocatable);
+			swap(mGraphicsOwned, _other.mGraphicsOwned);
+			swap(mRetiredBuffer, _other.mRetiredBuffer);
+			swap(mRetiredMemory, _other.mRetiredMemory);
+
+			// the allocator refers to owners by address
+			if (mRelocatable && mBuffer)
+				mAllocator->setOwner(mMemory, this);
+			if (_other.mRelocatable && _other.mBuffer)
+				_other.mAllocator->setOwner(_other.mMemory, &_other);
 		}
 
 		Buffer::~Buffer() {
+			if (mRetiredBuffer)
+				finishRelocation();
+
 			if (mBuffer) {
 				mAllocator->getDevice()->getVkHandle().destroyBuffer(mBuffer);
 				mAllocator->deallocate(mMemory);
@@ -147,6 +163,55 @@ namespace Mix {
 			mAllocator->getDevice()->getVkHandle().flushMappedMemoryRanges(mappedRange);
 		}
 
+		void Buffer::setRelocatable(const bool _relocatable) {
+			if (_relocatable && !(mUsages & vk::BufferUsageFlagBits::eTransferSrc)) {
+				Log::Warning("Buffer can not be relocated without eTransferSrc usage");
+				return;
+			}
+
+			mRelocatable = _relocatable;
+			mAllocator->setOwner(mMemory, _relocatable ? this : nullptr);
+		}
+
+		bool Buffer::recordRelocation(const vk::CommandBuffer& _cmd) {
+			// a move per pass, the retired buffer is released by finishRelocation()
+			if (mRetiredBuffer)
+				return false;
+
+			const auto& device = mAllocator->getDevice()->getVkHandle();
+
+			// the new buffer may be moved again later
+			mUsages |= vk::BufferUsageFlagBits::eTransferDst;
+
+			vk::BufferCreateInfo createInfo;
+			createInfo.size = mSize;
+			createInfo.usage = mUsages;
+			createInfo.sharingMode = mSharingMode;
+			const vk::Buffer newBuffer = device.createBuffer(createInfo);
+
+			const MemoryBlock newMemory = mAllocator->allocate(newBuffer, mMemoryProperty);
+			if (!newMemory.memory) {
+				device.destroyBuffer(newBuffer);
+				return false;
+			}
+
+			_cmd.copyBuffer(mBuffer, newBuffer, vk::BufferCopy(0, 0, mSize));
+
+			mRetiredBuffer = mBuffer;
+			mRetiredMemory = mMemory;
+			mBuffer = newBuffer;
+			mMemory = newMemory;
+			mAllocator->setOwner(mMemory, this);
+			return true;
+		}
+
+		void Buffer::finishRelocation() {
+			mAllocator->getDevice()->getVkHandle().destroyBuffer(mRetiredBuffer);
+			mAllocator->deallocate(mRetiredMemory);
+			mRetiredBuffer = nullptr;
+			mRetiredMemory = MemoryBlock();
+		}
+
 		void Buffer::invalidate(const vk::DeviceSize _size, const vk::DeviceSize _offset) const {
 			vk::MappedMemoryRange mappedRange = {};
 			mappedRange.memory = mMemory.memory;
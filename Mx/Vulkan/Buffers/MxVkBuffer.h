@@ -13,7 +13,7 @@ namespace Mix {
 	namespace Vulkan {
 		class Device;
 
-		class Buffer : public GeneralBase::NoCopyBase, public Descriptor {
+		class Buffer : public GeneralBase::NoCopyBase, public Descriptor, public AllocationOwner {
 		public:
 			Buffer(const std::shared_ptr<DeviceAllocator>& _allocator,
 				   const vk::BufferUsageFlags& _usage,
@@ -56,6 +56,25 @@ namespace Mix {
 
 			void* rawPtr() const { return mMemory.ptr; }
 
+			/**
+			 * @brief Allow the allocator to move this buffer during defragmentation.
+			 * @note Requires eTransferSrc usage, descriptors that reference the buffer are not updated.
+			 */
+			void setRelocatable(const bool _relocatable);
+
+			bool isRelocatable() const { return mRelocatable; }
+
+			/**
+			 * @brief Set by UploadManager once the first upload has handed the buffer to the graphics queue family.
+			 */
+			bool isGraphicsOwned() const { return mGraphicsOwned; }
+
+			void setGraphicsOwned() { mGraphicsOwned = true; }
+
+			bool recordRelocation(const vk::CommandBuffer& _cmd) override;
+
+			void finishRelocation() override;
+
 		protected:
 			vk::Buffer mBuffer;
 			vk::DeviceSize mSize{};
@@ -63,9 +82,16 @@ namespace Mix {
 			MemoryBlock mMemory;
 			vk::BufferUsageFlags mUsages;
 			vk::MemoryPropertyFlags mMemoryProperty;
+			vk::SharingMode mSharingMode = vk::SharingMode::eExclusive;
 
 			std::shared_ptr<DeviceAllocator> mAllocator;
 
+			bool mRelocatable = false;
+			vk::Buffer mRetiredBuffer;
+			MemoryBlock mRetiredMemory;
+
+			bool mGraphicsOwned = false;
+
 		};
 	}
 }
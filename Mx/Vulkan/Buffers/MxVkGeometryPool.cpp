@@ -0,0 +1,197 @@
+#include "MxVkGeometryPool.h"
+#include "MxVkBuffer.h"
+#include "../../Utils/MxUtils.h"
+#include <algorithm>
+#include <limits>
+
+namespace Mix {
+	namespace Vulkan {
+		GeometryRange::~GeometryRange() {
+			// ranges of a destroyed pool only keep their buffer alive
+			if (auto pool = mPool.lock())
+				pool->release(*this);
+		}
+
+		GeometryPool::GeometryPool(const std::shared_ptr<DeviceAllocator>& _allocator,
+								   const uint32_t _framesInFlight,
+								   const vk::DeviceSize _vertexBlockSize,
+								   const vk::DeviceSize _indexBlockSize)
+			: mAllocator(_allocator),
+			mFramesInFlight(_framesInFlight),
+			mVertexBlockSize(_vertexBlockSize),
+			mIndexBlockSize(_indexBlockSize) {
+		}
+
+		std::shared_ptr<GeometryRange> GeometryPool::allocateVertices(const size_t _layout, const uint32_t _stride, const uint32_t _count) {
+			if (_stride == 0 || _count == 0)
+				return nullptr;
+
+			auto key = _layout;
+			Utils::HashCombine(key, _stride);
+
+			std::lock_guard<std::mutex> lock(mMutex);
+			auto& heap = mVertexHeaps[key];
+			if (heap.elementSize == 0) {
+				heap.usage = vk::BufferUsageFlagBits::eVertexBuffer;
+				heap.elementSize = _stride;
+				heap.blockCapacity = static_cast<uint32_t>(std::min<vk::DeviceSize>(mVertexBlockSize / _stride, std::numeric_limits<int32_t>::max()));
+			}
+			return allocate(heap, _count);
+		}
+
+		std::shared_ptr<GeometryRange> GeometryPool::allocateIndices(const vk::IndexType _type, const uint32_t _count) {
+			if (_count == 0)
+				return nullptr;
+
+			std::lock_guard<std::mutex> lock(mMutex);
+			auto& heap = mIndexHeaps[static_cast<uint32_t>(_type)];
+			if (heap.elementSize == 0) {
+				heap.usage = vk::BufferUsageFlagBits::eIndexBuffer;
+				heap.elementSize = _type == vk::IndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+				heap.blockCapacity = static_cast<uint32_t>(mIndexBlockSize / heap.elementSize);
+			}
+			return allocate(heap, _count);
+		}
+
+		void GeometryPool::nextFrame() {
+			std::lock_guard<std::mutex> lock(mMutex);
+			++mFrame;
+
+			auto it = std::remove_if(mPendingFrees.begin(), mPendingFrees.end(), [this](const PendingFree& _free) {
+				if (_free.frame + mFramesInFlight > mFrame)
+					return false;
+
+				Insert(*_free.block, _free.first, _free.count);
+				_free.block->used -= _free.count;
+				return true;
+			});
+			if (it == mPendingFrees.end())
+				return;
+			mPendingFrees.erase(it, mPendingFrees.end());
+
+			// keep one block per heap around for the meshes to come
+			const auto shrink = [](Heap& _heap) {
+				for (size_t i = _heap.blocks.size(); i-- > 0 && _heap.blocks.size() > 1;) {
+					if (_heap.blocks[i]->used == 0)
+						_heap.blocks.erase(_heap.blocks.begin() + i);
+				}
+			};
+			for (auto& heap : mVertexHeaps)
+				shrink(heap.second);
+			for (auto& heap : mIndexHeaps)
+				shrink(heap.second);
+		}
+
+		vk::DeviceSize GeometryPool::capacity() const {
+			std::lock_guard<std::mutex> lock(mMutex);
+			vk::DeviceSize result = 0;
+			for (auto& heap : mVertexHeaps) {
+				for (auto& block : heap.second.blocks)
+					result += block->buffer->size();
+			}
+			for (auto& heap : mIndexHeaps) {
+				for (auto& block : heap.second.blocks)
+					result += block->buffer->size();
+			}
+			return result;
+		}
+
+		vk::DeviceSize GeometryPool::usedSize() const {
+			std::lock_guard<std::mutex> lock(mMutex);
+			vk::DeviceSize result = 0;
+			for (auto& heap : mVertexHeaps) {
+				for (auto& block : heap.second.blocks)
+					result += static_cast<vk::DeviceSize>(block->used) * heap.second.elementSize;
+			}
+			for (auto& heap : mIndexHeaps) {
+				for (auto& block : heap.second.blocks)
+					result += static_cast<vk::DeviceSize>(block->used) * heap.second.elementSize;
+			}
+			return result;
+		}
+
+		std::shared_ptr<GeometryRange> GeometryPool::allocate(Heap& _heap, const uint32_t _count) {
+			Block* block = nullptr;
+			std::map<uint32_t, uint32_t>::iterator range;
+
+			// first fit, blocks are visited in creation order so older blocks fill up first
+			for (auto& candidate : _heap.blocks) {
+				if (candidate->capacity - candidate->used < _count)
+					continue;
+
+				range = std::find_if(candidate->freeRanges.begin(), candidate->freeRanges.end(),
+									 [_count](const std::pair<const uint32_t, uint32_t>& _range) { return _range.second >= _count; });
+				if (range != candidate->freeRanges.end()) {
+					block = candidate.get();
+					break;
+				}
+			}
+
+			// requests larger than a block get a block of their own
+			if (!block) {
+				block = &createBlock(_heap, std::max(_heap.blockCapacity, _count));
+				range = block->freeRanges.begin();
+			}
+
+			const auto first = range->first;
+			const auto left = range->second - _count;
+			block->freeRanges.erase(range);
+			if (left != 0)
+				block->freeRanges.emplace(first + _count, left);
+			block->used += _count;
+
+			std::shared_ptr<GeometryRange> result(new GeometryRange());
+			result->mPool = weak_from_this();
+			result->mBuffer = block->buffer;
+			result->mBlock = block;
+			result->mFirst = first;
+			result->mCount = _count;
+			result->mElementSize = _heap.elementSize;
+			return result;
+		}
+
+		GeometryPool::Block& GeometryPool::createBlock(Heap& _heap, const uint32_t _capacity) {
+			auto block = std::make_unique<Block>();
+			block->capacity = _capacity;
+			block->buffer = std::make_shared<Buffer>(mAllocator,
+													 _heap.usage |
+													 vk::BufferUsageFlagBits::eTransferDst |
+													 vk::BufferUsageFlagBits::eTransferSrc,
+													 vk::MemoryPropertyFlagBits::eDeviceLocal,
+													 static_cast<vk::DeviceSize>(_capacity) * _heap.elementSize);
+			// draws look the buffer up when they are recorded, so it can be moved by defragmentation
+			block->buffer->setRelocatable(true);
+			block->freeRanges.emplace(0, _capacity);
+
+			_heap.blocks.push_back(std::move(block));
+			return *_heap.blocks.back();
+		}
+
+		void GeometryPool::Insert(Block& _block, uint32_t _first, uint32_t _count) {
+			auto next = _block.freeRanges.lower_bound(_first);
+
+			// merge with the free range right after
+			if (next != _block.freeRanges.end() && _first + _count == next->first) {
+				_count += next->second;
+				next = _block.freeRanges.erase(next);
+			}
+
+			// and with the one right before
+			if (next != _block.freeRanges.begin()) {
+				auto prev = std::prev(next);
+				if (prev->first + prev->second == _first) {
+					prev->second += _count;
+					return;
+				}
+			}
+
+			_block.freeRanges.emplace_hint(next, _first, _count);
+		}
+
+		void GeometryPool::release(GeometryRange& _range) {
+			std::lock_guard<std::mutex> lock(mMutex);
+			// frames recorded up to now may still draw from the range
+			mPendingFrees.push_back({ _range.mBlock, _range.mFirst, _range.mCount, mFrame });
+		}
+	}
+}
@@ -0,0 +1,132 @@
+#pragma once
+#ifndef MX_VK_GEOMETRY_POOL_H_
+#define MX_VK_GEOMETRY_POOL_H_
+
+#include "../Memory/MxVkAllocator.h"
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+namespace Mix {
+	namespace Vulkan {
+		class Buffer;
+		class GeometryRange;
+
+		/**
+		 * @brief Sub-allocates mesh vertices and indices from a few large device-local buffers.
+		 *
+		 * Vertices of the same layout and indices of the same format share buffers, so consecutive draws
+		 * rarely have to bind new ones. Each buffer keeps an offset sorted free list, allocations take the
+		 * first range that fits and freed ranges are merged with their neighbours. A freed range is only
+		 * reused once every frame in flight that may still draw from it has completed, see nextFrame().
+		 */
+		class GeometryPool :public GeneralBase::NoCopyBase, public std::enable_shared_from_this<GeometryPool> {
+		public:
+			GeometryPool(const std::shared_ptr<DeviceAllocator>& _allocator,
+						 uint32_t _framesInFlight,
+						 vk::DeviceSize _vertexBlockSize = 64 * 1024 * 1024,
+						 vk::DeviceSize _indexBlockSize = 16 * 1024 * 1024);
+
+			/**
+			 * @param _layout Hash of the vertex layout, vertices of different layouts never share a buffer
+			 * @param _stride Size of one vertex in bytes
+			 */
+			std::shared_ptr<GeometryRange> allocateVertices(size_t _layout, uint32_t _stride, uint32_t _count);
+
+			std::shared_ptr<GeometryRange> allocateIndices(vk::IndexType _type, uint32_t _count);
+
+			/**
+			 * @brief Make ranges freed frames in flight ago available again and release buffers that became empty.
+			 *        Called once per frame after the fence of the frame has been waited on.
+			 */
+			void nextFrame();
+
+			/** @brief Bytes of all pool buffers */
+			vk::DeviceSize capacity() const;
+
+			/** @brief Bytes handed out to meshes */
+			vk::DeviceSize usedSize() const;
+
+		private:
+			friend class GeometryRange;
+
+			struct Block {
+				std::shared_ptr<Buffer> buffer;
+				uint32_t capacity = 0;
+				uint32_t used = 0;
+				// first element -> element count
+				std::map<uint32_t, uint32_t> freeRanges;
+			};
+
+			struct Heap {
+				vk::BufferUsageFlags usage;
+				uint32_t elementSize = 0;
+				uint32_t blockCapacity = 0;
+				std::vector<std::unique_ptr<Block>> blocks;
+			};
+
+			struct PendingFree {
+				Block* block;
+				uint32_t first;
+				uint32_t count;
+				uint64_t frame;
+			};
+
+			std::shared_ptr<GeometryRange> allocate(Heap& _heap, uint32_t _count);
+
+			Block& createBlock(Heap& _heap, uint32_t _capacity);
+
+			static void Insert(Block& _block, uint32_t _first, uint32_t _count);
+
+			void release(GeometryRange& _range);
+
+			std::shared_ptr<DeviceAllocator> mAllocator;
+			uint32_t mFramesInFlight;
+			vk::DeviceSize mVertexBlockSize;
+			vk::DeviceSize mIndexBlockSize;
+
+			std::unordered_map<size_t, Heap> mVertexHeaps;
+			std::unordered_map<uint32_t, Heap> mIndexHeaps;
+
+			std::vector<PendingFree> mPendingFrees;
+			uint64_t mFrame = 0;
+
+			mutable std::mutex mMutex;
+		};
+
+		/**
+		 * @brief Elements of a pool buffer owned by a mesh, given back to the pool on destruction.
+		 *        Offsets are counted in elements, so they can be added to firstIndex and vertexOffset of a draw.
+		 */
+		class GeometryRange :public GeneralBase::NoCopyBase {
+		public:
+			~GeometryRange();
+
+			const std::shared_ptr<Buffer>& getBuffer() const { return mBuffer; }
+
+			uint32_t first() const { return mFirst; }
+
+			uint32_t count() const { return mCount; }
+
+			uint32_t elementSize() const { return mElementSize; }
+
+			vk::DeviceSize byteOffset() const { return static_cast<vk::DeviceSize>(mFirst) * mElementSize; }
+
+			vk::DeviceSize byteSize() const { return static_cast<vk::DeviceSize>(mCount) * mElementSize; }
+
+		private:
+			friend class GeometryPool;
+
+			GeometryRange() = default;
+
+			std::weak_ptr<GeometryPool> mPool;
+			std::shared_ptr<Buffer> mBuffer;
+			GeometryPool::Block* mBlock = nullptr;
+			uint32_t mFirst = 0;
+			uint32_t mCount = 0;
+			uint32_t mElementSize = 0;
+		};
+	}
+}
+
+#endif // !MX_VK_GEOMETRY_POOL_H_
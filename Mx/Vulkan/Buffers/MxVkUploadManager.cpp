@@ -0,0 +1,498 @@
+#include "MxVkUploadManager.h"
+#include "MxVkBuffer.h"
+#include "../Image/MxVkImage.h"
+#include "../CommandBuffer/MxVkCommandPool.h"
+#include "../CommandBuffer/MxVkCommanddBufferHandle.h"
+#include "../../Log/MxLog.h"
+#include <cstring>
+
+namespace Mix {
+	namespace Vulkan {
+		// satisfies the offset rules of vkCmdCopyBufferToImage for all uncompressed and block compressed formats
+		static const vk::DeviceSize StagingAlignment = 16;
+
+		UploadManager::UploadManager(const std::shared_ptr<DeviceAllocator>& _allocator,
+									 const std::shared_ptr<CommandPool>& _transferPool,
+									 const uint32_t _framesInFlight,
+									 const vk::DeviceSize _ringSize)
+			: mAllocator(_allocator),
+			mTransferPool(_transferPool),
+			mFramesInFlight(_framesInFlight),
+			mRingSize(Math::Align(_ringSize, StagingAlignment)) {
+			auto& families = mAllocator->getDevice()->getQueueFamilyIndexSet();
+			mTransferFamily = families.transfer.value();
+			mGraphicsFamily = families.graphics.value();
+
+			mRing = std::make_shared<Buffer>(mAllocator,
+											 vk::BufferUsageFlagBits::eTransferSrc,
+											 vk::MemoryPropertyFlagBits::eHostVisible |
+											 vk::MemoryPropertyFlagBits::eHostCoherent,
+											 mRingSize);
+
+			mPending.id = 1;
+		}
+
+		UploadManager::~UploadManager() {
+			// CommandBufferHandle waits for its fence on destruction
+			mInFlight.clear();
+		}
+
+		UploadManager::BatchId UploadManager::uploadBuffer(const std::shared_ptr<Buffer>& _dst,
+														   const void* _data,
+														   const vk::DeviceSize _size,
+														   const vk::DeviceSize _dstOffset) {
+			assert(_dstOffset + _size <= _dst->size() && "Out of range");
+
+			std::lock_guard<std::recursive_mutex> lock(mMutex);
+			const auto staging = stage(_data, _size);
+
+			auto& upload = findBuffer(selectWork(*_dst), _dst);
+			upload.copies.emplace_back(staging.first, vk::BufferCopy(staging.second, _dstOffset, _size));
+			return mPending.id;
+		}
+
+		UploadManager::BatchId UploadManager::uploadBuffer(const std::shared_ptr<Buffer>& _dst,
+														   const vk::DeviceSize _size,
+														   const std::function<void(std::byte*)>& _write,
+														   const vk::DeviceSize _dstOffset) {
+			assert(_dstOffset + _size <= _dst->size() && "Out of range");
+
+			std::lock_guard<std::recursive_mutex> lock(mMutex);
+			const auto staging = allocateStaging(_size);
+			_write(staging.ptr);
+
+			auto& upload = findBuffer(selectWork(*_dst), _dst);
+			upload.copies.emplace_back(staging.buffer, vk::BufferCopy(staging.offset, _dstOffset, _size));
+			return mPending.id;
+		}
+
+		UploadManager::BatchId UploadManager::uploadImage(const std::shared_ptr<Image>& _dst,
+														  const void* _data,
+														  const vk::DeviceSize _size,
+														  const vk::BufferImageCopy& _region,
+														  const vk::ImageLayout _layout) {
+			std::lock_guard<std::recursive_mutex> lock(mMutex);
+			const auto staging = stage(_data, _size);
+
+			const vk::ImageLayout finalLayout = _layout == vk::ImageLayout::eUndefined ?
+				vk::ImageLayout::eShaderReadOnlyOptimal : _layout;
+
+			auto& upload = findImage(selectWork(*_dst), _dst, _layout, finalLayout);
+			vk::BufferImageCopy region = _region;
+			region.bufferOffset = staging.second;
+			upload.copies.emplace_back(staging.first, region);
+			return mPending.id;
+		}
+
+		UploadManager::BatchId UploadManager::initializeImage(const std::shared_ptr<Image>& _image,
+															  const vk::ImageSubresourceRange& _range,
+															  const vk::ImageLayout _layout) {
+			std::lock_guard<std::recursive_mutex> lock(mMutex);
+			auto& upload = findImage(selectWork(*_image), _image, vk::ImageLayout::eUndefined, _layout);
+			upload.range = _range;
+			return mPending.id;
+		}
+
+		UploadManager::BatchId UploadManager::addGraphicsCommand(std::function<void(const vk::CommandBuffer&)> _command,
+																 std::shared_ptr<void> _keepAlive) {
+			std::lock_guard<std::recursive_mutex> lock(mMutex);
+			mPending.graphicsCommands.push_back(std::move(_command));
+			if (_keepAlive)
+				mPending.keepAlive.push_back(std::move(_keepAlive));
+			return mPending.id;
+		}
+
+		void UploadManager::deferRelease(std::shared_ptr<void> _resource) {
+			std::lock_guard<std::recursive_mutex> lock(mMutex);
+			mPending.keepAlive.push_back(std::move(_resource));
+		}
+
+		void UploadManager::flush(const bool _wait) {
+			std::lock_guard<std::recursive_mutex> lock(mMutex);
+			submitPending();
+
+			if (_wait) {
+				for (auto& batch : mInFlight) {
+					if (batch.cmd)
+						batch.cmd->wait();
+				}
+			}
+		}
+
+		void UploadManager::recordFrame(const vk::CommandBuffer& _cmd) {
+			std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+			++mFrame;
+			mWaitSemaphores.clear();
+			mWaitStages.clear();
+
+			retireBatches();
+			submitPending();
+
+			for (auto& batch : mInFlight) {
+				if (batch.recorded)
+					continue;
+
+				if (batch.semaphore) {
+					mWaitSemaphores.push_back(batch.semaphore->get());
+					mWaitStages.push_back(vk::PipelineStageFlagBits::eAllCommands);
+				}
+
+				if (isQueueOwnershipTransferNeeded())
+					recordAcquire(_cmd, batch.transfer);
+
+				recordCopies(_cmd, batch.graphics, false);
+
+				for (auto& command : batch.graphicsCommands)
+					command(_cmd);
+
+				batch.recorded = true;
+				batch.recordedFrame = mFrame;
+			}
+		}
+
+		bool UploadManager::isComplete(const BatchId _batch) {
+			std::lock_guard<std::recursive_mutex> lock(mMutex);
+			retireBatches();
+			return _batch < (mInFlight.empty() ? mPending.id : mInFlight.front().id);
+		}
+
+		std::pair<vk::Buffer, vk::DeviceSize> UploadManager::stage(const void* _data, const vk::DeviceSize _size) {
+			const auto staging = allocateStaging(_size);
+			memcpy(staging.ptr, _data, static_cast<size_t>(_size));
+			return { staging.buffer, staging.offset };
+		}
+
+		UploadManager::Staging UploadManager::allocateStaging(const vk::DeviceSize _size) {
+			vk::DeviceSize offset = 0;
+			bool staged = allocateRing(_size, offset);
+
+			if (!staged) {
+				retireBatches();
+				staged = allocateRing(_size, offset);
+			}
+
+			if (!staged && _size <= mRingSize) {
+				// stall until the submitted copies have consumed their staging memory
+				submitPending();
+				for (auto& batch : mInFlight) {
+					if (batch.cmd)
+						batch.cmd->wait();
+				}
+				retireBatches();
+				staged = allocateRing(_size, offset);
+			}
+
+			if (staged)
+				return { mRing->get(), offset, static_cast<std::byte*>(mRing->rawPtr()) + offset };
+
+			// data that does not fit into the ring gets its own staging buffer
+			if (_size <= mRingSize)
+				Log::Warning("Staging ring of %1% bytes is exhausted, consider a larger ring", mRingSize);
+
+			auto buffer = std::make_shared<Buffer>(mAllocator,
+												   vk::BufferUsageFlagBits::eTransferSrc,
+												   vk::MemoryPropertyFlagBits::eHostVisible |
+												   vk::MemoryPropertyFlagBits::eHostCoherent,
+												   _size);
+			mPending.oversized.push_back(buffer);
+			return { buffer->get(), 0, static_cast<std::byte*>(buffer->rawPtr()) };
+		}
+
+		bool UploadManager::allocateRing(vk::DeviceSize _size, vk::DeviceSize& _offset) {
+			_size = Math::Align(_size, StagingAlignment);
+			if (_size > mRingSize)
+				return false;
+
+			const bool empty = mRingBatches == 0;
+			if (empty)
+				mRingHead = mRingTail = 0;
+
+			if (empty || mRingHead > mRingTail) {
+				// free space is [head, end) and [0, tail)
+				if (mRingHead + _size <= mRingSize)
+					_offset = mRingHead;
+				else if (_size <= mRingTail)
+					_offset = 0;
+				else
+					return false;
+			}
+			else if (mRingHead < mRingTail && mRingHead + _size <= mRingTail) {
+				_offset = mRingHead;
+			}
+			else
+				return false;
+
+			mRingHead = _offset + _size;
+
+			if (!mPending.usesRing) {
+				mPending.usesRing = true;
+				mPending.ringBegin = _offset;
+				++mRingBatches;
+			}
+			mPending.ringEnd = mRingHead;
+			return true;
+		}
+
+		void UploadManager::submitPending() {
+			if (mPending.transfer.empty() &&
+				mPending.graphics.empty() &&
+				mPending.graphicsCommands.empty() &&
+				mPending.keepAlive.empty() &&
+				!mPending.usesRing &&
+				mPending.oversized.empty())
+				return;
+
+			if (!mPending.transfer.empty()) {
+				mPending.cmd = std::make_unique<CommandBufferHandle>(mTransferPool);
+				mPending.cmd->begin(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+				recordCopies(mPending.cmd->get(), mPending.transfer, isQueueOwnershipTransferNeeded());
+				mPending.cmd->end();
+
+				mPending.semaphore = std::make_unique<Semaphore>(mAllocator->getDevice());
+				mPending.cmd->submit({}, {}, { mPending.semaphore->get() });
+			}
+
+			mPending.submitted = true;
+
+			const BatchId next = mPending.id + 1;
+			mInFlight.push_back(std::move(mPending));
+			mPending = Batch();
+			mPending.id = next;
+		}
+
+		bool UploadManager::isStagingReleasable(const Batch& _batch) const {
+			if (_batch.cmd && _batch.cmd->wait(0) != vk::Result::eSuccess)
+				return false;
+
+			// graphics side copies are done once the frame that recorded them has been waited on
+			return _batch.graphics.empty() ||
+				(_batch.recorded && mFrame >= _batch.recordedFrame + mFramesInFlight);
+		}
+
+		void UploadManager::retireBatches() {
+			// staging memory is released in allocation order
+			for (auto& batch : mInFlight) {
+				if (!batch.usesRing || batch.ringReleased)
+					continue;
+
+				if (!isStagingReleasable(batch))
+					break;
+
+				mRingTail = batch.ringEnd;
+				batch.ringReleased = true;
+				--mRingBatches;
+			}
+
+			while (!mInFlight.empty()) {
+				auto& batch = mInFlight.front();
+				if (!batch.recorded || mFrame < batch.recordedFrame + mFramesInFlight)
+					break;
+				if (batch.usesRing && !batch.ringReleased)
+					break;
+				if (batch.cmd && batch.cmd->wait(0) != vk::Result::eSuccess)
+					break;
+
+				mInFlight.pop_front();
+			}
+		}
+
+		void UploadManager::recordCopies(const vk::CommandBuffer& _cmd, const Work& _work, const bool _release) const {
+			if (_work.empty())
+				return;
+
+			const vk::AccessFlags readAccess = vk::AccessFlagBits::eShaderRead |
+				vk::AccessFlagBits::eVertexAttributeRead |
+				vk::AccessFlagBits::eIndexRead |
+				vk::AccessFlagBits::eUniformRead;
+
+			// all barriers of the batch are issued together
+			std::vector<vk::ImageMemoryBarrier> preImages, postImages;
+			std::vector<vk::BufferMemoryBarrier> preBuffers, postBuffers;
+
+			for (auto& upload : _work.images) {
+				vk::ImageMemoryBarrier barrier;
+				barrier.image = upload.image->get();
+				barrier.subresourceRange = upload.range;
+				barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+				if (!upload.copies.empty()) {
+					barrier.oldLayout = upload.oldLayout;
+					barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+					barrier.srcAccessMask = upload.oldLayout == vk::ImageLayout::eUndefined ?
+						vk::AccessFlags() : vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderRead;
+					barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+					preImages.push_back(barrier);
+
+					barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+					barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+				}
+				else {
+					barrier.oldLayout = upload.oldLayout;
+					barrier.srcAccessMask = vk::AccessFlags();
+				}
+
+				barrier.newLayout = upload.finalLayout;
+				barrier.dstAccessMask = _release ? vk::AccessFlags() : vk::AccessFlagBits::eShaderRead;
+				if (_release) {
+					barrier.srcQueueFamilyIndex = mTransferFamily;
+					barrier.dstQueueFamilyIndex = mGraphicsFamily;
+				}
+				postImages.push_back(barrier);
+			}
+
+			for (auto& upload : _work.buffers) {
+				vk::BufferMemoryBarrier barrier;
+				barrier.buffer = upload.buffer->get();
+				barrier.offset = 0;
+				barrier.size = VK_WHOLE_SIZE;
+				barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+				// the buffer may still be read by earlier frames
+				barrier.srcAccessMask = vk::AccessFlags();
+				barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+				preBuffers.push_back(barrier);
+
+				barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+				barrier.dstAccessMask = _release ? vk::AccessFlags() : readAccess;
+				if (_release) {
+					barrier.srcQueueFamilyIndex = mTransferFamily;
+					barrier.dstQueueFamilyIndex = mGraphicsFamily;
+				}
+				postBuffers.push_back(barrier);
+			}
+
+			_cmd.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,
+								 vk::PipelineStageFlagBits::eTransfer,
+								 vk::DependencyFlags(),
+								 nullptr, preBuffers, preImages);
+
+			for (auto& upload : _work.images) {
+				for (auto& copy : upload.copies) {
+					_cmd.copyBufferToImage(copy.first, upload.image->get(), vk::ImageLayout::eTransferDstOptimal, copy.second);
+				}
+			}
+
+			for (auto& upload : _work.buffers) {
+				for (auto& copy : upload.copies) {
+					_cmd.copyBuffer(copy.first, upload.buffer->get(), copy.second);
+				}
+			}
+
+			_cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+								 _release ? vk::PipelineStageFlagBits::eBottomOfPipe : vk::PipelineStageFlagBits::eAllCommands,
+								 vk::DependencyFlags(),
+								 nullptr, postBuffers, postImages);
+		}
+
+		void UploadManager::recordAcquire(const vk::CommandBuffer& _cmd, const Work& _work) const {
+			if (_work.empty())
+				return;
+
+			// must match the release barriers recorded by recordCopies()
+			std::vector<vk::ImageMemoryBarrier> images;
+			std::vector<vk::BufferMemoryBarrier> buffers;
+
+			for (auto& upload : _work.images) {
+				vk::ImageMemoryBarrier barrier;
+				barrier.image = upload.image->get();
+				barrier.subresourceRange = upload.range;
+				barrier.oldLayout = upload.copies.empty() ? upload.oldLayout : vk::ImageLayout::eTransferDstOptimal;
+				barrier.newLayout = upload.finalLayout;
+				barrier.srcAccessMask = vk::AccessFlags();
+				barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eTransferRead;
+				barrier.srcQueueFamilyIndex = mTransferFamily;
+				barrier.dstQueueFamilyIndex = mGraphicsFamily;
+				images.push_back(barrier);
+			}
+
+			for (auto& upload : _work.buffers) {
+				vk::BufferMemoryBarrier barrier;
+				barrier.buffer = upload.buffer->get();
+				barrier.offset = 0;
+				barrier.size = VK_WHOLE_SIZE;
+				barrier.srcAccessMask = vk::AccessFlags();
+				barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead |
+					vk::AccessFlagBits::eVertexAttributeRead |
+					vk::AccessFlagBits::eIndexRead |
+					vk::AccessFlagBits::eUniformRead;
+				barrier.srcQueueFamilyIndex = mTransferFamily;
+				barrier.dstQueueFamilyIndex = mGraphicsFamily;
+				buffers.push_back(barrier);
+			}
+
+			_cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+								 vk::PipelineStageFlagBits::eAllCommands,
+								 vk::DependencyFlags(),
+								 nullptr, buffers, images);
+		}
+
+		UploadManager::ImageUpload& UploadManager::findImage(Work& _work,
+															 const std::shared_ptr<Image>& _image,
+															 const vk::ImageLayout _oldLayout,
+															 const vk::ImageLayout _finalLayout) {
+			for (auto& upload : _work.images) {
+				if (upload.image == _image)
+					return upload;
+			}
+
+			ImageUpload upload;
+			upload.image = _image;
+			upload.range = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor,
+													 0, _image->mipLevels(),
+													 0, _image->arrayLevels());
+			upload.oldLayout = _oldLayout;
+			upload.finalLayout = _finalLayout;
+			_work.images.push_back(std::move(upload));
+			return _work.images.back();
+		}
+
+		UploadManager::BufferUpload& UploadManager::findBuffer(Work& _work, const std::shared_ptr<Buffer>& _buffer) {
+			for (auto& upload : _work.buffers) {
+				if (upload.buffer == _buffer)
+					return upload;
+			}
+
+			BufferUpload upload;
+			upload.buffer = _buffer;
+			_work.buffers.push_back(std::move(upload));
+			return _work.buffers.back();
+		}
+
+		UploadManager::Work& UploadManager::selectWork(Buffer& _buffer) {
+			auto& work = selectWork(&_buffer, _buffer.isGraphicsOwned());
+			_buffer.setGraphicsOwned();
+			return work;
+		}
+
+		UploadManager::Work& UploadManager::selectWork(Image& _image) {
+			auto& work = selectWork(&_image, _image.isGraphicsOwned());
+			_image.setGraphicsOwned();
+			return work;
+		}
+
+		UploadManager::Work& UploadManager::selectWork(const void* _handle, const bool _graphicsOwned) {
+			if (!isQueueOwnershipTransferNeeded())
+				return mPending.transfer;
+
+			// resources first uploaded by the pending batch stay on the transfer queue
+			for (auto& upload : mPending.transfer.images) {
+				if (upload.image.get() == _handle)
+					return mPending.transfer;
+			}
+			for (auto& upload : mPending.transfer.buffers) {
+				if (upload.buffer.get() == _handle)
+					return mPending.transfer;
+			}
+
+			// moving ownership back to the transfer queue would need a release on the graphics queue,
+			// so later uploads are copied on the graphics queue instead
+			if (_graphicsOwned)
+				return mPending.graphics;
+
+			return mPending.transfer;
+		}
+	}
+}
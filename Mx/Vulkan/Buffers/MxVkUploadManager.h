@@ -0,0 +1,223 @@
+#pragma once
+#ifndef MX_VK_UPLOAD_MANAGER_H_
+#define MX_VK_UPLOAD_MANAGER_H_
+
+#include "../Memory/MxVkAllocator.h"
+#include "../SyncObject/MxVkSyncObject.h"
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace Mix {
+	namespace Vulkan {
+		class Buffer;
+		class Image;
+		class CommandPool;
+		class CommandBufferHandle;
+
+		/**
+		 * @brief Collects uploads into one transfer queue submission per frame.
+		 *
+		 * Data is copied into a persistent staging ring right away. Recorded uploads are submitted
+		 * by recordFrame() (called from VulkanAPI::beginFrame()), and the graphics submission of the
+		 * same frame waits on the batch semaphore, so a resource can be used by any frame rendered
+		 * after the upload call. When the transfer and graphics queues belong to different families,
+		 * ownership is released by the batch and acquired on the graphics queue.
+		 */
+		class UploadManager :public GeneralBase::NoCopyBase {
+		public:
+			using BatchId = uint64_t;
+
+			UploadManager(const std::shared_ptr<DeviceAllocator>& _allocator,
+						  const std::shared_ptr<CommandPool>& _transferPool,
+						  uint32_t _framesInFlight,
+						  vk::DeviceSize _ringSize = 32 * 1024 * 1024);
+
+			~UploadManager();
+
+			/**
+			 * @brief Upload data to a buffer.
+			 * @return The batch the upload belongs to
+			 */
+			BatchId uploadBuffer(const std::shared_ptr<Buffer>& _dst,
+								 const void* _data,
+								 vk::DeviceSize _size,
+								 vk::DeviceSize _dstOffset = 0);
+
+			/**
+			 * @brief Upload @p _size bytes that @p _write fills in place, saving the copy of an intermediate buffer.
+			 * @param _write Receives the staging memory, must not call back into the manager
+			 */
+			BatchId uploadBuffer(const std::shared_ptr<Buffer>& _dst,
+								 vk::DeviceSize _size,
+								 const std::function<void(std::byte*)>& _write,
+								 vk::DeviceSize _dstOffset = 0);
+
+			/**
+			 * @brief Upload data to an image. bufferOffset of @p _region is filled in by the manager.
+			 * @param _layout Layout of the image outside of uploads, only eUndefined for images that were never initialized
+			 */
+			BatchId uploadImage(const std::shared_ptr<Image>& _dst,
+								const void* _data,
+								vk::DeviceSize _size,
+								const vk::BufferImageCopy& _region,
+								vk::ImageLayout _layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+
+			/**
+			 * @brief Transition a new image from eUndefined to @p _layout as part of the next batch.
+			 */
+			BatchId initializeImage(const std::shared_ptr<Image>& _image,
+									const vk::ImageSubresourceRange& _range,
+									vk::ImageLayout _layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+
+			/**
+			 * @brief Record work on the graphics queue once the current batch is usable (e.g. mipmap generation).
+			 * @param _keepAlive Resources that must outlive the command
+			 */
+			BatchId addGraphicsCommand(std::function<void(const vk::CommandBuffer&)> _command,
+									   std::shared_ptr<void> _keepAlive = nullptr);
+
+			/**
+			 * @brief Keep @p _resource alive until every frame that may still use it has completed.
+			 */
+			void deferRelease(std::shared_ptr<void> _resource);
+
+			/**
+			 * @brief Submit the pending batch to the transfer queue.
+			 * @param _wait Block until the transfer has completed
+			 */
+			void flush(bool _wait = false);
+
+			// ---------- frame integration, used by VulkanAPI ----------
+
+			/**
+			 * @brief Submit pending uploads and record acquire barriers, graphics side copies and
+			 *        graphics commands into @p _cmd, which must be outside of a render pass.
+			 */
+			void recordFrame(const vk::CommandBuffer& _cmd);
+
+			/** @brief Semaphores the graphics submission of the current frame has to wait on */
+			const std::vector<vk::Semaphore>& getWaitSemaphores() const { return mWaitSemaphores; }
+
+			const std::vector<vk::PipelineStageFlags>& getWaitStages() const { return mWaitStages; }
+
+			/** @brief Whether all work of the batch has completed on the GPU */
+			bool isComplete(BatchId _batch);
+
+			BatchId currentBatch() const { return mPending.id; }
+
+			bool isQueueOwnershipTransferNeeded() const { return mTransferFamily != mGraphicsFamily; }
+
+			vk::DeviceSize ringSize() const { return mRingSize; }
+
+		private:
+			struct ImageUpload {
+				std::shared_ptr<Image> image;
+				vk::ImageSubresourceRange range;
+				vk::ImageLayout oldLayout = vk::ImageLayout::eUndefined;
+				vk::ImageLayout finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+				std::vector<std::pair<vk::Buffer, vk::BufferImageCopy>> copies;
+			};
+
+			struct BufferUpload {
+				std::shared_ptr<Buffer> buffer;
+				std::vector<std::pair<vk::Buffer, vk::BufferCopy>> copies;
+			};
+
+			struct Work {
+				std::vector<ImageUpload> images;
+				std::vector<BufferUpload> buffers;
+
+				bool empty() const { return images.empty() && buffers.empty(); }
+			};
+
+			struct Batch {
+				BatchId id = 0;
+
+				// recorded on the transfer queue
+				Work transfer;
+				// recorded on the graphics queue, for resources already owned by it
+				Work graphics;
+				std::vector<std::function<void(const vk::CommandBuffer&)>> graphicsCommands;
+				std::vector<std::shared_ptr<void>> keepAlive;
+
+				// staging memory used by the batch
+				vk::DeviceSize ringBegin = 0;
+				vk::DeviceSize ringEnd = 0;
+				bool usesRing = false;
+				bool ringReleased = false;
+				std::vector<std::shared_ptr<Buffer>> oversized;
+
+				std::unique_ptr<CommandBufferHandle> cmd;
+				std::unique_ptr<Semaphore> semaphore;
+				bool submitted = false;
+				bool recorded = false;
+				uint64_t recordedFrame = 0;
+			};
+
+			struct Staging {
+				vk::Buffer buffer;
+				vk::DeviceSize offset;
+				std::byte* ptr;
+			};
+
+			/** @brief Copy data to staging memory owned by the pending batch */
+			std::pair<vk::Buffer, vk::DeviceSize> stage(const void* _data, vk::DeviceSize _size);
+
+			/** @brief Host visible staging memory owned by the pending batch */
+			Staging allocateStaging(vk::DeviceSize _size);
+
+			bool allocateRing(vk::DeviceSize _size, vk::DeviceSize& _offset);
+
+			void submitPending();
+
+			/** @brief Whether the copies of the batch no longer read its staging memory */
+			bool isStagingReleasable(const Batch& _batch) const;
+
+			void retireBatches();
+
+			/**
+			 * @param _release Release ownership to the graphics queue family after the copies
+			 */
+			void recordCopies(const vk::CommandBuffer& _cmd, const Work& _work, bool _release) const;
+
+			void recordAcquire(const vk::CommandBuffer& _cmd, const Work& _work) const;
+
+			ImageUpload& findImage(Work& _work, const std::shared_ptr<Image>& _image, vk::ImageLayout _oldLayout, vk::ImageLayout _finalLayout);
+
+			BufferUpload& findBuffer(Work& _work, const std::shared_ptr<Buffer>& _buffer);
+
+			/** @brief Uploads to resources the graphics queue already owns are recorded on the graphics queue */
+			Work& selectWork(Buffer& _buffer);
+
+			Work& selectWork(Image& _image);
+
+			Work& selectWork(const void* _handle, bool _graphicsOwned);
+
+			std::shared_ptr<DeviceAllocator> mAllocator;
+			std::shared_ptr<CommandPool> mTransferPool;
+			uint32_t mFramesInFlight;
+
+			QueueFamilyIndex mTransferFamily;
+			QueueFamilyIndex mGraphicsFamily;
+
+			std::shared_ptr<Buffer> mRing;
+			vk::DeviceSize mRingSize;
+			vk::DeviceSize mRingHead = 0;
+			vk::DeviceSize mRingTail = 0;
+			// number of batches holding staging memory
+			uint32_t mRingBatches = 0;
+
+			Batch mPending;
+			std::deque<Batch> mInFlight;
+
+			uint64_t mFrame = 0;
+			std::vector<vk::Semaphore> mWaitSemaphores;
+			std::vector<vk::PipelineStageFlags> mWaitStages;
+
+			std::recursive_mutex mMutex;
+		};
+	}
+}
+
+#endif // !MX_VK_UPLOAD_MANAGER_H_
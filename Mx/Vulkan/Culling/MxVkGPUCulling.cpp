@@ -0,0 +1,229 @@
+#include "MxVkGPUCulling.h"
+#include "../Buffers/MxVkBuffer.h"
+#include "../Pipeline/MxVkShaderModule.h"
+#include "../../Resource/MxResourceLoader.h"
+#include "../../Resource/Shader/MxShaderSource.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Mix {
+	namespace Vulkan {
+		namespace {
+			// push constants of FrustumCull.comp
+			struct CullParams {
+				Vector4f planes[Frustum::PlaneCount];
+				uint32_t objectCount;
+				uint32_t compact;
+			};
+
+			const uint32_t WorkGroupSize = 64;
+		}
+
+		GPUCulling::GPUCulling(const std::shared_ptr<Device>& _device,
+							   const std::shared_ptr<DeviceAllocator>& _allocator,
+							   const uint32_t _framesInFlight)
+			: mDevice(_device),
+			mAllocator(_allocator),
+			mFrames(_framesInFlight) {
+			mDrawIndirectCount = mDevice->isExtensionEnabled(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+			mMultiDrawIndirect = mDevice->getEnabledFeatures().multiDrawIndirect;
+
+			mCullSetLayout = std::make_shared<DescriptorSetLayout>(mDevice);
+			mCullSetLayout->setBindings({
+				{ 0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute },
+				{ 1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute },
+				{ 2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute },
+				{ 3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute }
+			});
+			mCullSetLayout->create();
+
+			mObjectSetLayout = std::make_shared<DescriptorSetLayout>(mDevice);
+			mObjectSetLayout->setBindings({
+				{ 0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex }
+			});
+			mObjectSetLayout->create();
+
+			mDescriptorPool = std::make_shared<DescriptorPool>(mDevice);
+			mDescriptorPool->addPoolSize(vk::DescriptorType::eStorageBuffer, 5 * _framesInFlight);
+			mDescriptorPool->create(2 * _framesInFlight);
+
+			for (auto& frame : mFrames) {
+				frame.cullSet = mDescriptorPool->allocDescriptorSet(*mCullSetLayout);
+				frame.objectSet = mDescriptorPool->allocDescriptorSet(*mObjectSetLayout);
+			}
+
+			createPipeline();
+		}
+
+		GPUCulling::~GPUCulling() {
+			mFrames.clear();
+			mDescriptorPool.reset();
+			if (mPipeline)
+				mDevice->getVkHandle().destroyPipeline(mPipeline);
+			if (mPipelineLayout)
+				mDevice->getVkHandle().destroyPipelineLayout(mPipelineLayout);
+		}
+
+		bool GPUCulling::IsSupported(const Device& _device) {
+			// vertex shaders find their object through the firstInstance of the indirect command
+			return _device.getEnabledFeatures().drawIndirectFirstInstance;
+		}
+
+		void GPUCulling::begin() {
+			mObjects.clear();
+			mBatches.clear();
+		}
+
+		uint32_t GPUCulling::addBatch() {
+			Batch batch;
+			batch.first = static_cast<uint32_t>(mObjects.size());
+			mBatches.push_back(batch);
+			return static_cast<uint32_t>(mBatches.size() - 1);
+		}
+
+		void GPUCulling::addObject(const CullObject& _object) {
+			if (mBatches.empty())
+				addBatch();
+
+			mObjects.push_back(_object);
+			mObjects.back().batch = static_cast<uint32_t>(mBatches.size() - 1);
+			++mBatches.back().count;
+		}
+
+		void GPUCulling::record(const vk::CommandBuffer& _cmd, const uint32_t _frame, const Frustum& _frustum) {
+			mCurrFrame = _frame;
+			if (mObjects.empty())
+				return;
+
+			auto& frame = mFrames[_frame];
+			reserve(frame);
+
+			// the fence of the frame has been waited on, its buffers are no longer read
+			std::memcpy(frame.objects->rawPtr(), mObjects.data(), mObjects.size() * sizeof(CullObject));
+			std::memcpy(frame.batches->rawPtr(), mBatches.data(), mBatches.size() * sizeof(Batch));
+
+			if (mDrawIndirectCount) {
+				_cmd.fillBuffer(frame.counts->get(), 0, mBatches.size() * sizeof(uint32_t), 0);
+
+				vk::MemoryBarrier clear(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+				_cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+									 vk::PipelineStageFlagBits::eComputeShader,
+									 vk::DependencyFlags(),
+									 clear, nullptr, nullptr);
+			}
+
+			CullParams params;
+			std::copy_n(_frustum.getPlanes(), static_cast<size_t>(Frustum::PlaneCount), params.planes);
+			params.objectCount = objectCount();
+			params.compact = mDrawIndirectCount ? 1 : 0;
+
+			_cmd.bindPipeline(vk::PipelineBindPoint::eCompute, mPipeline);
+			_cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, mPipelineLayout, 0, frame.cullSet.get(), nullptr);
+			_cmd.pushConstants<CullParams>(mPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, params);
+			_cmd.dispatch((objectCount() + WorkGroupSize - 1) / WorkGroupSize, 1, 1);
+
+			vk::MemoryBarrier written(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead);
+			_cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+								 vk::PipelineStageFlagBits::eDrawIndirect,
+								 vk::DependencyFlags(),
+								 written, nullptr, nullptr);
+		}
+
+		void GPUCulling::bindObjects(const vk::CommandBuffer& _cmd, const vk::PipelineLayout& _layout, const uint32_t _set) const {
+			_cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, _layout, _set, mFrames[mCurrFrame].objectSet.get(), nullptr);
+		}
+
+		void GPUCulling::drawBatch(const vk::CommandBuffer& _cmd, const uint32_t _batch) const {
+			const auto& batch = mBatches[_batch];
+			if (batch.count == 0)
+				return;
+
+			const auto& frame = mFrames[mCurrFrame];
+			const uint32_t stride = sizeof(vk::DrawIndexedIndirectCommand);
+			const vk::DeviceSize offset = static_cast<vk::DeviceSize>(batch.first) * stride;
+
+			if (mDrawIndirectCount) {
+				_cmd.drawIndexedIndirectCountKHR(frame.commands->get(), offset,
+												 frame.counts->get(), _batch * sizeof(uint32_t),
+												 batch.count, stride, mDevice->getDynamicLoader());
+			}
+			else if (mMultiDrawIndirect) {
+				_cmd.drawIndexedIndirect(frame.commands->get(), offset, batch.count, stride);
+			}
+			else {
+				for (uint32_t i = 0; i < batch.count; ++i)
+					_cmd.drawIndexedIndirect(frame.commands->get(), offset + i * stride, 1, stride);
+			}
+		}
+
+		void GPUCulling::reserve(Frame& _frame) {
+			bool changed = false;
+
+			if (_frame.objectCapacity < mObjects.size()) {
+				_frame.objectCapacity = std::max<uint32_t>(64, static_cast<uint32_t>(mObjects.size() + mObjects.size() / 2));
+				_frame.objects = std::make_shared<Buffer>(mAllocator,
+														  vk::BufferUsageFlagBits::eStorageBuffer,
+														  vk::MemoryPropertyFlagBits::eHostVisible |
+														  vk::MemoryPropertyFlagBits::eHostCoherent,
+														  _frame.objectCapacity * sizeof(CullObject));
+				_frame.commands = std::make_shared<Buffer>(mAllocator,
+														   vk::BufferUsageFlagBits::eStorageBuffer |
+														   vk::BufferUsageFlagBits::eIndirectBuffer,
+														   vk::MemoryPropertyFlagBits::eDeviceLocal,
+														   _frame.objectCapacity * sizeof(vk::DrawIndexedIndirectCommand));
+				changed = true;
+			}
+
+			if (_frame.batchCapacity < mBatches.size()) {
+				_frame.batchCapacity = std::max<uint32_t>(16, static_cast<uint32_t>(mBatches.size() + mBatches.size() / 2));
+				_frame.batches = std::make_shared<Buffer>(mAllocator,
+														  vk::BufferUsageFlagBits::eStorageBuffer,
+														  vk::MemoryPropertyFlagBits::eHostVisible |
+														  vk::MemoryPropertyFlagBits::eHostCoherent,
+														  _frame.batchCapacity * sizeof(Batch));
+				_frame.counts = std::make_shared<Buffer>(mAllocator,
+														 vk::BufferUsageFlagBits::eStorageBuffer |
+														 vk::BufferUsageFlagBits::eIndirectBuffer |
+														 vk::BufferUsageFlagBits::eTransferDst,
+														 vk::MemoryPropertyFlagBits::eDeviceLocal,
+														 _frame.batchCapacity * sizeof(uint32_t));
+				changed = true;
+			}
+
+			if (!changed)
+				return;
+
+			std::vector<WriteDescriptorSet> cullWrites{
+				_frame.objects->getWriteDescriptor(0, vk::DescriptorType::eStorageBuffer),
+				_frame.batches->getWriteDescriptor(1, vk::DescriptorType::eStorageBuffer),
+				_frame.commands->getWriteDescriptor(2, vk::DescriptorType::eStorageBuffer),
+				_frame.counts->getWriteDescriptor(3, vk::DescriptorType::eStorageBuffer)
+			};
+			_frame.cullSet.updateDescriptor(cullWrites);
+
+			std::vector<WriteDescriptorSet> objectWrites{
+				_frame.objects->getWriteDescriptor(0, vk::DescriptorType::eStorageBuffer)
+			};
+			_frame.objectSet.updateDescriptor(objectWrites);
+		}
+
+		void GPUCulling::createPipeline() {
+			vk::PushConstantRange pushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(CullParams));
+
+			vk::PipelineLayoutCreateInfo layoutInfo;
+			layoutInfo.setLayoutCount = 1;
+			layoutInfo.pSetLayouts = &mCullSetLayout->get();
+			layoutInfo.pushConstantRangeCount = 1;
+			layoutInfo.pPushConstantRanges = &pushConstant;
+			mPipelineLayout = mDevice->getVkHandle().createPipelineLayout(layoutInfo);
+
+			auto source = ResourceLoader::Get()->load<ShaderSource>("Resource/Shaders/FrustumCull.comp");
+			ShaderModule shader(mDevice, *source);
+
+			vk::ComputePipelineCreateInfo pipelineInfo;
+			pipelineInfo.stage = vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eCompute, shader.get(), "main");
+			pipelineInfo.layout = mPipelineLayout;
+			mPipeline = mDevice->getVkHandle().createComputePipeline(nullptr, pipelineInfo);
+		}
+	}
+}
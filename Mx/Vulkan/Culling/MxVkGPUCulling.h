@@ -0,0 +1,117 @@
+#pragma once
+#ifndef MX_VK_GPU_CULLING_H_
+#define MX_VK_GPU_CULLING_H_
+
+#include "../Memory/MxVkAllocator.h"
+#include "../Descriptor/MxVkDescriptorSet.h"
+#include "../../Math/MxMatrix4.h"
+#include "../../Math/MxFrustum.h"
+
+namespace Mix {
+	namespace Vulkan {
+		class Buffer;
+
+		/** @brief Object tested by the culling pass, std430 layout shared with FrustumCull.comp and vShaderIndirect.vert */
+		struct CullObject {
+			// local to world, vertex shaders read it through gl_InstanceIndex
+			Matrix4 model;
+			// world space center and radius of the bounding sphere
+			Vector4f sphere;
+			uint32_t indexCount = 0;
+			uint32_t firstIndex = 0;
+			int32_t vertexOffset = 0;
+			uint32_t batch = 0;
+		};
+
+		static_assert(sizeof(CullObject) == 96, "CullObject has to match the std430 layout of the shaders");
+
+		/**
+		 * @brief Frustum culling on the GPU with indirect draw submission.
+		 *
+		 * Objects are grouped into batches that share pipeline, descriptor sets and geometry buffers. A compute pass
+		 * tests the bounding sphere of every object and writes a VkDrawIndexedIndirectCommand per object, whose
+		 * firstInstance is the object index. With VK_KHR_draw_indirect_count the survivors of a batch are compacted
+		 * and drawn with drawIndexedIndirectCount(), otherwise culled commands get an instance count of 0 and the
+		 * batch is drawn with drawIndexedIndirect(), one command at a time without the multiDrawIndirect feature.
+		 * Requires the drawIndirectFirstInstance feature, see IsSupported().
+		 */
+		class GPUCulling :public GeneralBase::NoCopyBase {
+		public:
+			GPUCulling(const std::shared_ptr<Device>& _device,
+					   const std::shared_ptr<DeviceAllocator>& _allocator,
+					   uint32_t _framesInFlight);
+
+			~GPUCulling();
+
+			static bool IsSupported(const Device& _device);
+
+			/** @brief Drop the objects of the previous frame */
+			void begin();
+
+			/** @brief Start a new batch, objects added afterwards belong to it */
+			uint32_t addBatch();
+
+			void addObject(const CullObject& _object);
+
+			uint32_t objectCount() const { return static_cast<uint32_t>(mObjects.size()); }
+
+			uint32_t batchCount() const { return static_cast<uint32_t>(mBatches.size()); }
+
+			/**
+			 * @brief Upload the objects and record the culling dispatch into @p _cmd, which must be outside of a render pass.
+			 */
+			void record(const vk::CommandBuffer& _cmd, uint32_t _frame, const Frustum& _frustum);
+
+			/** @brief Layout of the set that exposes the objects to vertex shaders at binding 0 */
+			const std::shared_ptr<DescriptorSetLayout>& getObjectSetLayout() const { return mObjectSetLayout; }
+
+			void bindObjects(const vk::CommandBuffer& _cmd, const vk::PipelineLayout& _layout, uint32_t _set) const;
+
+			/** @brief Draw the survivors of @p _batch, the geometry buffers of the batch have to be bound */
+			void drawBatch(const vk::CommandBuffer& _cmd, uint32_t _batch) const;
+
+			bool isCompacting() const { return mDrawIndirectCount; }
+
+		private:
+			struct Batch {
+				uint32_t first = 0;
+				uint32_t count = 0;
+			};
+
+			struct Frame {
+				std::shared_ptr<Buffer> objects;
+				std::shared_ptr<Buffer> batches;
+				std::shared_ptr<Buffer> commands;
+				std::shared_ptr<Buffer> counts;
+				uint32_t objectCapacity = 0;
+				uint32_t batchCapacity = 0;
+				DescriptorSet cullSet;
+				DescriptorSet objectSet;
+			};
+
+			void reserve(Frame& _frame);
+
+			void createPipeline();
+
+			std::shared_ptr<Device> mDevice;
+			std::shared_ptr<DeviceAllocator> mAllocator;
+
+			bool mDrawIndirectCount = false;
+			bool mMultiDrawIndirect = false;
+
+			std::vector<CullObject> mObjects;
+			std::vector<Batch> mBatches;
+
+			std::vector<Frame> mFrames;
+			uint32_t mCurrFrame = 0;
+
+			std::shared_ptr<DescriptorPool> mDescriptorPool;
+			std::shared_ptr<DescriptorSetLayout> mCullSetLayout;
+			std::shared_ptr<DescriptorSetLayout> mObjectSetLayout;
+			vk::PipelineLayout mPipelineLayout;
+			vk::Pipeline mPipeline;
+		};
+	}
+}
+
+#endif // !MX_VK_GPU_CULLING_H_
@@ -1,5 +1,6 @@
 #include "MxVkDevice.h"
 #include <map>
+#include <algorithm>
 
 namespace Mix {
 	namespace Vulkan {
@@ -80,6 +81,10 @@ namespace Mix {
 			swap(mQueueSet, _other.mQueueSet);
 		}
 
+		bool Device::isExtensionEnabled(const std::string& _extension) const {
+			return std::find(mEnabledExts.begin(), mEnabledExts.end(), _extension) != mEnabledExts.end();
+		}
+
 		QueueFamilyIndexSet Device::getQueueFamilyIndexSet(const PhysicalDevice& _physicalDevice,
 		                                                   const vk::QueueFlags& _requiredQueue) {
 			QueueFamilyIndexSet indexSet;
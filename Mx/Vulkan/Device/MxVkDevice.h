@@ -42,6 +42,10 @@ namespace Mix {
 
 			const vk::DispatchLoaderStatic& getStaticLoader() const { return mStaticLoader; }
 
+			bool isExtensionEnabled(const std::string& _extension) const;
+
+			const vk::PhysicalDeviceFeatures& getEnabledFeatures() const { return mEnabledFeatures; }
+
 		private:
 			vk::Device mDevice;
 
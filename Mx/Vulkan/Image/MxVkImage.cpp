@@ -3,6 +3,7 @@
 #include "../Buffers/MxVkBuffer.h"
 #include "../Buffers/MxVkBufferTransfer.h"
 #include "../CommandBuffer/MxVkCommanddBufferHandle.h"
+#include "../Device/MxVkPhysicalDevice.h"
 
 namespace Mix {
 	namespace Vulkan {
@@ -33,7 +34,7 @@ namespace Mix {
 								   _tiling, _sharingMode,
 								   _flag);
 
-			mMemory = mAllocator->allocate(mImage, _memProperty);
+			mMemory = mAllocator->allocate(mImage, _memProperty, nullptr, _tiling);
 			mType = _type;
 			mFormat = _format;
 			mExtent = _extent;
@@ -42,12 +43,25 @@ namespace Mix {
 
 			mLayout = _initialLayout;
 			mTiling = _tiling;
+
+			mCreateInfo.imageType = _type;
+			mCreateInfo.extent = _extent;
+			mCreateInfo.mipLevels = _mipLevels;
+			mCreateInfo.arrayLayers = _arrayLayers;
+			mCreateInfo.format = _format;
+			mCreateInfo.tiling = _tiling;
+			mCreateInfo.initialLayout = _initialLayout;
+			mCreateInfo.usage = _usage;
+			mCreateInfo.sharingMode = _sharingMode;
+			mCreateInfo.samples = _sampleCount;
+			mCreateInfo.flags = _flag;
+			mMemoryProperty = _memProperty;
 		}
 
 		Image::Image(std::shared_ptr<DeviceAllocator> _allocator, const vk::ImageCreateInfo& _createInfo, const vk::MemoryPropertyFlags& _memProperty) :mAllocator(std::move(_allocator)) {
 			mImage = mAllocator->getDevice()->getVkHandle().createImage(_createInfo);
 
-			mMemory = mAllocator->allocate(mImage, _memProperty);
+			mMemory = mAllocator->allocate(mImage, _memProperty, nullptr, _createInfo.tiling);
 			mType = _createInfo.imageType;
 			mFormat = _createInfo.format;
 			mExtent = _createInfo.extent;
@@ -56,6 +70,13 @@ namespace Mix {
 
 			mLayout = _createInfo.initialLayout;
 			mTiling = _createInfo.tiling;
+
+			mCreateInfo = _createInfo;
+			// queue family indices are not kept alive by the caller
+			mCreateInfo.queueFamilyIndexCount = 0;
+			mCreateInfo.pQueueFamilyIndices = nullptr;
+			mCreateInfo.sharingMode = vk::SharingMode::eExclusive;
+			mMemoryProperty = _memProperty;
 		}
 
 		void Image::swap(Image& _other) noexcept {
@@ -70,6 +91,20 @@ namespace Mix {
 			swap(mArrayLevels, _other.mArrayLevels);
 			swap(mLayout, _other.mLayout);
 			swap(mTiling, _other.mTiling);
+			swap(mCreateInfo, _other.mCreateInfo);
+			swap(mMemoryProperty, _other.mMemoryProperty);
+			swap(mRelocatable, _other.mRelocatable);
+			swap(mGraphicsOwned, _other.mGraphicsOwned);
+			swap(mRelocationLayout, _other.mRelocationLayout);
+			swap(mOnRelocated, _other.mOnRelocated);
+			swap(mRetiredImage, _other.mRetiredImage);
+			swap(mRetiredMemory, _other.mRetiredMemory);
+
+			// the allocator refers to owners by address
+			if (mRelocatable && mImage)
+				mAllocator->setOwner(mMemory, this);
+			if (_other.mRelocatable && _other.mImage)
+				_other.mAllocator->setOwner(_other.mMemory, &_other);
 		}
 
 		/*void Image::uploadData(const void* _data, const vk::DeviceSize& _dstOffset, const vk::DeviceSize& _size) const {
@@ -78,12 +113,96 @@ namespace Mix {
 		}*/
 
 		Image::~Image() {
+			if (mRetiredImage) {
+				mAllocator->getDevice()->getVkHandle().destroyImage(mRetiredImage);
+				mAllocator->deallocate(mRetiredMemory);
+			}
+
 			if (mImage) {
 				mAllocator->getDevice()->getVkHandle().destroyImage(mImage);
 				mAllocator->deallocate(mMemory);
 			}
 		}
 
+		void Image::setRelocatable(const vk::ImageLayout _layout, std::function<void(Image&)> _onRelocated) {
+			const vk::ImageUsageFlags transferUsage = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst;
+			if ((mCreateInfo.usage & transferUsage) != transferUsage) {
+				Log::Warning("Image can not be relocated without transfer usage");
+				return;
+			}
+
+			mRelocatable = true;
+			mRelocationLayout = _layout;
+			mOnRelocated = std::move(_onRelocated);
+			mAllocator->setOwner(mMemory, this);
+		}
+
+		bool Image::recordRelocation(const vk::CommandBuffer& _cmd) {
+			// a move per pass, the retired image is released by finishRelocation()
+			if (mRetiredImage)
+				return false;
+
+			const auto& device = mAllocator->getDevice()->getVkHandle();
+
+			auto createInfo = mCreateInfo;
+			createInfo.initialLayout = vk::ImageLayout::eUndefined;
+			const vk::Image newImage = device.createImage(createInfo);
+
+			const MemoryBlock newMemory = mAllocator->allocate(newImage, mMemoryProperty, nullptr, mTiling);
+			if (!newMemory.memory) {
+				device.destroyImage(newImage);
+				return false;
+			}
+
+			vk::ImageAspectFlags aspect;
+			if (HasDepth(mFormat) || HasStencil(mFormat)) {
+				if (HasDepth(mFormat))
+					aspect |= vk::ImageAspectFlagBits::eDepth;
+				if (HasStencil(mFormat))
+					aspect |= vk::ImageAspectFlagBits::eStencil;
+			}
+			else
+				aspect = vk::ImageAspectFlagBits::eColor;
+
+			const vk::ImageSubresourceRange range(aspect, 0, mMipLevels, 0, mArrayLevels);
+
+			TransferVkImageLayout(_cmd, mImage, mRelocationLayout, vk::ImageLayout::eTransferSrcOptimal, range);
+			TransferVkImageLayout(_cmd, newImage, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, range);
+
+			std::vector<vk::ImageCopy> regions;
+			regions.reserve(mMipLevels);
+			for (uint32_t level = 0; level < mMipLevels; ++level) {
+				const vk::ImageSubresourceLayers layers(aspect, level, 0, mArrayLevels);
+				const vk::Extent3D extent(std::max(mExtent.width >> level, 1u),
+										  std::max(mExtent.height >> level, 1u),
+										  std::max(mExtent.depth >> level, 1u));
+				regions.emplace_back(layers, vk::Offset3D(), layers, vk::Offset3D(), extent);
+			}
+
+			_cmd.copyImage(mImage, vk::ImageLayout::eTransferSrcOptimal,
+						   newImage, vk::ImageLayout::eTransferDstOptimal,
+						   regions);
+
+			TransferVkImageLayout(_cmd, newImage, vk::ImageLayout::eTransferDstOptimal, mRelocationLayout, range);
+
+			mRetiredImage = mImage;
+			mRetiredMemory = mMemory;
+			mImage = newImage;
+			mMemory = newMemory;
+			mAllocator->setOwner(mMemory, this);
+			return true;
+		}
+
+		void Image::finishRelocation() {
+			mAllocator->getDevice()->getVkHandle().destroyImage(mRetiredImage);
+			mAllocator->deallocate(mRetiredMemory);
+			mRetiredImage = nullptr;
+			mRetiredMemory = MemoryBlock();
+
+			if (mOnRelocated)
+				mOnRelocated(*this);
+		}
+
 		vk::Image Image::CreateVkImage(const vk::Device& _device,
 									   const vk::ImageType _type,
 									   const vk::Extent3D& _extent,
@@ -330,19 +449,16 @@ namespace Mix {
 			return std::find(stencilFormats.begin(), stencilFormats.end(), _format) != std::end(stencilFormats);
 		}
 
-		std::shared_ptr<Image> Image::CreateDepthStencil(const std::shared_ptr<DeviceAllocator>& _allocator,
-														 const vk::Extent2D& _extent,
-														 const vk::SampleCountFlagBits _sampleCount) {
+		vk::Format Image::ChooseDepthStencilFormat(const PhysicalDevice& _physicalDevice) {
 			static vk::Format candidates[] = {
 				vk::Format::eD32SfloatS8Uint,
 				vk::Format::eD24UnormS8Uint,
 				vk::Format::eD16UnormS8Uint
 			};
-			auto device = _allocator->getDevice();
 
 			vk::Format format;
 			for (auto candidate : candidates) {
-				if (device->getPhysicalDevice()->checkFormatFeatureSupport(candidate,
+				if (_physicalDevice.checkFormatFeatureSupport(candidate,
 					vk::ImageTiling::eOptimal,
 					vk::FormatFeatureFlagBits::
 					eDepthStencilAttachment)) {
@@ -351,12 +467,17 @@ namespace Mix {
 					break;
 				}
 			}
+			return format;
+		}
 
+		std::shared_ptr<Image> Image::CreateDepthStencil(const std::shared_ptr<DeviceAllocator>& _allocator,
+														 const vk::Extent2D& _extent,
+														 const vk::SampleCountFlagBits _sampleCount) {
 			return std::make_shared<Image>(_allocator,
 										   vk::ImageType::e2D,
 										   vk::MemoryPropertyFlagBits::eDeviceLocal,
 										   vk::Extent3D(_extent, 1),
-										   format,
+										   ChooseDepthStencilFormat(*_allocator->getDevice()->getPhysicalDevice()),
 										   vk::ImageUsageFlagBits::eDepthStencilAttachment);
 		}
 
@@ -3,12 +3,13 @@
 #define MX_VK_IMAGE_H_
 
 #include <gli/gli.hpp>
+#include <functional>
 #include "../Memory/MxVkAllocator.h"
 
 namespace Mix {
 	namespace Vulkan {
 		class CommandBufferHandle;
-		class Image : GeneralBase::NoCopyBase {
+		class Image : GeneralBase::NoCopyBase, public AllocationOwner {
 		public:
 			Image(std::shared_ptr<DeviceAllocator> _allocator,
 				  const vk::ImageType _type,
@@ -37,6 +38,9 @@ namespace Mix {
 			~Image();
 
 
+			/** @brief First depth stencil format usable as attachment, the format of CreateDepthStencil() */
+			static vk::Format ChooseDepthStencilFormat(const PhysicalDevice& _physicalDevice);
+
 			static std::shared_ptr<Image> CreateDepthStencil(const std::shared_ptr<DeviceAllocator>& _allocator,
 															 const vk::Extent2D& _extent,
 															 const vk::SampleCountFlagBits _sampleCount);
@@ -123,6 +127,27 @@ namespace Mix {
 
 			char* rawPtr() { return reinterpret_cast<char*>(mMemory.ptr); }
 
+			/**
+			 * @brief Allow the allocator to move this image during defragmentation.
+			 * @param _layout The layout all subresources are in between frames
+			 * @param _onRelocated Called after vk::Image has changed, views of the old image must be recreated here
+			 * @note The image must be created with eTransferSrc | eTransferDst usage
+			 */
+			void setRelocatable(const vk::ImageLayout _layout, std::function<void(Image&)> _onRelocated);
+
+			bool isRelocatable() const { return mRelocatable; }
+
+			/**
+			 * @brief Set by UploadManager once the first upload has handed the image to the graphics queue family.
+			 */
+			bool isGraphicsOwned() const { return mGraphicsOwned; }
+
+			void setGraphicsOwned() { mGraphicsOwned = true; }
+
+			bool recordRelocation(const vk::CommandBuffer& _cmd) override;
+
+			void finishRelocation() override;
+
 		private:
 			std::shared_ptr<DeviceAllocator> mAllocator;
 
@@ -138,6 +163,17 @@ namespace Mix {
 			uint32_t mArrayLevels;
 			vk::ImageLayout mLayout;
 			vk::ImageTiling mTiling;
+
+			vk::ImageCreateInfo mCreateInfo;
+			vk::MemoryPropertyFlags mMemoryProperty;
+
+			bool mRelocatable = false;
+			vk::ImageLayout mRelocationLayout = vk::ImageLayout::eUndefined;
+			std::function<void(Image&)> mOnRelocated;
+			vk::Image mRetiredImage;
+			MemoryBlock mRetiredMemory;
+
+			bool mGraphicsOwned = false;
 		};
 	}
 }
@@ -0,0 +1,322 @@
+#include "MxVkMipmapGenerator.h"
+#include "MxVkImage.h"
+#include "../Descriptor/MxVkDescriptorSet.h"
+#include "../Pipeline/MxVkShaderModule.h"
+#include "../../Resource/MxResourceLoader.h"
+#include "../../Resource/Shader/MxShaderSource.h"
+#include "../../Log/MxLog.h"
+#include <algorithm>
+
+namespace Mix {
+	namespace Vulkan {
+		namespace {
+			// views and descriptor sets of one compute pass, released once the frame has completed
+			struct ComputeResources {
+				std::shared_ptr<Device> device;
+				std::vector<vk::ImageView> views;
+				std::unique_ptr<DescriptorPool> pool;
+				std::vector<DescriptorSet> sets;
+
+				~ComputeResources() {
+					sets.clear();
+					pool.reset();
+					for (auto& view : views)
+						device->getVkHandle().destroyImageView(view);
+				}
+			};
+
+			vk::ImageMemoryBarrier LevelBarrier(const Image& _image,
+												uint32_t _baseLevel,
+												uint32_t _levelCount,
+												vk::ImageLayout _oldLayout,
+												vk::ImageLayout _newLayout,
+												vk::AccessFlags _srcAccess,
+												vk::AccessFlags _dstAccess) {
+				vk::ImageMemoryBarrier barrier;
+				barrier.image = _image.get();
+				barrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, _baseLevel, _levelCount, 0, _image.arrayLevels());
+				barrier.oldLayout = _oldLayout;
+				barrier.newLayout = _newLayout;
+				barrier.srcAccessMask = _srcAccess;
+				barrier.dstAccessMask = _dstAccess;
+				barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				return barrier;
+			}
+
+			int32_t LevelSize(uint32_t _size, uint32_t _level) {
+				return static_cast<int32_t>(std::max(_size >> _level, 1u));
+			}
+		}
+
+		MipmapGenerator::MipmapGenerator(const std::shared_ptr<Device>& _device, UploadManager& _uploader)
+			:mDevice(_device), mUploader(_uploader) {
+		}
+
+		MipmapGenerator::~MipmapGenerator() {
+			if (mPipeline)
+				mDevice->getVkHandle().destroyPipeline(mPipeline);
+			if (mPipelineLayout)
+				mDevice->getVkHandle().destroyPipelineLayout(mPipelineLayout);
+		}
+
+		void MipmapGenerator::add(const std::shared_ptr<Image>& _image) {
+			if (_image->mipLevels() == 1)
+				return;
+
+			const auto batch = mUploader.currentBatch();
+			auto& images = mPending[batch];
+
+			// one command per batch generates the mips of every image added to it
+			if (images.empty()) {
+				mUploader.addGraphicsCommand([this, batch](const vk::CommandBuffer& _cmd) {
+					auto it = mPending.find(batch);
+					if (it == mPending.end())
+						return;
+					record(_cmd, it->second);
+					mPending.erase(it);
+				});
+			}
+
+			if (std::find(images.begin(), images.end(), _image) == images.end())
+				images.push_back(_image);
+		}
+
+		void MipmapGenerator::record(const vk::CommandBuffer& _cmd, ArrayProxy<const std::shared_ptr<Image>> _images) {
+			std::vector<Image*> blits, computes;
+
+			for (auto& image : _images) {
+				if (image->mipLevels() == 1)
+					continue;
+
+				const auto format = image->format();
+				if (requiresStorage(format))
+					computes.push_back(image.get());
+				else if (mMethod != Method::Compute && isBlitSupported(format))
+					blits.push_back(image.get());
+				else
+					Log::Warning("Mipmaps of format %1% can not be generated", vk::to_string(format));
+			}
+
+			if (!blits.empty())
+				recordBlit(_cmd, blits);
+
+			if (!computes.empty())
+				recordCompute(_cmd, computes);
+		}
+
+		bool MipmapGenerator::requiresStorage(vk::Format _format) const {
+			const bool compute = mMethod == Method::Compute || (mMethod == Method::Auto && !isBlitSupported(_format));
+			return compute && isComputeSupported(_format);
+		}
+
+		bool MipmapGenerator::isBlitSupported(vk::Format _format) const {
+			return mDevice->getPhysicalDevice()->checkFormatFeatureSupport(_format, vk::ImageTiling::eOptimal,
+																		   vk::FormatFeatureFlagBits::eBlitSrc |
+																		   vk::FormatFeatureFlagBits::eBlitDst |
+																		   vk::FormatFeatureFlagBits::eSampledImageFilterLinear);
+		}
+
+		bool MipmapGenerator::isComputeSupported(vk::Format _format) const {
+			// the downsampler declares its images as rgba8
+			return _format == vk::Format::eR8G8B8A8Unorm &&
+				mDevice->getPhysicalDevice()->checkFormatFeatureSupport(_format, vk::ImageTiling::eOptimal,
+																		vk::FormatFeatureFlagBits::eStorageImage);
+		}
+
+		void MipmapGenerator::recordBlit(const vk::CommandBuffer& _cmd, const std::vector<Image*>& _images) const {
+			std::vector<vk::ImageMemoryBarrier> barriers;
+			uint32_t maxLevels = 0;
+
+			// level 0 is the source of level 1, all other levels are blit destinations
+			for (auto image : _images) {
+				barriers.push_back(LevelBarrier(*image, 0, 1,
+												vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferSrcOptimal,
+												vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferRead));
+				barriers.push_back(LevelBarrier(*image, 1, image->mipLevels() - 1,
+												vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferDstOptimal,
+												vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferWrite));
+				maxLevels = std::max(maxLevels, image->mipLevels());
+			}
+
+			_cmd.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eTransfer,
+								 vk::PipelineStageFlagBits::eTransfer,
+								 vk::DependencyFlags(),
+								 nullptr, nullptr, barriers);
+
+			for (uint32_t level = 1; level < maxLevels; ++level) {
+				barriers.clear();
+
+				for (auto image : _images) {
+					if (level >= image->mipLevels())
+						continue;
+
+					const auto& extent = image->extent();
+
+					vk::ImageBlit blit;
+					blit.srcOffsets[1] = vk::Offset3D(LevelSize(extent.width, level - 1), LevelSize(extent.height, level - 1), 1);
+					blit.srcSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level - 1, 0, image->arrayLevels());
+					blit.dstOffsets[1] = vk::Offset3D(LevelSize(extent.width, level), LevelSize(extent.height, level), 1);
+					blit.dstSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level, 0, image->arrayLevels());
+
+					_cmd.blitImage(image->get(), vk::ImageLayout::eTransferSrcOptimal,
+								   image->get(), vk::ImageLayout::eTransferDstOptimal,
+								   blit, vk::Filter::eLinear);
+
+					// the written level becomes the next source, the previous source is done
+					barriers.push_back(LevelBarrier(*image, level, 1,
+													vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eTransferSrcOptimal,
+													vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferRead));
+					barriers.push_back(LevelBarrier(*image, level - 1, 1,
+													vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+													vk::AccessFlagBits::eTransferRead, vk::AccessFlagBits::eShaderRead));
+				}
+
+				_cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+									 vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eFragmentShader,
+									 vk::DependencyFlags(),
+									 nullptr, nullptr, barriers);
+			}
+
+			barriers.clear();
+			for (auto image : _images) {
+				barriers.push_back(LevelBarrier(*image, image->mipLevels() - 1, 1,
+												vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+												vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead));
+			}
+
+			_cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+								 vk::PipelineStageFlagBits::eFragmentShader,
+								 vk::DependencyFlags(),
+								 nullptr, nullptr, barriers);
+		}
+
+		void MipmapGenerator::recordCompute(const vk::CommandBuffer& _cmd, const std::vector<Image*>& _images) {
+			if (!mPipeline)
+				createComputePipeline();
+
+			const auto& device = mDevice->getVkHandle();
+			auto resources = std::make_shared<ComputeResources>();
+			resources->device = mDevice;
+
+			// one view per level, one set per generated level
+			uint32_t setCount = 0;
+			uint32_t maxLevels = 0;
+			std::vector<uint32_t> firstView(_images.size());
+
+			for (size_t i = 0; i < _images.size(); ++i) {
+				auto image = _images[i];
+				firstView[i] = static_cast<uint32_t>(resources->views.size());
+
+				vk::ImageViewCreateInfo viewInfo;
+				viewInfo.image = image->get();
+				viewInfo.viewType = vk::ImageViewType::e2DArray;
+				viewInfo.format = image->format();
+				for (uint32_t level = 0; level < image->mipLevels(); ++level) {
+					viewInfo.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, level, 1, 0, image->arrayLevels());
+					resources->views.push_back(device.createImageView(viewInfo));
+				}
+
+				setCount += image->mipLevels() - 1;
+				maxLevels = std::max(maxLevels, image->mipLevels());
+			}
+
+			resources->pool = std::make_unique<DescriptorPool>(mDevice);
+			resources->pool->addPoolSize(vk::DescriptorType::eStorageImage, setCount * 2);
+			resources->pool->create(setCount);
+			resources->sets = resources->pool->allocDescriptorSet(*mSetLayout, setCount);
+
+			// sets are ordered by image, then by destination level
+			std::vector<uint32_t> firstSet(_images.size());
+			uint32_t set = 0;
+			for (size_t i = 0; i < _images.size(); ++i) {
+				firstSet[i] = set;
+				for (uint32_t level = 1; level < _images[i]->mipLevels(); ++level, ++set) {
+					vk::WriteDescriptorSet src{ nullptr, 0, 0, 1, vk::DescriptorType::eStorageImage };
+					vk::WriteDescriptorSet dst{ nullptr, 1, 0, 1, vk::DescriptorType::eStorageImage };
+
+					std::vector<WriteDescriptorSet> writes{
+						WriteDescriptorSet(src, vk::DescriptorImageInfo(nullptr, resources->views[firstView[i] + level - 1], vk::ImageLayout::eGeneral)),
+						WriteDescriptorSet(dst, vk::DescriptorImageInfo(nullptr, resources->views[firstView[i] + level], vk::ImageLayout::eGeneral))
+					};
+					resources->sets[set].updateDescriptor(writes);
+				}
+			}
+
+			std::vector<vk::ImageMemoryBarrier> barriers;
+			for (auto image : _images) {
+				barriers.push_back(LevelBarrier(*image, 0, image->mipLevels(),
+												vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eGeneral,
+												vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eTransferWrite,
+												vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite));
+			}
+
+			_cmd.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eTransfer,
+								 vk::PipelineStageFlagBits::eComputeShader,
+								 vk::DependencyFlags(),
+								 nullptr, nullptr, barriers);
+
+			_cmd.bindPipeline(vk::PipelineBindPoint::eCompute, mPipeline);
+
+			vk::MemoryBarrier levelBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead);
+
+			// every image of a level is dispatched before the single barrier of the level
+			for (uint32_t level = 1; level < maxLevels; ++level) {
+				for (size_t i = 0; i < _images.size(); ++i) {
+					auto image = _images[i];
+					if (level >= image->mipLevels())
+						continue;
+
+					_cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, mPipelineLayout, 0,
+											resources->sets[firstSet[i] + level - 1].get(), nullptr);
+
+					const auto& extent = image->extent();
+					_cmd.dispatch((LevelSize(extent.width, level) + 7) / 8,
+								  (LevelSize(extent.height, level) + 7) / 8,
+								  image->arrayLevels());
+				}
+
+				_cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+									 vk::PipelineStageFlagBits::eComputeShader,
+									 vk::DependencyFlags(),
+									 levelBarrier, nullptr, nullptr);
+			}
+
+			barriers.clear();
+			for (auto image : _images) {
+				barriers.push_back(LevelBarrier(*image, 0, image->mipLevels(),
+												vk::ImageLayout::eGeneral, vk::ImageLayout::eShaderReadOnlyOptimal,
+												vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead));
+			}
+
+			_cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+								 vk::PipelineStageFlagBits::eFragmentShader,
+								 vk::DependencyFlags(),
+								 nullptr, nullptr, barriers);
+
+			mUploader.deferRelease(std::move(resources));
+		}
+
+		void MipmapGenerator::createComputePipeline() {
+			mSetLayout = std::make_shared<DescriptorSetLayout>(mDevice);
+			mSetLayout->setBindings({
+				{ 0, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute },
+				{ 1, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute }
+			});
+			mSetLayout->create();
+
+			vk::PipelineLayoutCreateInfo layoutInfo;
+			layoutInfo.setLayoutCount = 1;
+			layoutInfo.pSetLayouts = &mSetLayout->get();
+			mPipelineLayout = mDevice->getVkHandle().createPipelineLayout(layoutInfo);
+
+			auto source = ResourceLoader::Get()->load<ShaderSource>("Resource/Shaders/GenMipmap.comp");
+			ShaderModule shader(mDevice, *source);
+
+			vk::ComputePipelineCreateInfo pipelineInfo;
+			pipelineInfo.stage = vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eCompute, shader.get(), "main");
+			pipelineInfo.layout = mPipelineLayout;
+			mPipeline = mDevice->getVkHandle().createComputePipeline(nullptr, pipelineInfo);
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+#ifndef MX_VK_MIPMAP_GENERATOR_H_
+#define MX_VK_MIPMAP_GENERATOR_H_
+
+#include "../Buffers/MxVkUploadManager.h"
+#include "../../Utils/MxArrayProxy.h"
+#include <unordered_map>
+
+namespace Mix {
+	namespace Vulkan {
+		class Image;
+		class DescriptorSetLayout;
+
+		/**
+		 * @brief Generates the mip chains of all images queued during one upload batch with a single pass
+		 *        recorded on the graphics queue. Barriers of all images are batched per mip level.
+		 */
+		class MipmapGenerator :public GeneralBase::NoCopyBase {
+		public:
+			enum class Method {
+				// blit when the format supports linear blits, compute otherwise
+				Auto,
+				Blit,
+				Compute
+			};
+
+			MipmapGenerator(const std::shared_ptr<Device>& _device, UploadManager& _uploader);
+
+			~MipmapGenerator();
+
+			/**
+			 * @brief Generate every mip level and layer of @p _image from level 0 once the current upload batch is usable.
+			 *        All levels have to be in eShaderReadOnlyOptimal, they are left in that layout.
+			 */
+			void add(const std::shared_ptr<Image>& _image);
+
+			/**
+			 * @brief Record the generation of all @p _images into @p _cmd, which must be outside of a render pass.
+			 */
+			void record(const vk::CommandBuffer& _cmd, ArrayProxy<const std::shared_ptr<Image>> _images);
+
+			void setMethod(const Method _method) { mMethod = _method; }
+
+			Method getMethod() const { return mMethod; }
+
+			/** @brief Images of this format need eStorage usage because they are downsampled by compute */
+			bool requiresStorage(vk::Format _format) const;
+
+			bool isBlitSupported(vk::Format _format) const;
+
+			bool isComputeSupported(vk::Format _format) const;
+
+		private:
+			void recordBlit(const vk::CommandBuffer& _cmd, const std::vector<Image*>& _images) const;
+
+			void recordCompute(const vk::CommandBuffer& _cmd, const std::vector<Image*>& _images);
+
+			void createComputePipeline();
+
+			std::shared_ptr<Device> mDevice;
+			UploadManager& mUploader;
+			Method mMethod = Method::Auto;
+
+			std::unordered_map<UploadManager::BatchId, std::vector<std::shared_ptr<Image>>> mPending;
+
+			std::shared_ptr<DescriptorSetLayout> mSetLayout;
+			vk::PipelineLayout mPipelineLayout;
+			vk::Pipeline mPipeline;
+		};
+	}
+}
+
+#endif // !MX_VK_MIPMAP_GENERATOR_H_
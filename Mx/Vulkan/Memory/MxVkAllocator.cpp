@@ -1,15 +1,22 @@
 #include "MxVkAllocator.h"
 #include "../../Log/MxLog.h"
+#include "../CommandBuffer/MxVkCommanddBufferHandle.h"
+#include <algorithm>
 
 namespace Mix {
     namespace Vulkan {
         Chunk::Chunk(const std::shared_ptr<Device>& _device,
                      const vk::DeviceSize& _size,
-                     const uint32_t _memoryTypeIndex)
+                     const uint32_t _memoryTypeIndex,
+                     const ResourceClass _resourceClass,
+                     const vk::MemoryDedicatedAllocateInfo* _dedicatedInfo)
             :mDevice(_device),
             mSize(_size),
-            mMemTypeIndex(_memoryTypeIndex) {
-            const vk::MemoryAllocateInfo allocInfo(_size, _memoryTypeIndex);
+            mMemTypeIndex(_memoryTypeIndex),
+            mResourceClass(_resourceClass),
+            mDedicated(_dedicatedInfo != nullptr) {
+            vk::MemoryAllocateInfo allocInfo(_size, _memoryTypeIndex);
+            allocInfo.pNext = _dedicatedInfo;
 
             MemoryBlock block;
             block.free = true;
@@ -33,8 +40,11 @@ namespace Mix {
             mMem = _chunk.mMem;
             mSize = _chunk.mSize;
             mMemTypeIndex = _chunk.mMemTypeIndex;
+            mResourceClass = _chunk.mResourceClass;
+            mDedicated = _chunk.mDedicated;
             mBlocks = std::move(_chunk.mBlocks);
             mPtr = _chunk.mPtr;
+            mEvacuating = _chunk.mEvacuating;
 
             _chunk.mMem = nullptr;
 
@@ -49,65 +59,163 @@ namespace Mix {
         bool Chunk::allocate(const vk::DeviceSize& _size,
                              const vk::DeviceSize& _alignment,
                              MemoryBlock& _block) {
-            if (_size > mSize)
+            if (_size > mSize || mEvacuating)
+                return false;
+
+            if (mDedicated && !empty())
                 return false;
 
             for (size_t i = 0; i < mBlocks.size(); ++i) {
                 // if block is unused
-                if (mBlocks[i].free && mBlocks[i].size >= _size) {
-                    // compute new size
-                    vk::DeviceSize newSize = mBlocks[i].size;
-
-                    // compute new size after being aligned
-                    if (mBlocks[i].offset % _alignment != 0)
-                        newSize -= (_alignment - mBlocks[i].offset % _alignment);
-
-                    // if block is suitable
-                    if (newSize >= _size) {
-                        mBlocks[i].size = newSize;
-                        if (mBlocks[i].offset % _alignment != 0)
-                            mBlocks[i].offset += (_alignment - mBlocks[i].offset % _alignment);
-
-                        // compute offset for ptr
-                        if (mPtr)
-                            mBlocks[i].ptr = static_cast<char*>(mPtr) + mBlocks[i].offset;
-
-                        // if block is perfect match
-                        if (mBlocks[i].size == _size) {
-                            mBlocks[i].free = false;
-                            _block = mBlocks[i];
-                            return true;
-                        }
-
-                        // if there are space left
-                        MemoryBlock nextBlock;
-                        nextBlock.free = true;
-                        nextBlock.offset = mBlocks[i].offset + _size;
-                        nextBlock.memory = mMem;
-                        nextBlock.size = mBlocks[i].size - _size;
-                        mBlocks.emplace_back(nextBlock);
-
-                        mBlocks[i].size = _size;
-                        mBlocks[i].free = false;
-
-                        _block = mBlocks[i];
-                        return true;
-                    }
+                if (!mBlocks[i].free || mBlocks[i].size < _size)
+                    continue;
+
+                // compute the padding needed to align the block
+                const vk::DeviceSize alignedOffset = Math::Align(mBlocks[i].offset, _alignment);
+                const vk::DeviceSize padding = alignedOffset - mBlocks[i].offset;
+
+                // if block is suitable
+                if (mBlocks[i].size < padding + _size)
+                    continue;
+
+                const vk::DeviceSize remain = mBlocks[i].size - padding - _size;
+
+                MemoryBlock block;
+                block.memory = mMem;
+                block.offset = alignedOffset;
+                block.size = _size;
+                block.free = false;
+
+                // compute offset for ptr
+                if (mPtr)
+                    block.ptr = static_cast<char*>(mPtr) + alignedOffset;
+
+                // keep the padding as a free block so it can be merged back later
+                auto it = mBlocks.begin() + i;
+                if (padding != 0) {
+                    it->size = padding;
+                    it = mBlocks.insert(it + 1, block);
                 }
+                else
+                    *it = block;
+
+                // if there are space left
+                if (remain != 0) {
+                    MemoryBlock nextBlock;
+                    nextBlock.free = true;
+                    nextBlock.offset = alignedOffset + _size;
+                    nextBlock.memory = mMem;
+                    nextBlock.size = remain;
+                    mBlocks.insert(it + 1, nextBlock);
+                }
+
+                _block = block;
+                return true;
             }
             return false;
         }
 
         void Chunk::deallocate(const MemoryBlock& _block) {
-            const auto it = std::find(mBlocks.begin(), mBlocks.end(), _block);
+            const auto it = std::find_if(mBlocks.begin(), mBlocks.end(), [&_block](const MemoryBlock& _b) {
+                return !_b.free && _b.offset == _block.offset;
+            });
             assert(it != mBlocks.end());
-            it->free = true;
+
+            size_t index = it - mBlocks.begin();
+            mBlocks[index].free = true;
+            mBlocks[index].ptr = nullptr;
+            mBlocks[index].owner = nullptr;
+
+            // merge with adjacent free blocks
+            if (index + 1 < mBlocks.size() && mBlocks[index + 1].free) {
+                mBlocks[index].size += mBlocks[index + 1].size;
+                mBlocks.erase(mBlocks.begin() + index + 1);
+            }
+            if (index > 0 && mBlocks[index - 1].free) {
+                mBlocks[index - 1].size += mBlocks[index].size;
+                mBlocks.erase(mBlocks.begin() + index);
+            }
         }
 
-        std::unique_ptr<Chunk> ChunkFactory::getChunk(vk::DeviceSize _size, uint32_t _memTypeIndex) {
-            _size = (mMinChunkSize < _size) ? Math::NextPowerOf2(_size) : mMinChunkSize;
+        void Chunk::setOwner(const MemoryBlock& _block, AllocationOwner* _owner) {
+            const auto it = std::find_if(mBlocks.begin(), mBlocks.end(), [&_block](const MemoryBlock& _b) {
+                return !_b.free && _b.offset == _block.offset;
+            });
+            assert(it != mBlocks.end());
+            it->owner = _owner;
+        }
+
+        vk::DeviceSize Chunk::usedSize() const {
+            vk::DeviceSize used = 0;
+            for (auto& block : mBlocks) {
+                if (!block.free)
+                    used += block.size;
+            }
+            return used;
+        }
+
+        vk::DeviceSize Chunk::largestFreeBlock() const {
+            vk::DeviceSize largest = 0;
+            for (auto& block : mBlocks) {
+                if (block.free)
+                    largest = std::max(largest, block.size);
+            }
+            return largest;
+        }
+
+        uint32_t Chunk::allocationCount() const {
+            return static_cast<uint32_t>(std::count_if(mBlocks.begin(), mBlocks.end(), [](const MemoryBlock& _b) {
+                return !_b.free;
+            }));
+        }
+
+        bool Chunk::isRelocatable() const {
+            return std::all_of(mBlocks.begin(), mBlocks.end(), [](const MemoryBlock& _b) {
+                return _b.free || _b.owner;
+            });
+        }
+
+        std::vector<MemoryBlock> Chunk::getAllocations() const {
+            std::vector<MemoryBlock> allocations;
+            for (auto& block : mBlocks) {
+                if (!block.free)
+                    allocations.push_back(block);
+            }
+            return allocations;
+        }
+
+        ChunkFactory::ChunkFactory(const std::shared_ptr<Device>& _device) :mDevice(_device) {
+            // small heaps (e.g. host visible device local memory) get proportionally smaller chunks
+            const auto& memProps = mDevice->getPhysicalDevice()->getMemoryProperties();
+            for (uint32_t i = 0; i < memProps.memoryTypeCount; ++i) {
+                const vk::DeviceSize heapSize = memProps.memoryHeaps[memProps.memoryTypes[i].heapIndex].size;
+                if (heapSize / 8 < mDefaultPolicy.chunkSize) {
+                    ChunkSizePolicy policy;
+                    policy.chunkSize = heapSize / 8;
+                    policy.dedicatedThreshold = policy.chunkSize / 2;
+                    mPolicies[i] = policy;
+                }
+            }
+        }
+
+        const ChunkSizePolicy& ChunkFactory::getPolicy(uint32_t _memTypeIndex) const {
+            const auto it = mPolicies.find(_memTypeIndex);
+            return it != mPolicies.end() ? it->second : mDefaultPolicy;
+        }
+
+        std::unique_ptr<Chunk> ChunkFactory::getChunk(vk::DeviceSize _size, uint32_t _memTypeIndex, ResourceClass _resourceClass) {
+            // oversized requests get a chunk that fits them instead of the next power of 2
+            static const vk::DeviceSize Granularity = 64 * 1024;
+            _size = std::max(getPolicy(_memTypeIndex).chunkSize, Math::Align(_size, Granularity));
+
+            return std::make_unique<Chunk>(mDevice, _size, _memTypeIndex, _resourceClass);
+        }
 
-            return std::make_unique<Chunk>(mDevice, _size, _memTypeIndex);
+        std::unique_ptr<Chunk> ChunkFactory::getDedicatedChunk(vk::DeviceSize _size,
+                                                               uint32_t _memTypeIndex,
+                                                               ResourceClass _resourceClass,
+                                                               const vk::MemoryDedicatedAllocateInfo& _dedicatedInfo) {
+            return std::make_unique<Chunk>(mDevice, _size, _memTypeIndex, _resourceClass, &_dedicatedInfo);
         }
 
         void DeviceAllocator::swap(DeviceAllocator& _other) noexcept {
@@ -115,35 +223,37 @@ namespace Mix {
             swap(mDevice, _other.mDevice);
             swap(mChunkFactory, _other.mChunkFactory);
             swap(mChunks, _other.mChunks);
+            swap(mAllowGrowth, _other.mAllowGrowth);
         }
 
         MemoryBlock DeviceAllocator::allocate(const vk::DeviceSize& _size, const vk::DeviceSize& _alignment,
                                               const uint32_t _memoryTypeIndex) {
-            MemoryBlock block;
-            // search for a suitable chunk
-            uint32_t chunkId = 0;
-            for (auto& chunk : mChunks) {
-                if (chunk->memoryTypeIndex() == _memoryTypeIndex) {
-                    if (chunk->allocate(_size, _alignment, block)) {
-                        return block;
-                    }
-                }
-            }
+            return allocateFromChunks(_size, _alignment, _memoryTypeIndex, ResourceClass::Linear);
+        }
 
-            // no suitable chunk exist, create one
-            mChunks.emplace_back(mChunkFactory.getChunk(_size, _memoryTypeIndex));
-            assert(mChunks.back()->allocate(_size, _alignment, block));
-            return block;
+        MemoryBlock DeviceAllocator::allocate(const vk::DeviceSize& _size, const vk::DeviceSize& _alignment,
+                                              const uint32_t _memoryTypeIndex, const ResourceClass _resourceClass) {
+            return allocateFromChunks(_size, _alignment, _memoryTypeIndex, _resourceClass);
         }
 
         MemoryBlock DeviceAllocator::allocate(const vk::Image& _image,
                                               const vk::MemoryPropertyFlags& _properties,
-                                              vk::MemoryRequirements* _memReq) {
-            auto memoryReq = mDevice->getVkHandle().getImageMemoryRequirements(_image);
-            const MemoryBlock block = allocate(memoryReq.size, memoryReq.alignment,
-                                               mDevice->getPhysicalDevice()->getMemoryTypeIndex(memoryReq.memoryTypeBits, _properties));
+                                              vk::MemoryRequirements* _memReq,
+                                              const vk::ImageTiling _tiling) {
+            const auto& device = mDevice->getVkHandle();
+            auto reqChain = device.getImageMemoryRequirements2<vk::MemoryRequirements2, vk::MemoryDedicatedRequirements>(vk::ImageMemoryRequirementsInfo2(_image));
+            const auto& memoryReq = reqChain.get<vk::MemoryRequirements2>().memoryRequirements;
+            const auto& dedicatedReq = reqChain.get<vk::MemoryDedicatedRequirements>();
 
-            mDevice->getVkHandle().bindImageMemory(_image, block.memory, block.offset);
+            const uint32_t memoryTypeIndex = mDevice->getPhysicalDevice()->getMemoryTypeIndex(memoryReq.memoryTypeBits, _properties);
+            const ResourceClass resourceClass = _tiling == vk::ImageTiling::eOptimal ? ResourceClass::Optimal : ResourceClass::Linear;
+
+            const MemoryBlock block = useDedicated(memoryReq, dedicatedReq, memoryTypeIndex) ?
+                allocateDedicated(memoryReq, memoryTypeIndex, resourceClass, vk::MemoryDedicatedAllocateInfo(_image, nullptr)) :
+                allocateFromChunks(memoryReq.size, memoryReq.alignment, memoryTypeIndex, resourceClass);
+
+            if (block.memory)
+                device.bindImageMemory(_image, block.memory, block.offset);
 
             if (_memReq)
                 *_memReq = memoryReq;
@@ -154,10 +264,19 @@ namespace Mix {
         MemoryBlock DeviceAllocator::allocate(const vk::Buffer& _buffer,
                                               const vk::MemoryPropertyFlags& _properties,
                                               vk::MemoryRequirements* _memReq) {
-            auto memoryReq = mDevice->getVkHandle().getBufferMemoryRequirements(_buffer);
-            const MemoryBlock block = allocate(memoryReq.size, memoryReq.alignment,
-                                               mDevice->getPhysicalDevice()->getMemoryTypeIndex(memoryReq.memoryTypeBits, _properties));
-            mDevice->getVkHandle().bindBufferMemory(_buffer, block.memory, block.offset);
+            const auto& device = mDevice->getVkHandle();
+            auto reqChain = device.getBufferMemoryRequirements2<vk::MemoryRequirements2, vk::MemoryDedicatedRequirements>(vk::BufferMemoryRequirementsInfo2(_buffer));
+            const auto& memoryReq = reqChain.get<vk::MemoryRequirements2>().memoryRequirements;
+            const auto& dedicatedReq = reqChain.get<vk::MemoryDedicatedRequirements>();
+
+            const uint32_t memoryTypeIndex = mDevice->getPhysicalDevice()->getMemoryTypeIndex(memoryReq.memoryTypeBits, _properties);
+
+            const MemoryBlock block = useDedicated(memoryReq, dedicatedReq, memoryTypeIndex) ?
+                allocateDedicated(memoryReq, memoryTypeIndex, ResourceClass::Linear, vk::MemoryDedicatedAllocateInfo(nullptr, _buffer)) :
+                allocateFromChunks(memoryReq.size, memoryReq.alignment, memoryTypeIndex, ResourceClass::Linear);
+
+            if (block.memory)
+                device.bindBufferMemory(_buffer, block.memory, block.offset);
 
             if (_memReq)
                 *_memReq = memoryReq;
@@ -165,14 +284,246 @@ namespace Mix {
             return block;
         }
 
+        MemoryBlock DeviceAllocator::allocateFromChunks(const vk::DeviceSize& _size,
+                                                        const vk::DeviceSize& _alignment,
+                                                        const uint32_t _memoryTypeIndex,
+                                                        const ResourceClass _resourceClass) {
+            MemoryBlock block;
+            // search for a suitable chunk
+            for (auto& chunk : mChunks) {
+                if (chunk->memoryTypeIndex() == _memoryTypeIndex &&
+                    chunk->resourceClass() == _resourceClass &&
+                    !chunk->isDedicated()) {
+                    if (chunk->allocate(_size, _alignment, block)) {
+                        return block;
+                    }
+                }
+            }
+
+            if (!canGrow(_size, _memoryTypeIndex))
+                return block;
+
+            // no suitable chunk exist, create one
+            mChunks.emplace_back(mChunkFactory.getChunk(_size, _memoryTypeIndex, _resourceClass));
+            const bool allocated = mChunks.back()->allocate(_size, _alignment, block);
+            assert(allocated && "Error : new chunk is too small");
+            return block;
+        }
+
+        MemoryBlock DeviceAllocator::allocateDedicated(const vk::MemoryRequirements& _memReq,
+                                                       const uint32_t _memoryTypeIndex,
+                                                       const ResourceClass _resourceClass,
+                                                       const vk::MemoryDedicatedAllocateInfo& _dedicatedInfo) {
+            MemoryBlock block;
+            if (!canGrow(_memReq.size, _memoryTypeIndex))
+                return block;
+
+            mChunks.emplace_back(mChunkFactory.getDedicatedChunk(_memReq.size, _memoryTypeIndex, _resourceClass, _dedicatedInfo));
+            const bool allocated = mChunks.back()->allocate(_memReq.size, _memReq.alignment, block);
+            assert(allocated && "Error : dedicated chunk is too small");
+            return block;
+        }
+
+        bool DeviceAllocator::canGrow(const vk::DeviceSize& _size, const uint32_t _memoryTypeIndex) const {
+            // defragmentation must not grow the pool, report failure with an empty block instead
+            if (!mAllowGrowth)
+                return false;
+
+            // the budget is a hint of the driver, exceeding it may still succeed but makes paging likely
+            const auto heapIndex = mDevice->getPhysicalDevice()->getMemoryProperties().memoryTypes[_memoryTypeIndex].heapIndex;
+            const auto budget = getHeapBudgets()[heapIndex];
+            if (budget.usage + _size > budget.budget)
+                Log::Warning("%1%: Allocating %2% bytes exceeds the budget of heap %3%", __FUNCTION__, _size, heapIndex);
+
+            return true;
+        }
+
+        bool DeviceAllocator::useDedicated(const vk::MemoryRequirements& _memReq,
+                                           const vk::MemoryDedicatedRequirements& _dedicatedReq,
+                                           const uint32_t _memoryTypeIndex) const {
+            return _dedicatedReq.requiresDedicatedAllocation ||
+                _dedicatedReq.prefersDedicatedAllocation ||
+                _memReq.size >= mChunkFactory.getPolicy(_memoryTypeIndex).dedicatedThreshold;
+        }
+
         void DeviceAllocator::deallocate(MemoryBlock& _block) {
+            for (auto it = mChunks.begin(); it != mChunks.end(); ++it) {
+                if ((*it)->isIn(_block)) {
+                    (*it)->deallocate(_block);
+
+                    // dedicated memory is returned to the driver right away
+                    if ((*it)->isDedicated())
+                        mChunks.erase(it);
+                    return;
+                }
+            }
+            assert(!"Error : unable to deallocate the block");
+        }
+
+        void DeviceAllocator::setOwner(const MemoryBlock& _block, AllocationOwner* _owner) {
             for (auto& chunk : mChunks) {
                 if (chunk->isIn(_block)) {
-                    chunk->deallocate(_block);
+                    chunk->setOwner(_block, _owner);
                     return;
                 }
             }
-            assert(!"Error : unable to deallocate the block");
+            assert(!"Error : the block does not belong to this allocator");
+        }
+
+        std::vector<MemoryTypeStatistics> DeviceAllocator::getStatistics() const {
+            const auto& memProps = mDevice->getPhysicalDevice()->getMemoryProperties();
+
+            std::vector<MemoryTypeStatistics> statistics;
+            for (uint32_t i = 0; i < memProps.memoryTypeCount; ++i) {
+                MemoryTypeStatistics stats;
+                stats.memoryTypeIndex = i;
+                stats.heapIndex = memProps.memoryTypes[i].heapIndex;
+                stats.propertyFlags = memProps.memoryTypes[i].propertyFlags;
+
+                for (auto& chunk : mChunks) {
+                    if (chunk->memoryTypeIndex() != i)
+                        continue;
+
+                    ++stats.chunkCount;
+                    if (chunk->isDedicated())
+                        ++stats.dedicatedCount;
+                    stats.allocationCount += chunk->allocationCount();
+                    stats.allocatedSize += chunk->size();
+                    stats.usedSize += chunk->usedSize();
+                    stats.largestFreeBlock = std::max(stats.largestFreeBlock, chunk->largestFreeBlock());
+                }
+
+                // only report memory types that are in use
+                if (stats.chunkCount == 0)
+                    continue;
+
+                stats.freeSize = stats.allocatedSize - stats.usedSize;
+                if (stats.freeSize != 0)
+                    stats.fragmentation = 1.0f - static_cast<float>(stats.largestFreeBlock) / static_cast<float>(stats.freeSize);
+
+                statistics.push_back(stats);
+            }
+            return statistics;
+        }
+
+        std::vector<MemoryHeapBudget> DeviceAllocator::getHeapBudgets() const {
+            const auto& physicalDevice = mDevice->getPhysicalDevice();
+            const auto& memProps = physicalDevice->getMemoryProperties();
+
+            std::vector<MemoryHeapBudget> budgets(memProps.memoryHeapCount);
+            for (uint32_t i = 0; i < memProps.memoryHeapCount; ++i) {
+                budgets[i].heapIndex = i;
+                budgets[i].flags = memProps.memoryHeaps[i].flags;
+                budgets[i].heapSize = memProps.memoryHeaps[i].size;
+            }
+
+            for (auto& chunk : mChunks)
+                budgets[memProps.memoryTypes[chunk->memoryTypeIndex()].heapIndex].allocatedSize += chunk->size();
+
+            if (mDevice->isExtensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+                auto chain = physicalDevice->get().getMemoryProperties2<vk::PhysicalDeviceMemoryProperties2,
+                    vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+                const auto& budgetProps = chain.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+
+                for (auto& budget : budgets) {
+                    budget.budget = budgetProps.heapBudget[budget.heapIndex];
+                    budget.usage = budgetProps.heapUsage[budget.heapIndex];
+                    budget.fromExtension = true;
+                }
+            }
+            else {
+                // without the extension only our own allocations are known,
+                // other processes usually leave about 80% of a heap to the application
+                for (auto& budget : budgets) {
+                    budget.budget = budget.heapSize / 10 * 8;
+                    budget.usage = budget.allocatedSize;
+                }
+            }
+            return budgets;
+        }
+
+        DefragmentationResult DeviceAllocator::defragment(const std::shared_ptr<CommandPool>& _commandPool,
+                                                          const DefragmentationSettings& _settings) {
+            DefragmentationResult result;
+
+            // evacuate the sparsest chunks first
+            std::vector<Chunk*> candidates;
+            for (auto& chunk : mChunks) {
+                if (chunk->empty() || chunk->isDedicated() || !chunk->isRelocatable())
+                    continue;
+
+                const float usage = static_cast<float>(chunk->usedSize()) / static_cast<float>(chunk->size());
+                if (usage < _settings.maxChunkUsage)
+                    candidates.push_back(chunk.get());
+            }
+
+            std::sort(candidates.begin(), candidates.end(), [](const Chunk* _a, const Chunk* _b) {
+                return _a->usedSize() < _b->usedSize();
+            });
+
+            std::vector<AllocationOwner*> movedOwners;
+            std::vector<Chunk*> evacuating;
+
+            // every chunk of the pass is excluded before anything moves, otherwise a block could land in
+            // a chunk evacuated later and be copied twice without a barrier in between
+            vk::DeviceSize selectedBytes = 0;
+            for (auto chunk : candidates) {
+                if (selectedBytes + chunk->usedSize() > _settings.maxBytesPerPass)
+                    break;
+
+                selectedBytes += chunk->usedSize();
+                chunk->setEvacuating(true);
+                evacuating.push_back(chunk);
+            }
+
+            CommandBufferHandle cmd(_commandPool);
+            cmd.begin(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+
+            // moved allocations have to fit into the remaining chunks
+            mAllowGrowth = false;
+
+            for (auto chunk : evacuating) {
+                for (auto& block : chunk->getAllocations()) {
+                    if (block.owner->recordRelocation(cmd.get())) {
+                        movedOwners.push_back(block.owner);
+                        ++result.movedAllocations;
+                        result.movedBytes += block.size;
+                    }
+                }
+            }
+
+            mAllowGrowth = true;
+            cmd.end();
+
+            if (!movedOwners.empty()) {
+                cmd.submit();
+                cmd.wait();
+            }
+
+            for (auto owner : movedOwners)
+                owner->finishRelocation();
+
+            for (auto chunk : evacuating) {
+                if (chunk->empty())
+                    ++result.freedChunks;
+                chunk->setEvacuating(false);
+            }
+
+            result.freedBytes = releaseEmptyChunks();
+            return result;
+        }
+
+        vk::DeviceSize DeviceAllocator::releaseEmptyChunks() {
+            vk::DeviceSize released = 0;
+            for (auto it = mChunks.begin(); it != mChunks.end();) {
+                if ((*it)->empty()) {
+                    released += (*it)->size();
+                    it = mChunks.erase(it);
+                }
+                else
+                    ++it;
+            }
+            return released;
         }
     }
 }
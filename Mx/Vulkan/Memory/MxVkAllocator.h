@@ -4,9 +4,48 @@
 
 #include "../Device/MxVkDevice.h"
 #include "../../Math/MxMath.h"
+#include <unordered_map>
 
 namespace Mix {
     namespace Vulkan {
+        class CommandPool;
+
+        /**
+         * @brief Linear resources (buffers, linear images) and optimal images never share a chunk,
+         *        so bufferImageGranularity never has to be respected between neighbouring blocks.
+         */
+        enum class ResourceClass {
+            Linear,
+            Optimal
+        };
+
+        struct ChunkSizePolicy {
+            // size of the chunks shared by regular allocations
+            vk::DeviceSize chunkSize = 8 * 1024 * 1024;
+
+            // allocations at least this large get their own vk::DeviceMemory
+            vk::DeviceSize dedicatedThreshold = 4 * 1024 * 1024;
+        };
+
+        /**
+         * @brief Implemented by resources whose memory may be moved by DeviceAllocator::defragment().
+         */
+        class AllocationOwner {
+        public:
+            virtual ~AllocationOwner() = default;
+
+            /**
+             * @brief Allocate new memory for the resource and record a copy into it.
+             * @return false if the resource could not be moved, the old memory is kept in that case
+             */
+            virtual bool recordRelocation(const vk::CommandBuffer& _cmd) = 0;
+
+            /**
+             * @brief Called once the copy has completed on the GPU, release the old memory here.
+             */
+            virtual void finishRelocation() = 0;
+        };
+
         struct MemoryBlock {
             vk::DeviceMemory memory = nullptr;
             vk::DeviceSize offset = 0;
@@ -15,6 +54,9 @@ namespace Mix {
             bool free = false;
             void* ptr = nullptr;
 
+            // not part of the block identity
+            AllocationOwner* owner = nullptr;
+
             bool operator==(const MemoryBlock& _block) const {
                 return (memory == _block.memory &&
                         offset == _block.offset &&
@@ -27,11 +69,60 @@ namespace Mix {
             friend class Chunk;
         };
 
+        struct MemoryTypeStatistics {
+            uint32_t memoryTypeIndex = 0;
+            uint32_t heapIndex = 0;
+            vk::MemoryPropertyFlags propertyFlags;
+
+            uint32_t chunkCount = 0;
+            uint32_t dedicatedCount = 0;
+            uint32_t allocationCount = 0;
+
+            vk::DeviceSize allocatedSize = 0;
+            vk::DeviceSize usedSize = 0;
+            vk::DeviceSize freeSize = 0;
+            vk::DeviceSize largestFreeBlock = 0;
+
+            // 0 when all free space is contiguous, close to 1 when it is scattered into small blocks
+            float fragmentation = 0.0f;
+        };
+
+        struct MemoryHeapBudget {
+            uint32_t heapIndex = 0;
+            vk::MemoryHeapFlags flags;
+            vk::DeviceSize heapSize = 0;
+
+            // memory held by this allocator
+            vk::DeviceSize allocatedSize = 0;
+
+            // process wide values when VK_EXT_memory_budget is enabled, estimated otherwise
+            vk::DeviceSize budget = 0;
+            vk::DeviceSize usage = 0;
+            bool fromExtension = false;
+        };
+
+        struct DefragmentationSettings {
+            // chunks used below this ratio are evacuated
+            float maxChunkUsage = 0.25f;
+
+            // upper bound of bytes copied by a single pass
+            vk::DeviceSize maxBytesPerPass = 32 * 1024 * 1024;
+        };
+
+        struct DefragmentationResult {
+            uint32_t movedAllocations = 0;
+            vk::DeviceSize movedBytes = 0;
+            uint32_t freedChunks = 0;
+            vk::DeviceSize freedBytes = 0;
+        };
+
         class Chunk :public GeneralBase::NoCopyBase {
         public:
             Chunk(const std::shared_ptr<Device>& _device,
                   const vk::DeviceSize& _size,
-                  uint32_t _memoryTypeIndex);
+                  uint32_t _memoryTypeIndex,
+                  ResourceClass _resourceClass = ResourceClass::Linear,
+                  const vk::MemoryDedicatedAllocateInfo* _dedicatedInfo = nullptr);
 
             Chunk(Chunk&& _chunk) noexcept;
 
@@ -50,34 +141,72 @@ namespace Mix {
                 return mMemTypeIndex;
             }
 
+            ResourceClass resourceClass() const { return mResourceClass; }
+
+            /** @brief A dedicated chunk holds exactly one resource */
+            bool isDedicated() const { return mDedicated; }
+
+            void setOwner(const MemoryBlock& _block, AllocationOwner* _owner);
+
+            vk::DeviceSize size() const { return mSize; }
+
+            vk::DeviceSize usedSize() const;
+
+            vk::DeviceSize largestFreeBlock() const;
+
+            uint32_t allocationCount() const;
+
+            bool empty() const { return allocationCount() == 0; }
+
+            /** @brief Whether every allocation in this chunk has an owner that can move it */
+            bool isRelocatable() const;
+
+            std::vector<MemoryBlock> getAllocations() const;
+
+            /** @brief An evacuating chunk accepts no new allocations */
+            void setEvacuating(const bool _evacuating) { mEvacuating = _evacuating; }
+
+            bool isEvacuating() const { return mEvacuating; }
+
         private:
             std::shared_ptr<Device> mDevice;
             vk::DeviceMemory mMem = nullptr;
             vk::DeviceSize mSize;
 
             uint32_t mMemTypeIndex;
+            ResourceClass mResourceClass = ResourceClass::Linear;
+            bool mDedicated = false;
+            // sorted by offset
             std::vector<MemoryBlock> mBlocks;
             void* mPtr = nullptr;
+            bool mEvacuating = false;
 
         };
 
         class ChunkFactory {
-            static const vk::DeviceSize MinChunkSize = 8 * 1024 * 1024;
         public:
             ChunkFactory() = default;
 
-            explicit ChunkFactory(const std::shared_ptr<Device>& _device) :mDevice(_device) {}
+            explicit ChunkFactory(const std::shared_ptr<Device>& _device);
 
-            void setMinChunkSize(const vk::DeviceSize _size) {
-                assert(Math::IsPowerOf2(_size));
-                mMinChunkSize = _size;
-            }
+            /** @brief Policy used by memory types without their own one */
+            void setDefaultPolicy(const ChunkSizePolicy& _policy) { mDefaultPolicy = _policy; }
+
+            void setPolicy(uint32_t _memTypeIndex, const ChunkSizePolicy& _policy) { mPolicies[_memTypeIndex] = _policy; }
 
-            std::unique_ptr<Chunk> getChunk(vk::DeviceSize _size, uint32_t _memTypeIndex);
+            const ChunkSizePolicy& getPolicy(uint32_t _memTypeIndex) const;
+
+            std::unique_ptr<Chunk> getChunk(vk::DeviceSize _size, uint32_t _memTypeIndex, ResourceClass _resourceClass);
+
+            std::unique_ptr<Chunk> getDedicatedChunk(vk::DeviceSize _size,
+                                                     uint32_t _memTypeIndex,
+                                                     ResourceClass _resourceClass,
+                                                     const vk::MemoryDedicatedAllocateInfo& _dedicatedInfo);
 
         private:
             std::shared_ptr<Device> mDevice;
-            vk::DeviceSize mMinChunkSize = MinChunkSize;
+            ChunkSizePolicy mDefaultPolicy;
+            std::unordered_map<uint32_t, ChunkSizePolicy> mPolicies;
         };
 
         class AbstractAllocator : public GeneralBase::NoCopyBase {
@@ -106,9 +235,16 @@ namespace Mix {
                                  const vk::DeviceSize& _alignment,
                                  uint32_t _memoryTypeIndex) override;
 
+            /** @brief Memory not bound to a resource yet, e.g. shared by images whose lifetimes don't overlap */
+            MemoryBlock allocate(const vk::DeviceSize& _size,
+                                 const vk::DeviceSize& _alignment,
+                                 uint32_t _memoryTypeIndex,
+                                 ResourceClass _resourceClass);
+
             MemoryBlock allocate(const vk::Image& _image,
                                  const vk::MemoryPropertyFlags & _properties,
-                                 vk::MemoryRequirements* _memReq = nullptr);
+                                 vk::MemoryRequirements* _memReq = nullptr,
+                                 vk::ImageTiling _tiling = vk::ImageTiling::eOptimal);
 
             MemoryBlock allocate(const vk::Buffer& _buffer,
                                  const vk::MemoryPropertyFlags& _properties,
@@ -116,10 +252,50 @@ namespace Mix {
 
             void deallocate(MemoryBlock& _block) override;
 
+            ChunkFactory& getChunkFactory() { return mChunkFactory; }
+
+            /**
+             * @brief Register the owner that moves @p _block during defragmentation, nullptr to unregister.
+             */
+            void setOwner(const MemoryBlock& _block, AllocationOwner* _owner);
+
+            std::vector<MemoryTypeStatistics> getStatistics() const;
+
+            std::vector<MemoryHeapBudget> getHeapBudgets() const;
+
+            /**
+             * @brief Move relocatable allocations out of sparsely used chunks and free those chunks.
+             *        The caller must make sure that no submitted work still uses the moved resources.
+             * @param _commandPool Pool of the queue family that owns the moved resources.
+             */
+            DefragmentationResult defragment(const std::shared_ptr<CommandPool>& _commandPool,
+                                             const DefragmentationSettings& _settings = {});
+
+            /** @return number of bytes returned to the driver */
+            vk::DeviceSize releaseEmptyChunks();
+
         private:
+            MemoryBlock allocateFromChunks(const vk::DeviceSize& _size,
+                                           const vk::DeviceSize& _alignment,
+                                           uint32_t _memoryTypeIndex,
+                                           ResourceClass _resourceClass);
+
+            MemoryBlock allocateDedicated(const vk::MemoryRequirements& _memReq,
+                                          uint32_t _memoryTypeIndex,
+                                          ResourceClass _resourceClass,
+                                          const vk::MemoryDedicatedAllocateInfo& _dedicatedInfo);
+
+            /** @brief Whether new device memory may be allocated, checked by chunk and dedicated allocations alike */
+            bool canGrow(const vk::DeviceSize& _size, uint32_t _memoryTypeIndex) const;
+
+            bool useDedicated(const vk::MemoryRequirements& _memReq,
+                              const vk::MemoryDedicatedRequirements& _dedicatedReq,
+                              uint32_t _memoryTypeIndex) const;
+
             std::shared_ptr<Device> mDevice;
             ChunkFactory mChunkFactory;
             std::vector<std::unique_ptr<Chunk>> mChunks;
+            bool mAllowGrowth = true;
         };
     }
 }
@@ -18,6 +18,9 @@ namespace Mix {
             case VertexElementType::UInt3: return vk::Format::eR32G32B32Uint;
             case VertexElementType::UInt4: return vk::Format::eR32G32B32A32Uint;
             case VertexElementType::UByte4_Norm: return vk::Format::eR8G8B8A8Unorm;
+            case VertexElementType::Byte4_Norm: return vk::Format::eR8G8B8A8Snorm;
+            case VertexElementType::Short4_Norm: return vk::Format::eR16G16B16A16Snorm;
+            case VertexElementType::Half2: return vk::Format::eR16G16Sfloat;
             default: return vk::Format::eUndefined;
             }
         }
@@ -14,6 +14,10 @@
 #include "MxVkUtils.h"
 #include "Image/MxVkImage.h"
 #include "FrameBuffer/MxVkFramebuffer.h"
+#include "Buffers/MxVkUploadManager.h"
+#include "Image/MxVkMipmapGenerator.h"
+#include "Buffers/MxVkGeometryPool.h"
+#include <algorithm>
 
 namespace Mix {
     namespace Vulkan {
@@ -65,49 +69,91 @@ namespace Mix {
         }
 
         void VulkanAPI::build() {
+            // a window without surface, e.g. on build machines without display, renders offscreen
+            mHeadless = !mWindow || !mWindow->rawPtr();
+
             // Initialize Vulkan API
             createInstance();
             pickPhysicalDevice();
             createDevice();
             createDebugUtils();
             createDescriptorPool();
-            createSwapchain();
+            if (!mHeadless)
+                createSwapchain();
             createCommandPool();
             createAllocator();
+            if (mHeadless)
+                createOffscreenTargets();
             createRenderPass();
-            createFrameBuffer();
 
-            mGraphicsCommandBuffers.reserve(mSwapchain->imageCount());
-            for (size_t i = 0; i < mSwapchain->imageCount(); ++i) {
+            mGraphicsCommandBuffers.reserve(getFrameCount());
+            for (size_t i = 0; i < getFrameCount(); ++i) {
                 mGraphicsCommandBuffers.emplace_back(std::make_shared<CommandBufferHandle>(mGraphicsCommandPool));
             }
 
+            mUploadManager = std::make_shared<UploadManager>(mAllocator, mTransferCommandPool, getFrameCount());
+            mMipmapGenerator = std::make_shared<MipmapGenerator>(mDevice, *mUploadManager);
+            mGeometryPool = std::make_shared<GeometryPool>(mAllocator, getFrameCount());
+
             mVertexInputManager = std::make_shared<VertexInputManager>();
         }
 
-        void VulkanAPI::beginRender() {
-            mCurrFrame = mSwapchain->getCurrFrame();
+        uint32_t VulkanAPI::getFrameCount() const {
+            return mHeadless ? static_cast<uint32_t>(mOffscreenImages.size()) : mSwapchain->imageCount();
+        }
+
+        const vk::Extent2D& VulkanAPI::getFrameExtent() const {
+            return mHeadless ? mOffscreenExtent : mSwapchain->extent();
+        }
+
+        vk::Format VulkanAPI::getColorFormat() const {
+            return mHeadless ? mOffscreenImages.front()->format() : mSwapchain->surfaceFormat().format;
+        }
+
+        const vk::Image& VulkanAPI::getCurrColorImage() const {
+            return mHeadless ? mOffscreenImages[mCurrFrame]->get() : mSwapchain->getCurrImage();
+        }
+
+        const vk::ImageView& VulkanAPI::getCurrColorImageView() const {
+            return mHeadless ? mOffscreenImageViews[mCurrFrame] : mSwapchain->getCurrImageView();
+        }
+
+        void VulkanAPI::beginFrame() {
+            mCurrFrame = mHeadless ? mNextOffscreenFrame : mSwapchain->getCurrFrame();
             mCurrCmd = mGraphicsCommandBuffers[mCurrFrame].get();
             mCurrCmd->wait();
-            mSwapchain->acquireNextImage();
+            // the last frame recorded into this command buffer has completed, geometry it drew can be reused
+            mGeometryPool->nextFrame();
+            if (!mHeadless)
+                mSwapchain->acquireNextImage();
             mCurrCmd->begin();
 
-            std::vector<vk::ClearValue> clearValues(2);
-            clearValues[0].color = std::array<float, 4>{0.2f, 0.2f, 0.2f, 1.0f};
-            clearValues[1].depthStencil = vk::ClearDepthStencilValue(1.0f, 0);
-
-            mRenderPass->beginRenderPass(mCurrCmd->get(),
-                                         mFrameBuffers[mCurrFrame].get(),
-                                         clearValues,
-                                         mSwapchain->extent());
+            // submit the uploads of this frame and make them visible to the graphics queue
+            mUploadManager->recordFrame(mCurrCmd->get());
         }
 
-        void VulkanAPI::endRender() {
-            mRenderPass->endRenderPass(mCurrCmd->get());
-
+        void VulkanAPI::endFrame() {
             mCurrCmd->end();
-            mCurrCmd->submit({ mSwapchain->presentFinishedSph() }, // wait for image
-                             { vk::PipelineStageFlagBits::eColorAttachmentOutput },
+
+            // nothing to present, the fence of the command buffer throttles the frames in flight
+            if (mHeadless) {
+                mCurrCmd->submit(mUploadManager->getWaitSemaphores(), mUploadManager->getWaitStages());
+                mNextOffscreenFrame = (mCurrFrame + 1) % getFrameCount();
+                return;
+            }
+
+            // wait for image and uploads
+            std::vector<vk::Semaphore> waitSemaphores{ mSwapchain->presentFinishedSph() };
+            std::vector<vk::PipelineStageFlags> waitStages{ vk::PipelineStageFlagBits::eColorAttachmentOutput };
+            waitSemaphores.insert(waitSemaphores.end(),
+                                  mUploadManager->getWaitSemaphores().begin(),
+                                  mUploadManager->getWaitSemaphores().end());
+            waitStages.insert(waitStages.end(),
+                              mUploadManager->getWaitStages().begin(),
+                              mUploadManager->getWaitStages().end());
+
+            mCurrCmd->submit(waitSemaphores,
+                             waitStages,
                              { mSwapchain->renderFinishedSph() }); // notify swapchain
             mSwapchain->present();
         }
@@ -124,13 +170,18 @@ namespace Mix {
                 std::cerr << e.what() << std::endl;
             }
 
-            if (mDevice && mDepthStencilView)
-                mDevice->getVkHandle().destroy(mDepthStencilView);
-
+            // pending generation commands refer to the generator
+            mUploadManager.reset();
+            mMipmapGenerator.reset();
+            mGeometryPool.reset();
             mGraphicsCommandBuffers.clear();
             mGraphicsCommandPool.reset();
             mTransferCommandPool.reset();
             mSwapchain.reset();
+            for (auto& view : mOffscreenImageViews)
+                mDevice->getVkHandle().destroyImageView(view);
+            mOffscreenImageViews.clear();
+            mOffscreenImages.clear();
             mAllocator.reset();
             mDebugUtils.reset();
             mPhysicalDevice.reset();
@@ -162,11 +213,15 @@ namespace Mix {
         }
 
         void VulkanAPI::createDevice() {
-            VkSurfaceKHR surface;
-            SDL_Vulkan_CreateSurface(mWindow->rawPtr(), static_cast<VkInstance>(mInstance->get()), &surface);
-            mSurface = static_cast<vk::SurfaceKHR>(surface);
+            std::optional<vk::SurfaceKHR> surface;
+            if (!mHeadless) {
+                VkSurfaceKHR sdlSurface;
+                SDL_Vulkan_CreateSurface(mWindow->rawPtr(), static_cast<VkInstance>(mInstance->get()), &sdlSurface);
+                mSurface = static_cast<vk::SurfaceKHR>(sdlSurface);
+                surface = mSurface;
+            }
             mDevice = std::make_shared<Device>(mPhysicalDevice,
-                                               mSurface,
+                                               surface,
                                                &mSettings->enabledFeatures,
                                                mSettings->deviceExts,
                                                mSettings->validationLayers,
@@ -197,6 +252,28 @@ namespace Mix {
                                vk::Extent2D(640, 480));
         }
 
+        void VulkanAPI::createOffscreenTargets() {
+            const Vector2i size = mWindow ? mWindow->getExtent() : Vector2i(640, 480);
+            mOffscreenExtent = vk::Extent2D(static_cast<uint32_t>(std::max(size.x, 1)), static_cast<uint32_t>(std::max(size.y, 1)));
+
+            // same frames in flight as the swapchain, sampled usage allows the shader read only layout Texture::GetPixels expects
+            const uint32_t frameCount = 2;
+            for (uint32_t i = 0; i < frameCount; ++i) {
+                mOffscreenImages.push_back(std::make_shared<Image>(mAllocator,
+                                                                   vk::ImageType::e2D,
+                                                                   vk::MemoryPropertyFlagBits::eDeviceLocal,
+                                                                   vk::Extent3D(mOffscreenExtent.width, mOffscreenExtent.height, 1),
+                                                                   vk::Format::eR8G8B8A8Unorm,
+                                                                   vk::ImageUsageFlagBits::eColorAttachment |
+                                                                   vk::ImageUsageFlagBits::eSampled |
+                                                                   vk::ImageUsageFlagBits::eTransferSrc));
+                mOffscreenImageViews.push_back(Image::CreateVkImageView2D(mDevice->getVkHandle(),
+                                                                          mOffscreenImages.back()->get(),
+                                                                          mOffscreenImages.back()->format(),
+                                                                          vk::ImageAspectFlagBits::eColor));
+            }
+        }
+
         void VulkanAPI::createCommandPool() {
             mTransferCommandPool = std::make_shared<CommandPool>(mDevice, vk::QueueFlagBits::eTransfer);
             mGraphicsCommandPool = std::make_shared<CommandPool>(mDevice, vk::QueueFlagBits::eGraphics,
@@ -208,21 +285,15 @@ namespace Mix {
         }
 
         void VulkanAPI::createRenderPass() {
-            mDepthStencil = Image::CreateDepthStencil(getAllocator(),
-                                                      mSwapchain->extent(),
-                                                      vk::SampleCountFlagBits::e1);
-            mDepthStencilView = Image::CreateVkImageView2D(mDevice->getVkHandle(),
-                                                           mDepthStencil->get(),
-                                                           mDepthStencil->format(),
-                                                           vk::ImageAspectFlagBits::eDepth |
-                                                           vk::ImageAspectFlagBits::eStencil);
+            // the depth buffer itself is a transient of the render graph
+            mDepthStencilFormat = Image::ChooseDepthStencilFormat(*mPhysicalDevice);
 
             // RenderPass
             mRenderPass = std::make_shared<RenderPass>(getLogicalDevice());
 
             mRenderPass->addAttachment({
-                {0, Attachment::Type::PRESENT, mSwapchain->surfaceFormat().format},
-                {1, Attachment::Type::DEPTH_STENCIL, mDepthStencil->format()}
+                {0, Attachment::Type::PRESENT, getColorFormat()},
+                {1, Attachment::Type::DEPTH_STENCIL, mDepthStencilFormat}
                                        });
 
             Subpass subpass(0);
@@ -245,14 +316,6 @@ namespace Mix {
             mRenderPass->create();
         }
 
-        void VulkanAPI::createFrameBuffer() {
-            for (size_t i = 0; i < mSwapchain->imageCount(); ++i) {
-                mFrameBuffers.emplace_back(mRenderPass, getSwapchain()->extent());
-                mFrameBuffers.back().addAttachments({ mSwapchain->getImageViews()[i], mDepthStencilView });
-                mFrameBuffers.back().create();
-            }
-        }
-
         void VulkanAPI::destroy() {
         }
     }
@@ -33,6 +33,9 @@ namespace Mix {
         class DynamicUniformBuffer;
         class ShaderBase;
         class VertexInputManager;
+        class UploadManager;
+        class MipmapGenerator;
+        class GeometryPool;
 
         struct VulkanSettings {
             struct {
@@ -77,27 +80,61 @@ namespace Mix {
                 return mAllocator;
             }
 
+            /** @brief Null in headless mode, frames are then rendered to offscreen images */
             const std::shared_ptr<Swapchain>& getSwapchain() const {
                 return mSwapchain;
             }
 
+            /** @brief Whether the target window has no surface, set up by build() */
+            bool isHeadless() const { return mHeadless; }
+
+            /** @brief Frames recorded ahead of the gpu, each with its own command buffer and color target */
+            uint32_t getFrameCount() const;
+
+            const vk::Extent2D& getFrameExtent() const;
+
+            /** @brief Format of the color target frames are rendered to */
+            vk::Format getColorFormat() const;
+
+            const vk::Image& getCurrColorImage() const;
+
+            const vk::ImageView& getCurrColorImageView() const;
+
+            /** @brief Offscreen color target of @p _frame in headless mode, left in shader read only layout after its frame */
+            const std::shared_ptr<Image>& getOffscreenImage(const uint32_t _frame) const { return mOffscreenImages[_frame]; }
+
             const std::shared_ptr<CommandPool>& getTransferCommandPool() const { return mTransferCommandPool; }
 
             const std::shared_ptr<CommandPool>& getGraphicsCommandPool() const { return mGraphicsCommandPool; }
 
             const std::shared_ptr<DescriptorPool>& getDescriptorPool() const { return mDescriptorPool; }
 
-            void beginRender();
+            UploadManager& getUploadManager() const { return *mUploadManager; }
+
+            MipmapGenerator& getMipmapGenerator() const { return *mMipmapGenerator; }
+
+            GeometryPool& getGeometryPool() const { return *mGeometryPool; }
 
-            void endRender();
+            /**
+             * @brief Wait for the frame to be reusable and begin its command buffer, uploads are recorded.
+             *        The passes of the frame are then recorded by a RenderGraph into getCurrDrawCmd().
+             */
+            void beginFrame();
+
+            /** @brief Submit the command buffer of the frame and present its swapchain image, if any */
+            void endFrame();
 
             uint32_t getCurrFrame() const { return mCurrFrame; }
 
             CommandBufferHandle& getCurrDrawCmd()const { return *mCurrCmd; }
 
+            /**
+             * @brief Render pass with a swapchain color and a depth attachment that pipelines are created against.
+             *        Render passes of the render graph with the same formats are compatible with it.
+             */
             const std::shared_ptr<RenderPass>& getRenderPass() { return mRenderPass; }
 
-            const FrameBuffer& getCurrFrameBuffer() const { return mFrameBuffers[mCurrFrame]; }
+            vk::Format getDepthStencilFormat() const { return mDepthStencilFormat; }
 
             void waitDeviceIdle();
 
@@ -115,11 +152,11 @@ namespace Mix {
             void createDebugUtils();
             void createDescriptorPool();
             void createSwapchain();
+            void createOffscreenTargets();
             void createCommandPool();
             void createAllocator();
 
             void createRenderPass();
-            void createFrameBuffer();
 
             void destroy() override;
 
@@ -137,13 +174,21 @@ namespace Mix {
             std::shared_ptr<Swapchain>          mSwapchain;
             std::shared_ptr<DescriptorPool>		mDescriptorPool;
 
+            // headless mode renders into these instead of swapchain images
+            bool mHeadless = false;
+            vk::Extent2D mOffscreenExtent;
+            std::vector<std::shared_ptr<Image>> mOffscreenImages;
+            std::vector<vk::ImageView> mOffscreenImageViews;
+            uint32_t mNextOffscreenFrame = 0;
+
             std::shared_ptr<RenderPass> mRenderPass;
-            std::vector<FrameBuffer> mFrameBuffers;
-            std::shared_ptr<Image> mDepthStencil;
-            vk::ImageView mDepthStencilView;
+            vk::Format mDepthStencilFormat = vk::Format::eUndefined;
 
             std::shared_ptr<CommandPool>		mTransferCommandPool;
             std::shared_ptr<CommandPool>		mGraphicsCommandPool;
+            std::shared_ptr<UploadManager>      mUploadManager;
+            std::shared_ptr<MipmapGenerator>    mMipmapGenerator;
+            std::shared_ptr<GeometryPool>       mGeometryPool;
 
             // Test managers
             std::shared_ptr<VertexInputManager> mVertexInputManager;
@@ -21,6 +21,17 @@ namespace Mix {
                 vk::ColorComponentFlagBits::eA
         };
 
+        const vk::PipelineColorBlendAttachmentState GraphicsPipelineState::NoColorWriteAttachment = {
+            false,
+            vk::BlendFactor::eOne,
+            vk::BlendFactor::eZero,
+            vk::BlendOp::eAdd,
+            vk::BlendFactor::eOne,
+            vk::BlendFactor::eZero,
+            vk::BlendOp::eAdd,
+            vk::ColorComponentFlags()
+        };
+
         GraphicsPipelineState::GraphicsPipelineState(std::shared_ptr<Device> _device, const GraphicsPipelineStateDesc& _desc) :mDevice(std::move(_device)) {
             // Prepare shader stage
             std::pair<vk::ShaderStageFlagBits, std::shared_ptr<ShaderModule>> shaderModules[] = {
@@ -49,6 +60,10 @@ namespace Mix {
 
             mVertexDecl = _desc.vertexDecl;
             mShaderModules = std::move(usedShaderModules);
+            for (auto& module : mShaderModules)
+                mVariantMask |= module->specConstantMask();
+            if (_desc.variantConstantCount < 32)
+                mVariantMask &= (1u << _desc.variantConstantCount) - 1;
 
             // Prepare input assebly state
             mPipelineStateData.inputAssemblyInfo.topology = vk::PrimitiveTopology::eTriangleList; // Set at runtime
@@ -181,11 +196,16 @@ namespace Mix {
                                                                      MeshTopology _drawMode,
                                                                      bool _depthTest,
                                                                      bool _depthWrite,
-                                                                     bool _stencilTest) {
+                                                                     bool _stencilTest,
+                                                                     vk::CompareOp _depthCompareOp,
+                                                                     uint32_t _variant) {
                                // todo Find a nother way to generate the id of RenderPass
             auto renderPassKey = static_cast<uint32_t>(reinterpret_cast<intptr_t>(_renderPass.get()));
 
-            PipelineKey key{ renderPassKey,_subpassIndex,_drawMode,_vertexInput->getId(),_depthTest,_depthWrite,_stencilTest };
+            // bits without a declared constant don't change the pipeline, so they must not create another one
+            _variant &= mVariantMask;
+
+            PipelineKey key{ renderPassKey,_subpassIndex,_drawMode,_vertexInput->getId(),_depthTest,_depthWrite,_stencilTest,_depthCompareOp,_variant };
 
             // A suitable graphice pipeline exists
             auto it = mPipelineMap.find(key);
@@ -194,7 +214,7 @@ namespace Mix {
 
             // No suitable graphice pipeline
             // Create a new one
-            auto newPipeline = createPipeline(_renderPass, _subpassIndex, _drawMode, _vertexInput, _depthTest, _depthWrite, _stencilTest);
+            auto newPipeline = createPipeline(_renderPass, _subpassIndex, _drawMode, _vertexInput, _depthTest, _depthWrite, _stencilTest, _depthCompareOp, _variant);
             mPipelineMap[key] = newPipeline;
             return newPipeline;
         }
@@ -229,18 +249,39 @@ namespace Mix {
                                                                         const std::shared_ptr<VertexInput>& _vertexInput,
                                                                         bool _depthTest,
                                                                         bool _depthWrite,
-                                                                        bool _stencilTest) {
+                                                                        bool _stencilTest,
+                                                                        vk::CompareOp _depthCompareOp,
+                                                                        uint32_t _variant) {
                // todo Add more other common options
             mPipelineStateData.inputAssemblyInfo.topology = VulkanUtils::GetTopology(_drawMode);
             mPipelineStateData.depthStencilInfo.depthTestEnable = _depthTest;
             mPipelineStateData.depthStencilInfo.depthWriteEnable = _depthWrite;
+            mPipelineStateData.depthStencilInfo.depthCompareOp = _depthCompareOp;
             mPipelineStateData.depthStencilInfo.stencilTestEnable = _stencilTest;
             mPipelineStateData.pipelineCreateInfo.renderPass = _renderPass->get();
             mPipelineStateData.pipelineCreateInfo.subpass = _subpassIndex;
             mPipelineStateData.pipelineCreateInfo.pVertexInputState = &_vertexInput->getVertexInputStateInfo();
 
+            // the driver folds the constants, so branches and samples of disabled features are compiled out
+            std::vector<vk::Bool32> constants;
+            std::vector<vk::SpecializationMapEntry> entries;
+            for (uint32_t i = 0; i < 32; ++i) {
+                if (!(mVariantMask & (1u << i)))
+                    continue;
+                entries.emplace_back(i, static_cast<uint32_t>(constants.size() * sizeof(vk::Bool32)), sizeof(vk::Bool32));
+                constants.push_back((_variant >> i) & 1u);
+            }
+            vk::SpecializationInfo specialization(static_cast<uint32_t>(entries.size()), entries.data(), constants.size() * sizeof(vk::Bool32), constants.data());
+
+            // constants a stage doesn't declare are ignored
+            for (uint32_t i = 0; i < mPipelineStateData.pipelineCreateInfo.stageCount; ++i)
+                mPipelineStateData.shaderStageInfo[i].pSpecializationInfo = entries.empty() ? nullptr : &specialization;
+
             vk::Pipeline pipeline = mDevice->getVkHandle().createGraphicsPipeline(nullptr, mPipelineStateData.pipelineCreateInfo);
 
+            for (uint32_t i = 0; i < mPipelineStateData.pipelineCreateInfo.stageCount; ++i)
+                mPipelineStateData.shaderStageInfo[i].pSpecializationInfo = nullptr;
+
             return std::shared_ptr<Pipeline>(new Pipeline(_renderPass, mPipelineStateData.descriptorSetLayouts, _subpassIndex, pipeline, mPipelineStateData.pipelineLayout));
         }
 
@@ -252,6 +293,8 @@ namespace Mix {
             Utils::HashCombine(hash, _v.vertexInputId);
             uint32_t flag = (_v.depthTest << 2 | _v.depthWrite << 1 | _v.stencilTest);
             Utils::HashCombine(hash, flag);
+            Utils::HashCombine(hash, static_cast<uint32_t>(_v.depthCompareOp));
+            Utils::HashCombine(hash, _v.variant);
             return hash;
         }
 
@@ -266,7 +309,9 @@ namespace Mix {
                 vertexInputId == _other.vertexInputId &&
                 depthTest == _other.depthTest &&
                 depthWrite == _other.depthWrite &&
-                stencilTest == _other.stencilTest;
+                stencilTest == _other.stencilTest &&
+                depthCompareOp == _other.depthCompareOp &&
+                variant == _other.variant;
         }
 
         bool GraphicsPipelineState::PipelineKey::operator!=(const PipelineKey& _other) const {
@@ -37,6 +37,10 @@ namespace Mix {
             std::vector<vk::PipelineColorBlendAttachmentState> blendStates;
             std::vector<vk::PushConstantRange> pushConstant;
             std::vector<std::shared_ptr<DescriptorSetLayout>> descriptorSetLayouts;
+
+            // boolean specialization constants with constant_id 0 to count - 1, set from the bits of the variant passed to getPipeline()
+            // constants none of the stages declare are dropped
+            uint32_t variantConstantCount = 0;
         };
 
         class GraphicsPipelineState {
@@ -55,7 +59,12 @@ namespace Mix {
                                                   MeshTopology _drawMode = MeshTopology::Triangles_List,
                                                   bool _depthTest = true,
                                                   bool _depthWrite = true,
-                                                  bool _stencilTest = false);
+                                                  bool _stencilTest = false,
+                                                  vk::CompareOp _depthCompareOp = vk::CompareOp::eLess,
+                                                  uint32_t _variant = 0);
+
+            /** @brief Blend state of a color attachment that is left untouched, for depth only pipelines */
+            static const vk::PipelineColorBlendAttachmentState NoColorWriteAttachment;
 
             static const vk::PipelineColorBlendAttachmentState DefaultBlendAttachment;
         private:
@@ -87,6 +96,8 @@ namespace Mix {
                 bool depthTest;
                 bool depthWrite;
                 bool stencilTest;
+                vk::CompareOp depthCompareOp;
+                uint32_t variant;
 
                 static size_t Hash(const PipelineKey& _v);
 
@@ -103,6 +114,8 @@ namespace Mix {
             std::shared_ptr<Device> mDevice;
             std::shared_ptr<VertexDeclaration> mVertexDecl;
             std::vector<std::shared_ptr<ShaderModule>> mShaderModules;
+            // variant bits whose constant is declared by at least one stage
+            uint32_t mVariantMask = 0;
             std::unordered_map<PipelineKey, std::shared_ptr<Pipeline>, PipelineKey::Hasher> mPipelineMap;
 
 
@@ -112,7 +125,9 @@ namespace Mix {
                                                      const std::shared_ptr<VertexInput>& _vertexInput,
                                                      bool _depthTest = true,
                                                      bool _depthWrite = true,
-                                                     bool _stencilTest = false);
+                                                     bool _stencilTest = false,
+                                                     vk::CompareOp _depthCompareOp = vk::CompareOp::eLess,
+                                                     uint32_t _variant = 0);
         };
     }
 }
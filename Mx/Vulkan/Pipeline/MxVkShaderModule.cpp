@@ -18,6 +18,7 @@ namespace Mix {
 
 			mModule = mDevice->getVkHandle().createShaderModule(createInfo);
 			mStage = _stage;
+			mSpecConstantMask = ReflectSpecConstants(_data, _size);
 		}
 
 		ShaderModule::ShaderModule(std::shared_ptr<Device> _device, const ShaderSource& _source):mDevice(std::move(_device)) {
@@ -27,6 +28,7 @@ namespace Mix {
 			
 			mModule = mDevice->getVkHandle().createShaderModule(createInfo);
 			mStage = _source.getStage();
+			mSpecConstantMask = ReflectSpecConstants(_source.getSprvData(), _source.getSprvDataSize());
 		}
 
 		ShaderModule::~ShaderModule() {
@@ -39,6 +41,28 @@ namespace Mix {
 			swap(mDevice, _other.mDevice);
 			swap(mModule, _other.mModule);
 			swap(mStage, _other.mStage);
+			swap(mSpecConstantMask, _other.mSpecConstantMask);
+		}
+
+		uint32_t ShaderModule::ReflectSpecConstants(const uint32_t* _code, size_t _size) {
+			constexpr uint32_t headerWords = 5;
+			constexpr uint32_t opDecorate = 71;
+			constexpr uint32_t decorationSpecId = 1;
+
+			// constant_id is stored as an OpDecorate SpecId on the constant
+			uint32_t mask = 0;
+			const size_t wordCount = _size / sizeof(uint32_t);
+			for (size_t i = headerWords; i < wordCount;) {
+				const uint32_t length = _code[i] >> 16;
+				const uint32_t opcode = _code[i] & 0xFFFF;
+				if (length == 0 || i + length > wordCount)
+					break;
+
+				if (opcode == opDecorate && length >= 4 && _code[i + 2] == decorationSpecId && _code[i + 3] < 32)
+					mask |= 1u << _code[i + 3];
+				i += length;
+			}
+			return mask;
 		}
 	}
 }
@@ -32,10 +32,19 @@ namespace Mix {
 
 			const vk::ShaderStageFlagBits& stage() const { return mStage; }
 
+			/**
+			 * @brief Bit i is set when the module declares a specialization constant with constant_id i, ids above 31 are not recorded
+			 */
+			uint32_t specConstantMask() const { return mSpecConstantMask; }
+
 		private:
 			std::shared_ptr<Device> mDevice;
 			vk::ShaderModule mModule;
 			vk::ShaderStageFlagBits mStage;
+			uint32_t mSpecConstantMask = 0;
+
+			/** @param _size Size of @p _code in bytes */
+			static uint32_t ReflectSpecConstants(const uint32_t* _code, size_t _size);
 		};
 	}
 }
@@ -0,0 +1,53 @@
+#include "MxVkFragmentQuery.h"
+
+namespace Mix {
+	namespace Vulkan {
+		FragmentQuery::FragmentQuery(const std::shared_ptr<Device>& _device, const uint32_t _framesInFlight)
+			: mDevice(_device),
+			mIssued(_framesInFlight, false) {
+			vk::QueryPoolCreateInfo createInfo;
+			createInfo.queryType = vk::QueryType::ePipelineStatistics;
+			createInfo.queryCount = _framesInFlight;
+			createInfo.pipelineStatistics = vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations;
+			mQueryPool = mDevice->getVkHandle().createQueryPool(createInfo);
+		}
+
+		FragmentQuery::~FragmentQuery() {
+			if (mQueryPool)
+				mDevice->getVkHandle().destroyQueryPool(mQueryPool);
+		}
+
+		bool FragmentQuery::IsSupported(const Device& _device) {
+			return _device.getEnabledFeatures().pipelineStatisticsQuery;
+		}
+
+		std::optional<uint64_t> FragmentQuery::getResult(const uint32_t _frame) {
+			if (!mIssued[_frame])
+				return std::nullopt;
+			mIssued[_frame] = false;
+
+			// invocation count followed by the availability
+			uint64_t data[2] = { 0, 0 };
+			const auto result = mDevice->getVkHandle().getQueryPoolResults(mQueryPool, _frame, 1,
+																			 sizeof(data), data, sizeof(data),
+																			 vk::QueryResultFlagBits::e64 |
+																			 vk::QueryResultFlagBits::eWithAvailability);
+			if (result != vk::Result::eSuccess || data[1] == 0)
+				return std::nullopt;
+			return data[0];
+		}
+
+		void FragmentQuery::reset(const vk::CommandBuffer& _cmd, const uint32_t _frame) {
+			_cmd.resetQueryPool(mQueryPool, _frame, 1);
+		}
+
+		void FragmentQuery::begin(const vk::CommandBuffer& _cmd, const uint32_t _frame) {
+			_cmd.beginQuery(mQueryPool, _frame, vk::QueryControlFlags());
+		}
+
+		void FragmentQuery::end(const vk::CommandBuffer& _cmd, const uint32_t _frame) {
+			_cmd.endQuery(mQueryPool, _frame);
+			mIssued[_frame] = true;
+		}
+	}
+}
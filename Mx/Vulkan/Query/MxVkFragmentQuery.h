@@ -0,0 +1,42 @@
+#pragma once
+#ifndef MX_VK_FRAGMENT_QUERY_H_
+#define MX_VK_FRAGMENT_QUERY_H_
+
+#include "../Device/MxVkDevice.h"
+#include <optional>
+#include <vector>
+
+namespace Mix {
+	namespace Vulkan {
+		/**
+		 * @brief Counts the fragment shader invocations of a range of draws, with one pipeline statistics query
+		 *        per frame in flight. A result is read once the fence of its frame has been waited on, so it never stalls.
+		 *        Requires the pipelineStatisticsQuery feature, see IsSupported().
+		 */
+		class FragmentQuery :public GeneralBase::NoCopyBase {
+		public:
+			FragmentQuery(const std::shared_ptr<Device>& _device, uint32_t _framesInFlight);
+
+			~FragmentQuery();
+
+			static bool IsSupported(const Device& _device);
+
+			/** @brief Invocations counted by the last query of @p _frame, nothing when it wasn't issued since the last call */
+			std::optional<uint64_t> getResult(uint32_t _frame);
+
+			/** @brief Reset the query of @p _frame, has to be recorded outside of a render pass */
+			void reset(const vk::CommandBuffer& _cmd, uint32_t _frame);
+
+			void begin(const vk::CommandBuffer& _cmd, uint32_t _frame);
+
+			void end(const vk::CommandBuffer& _cmd, uint32_t _frame);
+
+		private:
+			std::shared_ptr<Device> mDevice;
+			vk::QueryPool mQueryPool;
+			std::vector<bool> mIssued;
+		};
+	}
+}
+
+#endif // !MX_VK_FRAGMENT_QUERY_H_
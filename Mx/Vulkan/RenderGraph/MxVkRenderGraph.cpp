@@ -0,0 +1,668 @@
+#include "MxVkRenderGraph.h"
+#include "../Image/MxVkImage.h"
+#include "../Pipeline/MxVkRenderPass.h"
+#include "../FrameBuffer/MxVkFramebuffer.h"
+#include "../Device/MxVkPhysicalDevice.h"
+#include "../../Log/MxLog.h"
+#include <algorithm>
+#include <numeric>
+
+namespace Mix {
+	namespace Vulkan {
+		namespace {
+			const vk::AccessFlags WriteAccess = vk::AccessFlagBits::eColorAttachmentWrite |
+				vk::AccessFlagBits::eDepthStencilAttachmentWrite |
+				vk::AccessFlagBits::eShaderWrite |
+				vk::AccessFlagBits::eTransferWrite;
+
+			bool Contains(const vk::PipelineStageFlags _stages, const vk::PipelineStageFlags _subset) {
+				return (_stages & _subset) == _subset;
+			}
+		}
+
+		RenderGraphResource RenderGraphBuilder::createImage(const std::string& _name, const RenderGraphImageDesc& _desc) {
+			RenderGraph::Resource resource;
+			resource.name = _name;
+			resource.desc = _desc;
+			if (Image::HasDepth(_desc.format)) {
+				resource.aspect = vk::ImageAspectFlagBits::eDepth;
+				if (Image::HasStencil(_desc.format))
+					resource.aspect |= vk::ImageAspectFlagBits::eStencil;
+			}
+			else
+				resource.aspect = vk::ImageAspectFlagBits::eColor;
+
+			mGraph.mResources.push_back(std::move(resource));
+			return static_cast<RenderGraphResource>(mGraph.mResources.size() - 1);
+		}
+
+		void RenderGraphBuilder::writeColor(const RenderGraphResource _image, std::optional<vk::ClearColorValue> _clear) {
+			std::optional<vk::ClearValue> clear;
+			if (_clear) {
+				clear.emplace();
+				clear->color = _clear.value();
+			}
+			use(_image, RenderGraphAccess::ColorAttachment, clear);
+		}
+
+		void RenderGraphBuilder::writeDepth(const RenderGraphResource _image, std::optional<vk::ClearDepthStencilValue> _clear) {
+			std::optional<vk::ClearValue> clear;
+			if (_clear) {
+				clear.emplace();
+				clear->depthStencil = _clear.value();
+			}
+			use(_image, RenderGraphAccess::DepthAttachment, clear);
+		}
+
+		void RenderGraphBuilder::readDepth(const RenderGraphResource _image) {
+			use(_image, RenderGraphAccess::DepthReadOnly, std::nullopt);
+		}
+
+		void RenderGraphBuilder::read(const RenderGraphResource _image, const RenderGraphAccess _access) {
+			use(_image, _access, std::nullopt);
+		}
+
+		void RenderGraphBuilder::write(const RenderGraphResource _image, const RenderGraphAccess _access) {
+			use(_image, _access, std::nullopt);
+		}
+
+		void RenderGraphBuilder::setSideEffect() {
+			mGraph.mPasses[mPass].sideEffect = true;
+		}
+
+		void RenderGraphBuilder::use(const RenderGraphResource _image, const RenderGraphAccess _access, std::optional<vk::ClearValue> _clear) {
+			if (_image >= mGraph.mResources.size()) {
+				Log::Warning("Pass %1% uses an unknown image", mGraph.mPasses[mPass].name);
+				return;
+			}
+
+			// an image is in one layout during a pass, so it has a single access
+			auto& accesses = mGraph.mPasses[mPass].accesses;
+			auto it = std::find_if(accesses.begin(), accesses.end(), [_image](const RenderGraph::Access& _a) { return _a.resource == _image; });
+			if (it != accesses.end()) {
+				Log::Warning("Pass %1% uses image %2% more than once, only the last use is kept", mGraph.mPasses[mPass].name, mGraph.mResources[_image].name);
+				accesses.erase(it);
+			}
+
+			accesses.push_back({ _image, _access, _clear });
+			mGraph.mResources[_image].usage |= RenderGraph::GetAccessInfo(_access).usage;
+		}
+
+		RenderGraph::RenderGraph(const std::shared_ptr<DeviceAllocator>& _allocator)
+			: mAllocator(_allocator), mDevice(_allocator->getDevice()->getVkHandle()) {
+		}
+
+		RenderGraph::~RenderGraph() {
+			releaseTransients();
+			mFrameBuffers.clear();
+			mRenderPasses.clear();
+		}
+
+		void RenderGraph::reset() {
+			mResources.clear();
+			mPasses.clear();
+			mSteps.clear();
+		}
+
+		RenderGraphResource RenderGraph::importImage(const std::string& _name,
+													 const vk::Image& _image,
+													 const vk::ImageView& _view,
+													 const RenderGraphImageDesc& _desc,
+													 const vk::ImageLayout _initialLayout,
+													 const vk::ImageLayout _finalLayout,
+													 const vk::PipelineStageFlags _waitStage) {
+			RenderGraphBuilder builder(*this, 0);
+			const auto index = builder.createImage(_name, _desc);
+
+			auto& resource = mResources[index];
+			resource.imported = true;
+			resource.image = _image;
+			resource.view = _view;
+			resource.initialLayout = _initialLayout;
+			resource.finalLayout = _finalLayout;
+			resource.waitStage = _waitStage;
+			return index;
+		}
+
+		void RenderGraph::addPass(const std::string& _name, const std::function<void(RenderGraphBuilder&)>& _setup, Execute _execute) {
+			mPasses.emplace_back();
+			mPasses.back().name = _name;
+
+			RenderGraphBuilder builder(*this, static_cast<uint32_t>(mPasses.size() - 1));
+			_setup(builder);
+			mPasses.back().execute = std::move(_execute);
+		}
+
+		void RenderGraph::execute(const vk::CommandBuffer& _cmd) {
+			mStatistics = {};
+			mStatistics.passCount = static_cast<uint32_t>(mPasses.size());
+
+			cull();
+			plan();
+			allocateTransients();
+
+			for (auto& step : mSteps)
+				record(_cmd, step);
+		}
+
+		RenderGraph::AccessInfo RenderGraph::GetAccessInfo(const RenderGraphAccess _access) {
+			using Stage = vk::PipelineStageFlagBits;
+			using Access = vk::AccessFlagBits;
+			using Usage = vk::ImageUsageFlagBits;
+			using Layout = vk::ImageLayout;
+
+			const vk::PipelineStageFlags depthStages = Stage::eEarlyFragmentTests | Stage::eLateFragmentTests;
+
+			switch (_access) {
+			case RenderGraphAccess::ColorAttachment:
+				return { Layout::eColorAttachmentOptimal, Stage::eColorAttachmentOutput,
+					Access::eColorAttachmentRead | Access::eColorAttachmentWrite, Usage::eColorAttachment, true, true };
+			case RenderGraphAccess::DepthAttachment:
+				return { Layout::eDepthStencilAttachmentOptimal, depthStages,
+					Access::eDepthStencilAttachmentRead | Access::eDepthStencilAttachmentWrite, Usage::eDepthStencilAttachment, true, true };
+			case RenderGraphAccess::DepthReadOnly:
+				return { Layout::eDepthStencilReadOnlyOptimal, depthStages,
+					Access::eDepthStencilAttachmentRead, Usage::eDepthStencilAttachment, false, true };
+			case RenderGraphAccess::SampledFragment:
+				return { Layout::eShaderReadOnlyOptimal, Stage::eFragmentShader, Access::eShaderRead, Usage::eSampled, false, false };
+			case RenderGraphAccess::SampledCompute:
+				return { Layout::eShaderReadOnlyOptimal, Stage::eComputeShader, Access::eShaderRead, Usage::eSampled, false, false };
+			case RenderGraphAccess::StorageRead:
+				return { Layout::eGeneral, Stage::eComputeShader, Access::eShaderRead, Usage::eStorage, false, false };
+			case RenderGraphAccess::StorageWrite:
+				return { Layout::eGeneral, Stage::eComputeShader, Access::eShaderRead | Access::eShaderWrite, Usage::eStorage, true, false };
+			case RenderGraphAccess::TransferSrc:
+				return { Layout::eTransferSrcOptimal, Stage::eTransfer, Access::eTransferRead, Usage::eTransferSrc, false, false };
+			default:
+			case RenderGraphAccess::TransferDst:
+				return { Layout::eTransferDstOptimal, Stage::eTransfer, Access::eTransferWrite, Usage::eTransferDst, true, false };
+			}
+		}
+
+		void RenderGraph::cull() {
+			// walk backwards from the results of the graph, a pass is kept if a kept pass or the result needs what it writes
+			std::vector<bool> needed(mResources.size(), false);
+			for (size_t i = 0; i < mResources.size(); ++i)
+				needed[i] = mResources[i].imported && mResources[i].finalLayout != vk::ImageLayout::eUndefined;
+
+			for (auto it = mPasses.rbegin(); it != mPasses.rend(); ++it) {
+				auto& pass = *it;
+				bool keep = pass.sideEffect;
+				for (auto& access : pass.accesses) {
+					if (GetAccessInfo(access.access).write && needed[access.resource])
+						keep = true;
+				}
+
+				pass.culled = !keep;
+				if (!keep) {
+					++mStatistics.culledPassCount;
+					continue;
+				}
+
+				// a cleared image doesn't depend on earlier passes, other writes may keep parts of the content
+				for (auto& access : pass.accesses)
+					needed[access.resource] = !(GetAccessInfo(access.access).write && access.clear);
+			}
+		}
+
+		void RenderGraph::plan() {
+			mSteps.clear();
+
+			for (auto& resource : mResources) {
+				resource.firstStep = ~0u;
+				resource.lastStep = 0;
+				resource.sync = {};
+				if (resource.imported) {
+					resource.layout = resource.initialLayout;
+					resource.sync.writeStages = resource.waitStage;
+				}
+				else
+					resource.layout = vk::ImageLayout::eUndefined;
+			}
+
+			for (uint32_t i = 0; i < static_cast<uint32_t>(mPasses.size()); ++i) {
+				const auto& pass = mPasses[i];
+				if (pass.culled)
+					continue;
+
+				const bool graphics = std::any_of(pass.accesses.begin(), pass.accesses.end(), [](const Access& _access) {
+					return GetAccessInfo(_access.access).attachment;
+				});
+
+				if (graphics && !mSteps.empty() && mSteps.back().renderPass && canMerge(mSteps.back(), pass)) {
+					mSteps.back().passes.push_back(i);
+					addToRenderPass(mSteps.back(), pass);
+					continue;
+				}
+
+				mSteps.emplace_back();
+				auto& step = mSteps.back();
+				step.passes.push_back(i);
+
+				if (graphics) {
+					step.renderPass = true;
+					for (auto& access : pass.accesses) {
+						if (GetAccessInfo(access.access).attachment) {
+							step.extent = mResources[access.resource].desc.extent;
+							break;
+						}
+					}
+					addToRenderPass(step, pass);
+				}
+				else {
+					for (auto& access : pass.accesses) {
+						transition(access.resource, mResources[access.resource], GetAccessInfo(access.access), step.barriers);
+						step.resources.push_back(access.resource);
+					}
+				}
+			}
+
+			// results of the graph are left in the layout their users expect
+			Step finalStep;
+			for (uint32_t i = 0; i < static_cast<uint32_t>(mResources.size()); ++i) {
+				auto& resource = mResources[i];
+				if (!resource.imported || resource.finalLayout == vk::ImageLayout::eUndefined || resource.layout == resource.finalLayout)
+					continue;
+
+				Barrier barrier;
+				barrier.resource = i;
+				barrier.oldLayout = resource.layout;
+				barrier.newLayout = resource.finalLayout;
+				barrier.srcStages = resource.sync.writeStages | resource.sync.readStages;
+				barrier.srcAccess = resource.sync.writeAccess;
+				barrier.dstStages = vk::PipelineStageFlagBits::eBottomOfPipe;
+				finalStep.barriers.push_back(barrier);
+				resource.layout = resource.finalLayout;
+			}
+			if (!finalStep.barriers.empty())
+				mSteps.push_back(std::move(finalStep));
+
+			const uint32_t stepCount = static_cast<uint32_t>(mSteps.size());
+			for (uint32_t s = 0; s < stepCount; ++s) {
+				for (auto resource : mSteps[s].resources) {
+					mResources[resource].firstStep = std::min(mResources[resource].firstStep, s);
+					mResources[resource].lastStep = std::max(mResources[resource].lastStep, s);
+				}
+			}
+
+			// attachments are only written back to memory if a later step or the user of the result reads them
+			for (uint32_t s = 0; s < stepCount; ++s) {
+				auto& step = mSteps[s];
+				const auto storeOp = [&](AttachmentInfo& _attachment) {
+					const auto& resource = mResources[_attachment.resource];
+					const bool result = resource.imported && resource.finalLayout != vk::ImageLayout::eUndefined;
+					_attachment.storeOp = result || resource.lastStep > s ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare;
+				};
+
+				for (auto& color : step.colors)
+					storeOp(color);
+				if (step.depth)
+					storeOp(step.depth.value());
+			}
+		}
+
+		bool RenderGraph::transition(const RenderGraphResource _index, Resource& _resource, const AccessInfo& _info, std::vector<Barrier>& _barriers) const {
+			auto& sync = _resource.sync;
+
+			const bool layoutChange = _resource.layout != _info.layout;
+			// writes wait for every earlier access, reads only for a write not yet visible to their stages
+			const bool hazard = _info.write ?
+				static_cast<bool>(sync.writeStages | sync.readStages) :
+				sync.writeStages && !Contains(sync.visibleStages, _info.stages);
+
+			const bool barrier = layoutChange || hazard;
+			if (barrier) {
+				Barrier b;
+				b.resource = _index;
+				b.oldLayout = _resource.layout;
+				b.newLayout = _info.layout;
+				b.srcStages = sync.writeStages | sync.readStages;
+				b.srcAccess = sync.writeAccess;
+				b.dstStages = _info.stages;
+				b.dstAccess = _info.access;
+				b.discard = !_resource.imported && _resource.layout == vk::ImageLayout::eUndefined;
+				_barriers.push_back(b);
+			}
+
+			_resource.layout = _info.layout;
+			if (_info.write) {
+				sync.writeStages = _info.stages;
+				sync.writeAccess = _info.access & WriteAccess;
+				sync.readStages = {};
+				sync.visibleStages = {};
+			}
+			else if (layoutChange) {
+				// later reads have to wait for the layout transition, which happens before these stages
+				sync.writeStages = _info.stages;
+				sync.writeAccess = {};
+				sync.readStages = _info.stages;
+				sync.visibleStages = _info.stages;
+			}
+			else {
+				sync.readStages |= _info.stages;
+				if (barrier)
+					sync.visibleStages |= _info.stages;
+			}
+			return barrier;
+		}
+
+		bool RenderGraph::canMerge(const Step& _step, const Pass& _pass) const {
+			std::vector<RenderGraphResource> colors;
+			for (auto& access : _pass.accesses) {
+				const auto& resource = mResources[access.resource];
+				const auto info = GetAccessInfo(access.access);
+
+				if (!info.attachment) {
+					// a barrier can't be recorded inside of the render pass
+					Resource state = resource;
+					std::vector<Barrier> barriers;
+					if (transition(access.resource, state, info, barriers))
+						return false;
+					continue;
+				}
+
+				if (resource.desc.extent != _step.extent)
+					return false;
+
+				const auto color = std::find_if(_step.colors.begin(), _step.colors.end(), [&](const AttachmentInfo& _a) { return _a.resource == access.resource; });
+				const bool depth = _step.depth && _step.depth->resource == access.resource;
+				const bool attached = color != _step.colors.end() || depth;
+
+				// attachments of the render pass keep their content, new ones can be transitioned before it begins
+				if (attached && access.clear)
+					return false;
+				if (!attached && std::find(_step.resources.begin(), _step.resources.end(), access.resource) != _step.resources.end())
+					return false;
+
+				if (access.access == RenderGraphAccess::ColorAttachment) {
+					colors.push_back(access.resource);
+				}
+				else if (_step.depth) {
+					if (!depth || _step.depth->layout != info.layout)
+						return false;
+				}
+			}
+
+			// the color attachments are bound to the locations of the pipelines, so they have to stay the same
+			if (!colors.empty() && !_step.colors.empty()) {
+				if (colors.size() != _step.colors.size())
+					return false;
+				for (size_t i = 0; i < colors.size(); ++i) {
+					if (colors[i] != _step.colors[i].resource)
+						return false;
+				}
+			}
+			return true;
+		}
+
+		void RenderGraph::addToRenderPass(Step& _step, const Pass& _pass) {
+			for (auto& access : _pass.accesses) {
+				auto& resource = mResources[access.resource];
+				const auto info = GetAccessInfo(access.access);
+
+				const bool attached = std::find(_step.resources.begin(), _step.resources.end(), access.resource) != _step.resources.end();
+				if (info.attachment && attached)
+					continue;
+
+				if (info.attachment) {
+					AttachmentInfo attachment;
+					attachment.resource = access.resource;
+					attachment.layout = info.layout;
+					if (access.clear) {
+						attachment.loadOp = vk::AttachmentLoadOp::eClear;
+						attachment.clear = access.clear.value();
+					}
+					else
+						attachment.loadOp = resource.layout == vk::ImageLayout::eUndefined ? vk::AttachmentLoadOp::eDontCare : vk::AttachmentLoadOp::eLoad;
+
+					if (access.access == RenderGraphAccess::ColorAttachment)
+						_step.colors.push_back(attachment);
+					else
+						_step.depth = attachment;
+				}
+
+				// transitions of attachments joining the render pass are recorded before it begins
+				transition(access.resource, resource, info, _step.barriers);
+				if (!attached)
+					_step.resources.push_back(access.resource);
+			}
+		}
+
+		void RenderGraph::allocateTransients() {
+			std::vector<RenderGraphResource> transients;
+			std::vector<TransientKey> keys;
+			for (uint32_t i = 0; i < static_cast<uint32_t>(mResources.size()); ++i) {
+				const auto& resource = mResources[i];
+				if (resource.imported || resource.firstStep == ~0u)
+					continue;
+
+				transients.push_back(i);
+				keys.push_back({ resource.desc, resource.usage, resource.firstStep, resource.lastStep });
+			}
+
+			if (keys != mTransientKeys) {
+				releaseTransients();
+				mTransientKeys = keys;
+
+				const auto physicalDevice = mAllocator->getDevice()->getPhysicalDevice();
+				std::vector<vk::MemoryRequirements> requirements(transients.size());
+				mPhysicalImages.resize(transients.size());
+				for (size_t i = 0; i < transients.size(); ++i) {
+					const auto& resource = mResources[transients[i]];
+					auto& physical = mPhysicalImages[i];
+					physical.desc = resource.desc;
+					physical.usage = resource.usage;
+					physical.image = Image::CreateVkImage(mDevice,
+														  vk::ImageType::e2D,
+														  vk::Extent3D(resource.desc.extent, 1),
+														  resource.desc.format,
+														  resource.usage,
+														  1,
+														  1,
+														  resource.desc.samples);
+					requirements[i] = mDevice.getImageMemoryRequirements(physical.image);
+					physical.size = requirements[i].size;
+				}
+
+				// large images first, smaller ones then fill the memory of images they don't overlap with
+				std::vector<size_t> order(transients.size());
+				std::iota(order.begin(), order.end(), 0);
+				std::stable_sort(order.begin(), order.end(), [&](const size_t _a, const size_t _b) {
+					return requirements[_a].size > requirements[_b].size;
+				});
+
+				for (auto i : order) {
+					const auto& resource = mResources[transients[i]];
+					const auto& requirement = requirements[i];
+					auto& physical = mPhysicalImages[i];
+
+					auto memory = std::find_if(mMemories.begin(), mMemories.end(), [&](const SharedMemory& _memory) {
+						if (!(requirement.memoryTypeBits & (1u << _memory.memoryTypeIndex)) ||
+							_memory.block.size < requirement.size ||
+							_memory.block.offset % requirement.alignment != 0)
+							return false;
+
+						return std::none_of(_memory.lifetimes.begin(), _memory.lifetimes.end(), [&](const std::pair<uint32_t, uint32_t>& _lifetime) {
+							return resource.firstStep <= _lifetime.second && _lifetime.first <= resource.lastStep;
+						});
+					});
+
+					if (memory == mMemories.end()) {
+						SharedMemory shared;
+						shared.memoryTypeIndex = physicalDevice->getMemoryTypeIndex(requirement.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
+						shared.block = mAllocator->allocate(requirement.size, requirement.alignment, shared.memoryTypeIndex, ResourceClass::Optimal);
+						mMemories.push_back(shared);
+						memory = mMemories.end() - 1;
+					}
+
+					memory->lifetimes.emplace_back(resource.firstStep, resource.lastStep);
+					physical.memory = static_cast<uint32_t>(memory - mMemories.begin());
+					mDevice.bindImageMemory(physical.image, memory->block.memory, memory->block.offset);
+					physical.view = Image::CreateVkImageView2D(mDevice, physical.image, resource.desc.format, resource.aspect);
+				}
+			}
+
+			for (size_t i = 0; i < transients.size(); ++i) {
+				auto& resource = mResources[transients[i]];
+				resource.physical = static_cast<uint32_t>(i);
+				resource.image = mPhysicalImages[i].image;
+				resource.view = mPhysicalImages[i].view;
+				mStatistics.transientRequestedSize += mPhysicalImages[i].size;
+			}
+
+			mStatistics.transientImageCount = static_cast<uint32_t>(transients.size());
+			for (auto& memory : mMemories)
+				mStatistics.transientAllocatedSize += memory.block.size;
+		}
+
+		void RenderGraph::releaseTransients() {
+			if (mPhysicalImages.empty() && mMemories.empty())
+				return;
+
+			// frames in flight may still use the transients of the old layout
+			mDevice.waitIdle();
+			mFrameBuffers.clear();
+
+			for (auto& physical : mPhysicalImages) {
+				if (physical.view)
+					mDevice.destroyImageView(physical.view);
+				mDevice.destroyImage(physical.image);
+			}
+			for (auto& memory : mMemories)
+				mAllocator->deallocate(memory.block);
+
+			mPhysicalImages.clear();
+			mMemories.clear();
+			mTransientKeys.clear();
+		}
+
+		const std::shared_ptr<RenderPass>& RenderGraph::getRenderPass(const Step& _step) {
+			std::vector<uint32_t> key;
+			const auto addKey = [&](const AttachmentInfo& _attachment) {
+				const auto& desc = mResources[_attachment.resource].desc;
+				key.insert(key.end(), {
+					static_cast<uint32_t>(desc.format),
+					static_cast<uint32_t>(desc.samples),
+					static_cast<uint32_t>(_attachment.loadOp),
+					static_cast<uint32_t>(_attachment.storeOp),
+					static_cast<uint32_t>(_attachment.layout)
+						   });
+			};
+			for (auto& color : _step.colors)
+				addKey(color);
+			key.push_back(~0u);
+			if (_step.depth)
+				addKey(_step.depth.value());
+
+			auto& renderPass = mRenderPasses[key];
+			if (renderPass)
+				return renderPass;
+
+			// layouts don't change within the render pass, the barriers in front of it transition them
+			renderPass = std::make_shared<RenderPass>(mAllocator->getDevice());
+			Subpass subpass(0);
+			uint32_t binding = 0;
+			for (auto& color : _step.colors) {
+				const auto& desc = mResources[color.resource].desc;
+				renderPass->addAttachment(Attachment(binding, Attachment::Type::IMAGE, desc.format, desc.samples,
+													 color.loadOp, color.storeOp,
+													 vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
+													 color.layout, color.layout));
+				subpass.addRef(AttachmentRef(AttachmentRef::Type::COLOR, binding, color.layout));
+				++binding;
+			}
+			if (_step.depth) {
+				const auto& depth = _step.depth.value();
+				const auto& desc = mResources[depth.resource].desc;
+				const bool stencil = Image::HasStencil(desc.format);
+				renderPass->addAttachment(Attachment(binding, Attachment::Type::IMAGE, desc.format, desc.samples,
+													 depth.loadOp, depth.storeOp,
+													 stencil ? depth.loadOp : vk::AttachmentLoadOp::eDontCare,
+													 stencil ? depth.storeOp : vk::AttachmentStoreOp::eDontCare,
+													 depth.layout, depth.layout));
+				subpass.addRef(AttachmentRef(AttachmentRef::Type::DEPTH_STENCIL, binding, depth.layout));
+			}
+			renderPass->addSubpass(subpass);
+			renderPass->create();
+			return renderPass;
+		}
+
+		const FrameBuffer& RenderGraph::getFrameBuffer(const std::shared_ptr<RenderPass>& _renderPass, const Step& _step) {
+			std::vector<vk::ImageView> views;
+			for (auto& color : _step.colors)
+				views.push_back(mResources[color.resource].view);
+			if (_step.depth)
+				views.push_back(mResources[_step.depth->resource].view);
+
+			auto& frameBuffer = mFrameBuffers[std::make_pair(_renderPass->get(), views)];
+			if (!frameBuffer) {
+				frameBuffer = std::make_unique<FrameBuffer>(_renderPass, _step.extent);
+				frameBuffer->addAttachments(views);
+				frameBuffer->create();
+			}
+			return *frameBuffer;
+		}
+
+		void RenderGraph::record(const vk::CommandBuffer& _cmd, const Step& _step) {
+			if (!_step.barriers.empty()) {
+				std::vector<vk::ImageMemoryBarrier> barriers;
+				barriers.reserve(_step.barriers.size());
+				vk::PipelineStageFlags srcStages, dstStages;
+
+				for (auto& b : _step.barriers) {
+					const auto& resource = mResources[b.resource];
+					auto stages = b.srcStages;
+					auto access = b.srcAccess;
+
+					// the previous user of the memory of a transient may be an other image, or the last frame
+					if (b.discard) {
+						auto& memory = mMemories[mPhysicalImages[resource.physical].memory];
+						stages = memory.sync.writeStages | memory.sync.readStages;
+						access = memory.sync.writeAccess;
+						memory.sync = resource.sync;
+					}
+
+					barriers.emplace_back(access, b.dstAccess, b.oldLayout, b.newLayout,
+										  VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+										  resource.image, vk::ImageSubresourceRange(resource.aspect, 0, 1, 0, 1));
+					srcStages |= stages;
+					dstStages |= b.dstStages;
+				}
+
+				_cmd.pipelineBarrier(srcStages ? srcStages : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eTopOfPipe),
+									 dstStages,
+									 {},
+									 nullptr,
+									 nullptr,
+									 barriers);
+				++mStatistics.barrierBatchCount;
+				mStatistics.imageBarrierCount += static_cast<uint32_t>(barriers.size());
+			}
+
+			if (!_step.renderPass) {
+				for (auto pass : _step.passes) {
+					if (mPasses[pass].execute)
+						mPasses[pass].execute(_cmd);
+				}
+				return;
+			}
+
+			const auto& renderPass = getRenderPass(_step);
+			const auto& frameBuffer = getFrameBuffer(renderPass, _step);
+
+			std::vector<vk::ClearValue> clearValues;
+			for (auto& color : _step.colors)
+				clearValues.push_back(color.clear);
+			if (_step.depth)
+				clearValues.push_back(_step.depth->clear);
+
+			renderPass->beginRenderPass(_cmd, frameBuffer.get(), clearValues, _step.extent);
+			for (auto pass : _step.passes) {
+				if (mPasses[pass].execute)
+					mPasses[pass].execute(_cmd);
+			}
+			renderPass->endRenderPass(_cmd);
+			++mStatistics.renderPassCount;
+		}
+	}
+}
@@ -0,0 +1,306 @@
+#pragma once
+#ifndef MX_VK_RENDER_GRAPH_H_
+#define MX_VK_RENDER_GRAPH_H_
+
+#include "../Memory/MxVkAllocator.h"
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Mix {
+	namespace Vulkan {
+		class RenderPass;
+		class FrameBuffer;
+		class RenderGraph;
+
+		using RenderGraphResource = uint32_t;
+
+		constexpr RenderGraphResource InvalidRenderGraphResource = ~0u;
+
+		/** @brief How a pass uses an image, decides its layout, the pipeline stages and the access flags */
+		enum class RenderGraphAccess {
+			ColorAttachment,
+			DepthAttachment,
+			// depth test without depth writes
+			DepthReadOnly,
+			SampledFragment,
+			SampledCompute,
+			StorageRead,
+			StorageWrite,
+			TransferSrc,
+			TransferDst
+		};
+
+		struct RenderGraphImageDesc {
+			vk::Format format = vk::Format::eUndefined;
+			vk::Extent2D extent;
+			vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+
+			bool operator==(const RenderGraphImageDesc& _other) const {
+				return format == _other.format && extent == _other.extent && samples == _other.samples;
+			}
+		};
+
+		/** @brief Declares the images a pass creates, reads and writes, handed to the setup function of RenderGraph::addPass() */
+		class RenderGraphBuilder {
+		public:
+			/** @brief Image living only within the frame, its memory is shared with transients of passes that don't overlap */
+			RenderGraphResource createImage(const std::string& _name, const RenderGraphImageDesc& _desc);
+
+			/** @brief Render to @p _image, the previous content is kept unless a clear value is given */
+			void writeColor(RenderGraphResource _image, std::optional<vk::ClearColorValue> _clear = std::nullopt);
+
+			void writeDepth(RenderGraphResource _image, std::optional<vk::ClearDepthStencilValue> _clear = std::nullopt);
+
+			void readDepth(RenderGraphResource _image);
+
+			/** @brief Use @p _image outside of the render pass of the pass, e.g. sampled or as a copy source */
+			void read(RenderGraphResource _image, RenderGraphAccess _access);
+
+			void write(RenderGraphResource _image, RenderGraphAccess _access);
+
+			/** @brief Keep the pass even if nothing reads its images, e.g. it only writes buffers the graph doesn't track */
+			void setSideEffect();
+
+		private:
+			friend RenderGraph;
+
+			RenderGraphBuilder(RenderGraph& _graph, const uint32_t _pass) :mGraph(_graph), mPass(_pass) {}
+
+			void use(RenderGraphResource _image, RenderGraphAccess _access, std::optional<vk::ClearValue> _clear);
+
+			RenderGraph& mGraph;
+			uint32_t mPass;
+		};
+
+		/**
+		 * @brief Frame graph recording the passes of a frame with their synchronization.
+		 *
+		 * Passes are declared every frame with the images they read and write. On execute() the graph culls
+		 * passes whose results are never used, batches the barriers and layout transitions in front of each
+		 * pass and merges consecutive graphics passes drawing to the same attachments into one render pass.
+		 * Passes run in the order they were added, which already respects their dependencies.
+		 *
+		 * Transient images are backed by memory from the DeviceAllocator that is shared by transients whose
+		 * lifetimes don't overlap, and kept across frames as long as the declared transients don't change.
+		 * Render passes use a single subpass with color attachments first and depth last, so pipelines created
+		 * against any render pass with the same formats in that order can be used by the passes.
+		 */
+		class RenderGraph :public GeneralBase::NoCopyBase {
+		public:
+			using Execute = std::function<void(const vk::CommandBuffer&)>;
+
+			struct Statistics {
+				uint32_t passCount = 0;
+				uint32_t culledPassCount = 0;
+				uint32_t renderPassCount = 0;
+				uint32_t barrierBatchCount = 0;
+				uint32_t imageBarrierCount = 0;
+				uint32_t transientImageCount = 0;
+				// memory of the transients without and with aliasing
+				vk::DeviceSize transientRequestedSize = 0;
+				vk::DeviceSize transientAllocatedSize = 0;
+			};
+
+			explicit RenderGraph(const std::shared_ptr<DeviceAllocator>& _allocator);
+
+			~RenderGraph();
+
+			/** @brief Drop the passes and resources declared for the last frame, allocated memory is kept */
+			void reset();
+
+			/**
+			 * @brief Use an image owned elsewhere, e.g. a swapchain image.
+			 * @param _initialLayout Layout the image is in, undefined if its content may be discarded
+			 * @param _finalLayout Layout to leave the image in, undefined if it isn't used after the graph.
+			 *        Images with a final layout are results of the graph, passes writing them are never culled
+			 * @param _waitStage Stage a semaphore makes wait for the image before the graph, e.g. color attachment output for swapchain images
+			 */
+			RenderGraphResource importImage(const std::string& _name,
+											const vk::Image& _image,
+											const vk::ImageView& _view,
+											const RenderGraphImageDesc& _desc,
+											vk::ImageLayout _initialLayout,
+											vk::ImageLayout _finalLayout,
+											vk::PipelineStageFlags _waitStage = vk::PipelineStageFlagBits::eTopOfPipe);
+
+			/** @brief Add a pass, @p _setup declares its resources right away and @p _execute records it if it isn't culled */
+			void addPass(const std::string& _name, const std::function<void(RenderGraphBuilder&)>& _setup, Execute _execute);
+
+			/** @brief Record the passes of the frame with their barriers and render passes into @p _cmd */
+			void execute(const vk::CommandBuffer& _cmd);
+
+			/** @brief Image of a resource, transients are only valid while the passes execute */
+			const vk::Image& getImage(RenderGraphResource _image) const { return mResources[_image].image; }
+
+			const vk::ImageView& getImageView(RenderGraphResource _image) const { return mResources[_image].view; }
+
+			const RenderGraphImageDesc& getDesc(RenderGraphResource _image) const { return mResources[_image].desc; }
+
+			const Statistics& getStatistics() const { return mStatistics; }
+
+		private:
+			friend RenderGraphBuilder;
+
+			struct AccessInfo {
+				vk::ImageLayout layout;
+				vk::PipelineStageFlags stages;
+				vk::AccessFlags access;
+				vk::ImageUsageFlags usage;
+				bool write;
+				bool attachment;
+			};
+
+			static AccessInfo GetAccessInfo(RenderGraphAccess _access);
+
+			/** @brief Stages and accesses since the last barrier, tracked per image and per shared memory */
+			struct SyncState {
+				vk::PipelineStageFlags writeStages;
+				vk::AccessFlags writeAccess;
+				vk::PipelineStageFlags readStages;
+				// stages the last write has been made visible to
+				vk::PipelineStageFlags visibleStages;
+			};
+
+			struct Resource {
+				std::string name;
+				RenderGraphImageDesc desc;
+				vk::ImageUsageFlags usage;
+				vk::ImageAspectFlags aspect;
+				vk::Image image;
+				vk::ImageView view;
+
+				bool imported = false;
+				vk::ImageLayout initialLayout = vk::ImageLayout::eUndefined;
+				vk::ImageLayout finalLayout = vk::ImageLayout::eUndefined;
+				vk::PipelineStageFlags waitStage;
+
+				// steps of the frame using the image, a transient may only share memory outside of them
+				uint32_t firstStep = ~0u;
+				uint32_t lastStep = 0;
+				uint32_t physical = ~0u;
+
+				vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+				SyncState sync;
+			};
+
+			struct Access {
+				RenderGraphResource resource;
+				RenderGraphAccess access;
+				std::optional<vk::ClearValue> clear;
+			};
+
+			struct Pass {
+				std::string name;
+				std::vector<Access> accesses;
+				Execute execute;
+				bool sideEffect = false;
+				bool culled = false;
+			};
+
+			struct Barrier {
+				RenderGraphResource resource;
+				vk::ImageLayout oldLayout;
+				vk::ImageLayout newLayout;
+				vk::PipelineStageFlags srcStages;
+				vk::AccessFlags srcAccess;
+				vk::PipelineStageFlags dstStages;
+				vk::AccessFlags dstAccess;
+				// first use of a transient in the frame, it waits for the last user of its memory instead
+				bool discard = false;
+			};
+
+			struct AttachmentInfo {
+				RenderGraphResource resource;
+				vk::ImageLayout layout;
+				vk::AttachmentLoadOp loadOp;
+				vk::AttachmentStoreOp storeOp = vk::AttachmentStoreOp::eDontCare;
+				vk::ClearValue clear;
+			};
+
+			/** @brief Barriers followed by a single pass or by a render pass shared by several graphics passes */
+			struct Step {
+				std::vector<Barrier> barriers;
+				std::vector<uint32_t> passes;
+				std::vector<RenderGraphResource> resources;
+
+				bool renderPass = false;
+				std::vector<AttachmentInfo> colors;
+				std::optional<AttachmentInfo> depth;
+				vk::Extent2D extent;
+			};
+
+			struct PhysicalImage {
+				RenderGraphImageDesc desc;
+				vk::ImageUsageFlags usage;
+				vk::Image image;
+				vk::ImageView view;
+				vk::DeviceSize size = 0;
+				uint32_t memory = 0;
+			};
+
+			struct SharedMemory {
+				MemoryBlock block;
+				uint32_t memoryTypeIndex = 0;
+				// steps of the transients placed in this memory during the current layout
+				std::vector<std::pair<uint32_t, uint32_t>> lifetimes;
+				SyncState sync;
+			};
+
+			/** @brief Declared transients in order, physical images are only rebuilt when this changes */
+			struct TransientKey {
+				RenderGraphImageDesc desc;
+				vk::ImageUsageFlags usage;
+				uint32_t firstStep;
+				uint32_t lastStep;
+
+				bool operator==(const TransientKey& _other) const {
+					return desc == _other.desc && usage == _other.usage &&
+						firstStep == _other.firstStep && lastStep == _other.lastStep;
+				}
+			};
+
+			void cull();
+
+			void plan();
+
+			/** @brief Add the barrier needed before @p _info to @p _barriers and update the state of the image */
+			bool transition(RenderGraphResource _index, Resource& _resource, const AccessInfo& _info, std::vector<Barrier>& _barriers) const;
+
+			/** @brief Whether @p _pass can be drawn in the render pass of @p _step without ending it */
+			bool canMerge(const Step& _step, const Pass& _pass) const;
+
+			void addToRenderPass(Step& _step, const Pass& _pass);
+
+			void allocateTransients();
+
+			void releaseTransients();
+
+			const std::shared_ptr<RenderPass>& getRenderPass(const Step& _step);
+
+			const FrameBuffer& getFrameBuffer(const std::shared_ptr<RenderPass>& _renderPass, const Step& _step);
+
+			void record(const vk::CommandBuffer& _cmd, const Step& _step);
+
+			std::shared_ptr<DeviceAllocator> mAllocator;
+			vk::Device mDevice;
+
+			std::vector<Resource> mResources;
+			std::vector<Pass> mPasses;
+			std::vector<Step> mSteps;
+
+			std::vector<TransientKey> mTransientKeys;
+			std::vector<PhysicalImage> mPhysicalImages;
+			std::vector<SharedMemory> mMemories;
+
+			std::map<std::vector<uint32_t>, std::shared_ptr<RenderPass>> mRenderPasses;
+			std::map<std::pair<vk::RenderPass, std::vector<vk::ImageView>>, std::unique_ptr<FrameBuffer>> mFrameBuffers;
+
+			Statistics mStatistics;
+		};
+	}
+}
+
+#endif // !MX_VK_RENDER_GRAPH_H_
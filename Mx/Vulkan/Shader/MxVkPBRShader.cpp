@@ -16,14 +16,29 @@
 #include "../../Graphics/Mesh/MxMesh.h"
 #include "../Pipeline/MxVkPipeline.h"
 #include "../../Component/MeshFilter/MxMeshFilter.h"
+#include "../../Graphics/Lighting/MxLightClusterer.h"
+#include <cstring>
 
 namespace Mix {
     namespace Vulkan {
+        namespace {
+            // interned once, they are looked up for every element
+            const PropertyId TextureIds[] = { "colorMap", "physicalDescriptorMap", "normalMap", "aoMap", "emissiveMap" };
+            const PropertyId AlphaMaskId = "alphaMask";
+            const PropertyId WorkflowId = "workflow";
+
+            const PropertyId LightPosId = "lightPos";
+            const PropertyId LightColorId = "lightColor";
+            const PropertyId ExposureId = "exposure";
+            const PropertyId GammaId = "gamma";
+            const PropertyId PrefilteredCubeMipLevelsId = "prefilteredCubeMipLevels";
+            const PropertyId ScaleIBLAmbientId = "scaleIBLAmbient";
+        }
 
         PBRShader::PBRShader(VulkanAPI* _vulkan) :ShaderBase(_vulkan) {
             mDevice = mVulkan->getLogicalDevice();
 
-            auto imageCount = mVulkan->getSwapchain()->imageCount();
+            auto imageCount = mVulkan->getFrameCount();
             mCameraUbo.reserve(imageCount);
             mRenderParamUbo.reserve(imageCount);
 
@@ -44,6 +59,7 @@ namespace Mix {
             buildDescriptorSetLayout();
             buildPipeline();
             buildDescriptorSet();
+            buildLightBuffers();
             buildPropertyBlock();
         }
 
@@ -55,18 +71,18 @@ namespace Mix {
 
             choosePipeline(*_element.material, *_element.mesh, _element.submesh);
             setMaterail(*_element.material);
-            DrawMesh(*mCurrCmd, *_element.mesh, _element.submesh);
+            DrawMesh(*mCurrCmd, *_element.mesh, _element.submesh, mBoundGeometry);
 
             endElement();
         }
 
         void PBRShader::update(const Shader& _shader) {
-            mRenderParam.lightDir = _shader.getGlobalVector("lightPos").value();
-            mRenderParam.lightColor = _shader.getGlobalVector("lightColor").value();
-            mRenderParam.exposure = _shader.getGlobalFloat("exposure").value();
-            mRenderParam.gamma = _shader.getGlobalFloat("gamma").value();
-            mRenderParam.prefilteredCubeMipLevels = _shader.getGlobalFloat("prefilteredCubeMipLevels").value();
-            mRenderParam.scaleIBLAmbient = _shader.getGlobalFloat("scaleIBLAmbient").value();
+            mRenderParam.lightDir = _shader.getGlobalVector(LightPosId).value();
+            mRenderParam.lightColor = _shader.getGlobalVector(LightColorId).value();
+            mRenderParam.exposure = _shader.getGlobalFloat(ExposureId).value();
+            mRenderParam.gamma = _shader.getGlobalFloat(GammaId).value();
+            mRenderParam.prefilteredCubeMipLevels = _shader.getGlobalFloat(PrefilteredCubeMipLevelsId).value();
+            mRenderParam.scaleIBLAmbient = _shader.getGlobalFloat(ScaleIBLAmbientId).value();
         }
 
         void PBRShader::beginRender(const Camera& _camera) {
@@ -74,6 +90,7 @@ namespace Mix {
             mCurrCmd = &mVulkan->getCurrDrawCmd();
             mCurrVertexInput = nullptr;
             mCurrPipeline = nullptr;
+            mBoundGeometry.reset();
 
             auto& cmd = mVulkan->getCurrDrawCmd();
 
@@ -82,6 +99,13 @@ namespace Mix {
 
             // update render param
             mRenderParamUbo[mCurrFrame].setData(&mRenderParam, sizeof(mRenderParam));
+
+            // other shaders may have bound sets in between, the lights stay bound for the whole pass
+            mCurrCmd->get().bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                               mGraphicsPipelineState->getPipelineLayout(),
+                                               2,
+                                               mLightFrames[mCurrFrame].descriptorSet.get(),
+                                               nullptr);
         }
 
         void PBRShader::endRender() {
@@ -125,7 +149,7 @@ namespace Mix {
             mCurrCmd->get().pushConstants<Matrix4>(mGraphicsPipelineState->getPipelineLayout(),
                                                    vk::ShaderStageFlagBits::eVertex,
                                                    0,
-                                                   _element.transform->localToWorldMatrix());
+                                                   _element.transform->localToWorldMatrix() * _element.mesh->getVertexTransform());
             mCurrCmd->get().bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
                                                mGraphicsPipelineState->getPipelineLayout(),
                                                0,
@@ -138,41 +162,161 @@ namespace Mix {
 
         bool PBRShader::choosePipeline(const Material& _material, const Mesh& _mesh, uint32_t _submesh) {
             bool depthWrite = _material.getRenderType() != RenderType::Transparent;
+            // the pre-pass has written the depth of opaque elements, only the frontmost surface is shaded
+            const bool depthEqual = depthWrite && mDepthPrePass && UsesDepthPass(_material);
+
+            const uint32_t variant = GetVariant(_material);
 
             auto newVertexInput = mVulkan->getVertexInputManager().getVertexInput(*_mesh.getVertexDeclaration(), *mGraphicsPipelineState->getVertexDeclaration());
             if (newVertexInput == nullptr) // This mesh is not compatiple with this pipeline
                 return false;
-            if (newVertexInput != mCurrVertexInput) {
-                auto newPipeline = mGraphicsPipelineState->getPipeline(mVulkan->getRenderPass(), 0, newVertexInput, _mesh.getTopology(_submesh), true, depthWrite);
+            if (newVertexInput != mCurrVertexInput || depthEqual != mCurrDepthEqual || variant != mCurrVariant) {
+                // variants are compiled the first time a material needs them and cached with the pipeline
+                auto newPipeline = mGraphicsPipelineState->getPipeline(mVulkan->getRenderPass(), 0, newVertexInput, _mesh.getTopology(_submesh),
+                                                                       true, depthWrite && !depthEqual, false,
+                                                                       depthEqual ? vk::CompareOp::eEqual : vk::CompareOp::eLess,
+                                                                       variant);
                 if (newPipeline != mCurrPipeline) {
                     mCurrCmd->get().bindPipeline(vk::PipelineBindPoint::eGraphics, newPipeline->get());
                     mCurrPipeline = newPipeline;
                 }
                 mCurrVertexInput = newVertexInput;
+                mCurrDepthEqual = depthEqual;
+                mCurrVariant = variant;
             }
             return true;
         }
 
+        uint32_t PBRShader::GetVariant(const Material& _material) {
+            uint32_t variant = 0;
+            // the texture bits follow the order of TextureIds
+            for (uint32_t i = 0; i < 5; ++i) {
+                if (_material.getTexture(TextureIds[i]))
+                    variant |= 1u << i;
+            }
+            if (_material.getFloat(AlphaMaskId).value_or(0.0f) != 0.0f)
+                variant |= Variant_AlphaMask;
+            if (_material.getFloat(WorkflowId).value_or(0.0f) != 0.0f)
+                variant |= Variant_SpecularGlossiness;
+            return variant;
+        }
+
+        bool PBRShader::UsesDepthPass(const Material& _material) {
+            return _material.getFloat(AlphaMaskId).value_or(0.0f) == 0.0f;
+        }
+
+        void PBRShader::renderDepth(RenderElement& _element) {
+            if (!UsesDepthPass(*_element.material))
+                return;
+
+            auto& mesh = *_element.mesh;
+            auto vertexInput = mVulkan->getVertexInputManager().getVertexInput(*mesh.getVertexDeclaration(), *mDepthPipelineState->getVertexDeclaration());
+            if (vertexInput == nullptr)
+                return;
+
+            // the depth pipeline shares its layout with the shading one
+            beginElement(_element);
+
+            if (vertexInput != mCurrVertexInput) {
+                auto pipeline = mDepthPipelineState->getPipeline(mVulkan->getRenderPass(), 0, vertexInput, mesh.getTopology(_element.submesh));
+                if (pipeline != mCurrPipeline) {
+                    mCurrCmd->get().bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline->get());
+                    mCurrPipeline = pipeline;
+                }
+                mCurrVertexInput = vertexInput;
+            }
+            DrawMesh(*mCurrCmd, mesh, _element.submesh, mBoundGeometry);
+
+            endElement();
+        }
+
+        void PBRShader::prepareLights(const LightClusterer& _lights) {
+            // the fence of the frame has been waited on, its buffers are no longer read
+            auto& frame = mLightFrames[mVulkan->getCurrFrame()];
+            reserveLights(frame, _lights);
+
+            frame.params->setData(&_lights.getParams(), sizeof(LightClusterParams));
+            if (!_lights.getLights().empty())
+                std::memcpy(frame.lights->rawPtr(), _lights.getLights().data(), _lights.getLights().size() * sizeof(ClusterLight));
+            if (!_lights.getClusters().empty())
+                std::memcpy(frame.clusters->rawPtr(), _lights.getClusters().data(), _lights.getClusters().size() * sizeof(LightCluster));
+            if (!_lights.getIndices().empty())
+                std::memcpy(frame.indices->rawPtr(), _lights.getIndices().data(), _lights.getIndices().size() * sizeof(uint32_t));
+        }
+
+        void PBRShader::reserveLights(LightFrame& _frame, const LightClusterer& _lights) {
+            const auto storageBuffer = [this](const vk::DeviceSize _size) {
+                return std::make_shared<Buffer>(mVulkan->getAllocator(),
+                                                vk::BufferUsageFlagBits::eStorageBuffer,
+                                                vk::MemoryPropertyFlagBits::eHostVisible |
+                                                vk::MemoryPropertyFlagBits::eHostCoherent,
+                                                _size);
+            };
+            // grown by half again, so a slowly rising light count doesn't reallocate every frame
+            const auto grow = [](const size_t _count, const uint32_t _minimum) {
+                return std::max(_minimum, static_cast<uint32_t>(_count + _count / 2));
+            };
+
+            bool changed = false;
+
+            if (!_frame.params) {
+                _frame.params = std::make_shared<Buffer>(mVulkan->getAllocator(),
+                                                         vk::BufferUsageFlagBits::eUniformBuffer,
+                                                         vk::MemoryPropertyFlagBits::eHostVisible |
+                                                         vk::MemoryPropertyFlagBits::eHostCoherent,
+                                                         sizeof(LightClusterParams));
+                changed = true;
+            }
+
+            if (!_frame.lights || _frame.lightCapacity < _lights.getLights().size()) {
+                _frame.lightCapacity = grow(_lights.getLights().size(), 64);
+                _frame.lights = storageBuffer(_frame.lightCapacity * sizeof(ClusterLight));
+                changed = true;
+            }
+
+            if (!_frame.clusters || _frame.clusterCapacity < _lights.getClusters().size()) {
+                _frame.clusterCapacity = std::max(1u, static_cast<uint32_t>(_lights.getClusters().size()));
+                _frame.clusters = storageBuffer(_frame.clusterCapacity * sizeof(LightCluster));
+                changed = true;
+            }
+
+            if (!_frame.indices || _frame.indexCapacity < _lights.getIndices().size()) {
+                _frame.indexCapacity = grow(_lights.getIndices().size(), 1024);
+                _frame.indices = storageBuffer(_frame.indexCapacity * sizeof(uint32_t));
+                changed = true;
+            }
+
+            if (!changed)
+                return;
+
+            std::vector<WriteDescriptorSet> writes{
+                _frame.params->getWriteDescriptor(0, vk::DescriptorType::eUniformBuffer),
+                _frame.lights->getWriteDescriptor(1, vk::DescriptorType::eStorageBuffer),
+                _frame.clusters->getWriteDescriptor(2, vk::DescriptorType::eStorageBuffer),
+                _frame.indices->getWriteDescriptor(3, vk::DescriptorType::eStorageBuffer)
+            };
+            _frame.descriptorSet.updateDescriptor(writes);
+        }
+
         void PBRShader::updateTexture(Material& _material) {
-            if (!_material._getChangedList().empty()) {
-                std::vector<WriteDescriptorSet> writes;
-                static std::string texNames[] = {
-                    "colorMap",
-                    "physicalDescriptorMap",
-                    "normalMap",
-                    "aoMap",
-                    "emissiveMap"
-                };
+            _material._checkTextureRevisions();
 
+            if (_material._getDirtyMask() != 0) {
                 bool textureChanged = false;
                 for (uint32_t i = 0; i < 5; ++i) {
-                    if (_material._getChangedList().count(texNames[i])) {
-                        writes.push_back(_material.getTexture(texNames[i])->getWriteDescriptor(i, vk::DescriptorType::eCombinedImageSampler));
+                    if (_material._isDirty(TextureIds[i])) {
                         textureChanged = true;
+                        break;
                     }
                 }
 
                 if (textureChanged) {
+                    // the set swapped in may hold outdated views, so every binding is written
+                    std::vector<WriteDescriptorSet> writes;
+                    for (uint32_t i = 0; i < 5; ++i) {
+                        if (auto texture = _material.getTexture(TextureIds[i]))
+                            writes.push_back(texture->getWriteDescriptor(i, vk::DescriptorType::eCombinedImageSampler));
+                    }
 
                     std::swap(mMaterialDescs[0][_material._getMaterialId()], mMaterialDescs[1][_material._getMaterialId()]);
                     mMaterialDescs[0][_material._getMaterialId()].updateDescriptor(writes);
@@ -184,23 +328,10 @@ namespace Mix {
         void PBRShader::setMaterail(Material& _material) {
             updateTexture(_material);
 
-            MaterialParam param;
-            param.baseColorFactor = _material.getVector("baseColorFactor").value();
-            param.emissiveFactor = _material.getVector("emissiveFactor").value();
-            param.workflow = _material.getFloat("workflow").value();
-            param.diffuseFactor = _material.getVector("diffuseFactor").value();
-            param.specularFactor = _material.getVector("specularFactor").value();
-            param.hasBaseColorTexture = _material.getFloat("hasBaseColorTexture").value();
-            param.hasPhysicalDescriptorTexture = _material.getFloat("hasPhysicalDescriptorTexture").value();
-            param.hasNormalTexture = _material.getFloat("hasNormalTexture").value();
-            param.hasOcclusionTexture = _material.getFloat("hasOcclusionTexture").value();
-            param.hasEmissiveTexture = _material.getFloat("hasEmissiveTexture").value();
-            param.metallicFactor = _material.getFloat("metallicFactor").value();
-            param.roughnessFactor = _material.getFloat("roughnessFactor").value();
-            param.alphaMask = _material.getFloat("alphaMask").value();
-            param.alphaMaskCutoff = _material.getFloat("alphaMaskCutoff").value();
-
-            mCurrCmd->get().pushConstants<MaterialParam>(mGraphicsPipelineState->getPipelineLayout(), vk::ShaderStageFlagBits::eFragment, sizeof(Matrix4), param);
+            // the block is packed in the layout of MaterialParam, see buildPropertyBlock()
+            const auto& block = _material._getParamBlock();
+            mCurrCmd->get().pushConstants(mGraphicsPipelineState->getPipelineLayout(), vk::ShaderStageFlagBits::eFragment,
+                                          sizeof(Matrix4), static_cast<uint32_t>(block.size()), block.data());
 
             mCurrCmd->get().bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
                                                mCurrPipeline->pipelineLayout(),
@@ -233,6 +364,18 @@ namespace Mix {
                 }
             );
             mDynamicPamramDescriptorSetLayout->create();
+
+            // clustered lights, see ClusteredLighting.glsl
+            mLightDescriptorSetLayout = std::make_shared<DescriptorSetLayout>(mDevice);
+            mLightDescriptorSetLayout->setBindings(
+                {
+                    {0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eFragment},
+                    {1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eFragment},
+                    {2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eFragment},
+                    {3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eFragment}
+                }
+            );
+            mLightDescriptorSetLayout->create();
         }
 
         void PBRShader::buildPipeline() {
@@ -255,17 +398,29 @@ namespace Mix {
             desc.enableDepthTest = true;
             desc.enableWriteDepth = true;
 
-            desc.descriptorSetLayouts = { mStaticParamDescriptorSetLayout,mDynamicPamramDescriptorSetLayout };
+            desc.descriptorSetLayouts = { mStaticParamDescriptorSetLayout,mDynamicPamramDescriptorSetLayout,mLightDescriptorSetLayout };
             desc.blendStates = { GraphicsPipelineState::DefaultBlendAttachment };
 
             desc.pushConstant.emplace_back(vk::ShaderStageFlagBits::eVertex, 0, sizeof(Matrix4));
             desc.pushConstant.emplace_back(vk::ShaderStageFlagBits::eFragment, sizeof(Matrix4), sizeof(MaterialParam));
 
+            desc.variantConstantCount = VariantConstantCount;
+
             mGraphicsPipelineState = std::make_shared<GraphicsPipelineState>(mDevice, desc);
+
+            // the depth pre-pass keeps the layout, so sets and push constants stay bound across both passes
+            auto depthVert = ResourceLoader::Get()->load<ShaderSource>("Resource/Shaders/DepthOnly.vert");
+            desc.gpuProgram.vertex = std::make_shared<ShaderModule>(mDevice, *depthVert);
+            desc.gpuProgram.fragment = nullptr;
+            desc.vertexDecl = std::make_shared<VertexDeclaration>(Flags<VertexAttribute>(VertexAttribute::Position));
+            desc.blendStates = { GraphicsPipelineState::NoColorWriteAttachment };
+            desc.variantConstantCount = 0;
+
+            mDepthPipelineState = std::make_shared<GraphicsPipelineState>(mDevice, desc);
         }
 
         void PBRShader::buildDescriptorSet() {
-            auto imageCount = mVulkan->getSwapchain()->imageCount();
+            auto imageCount = mVulkan->getFrameCount();
 
             mDescriptorPool = std::make_shared<DescriptorPool>(mDevice);
             mDescriptorPool->addPoolSize(vk::DescriptorType::eUniformBuffer, imageCount * 2);
@@ -292,6 +447,24 @@ namespace Mix {
                 mMaterialDescs[i] = mDescriptorPool->allocDescriptorSet(*mDynamicPamramDescriptorSetLayout, mDefaultMaterialCount);
         }
 
+        void PBRShader::buildLightBuffers() {
+            auto imageCount = mVulkan->getFrameCount();
+
+            mLightDescriptorPool = std::make_shared<DescriptorPool>(mDevice);
+            mLightDescriptorPool->addPoolSize(vk::DescriptorType::eUniformBuffer, imageCount);
+            mLightDescriptorPool->addPoolSize(vk::DescriptorType::eStorageBuffer, 3 * imageCount);
+            mLightDescriptorPool->create(imageCount);
+
+            // frames are valid without lights, every froxel then reads an empty list
+            LightClusterer empty;
+            mLightFrames.resize(imageCount);
+            for (auto& frame : mLightFrames) {
+                frame.descriptorSet = mLightDescriptorPool->allocDescriptorSet(*mLightDescriptorSetLayout);
+                reserveLights(frame, empty);
+                frame.params->setData(&empty.getParams(), sizeof(LightClusterParams));
+            }
+        }
+
         void PBRShader::buildPropertyBlock() {
             std::vector<MaterialPropertyInfo> properties = {
                 MaterialPropertyInfo("baseColorFactor",                 MaterialPropertyType::VECTOR,   Vector4f::One),
@@ -299,11 +472,6 @@ namespace Mix {
                 MaterialPropertyInfo("workflow",                        MaterialPropertyType::FLOAT,      0.0f),
                 MaterialPropertyInfo("diffuseFactor",                   MaterialPropertyType::VECTOR,   Vector4f::Zero),
                 MaterialPropertyInfo("specularFactor",                  MaterialPropertyType::VECTOR,   Vector4f::Zero),
-                MaterialPropertyInfo("hasBaseColorTexture",             MaterialPropertyType::FLOAT,    0.0f),
-                MaterialPropertyInfo("hasPhysicalDescriptorTexture",    MaterialPropertyType::FLOAT,    0.0f),
-                MaterialPropertyInfo("hasNormalTexture",                MaterialPropertyType::FLOAT,    0.0f),
-                MaterialPropertyInfo("hasOcclusionTexture",             MaterialPropertyType::FLOAT,    0.0f),
-                MaterialPropertyInfo("hasEmissiveTexture",              MaterialPropertyType::FLOAT,    0.0f),
                 MaterialPropertyInfo("metallicFactor",                  MaterialPropertyType::FLOAT,    0.0f),
                 MaterialPropertyInfo("roughnessFactor",                 MaterialPropertyType::FLOAT,    0.0f),
                 MaterialPropertyInfo("alphaMask",                       MaterialPropertyType::FLOAT,    0.0f),
@@ -318,6 +486,12 @@ namespace Mix {
             };
             mMaterialPropertySet.insert(properties.begin(), properties.end());
 
+            // members of MaterialParam in order, workflow, alphaMask and the textures select the variant instead
+            mPackedMaterialProperties = {
+                "baseColorFactor", "emissiveFactor", "diffuseFactor", "specularFactor",
+                "metallicFactor", "roughnessFactor", "alphaMaskCutoff"
+            };
+
             properties = {
                 MaterialPropertyInfo("lightPos",MaterialPropertyType::VECTOR,Vector4f::Zero),
                 MaterialPropertyInfo("lightColor",MaterialPropertyType::VECTOR,Vector4f::One),
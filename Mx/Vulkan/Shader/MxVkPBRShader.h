@@ -1,6 +1,7 @@
 #pragma once
 #include "MxVkShaderBase.h"
 #include "../Buffers/MxVkUniformBuffer.h"
+#include "../Descriptor/MxVkDescriptorSet.h"
 #include <vulkan/vulkan.hpp>
 #include <deque>
 
@@ -39,21 +40,38 @@ namespace Mix {
 
             void deleteMaterial(uint32_t _id) override;
 
+            bool hasDepthPass() const override { return true; }
+
+            void renderDepth(RenderElement& _element) override;
+
+            void prepareLights(const LightClusterer& _lights) override;
+
+            /**
+             * @brief Features of a material compiled into the fragment shader as specialization constants,
+             *        bit i is the boolean constant with constant_id i
+             */
+            enum Variant :uint32_t {
+                Variant_BaseColorTexture = 1 << 0,
+                Variant_PhysicalDescriptorTexture = 1 << 1,
+                Variant_NormalTexture = 1 << 2,
+                Variant_OcclusionTexture = 1 << 3,
+                Variant_EmissiveTexture = 1 << 4,
+                Variant_AlphaMask = 1 << 5,
+                Variant_SpecularGlossiness = 1 << 6,
+                VariantConstantCount = 7
+            };
+
+            /** @brief Variant matching the textures bound to @p _material and its flags */
+            static uint32_t GetVariant(const Material& _material);
+
         private:
             struct MaterialParam {
                 Vector4f baseColorFactor;
                 Vector4f emissiveFactor;
                 Vector4f diffuseFactor;
                 Vector4f specularFactor;
-                float workflow;
-                float hasBaseColorTexture;
-                float hasPhysicalDescriptorTexture;
-                float hasNormalTexture;
-                float hasOcclusionTexture;
-                float hasEmissiveTexture;
                 float metallicFactor;
                 float roughnessFactor;
-                float alphaMask;
                 float alphaMaskCutoff;
             };
 
@@ -74,6 +92,9 @@ namespace Mix {
 
             bool choosePipeline(const Material& _material, const Mesh& _mesh, uint32_t _submesh);
 
+            /** @brief Alpha masked materials discard fragments, their depth is only written while shading */
+            static bool UsesDepthPass(const Material& _material);
+
             void updateTexture(Material& _material);
 
             void setMaterail(Material& _material);
@@ -90,10 +111,29 @@ namespace Mix {
 
             void buildPropertyBlock();
 
+            /** @brief Per frame buffers of the clustered lights, bound as set 2 of the fragment shader */
+            struct LightFrame {
+                std::shared_ptr<Buffer> params;
+                std::shared_ptr<Buffer> lights;
+                std::shared_ptr<Buffer> clusters;
+                std::shared_ptr<Buffer> indices;
+                uint32_t lightCapacity = 0;
+                uint32_t clusterCapacity = 0;
+                uint32_t indexCapacity = 0;
+                DescriptorSet descriptorSet;
+            };
+
+            void buildLightBuffers();
+
+            /** @brief Grow the buffers of @p _frame to hold @p _lights and rewrite its descriptor set when they changed */
+            void reserveLights(LightFrame& _frame, const LightClusterer& _lights);
+
 
             std::shared_ptr<Device> mDevice;
 
             std::shared_ptr<GraphicsPipelineState> mGraphicsPipelineState;
+            // position only variant for the depth pre-pass
+            std::shared_ptr<GraphicsPipelineState> mDepthPipelineState;
 
             std::shared_ptr<DescriptorSetLayout> mStaticParamDescriptorSetLayout;
             std::shared_ptr<DescriptorSetLayout> mDynamicPamramDescriptorSetLayout;
@@ -104,6 +144,10 @@ namespace Mix {
             RenderParam mRenderParam;
             std::vector<DynamicUniformBuffer> mDynamicUniform;
 
+            std::shared_ptr<DescriptorSetLayout> mLightDescriptorSetLayout;
+            std::shared_ptr<DescriptorPool> mLightDescriptorPool;
+            std::vector<LightFrame> mLightFrames;
+
             // PBR tex
             /*struct TexRes {
                 std::shared_ptr<Image> image;
@@ -125,6 +169,8 @@ namespace Mix {
             // Frame rendering info
             std::shared_ptr<VertexInput> mCurrVertexInput;
             std::shared_ptr<Pipeline> mCurrPipeline;
+            bool mCurrDepthEqual = false;
+            uint32_t mCurrVariant = 0;
             uint32_t mCurrFrame = 0;
             CommandBufferHandle* mCurrCmd;
         };
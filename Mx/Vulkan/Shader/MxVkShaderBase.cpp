@@ -1,18 +1,59 @@
 #include "../../Graphics/Mesh/MxMesh.h"
 #include "MxVkShaderBase.h"
 #include "../CommandBuffer/MxVkCommanddBufferHandle.h"
+#include "../Buffers/MxVkGeometryPool.h"
 
 namespace Mix {
-	void Vulkan::ShaderBase::DrawMesh(CommandBufferHandle& _cmd, const Mesh& _mesh, uint32_t _submesh) {
-		_cmd.get().bindVertexBuffers(0, _mesh.mVertexBuffer->get(), { 0 });
-		_cmd.get().bindIndexBuffer(_mesh.mIndexBuffer->get(),
-								   0,
-								   _mesh.mIndexFormat == IndexFormat::UInt16 ? vk::IndexType::eUint16 : vk::IndexType::eUint32);;
-
-		_cmd.get().drawIndexed(_mesh.mSubMeshes[_submesh].indexCount,
-							   1,
-							   _mesh.mSubMeshes[_submesh].firstIndex,
-							   _mesh.mSubMeshes[_submesh].baseVertex,
-							   0);
+	void Vulkan::ShaderBase::DrawMesh(CommandBufferHandle& _cmd, const Mesh& _mesh, uint32_t _submesh, BoundGeometry& _bound) {
+		if (!_mesh.mVertexRange)
+			return;
+
+		BindGeometry(_cmd, GetGeometry(_mesh), _bound);
+
+		uint32_t indexCount, firstIndex;
+		int32_t vertexOffset;
+		if (GetDrawArguments(_mesh, _submesh, indexCount, firstIndex, vertexOffset)) {
+			_cmd.get().drawIndexed(indexCount, 1, firstIndex, vertexOffset, 0);
+			return;
+		}
+
+		const auto& submesh = _mesh.mSubMeshes[_submesh];
+		_cmd.get().draw(submesh.indexCount, 1, _mesh.mVertexRange->first() + submesh.baseVertex + submesh.firstIndex, 0);
+	}
+
+	Vulkan::ShaderBase::BoundGeometry Vulkan::ShaderBase::GetGeometry(const Mesh& _mesh) {
+		// meshes of the same layout share pool buffers, they are only told apart by their offsets
+		BoundGeometry result;
+		if (_mesh.mVertexRange)
+			result.vertexBuffer = _mesh.mVertexRange->getBuffer()->get();
+		if (_mesh.mIndexRange) {
+			result.indexBuffer = _mesh.mIndexRange->getBuffer()->get();
+			result.indexType = _mesh.mIndexFormat == IndexFormat::UInt16 ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+		}
+		return result;
+	}
+
+	void Vulkan::ShaderBase::BindGeometry(CommandBufferHandle& _cmd, const BoundGeometry& _geometry, BoundGeometry& _bound) {
+		if (_geometry.vertexBuffer && _bound.vertexBuffer != _geometry.vertexBuffer) {
+			_cmd.get().bindVertexBuffers(0, _geometry.vertexBuffer, { 0 });
+			_bound.vertexBuffer = _geometry.vertexBuffer;
+		}
+
+		if (_geometry.indexBuffer && (_bound.indexBuffer != _geometry.indexBuffer || _bound.indexType != _geometry.indexType)) {
+			_cmd.get().bindIndexBuffer(_geometry.indexBuffer, 0, _geometry.indexType);
+			_bound.indexBuffer = _geometry.indexBuffer;
+			_bound.indexType = _geometry.indexType;
+		}
+	}
+
+	bool Vulkan::ShaderBase::GetDrawArguments(const Mesh& _mesh, uint32_t _submesh, uint32_t& _indexCount, uint32_t& _firstIndex, int32_t& _vertexOffset) {
+		if (!_mesh.mVertexRange || !_mesh.mIndexRange)
+			return false;
+
+		const auto& submesh = _mesh.mSubMeshes[_submesh];
+		_indexCount = submesh.indexCount;
+		_firstIndex = _mesh.mIndexRange->first() + submesh.firstIndex;
+		_vertexOffset = static_cast<int32_t>(_mesh.mVertexRange->first() + submesh.baseVertex);
+		return true;
 	}
 }
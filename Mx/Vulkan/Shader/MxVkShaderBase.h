@@ -5,10 +5,12 @@
 #include "../../Utils/MxGeneralBase.hpp"
 #include "../../Graphics/MxMaterial.h"
 #include "../../Utils/MxArrayProxy.h"
+#include "../Core/MxVkDef.h"
 
 namespace Mix {
     class Camera;
     class Mesh;
+    class LightClusterer;
 
     namespace Vulkan {
         class CommandBufferHandle;
@@ -25,22 +27,82 @@ namespace Mix {
 
             virtual void endRender() = 0;
 
+            /** @brief Whether opaque elements are culled on the GPU by cull() and drawn by renderCulled() instead of render() */
+            virtual bool isGPUDriven() const { return false; }
+
+            /** @brief Record the culling of @p _elements, called outside of the render pass before beginRender() */
+            virtual void cull(const Camera& _camera, ArrayProxy<RenderElement* const> _elements) {}
+
+            /** @brief Draw the elements that survived the last cull(), between beginRender() and endRender() */
+            virtual void renderCulled() {}
+
+            /** @brief Whether opaque elements can write their depth ahead of shading with renderDepth() */
+            virtual bool hasDepthPass() const { return false; }
+
+            /** @brief Write only the depth of an opaque element, between beginRender() and endRender() */
+            virtual void renderDepth(RenderElement& _element) {}
+
+            /** @brief Write only the depth of the elements that survived the last cull() */
+            virtual void renderCulledDepth() {}
+
+            /**
+             * @brief Shade opaque elements against the depth of the pre-pass with an EQUAL depth test and without writing depth
+             */
+            void setDepthPrePass(const bool _enable) { mDepthPrePass = _enable; }
+
+            /** @brief Upload the lights binned for the current frame, called once per frame outside of the render pass */
+            virtual void prepareLights(const LightClusterer& _lights) {}
+
             virtual void update(const Shader& _shader) = 0;
 
             const MaterialPropertySet& getMaterialPropertySet() const { return mMaterialPropertySet; }
 
             const MaterialPropertySet& getShaderPropertySet() const { return mShaderPropertySet; }
 
+            /** @brief Material properties packed into the parameter block of a material, in the order of the shader block */
+            const std::vector<std::string>& getPackedMaterialProperties() const { return mPackedMaterialProperties; }
+
             virtual uint32_t newMaterial() = 0;
 
             virtual void deleteMaterial(uint32_t _id) = 0;
 
         protected:
+            /** @brief Geometry buffers bound by the last DrawMesh() on the current command buffer */
+            struct BoundGeometry {
+                vk::Buffer vertexBuffer;
+                vk::Buffer indexBuffer;
+                vk::IndexType indexType = vk::IndexType::eUint16;
+
+                void reset() { *this = BoundGeometry(); }
+
+                bool operator==(const BoundGeometry& _other) const {
+                    return vertexBuffer == _other.vertexBuffer && indexBuffer == _other.indexBuffer && indexType == _other.indexType;
+                }
+
+                bool operator!=(const BoundGeometry& _other) const { return !(*this == _other); }
+            };
+
             VulkanAPI* mVulkan;
             MaterialPropertySet mMaterialPropertySet;
             MaterialPropertySet mShaderPropertySet;
+            std::vector<std::string> mPackedMaterialProperties;
+            // reset by beginRender(), other passes may bind buffers in between
+            BoundGeometry mBoundGeometry;
+            // the depth of opaque elements has been written by renderDepth() this frame
+            bool mDepthPrePass = false;
+
+            /**
+             * @brief Draw a sub mesh, the pool buffers are only bound when they differ from @p _bound
+             */
+            static void DrawMesh(CommandBufferHandle& _cmd, const Mesh& _mesh, uint32_t _submesh, BoundGeometry& _bound);
+
+            /** @brief Pool buffers @p _mesh is drawn from, equal for meshes that can share one bind */
+            static BoundGeometry GetGeometry(const Mesh& _mesh);
+
+            static void BindGeometry(CommandBufferHandle& _cmd, const BoundGeometry& _geometry, BoundGeometry& _bound);
 
-            static void DrawMesh(CommandBufferHandle& _cmd, const Mesh& _mesh, uint32_t _submesh);
+            /** @brief Arguments of the indexed draw of a sub mesh, false when the mesh has no indices */
+            static bool GetDrawArguments(const Mesh& _mesh, uint32_t _submesh, uint32_t& _indexCount, uint32_t& _firstIndex, int32_t& _vertexOffset);
         };
     }
 }
@@ -16,13 +16,16 @@
 #include "../MxVulkan.h"
 #include "../Pipeline/MxVkVertexInput.h"
 #include "../../Graphics/MxRenderInfo.h"
+#include "../Culling/MxVkGPUCulling.h"
+#include <algorithm>
+#include <tuple>
 
 namespace Mix {
     namespace Vulkan {
         StandardShader::StandardShader(VulkanAPI* _vulkan) :ShaderBase(_vulkan) {
             mDevice = mVulkan->getLogicalDevice();
 
-            auto imageCount = mVulkan->getSwapchain()->imageCount();
+            auto imageCount = mVulkan->getFrameCount();
             //mDynamicUniform.reserve(imageCount);
             // mTestDynamic.reserve(imageCount);
             mCameraUniforms.reserve(imageCount);
@@ -40,6 +43,8 @@ namespace Mix {
             }
 
             buildDescriptorSetLayout();
+            if (GPUCulling::IsSupported(*mDevice))
+                mCulling = std::make_shared<GPUCulling>(mDevice, mVulkan->getAllocator(), imageCount);
             buildPipeline();
             buildDescriptorSet();
             buildPropertyBlock();
@@ -53,6 +58,7 @@ namespace Mix {
             mCurrCmd = &mVulkan->getCurrDrawCmd();
             mCurrVertexInput = nullptr;
             mCurrPipeline = nullptr;
+            mBoundGeometry.reset();
 
             auto& cmd = mVulkan->getCurrDrawCmd();
 
@@ -92,7 +98,8 @@ namespace Mix {
             //Uniform::MeshUniform uniform;
             //uniform.modelMat = _renderer.transform->localToWorldMatrix();
             //mDynamicUniform[mCurrFrame].pushBack(&uniform, sizeof uniform);
-            mCurrCmd->get().pushConstants<Matrix4>(mGraphicsPipelineState->getPipelineLayout(), vk::ShaderStageFlagBits::eVertex, 0, _element.transform->localToWorldMatrix());
+            // quantized positions are mapped back to local space by the model matrix
+            mCurrCmd->get().pushConstants<Matrix4>(mGraphicsPipelineState->getPipelineLayout(), vk::ShaderStageFlagBits::eVertex, 0, _element.transform->localToWorldMatrix() * _element.mesh->getVertexTransform());
             mCurrCmd->get().bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
                                                mGraphicsPipelineState->getPipelineLayout(),
                                                0,
@@ -106,27 +113,35 @@ namespace Mix {
 
         bool StandardShader::choosePipeline(const Material& _material, const Mesh& _mesh, uint32_t _submesh) {
             bool depthWrite = _material.getRenderType() != RenderType::Transparent;
+            // the pre-pass has written the depth of opaque elements, only the frontmost surface is shaded
+            const bool depthEqual = depthWrite && mDepthPrePass;
 
             auto newVertexInput = mVulkan->getVertexInputManager().getVertexInput(*_mesh.getVertexDeclaration(), *mGraphicsPipelineState->getVertexDeclaration());
             if (newVertexInput == nullptr) // This mesh is not compatiple with this pipeline
                 return false;
-            if (newVertexInput != mCurrVertexInput) {
-                auto newPipeline = mGraphicsPipelineState->getPipeline(mVulkan->getRenderPass(), 0, newVertexInput, _mesh.getTopology(_submesh), true, depthWrite);
+            if (newVertexInput != mCurrVertexInput || depthEqual != mCurrDepthEqual) {
+                auto newPipeline = mGraphicsPipelineState->getPipeline(mVulkan->getRenderPass(), 0, newVertexInput, _mesh.getTopology(_submesh),
+                                                                       true, depthWrite && !depthEqual, false,
+                                                                       depthEqual ? vk::CompareOp::eEqual : vk::CompareOp::eLess);
                 if (newPipeline != mCurrPipeline) {
                     mCurrCmd->get().bindPipeline(vk::PipelineBindPoint::eGraphics, newPipeline->get());
                     mCurrPipeline = newPipeline;
                 }
                 mCurrVertexInput = newVertexInput;
+                mCurrDepthEqual = depthEqual;
             }
             return true;
         }
 
         void StandardShader::updateMaterial(Material& _material) {
-            if (!_material._getChangedList().empty()) {
+            _material._checkTextureRevisions();
+
+            if (_material._getDirtyMask() != 0) {
+                // the set swapped in may hold outdated views, so every binding is written
                 std::vector<WriteDescriptorSet> writes;
-                for (auto& name : _material._getChangedList()) {
-                    if (_material.getTexture(name))
-                        writes.push_back(_material.getTexture(name)->getWriteDescriptor(mMaterialNameBindingMap[name], vk::DescriptorType::eCombinedImageSampler));;
+                for (auto& pair : mMaterialNameBindingMap) {
+                    if (auto texture = _material.getTexture(pair.first))
+                        writes.push_back(texture->getWriteDescriptor(pair.second, vk::DescriptorType::eCombinedImageSampler));
                 }
                 std::swap(mMaterialDescs[0][_material._getMaterialId()], mMaterialDescs[1][_material._getMaterialId()]);
                 mMaterialDescs[0][_material._getMaterialId()].updateDescriptor(writes);
@@ -142,12 +157,34 @@ namespace Mix {
                                                nullptr);
         }
 
+        void StandardShader::renderDepth(RenderElement& _element) {
+            auto& mesh = *_element.mesh;
+            auto vertexInput = mVulkan->getVertexInputManager().getVertexInput(*mesh.getVertexDeclaration(), *mDepthPipelineState->getVertexDeclaration());
+            if (vertexInput == nullptr)
+                return;
+
+            // the depth pipelines share their layout with the shading ones
+            beginElement(_element);
+
+            if (vertexInput != mCurrVertexInput) {
+                auto pipeline = mDepthPipelineState->getPipeline(mVulkan->getRenderPass(), 0, vertexInput, mesh.getTopology(_element.submesh));
+                if (pipeline != mCurrPipeline) {
+                    mCurrCmd->get().bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline->get());
+                    mCurrPipeline = pipeline;
+                }
+                mCurrVertexInput = vertexInput;
+            }
+            DrawMesh(*mCurrCmd, mesh, _element.submesh, mBoundGeometry);
+
+            endElement();
+        }
+
         void StandardShader::render(RenderElement& _element) {
             beginElement(_element);
 
             choosePipeline(*_element.material, *_element.mesh, _element.submesh);
             setMaterail(*_element.material);
-            DrawMesh(*mCurrCmd, *_element.mesh, _element.submesh);
+            DrawMesh(*mCurrCmd, *_element.mesh, _element.submesh, mBoundGeometry);
 
             endElement();
         // Test Gui
@@ -225,6 +262,134 @@ namespace Mix {
         //}
         }
 
+        void StandardShader::cull(const Camera& _camera, ArrayProxy<RenderElement* const> _elements) {
+            mCurrFrame = mVulkan->getCurrFrame();
+            mCulling->begin();
+            mIndirectBatches.clear();
+            mUnculledElements.clear();
+
+            struct Draw {
+                RenderElement* element;
+                IndirectBatch batch;
+            };
+
+            std::vector<Draw> draws;
+            draws.reserve(_elements.size());
+            for (auto element : _elements) {
+                auto& mesh = *element->mesh;
+                auto vertexInput = mVulkan->getVertexInputManager().getVertexInput(*mesh.getVertexDeclaration(), *mIndirectPipelineState->getVertexDeclaration());
+                auto depthVertexInput = mVulkan->getVertexInputManager().getVertexInput(*mesh.getVertexDeclaration(), *mIndirectDepthPipelineState->getVertexDeclaration());
+                if (vertexInput == nullptr || depthVertexInput == nullptr) // This mesh is not compatiple with this pipeline
+                    continue;
+
+                if (!mesh.hasIndices()) {
+                    mUnculledElements.push_back(element);
+                    continue;
+                }
+
+                draws.push_back({ element, { element->material.get(), vertexInput, depthVertexInput, mesh.getTopology(element->submesh), GetGeometry(mesh) } });
+            }
+
+            // draws of one batch have to be adjacent
+            const auto key = [](const IndirectBatch& _batch) {
+                return std::make_tuple(_batch.material, _batch.vertexInput.get(), _batch.topology,
+                                       _batch.geometry.vertexBuffer, _batch.geometry.indexBuffer, _batch.geometry.indexType);
+            };
+            std::sort(draws.begin(), draws.end(), [&key](const Draw& _a, const Draw& _b) { return key(_a.batch) < key(_b.batch); });
+
+            for (auto& draw : draws) {
+                if (mIndirectBatches.empty() || key(mIndirectBatches.back()) != key(draw.batch)) {
+                    mCulling->addBatch();
+                    mIndirectBatches.push_back(draw.batch);
+                }
+
+                auto& mesh = *draw.element->mesh;
+                const auto localToWorld = draw.element->transform->localToWorldMatrix();
+
+                CullObject object;
+                GetDrawArguments(mesh, draw.element->submesh, object.indexCount, object.firstIndex, object.vertexOffset);
+                // quantized positions are mapped back to local space by the model matrix
+                object.model = localToWorld * mesh.getVertexTransform();
+
+                // the sphere around the local bounds, scaled by the largest axis of the transform
+                float scale = 0.0f;
+                for (uint32_t i = 0; i < 3; ++i)
+                    scale = std::max(scale, Vector3f(localToWorld[i].x, localToWorld[i].y, localToWorld[i].z).length());
+                const auto& bounds = mesh.getBounds();
+                const auto center = localToWorld.multiplyPoint(bounds.getCenter());
+                object.sphere = Vector4f(center.x, center.y, center.z, (bounds.getExtent() * 0.5f).length() * scale);
+
+                mCulling->addObject(object);
+            }
+
+            mCulling->record(mVulkan->getCurrDrawCmd().get(), mCurrFrame, Frustum(_camera.getProjMat() * _camera.getViewMat()));
+        }
+
+        void StandardShader::renderCulled() {
+            if (!mIndirectBatches.empty()) {
+                const auto& layout = mIndirectPipelineState->getPipelineLayout();
+                mCurrCmd->get().bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                                   layout,
+                                                   0,
+                                                   mStaticDescriptorSets[mCurrFrame].get(),
+                                                   nullptr);
+                mCulling->bindObjects(mCurrCmd->get(), layout, 2);
+
+                for (uint32_t i = 0; i < mIndirectBatches.size(); ++i) {
+                    auto& batch = mIndirectBatches[i];
+
+                    auto pipeline = mIndirectPipelineState->getPipeline(mVulkan->getRenderPass(), 0, batch.vertexInput, batch.topology,
+                                                                        true, !mDepthPrePass, false,
+                                                                        mDepthPrePass ? vk::CompareOp::eEqual : vk::CompareOp::eLess);
+                    if (pipeline != mCurrPipeline) {
+                        mCurrCmd->get().bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline->get());
+                        mCurrPipeline = pipeline;
+                    }
+
+                    setMaterail(*batch.material);
+                    BindGeometry(*mCurrCmd, batch.geometry, mBoundGeometry);
+                    mCulling->drawBatch(mCurrCmd->get(), i);
+                }
+
+                // the bound pipeline doesn't belong to the per element path
+                mCurrVertexInput = nullptr;
+            }
+
+            for (auto element : mUnculledElements)
+                render(*element);
+        }
+
+        void StandardShader::renderCulledDepth() {
+            if (!mIndirectBatches.empty()) {
+                const auto& layout = mIndirectDepthPipelineState->getPipelineLayout();
+                mCurrCmd->get().bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                                   layout,
+                                                   0,
+                                                   mStaticDescriptorSets[mCurrFrame].get(),
+                                                   nullptr);
+                mCulling->bindObjects(mCurrCmd->get(), layout, 2);
+
+                // materials don't matter for depth, the commands of every batch are drawn as they are
+                for (uint32_t i = 0; i < mIndirectBatches.size(); ++i) {
+                    auto& batch = mIndirectBatches[i];
+
+                    auto pipeline = mIndirectDepthPipelineState->getPipeline(mVulkan->getRenderPass(), 0, batch.depthVertexInput, batch.topology);
+                    if (pipeline != mCurrPipeline) {
+                        mCurrCmd->get().bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline->get());
+                        mCurrPipeline = pipeline;
+                    }
+
+                    BindGeometry(*mCurrCmd, batch.geometry, mBoundGeometry);
+                    mCulling->drawBatch(mCurrCmd->get(), i);
+                }
+
+                mCurrVertexInput = nullptr;
+            }
+
+            for (auto element : mUnculledElements)
+                renderDepth(*element);
+        }
+
         void StandardShader::update(const Shader& _shader) {
         }
 
@@ -239,7 +404,7 @@ namespace Mix {
         }
 
         void StandardShader::buildDescriptorSet() {
-            auto imageCount = mVulkan->getSwapchain()->imageCount();
+            auto imageCount = mVulkan->getFrameCount();
 
             mDescriptorPool = std::make_shared<DescriptorPool>(mDevice);
             mDescriptorPool->addPoolSize(vk::DescriptorType::eUniformBuffer, imageCount);
@@ -376,6 +541,33 @@ namespace Mix {
             desc.pushConstant.push_back(vk::PushConstantRange(vk::ShaderStageFlagBits::eVertex, 0, sizeof(Matrix4)));
 
             mGraphicsPipelineState = std::make_shared<GraphicsPipelineState>(mDevice, desc);
+
+            // the depth pre-pass keeps the layouts, so sets and push constants stay bound across both passes
+            GraphicsPipelineStateDesc depthDesc = desc;
+            auto depthVert = ResourceLoader::Get()->load<ShaderSource>("Resource/Shaders/DepthOnly.vert");
+            depthDesc.gpuProgram.vertex = std::make_shared<ShaderModule>(mDevice, *depthVert);
+            depthDesc.gpuProgram.fragment = nullptr;
+            depthDesc.vertexDecl = std::make_shared<VertexDeclaration>(Flags<VertexAttribute>(VertexAttribute::Position));
+            depthDesc.blendStates = { GraphicsPipelineState::NoColorWriteAttachment };
+
+            mDepthPipelineState = std::make_shared<GraphicsPipelineState>(mDevice, depthDesc);
+
+            if (mCulling) {
+                // reads the model matrix of the culled object instead of the push constant
+                auto indirectVert = ResourceLoader::Get()->load<ShaderSource>("Resource/Shaders/vShaderIndirect.vert");
+                desc.gpuProgram.vertex = std::make_shared<ShaderModule>(mDevice, *indirectVert);
+                desc.descriptorSetLayouts.push_back(mCulling->getObjectSetLayout());
+                desc.pushConstant.clear();
+
+                mIndirectPipelineState = std::make_shared<GraphicsPipelineState>(mDevice, desc);
+
+                auto indirectDepthVert = ResourceLoader::Get()->load<ShaderSource>("Resource/Shaders/DepthOnlyIndirect.vert");
+                depthDesc.gpuProgram.vertex = std::make_shared<ShaderModule>(mDevice, *indirectDepthVert);
+                depthDesc.descriptorSetLayouts = desc.descriptorSetLayouts;
+                depthDesc.pushConstant.clear();
+
+                mIndirectDepthPipelineState = std::make_shared<GraphicsPipelineState>(mDevice, depthDesc);
+            }
             /*std::ifstream inFile;
             inFile.open("TestResources/pipeline/pipeline.json");
             nlohmann::json json = nlohmann::json::parse(inFile);
@@ -17,6 +17,7 @@ namespace Mix {
     namespace Vulkan {
         class Pipeline;
         class RenderPass;
+        class GPUCulling;
         class Image;
         class Swapchain;
         class DescriptorSetLayout;
@@ -41,6 +42,18 @@ namespace Mix {
 
             void deleteMaterial(uint32_t _id) override;
 
+            bool isGPUDriven() const override { return mCulling != nullptr; }
+
+            void cull(const Camera& _camera, ArrayProxy<RenderElement* const> _elements) override;
+
+            void renderCulled() override;
+
+            bool hasDepthPass() const override { return true; }
+
+            void renderDepth(RenderElement& _element) override;
+
+            void renderCulledDepth() override;
+
         private:
             void setCamera(const Camera& _camera);
 
@@ -54,10 +67,29 @@ namespace Mix {
 
             void setMaterail(Material& _material);
 
+            /** @brief Draws sharing material, pipeline and geometry buffers, culled and drawn together */
+            struct IndirectBatch {
+                Material* material;
+                std::shared_ptr<VertexInput> vertexInput;
+                std::shared_ptr<VertexInput> depthVertexInput;
+                MeshTopology topology;
+                BoundGeometry geometry;
+            };
+
 
             std::shared_ptr<Device> mDevice;
 
             std::shared_ptr<GraphicsPipelineState> mGraphicsPipelineState;
+            // position only variant for the depth pre-pass
+            std::shared_ptr<GraphicsPipelineState> mDepthPipelineState;
+
+            // null when the device can't draw indirectly with a first instance
+            std::shared_ptr<GPUCulling> mCulling;
+            std::shared_ptr<GraphicsPipelineState> mIndirectPipelineState;
+            std::shared_ptr<GraphicsPipelineState> mIndirectDepthPipelineState;
+            std::vector<IndirectBatch> mIndirectBatches;
+            // elements without indices are drawn one by one
+            std::vector<RenderElement*> mUnculledElements;
 
             std::shared_ptr<DescriptorSetLayout> mStaticParamDescriptorSetLayout;
             std::shared_ptr<DescriptorSetLayout> mDynamicPamramDescriptorSetLayout;
@@ -67,7 +99,7 @@ namespace Mix {
             std::vector<DynamicUniformBuffer> mDynamicUniform;
 
             uint32_t mDefaultMaterialCount = 100;
-            std::unordered_map<std::string, uint32_t> mMaterialNameBindingMap;
+            std::unordered_map<PropertyId, uint32_t, PropertyId::Hash> mMaterialNameBindingMap;
             std::vector<std::vector<DescriptorSet>> mMaterialDescs;
             std::deque<uint32_t> mUnusedId;
 
@@ -87,6 +119,7 @@ namespace Mix {
             // Frame rendering info
             std::shared_ptr<VertexInput> mCurrVertexInput;
             std::shared_ptr<Pipeline> mCurrPipeline;
+            bool mCurrDepthEqual = false;
             uint32_t mCurrFrame = 0;
             CommandBufferHandle* mCurrCmd;
         };
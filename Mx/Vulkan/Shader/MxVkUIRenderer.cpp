@@ -56,14 +56,14 @@ namespace Mix {
                 WriteDescriptorSet write;
                 write = _renderData.fontTexture->getWriteDescriptor(0, vk::DescriptorType::eCombinedImageSampler);
 
-                std::swap(mDescriptorSets[0], mDescriptorSets[1 + mCurrFrame % (mVulkan->getSwapchain()->imageCount() - 1)]);
+                std::swap(mDescriptorSets[0], mDescriptorSets[1 + mCurrFrame % (mVulkan->getFrameCount() - 1)]);
                 mDescriptorSets[0].updateDescriptor(write);
             }
         }
 
         void Mix::Vulkan::UIRenderer::render(GUI::UIRenderData& _renderData) {
             if (_renderData.drawData->CmdListsCount > 0) {
-                mCurrFrame = mVulkan->getSwapchain()->getCurrFrame();
+                mCurrFrame = mVulkan->getCurrFrame();
 
                 // Update vertex buffer and indice buffer
                 updateBuffers(_renderData);
@@ -192,7 +192,7 @@ namespace Mix {
                                                     vertexInput, MeshTopology::Triangles_List,
                                                     false, false);
 
-            uint32_t imageCount = mVulkan->getSwapchain()->imageCount();
+            uint32_t imageCount = mVulkan->getFrameCount();
 
             // DescriptorSet
             mDescriptorSets = mVulkan->getDescriptorPool()->allocDescriptorSet(*mPipeline->descriptorSetLayouts()[0].get(), imageCount);
@@ -59,14 +59,14 @@ namespace Mix {
     }
 
     Vector2i Window::getDrawableSize() const {
-        Vector2i size;
+        Vector2i size = mHeadlessSize;
         if (mWindow)
             SDL_Vulkan_GetDrawableSize(mWindow, &size.x, &size.y);
         return size;
     }
 
     Vector2i Window::getExtent() const {
-        Vector2i size;
+        Vector2i size = mHeadlessSize;
         if (mWindow)
             SDL_GetWindowSize(mWindow, &size.x, &size.y);
         return size;
@@ -84,6 +84,10 @@ namespace Mix {
     }
 
     std::vector<const char*> Window::getRequiredInstanceExts() const {
+        // no surface is created without window
+        if (!mWindow)
+            return {};
+
         unsigned int count;
         SDL_Vulkan_GetInstanceExtensions(mWindow, &count, nullptr);
         std::vector<const char*> result(count);
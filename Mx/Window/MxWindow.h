@@ -34,6 +34,9 @@ namespace Mix {
 
 		Window(const std::string& _title, const Vector2i& _size, Flags<WindowFlag> _windowFlag);
 
+		/** @brief Headless window without SDL window or surface, only provides the extent frames are rendered at */
+		explicit Window(const Vector2i& _size) : mWindow(nullptr), mHeadlessSize(_size) {}
+
 		~Window();
 
 		void load() override {};
@@ -48,6 +51,8 @@ namespace Mix {
 
 		SDL_Window* rawPtr() const { return mWindow; }
 
+		bool isHeadless() const { return !mWindow; }
+
 		SDL_Surface* rawSurface() const { return SDL_GetWindowSurface(mWindow); }
 
 		std::string getTitle() const;
@@ -60,6 +65,7 @@ namespace Mix {
 		static Uint32 ToSDLWindowFlags(Flags<WindowFlag> _flags);
 
 		SDL_Window* mWindow;
+		Vector2i mHeadlessSize;
 	};
 }
 
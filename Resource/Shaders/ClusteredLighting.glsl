@@ -0,0 +1,83 @@
+// Clustered forward lights binned on the cpu by LightClusterer, bound as set 2 of fragment shaders.
+// Included by fragment shaders, which loop over the lights of their froxel, see mypbr.frag:
+//
+//     LightCluster cluster = clusterAt(gl_FragCoord.xy, (camera.viewMat * vec4(worldPos, 1.0)).z);
+//     for (uint i = 0u; i < cluster.count; ++i) {
+//         ClusterLight light = clusterLight(cluster, i);
+//         vec3 L;
+//         vec3 radiance = lightRadiance(light, worldPos, L);
+//         color += brdf(surface, N, V, L) * radiance;
+//     }
+
+const float LIGHT_TYPE_POINT = 0.0;
+const float LIGHT_TYPE_SPOT = 1.0;
+
+struct ClusterLight {
+    // world space position and range
+    vec4 positionRange;
+    // color times intensity, w is the light type
+    vec4 color;
+    // world space direction, w is the cosine of the outer half angle
+    vec4 direction;
+    // scale and offset turning the cosine to the light into the spot fade
+    vec4 spot;
+};
+
+struct LightCluster {
+    uint offset;
+    uint count;
+};
+
+layout(std140, set = 2, binding = 0) uniform LightClusterParams {
+    // tiles along x and y, slices and light count
+    uvec4 gridSize;
+    // tile size in pixels, scale and bias turning log(view depth) into a slice
+    vec4 tileSizeSliceScaleBias;
+} clusterParams;
+
+layout(std430, set = 2, binding = 1) readonly buffer ClusterLights {
+    ClusterLight clusterLights[];
+};
+
+layout(std430, set = 2, binding = 2) readonly buffer LightClusters {
+    LightCluster lightClusters[];
+};
+
+layout(std430, set = 2, binding = 3) readonly buffer LightIndices {
+    uint lightIndices[];
+};
+
+LightCluster clusterAt(vec2 fragCoord, float viewDepth) {
+    if (clusterParams.gridSize.w == 0u)
+        return LightCluster(0u, 0u);
+
+    uvec3 grid = clusterParams.gridSize.xyz;
+    uvec2 tile = min(uvec2(fragCoord / clusterParams.tileSizeSliceScaleBias.xy), grid.xy - 1u);
+    float slice = log(max(viewDepth, 1e-4)) * clusterParams.tileSizeSliceScaleBias.z + clusterParams.tileSizeSliceScaleBias.w;
+    uint z = uint(clamp(slice, 0.0, float(grid.z - 1u)));
+    return lightClusters[(z * grid.y + tile.y) * grid.x + tile.x];
+}
+
+ClusterLight clusterLight(LightCluster cluster, uint i) {
+    return clusterLights[lightIndices[cluster.offset + i]];
+}
+
+// Radiance arriving at worldPos, L is set to the normalized direction towards the light
+vec3 lightRadiance(ClusterLight light, vec3 worldPos, out vec3 L) {
+    vec3 toLight = light.positionRange.xyz - worldPos;
+    float distSq = max(dot(toLight, toLight), 1e-8);
+    L = toLight * inversesqrt(distSq);
+
+    // inverse square falloff windowed to reach zero at the range
+    float range = light.positionRange.w;
+    float ratio = distSq / (range * range);
+    float window = clamp(1.0 - ratio * ratio, 0.0, 1.0);
+    float attenuation = window * window / distSq;
+
+    if (light.color.w == LIGHT_TYPE_SPOT) {
+        float cosAngle = dot(-L, light.direction.xyz);
+        float fade = clamp(cosAngle * light.spot.x + light.spot.y, 0.0, 1.0);
+        attenuation *= fade * fade;
+    }
+    return light.color.rgb * attenuation;
+}
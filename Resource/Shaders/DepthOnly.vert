@@ -0,0 +1,24 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+// position only vertex shader of the depth pre-pass, shading passes test their depth for equality against it
+
+layout(set = 0, binding = 0) uniform CameraUniform {
+	vec3 position;
+	vec3 forward;
+	mat4 viewMat;
+    mat4 projMat;
+}camera;
+
+layout(push_constant) uniform MeshConstant {
+	mat4 modelMat;
+}mesh;
+
+layout(location = 0) in vec3 inPosition;
+
+// the shading vertex shaders compute gl_Position the same way and declare it invariant as well
+invariant gl_Position;
+
+void main() 
+{
+    gl_Position = camera.projMat * camera.viewMat * mesh.modelMat * vec4(inPosition, 1.0f);
+}
@@ -0,0 +1,33 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+// DepthOnly.vert for indirect draws, the model matrix comes from the culled object instead of a push constant
+
+layout(set = 0, binding = 0) uniform CameraUniform {
+	vec3 position;
+	vec3 forward;
+	mat4 viewMat;
+    mat4 projMat;
+}camera;
+
+struct Object {
+	mat4 model;
+	vec4 sphere;
+	uint indexCount;
+	uint firstIndex;
+	int vertexOffset;
+	uint batch;
+};
+
+layout(std430, set = 2, binding = 0) readonly buffer Objects {
+	Object objects[];
+};
+
+layout(location = 0) in vec3 inPosition;
+
+invariant gl_Position;
+
+void main() 
+{
+	mat4 modelMat = objects[gl_InstanceIndex].model;
+    gl_Position = camera.projMat * camera.viewMat * modelMat * vec4(inPosition, 1.0f);
+}
@@ -0,0 +1,219 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+// metallic roughness and specular glossiness PBR with image based lighting,
+// the directional light of the scene and the clustered point and spot lights
+
+layout(location = 0) in vec3 inWorldPos;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inUV;
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform CameraUniform {
+	vec3 position;
+	vec3 forward;
+	mat4 viewMat;
+    mat4 projMat;
+}camera;
+
+layout(set = 0, binding = 1) uniform RenderParam {
+	vec4 lightDir;
+	vec4 lightColor;
+	float exposure;
+	float gamma;
+	float prefilteredCubeMipLevels;
+	float scaleIBLAmbient;
+}renderParam;
+
+layout(set = 0, binding = 2) uniform samplerCube irradianceMap;
+layout(set = 0, binding = 3) uniform samplerCube prefilteredMap;
+layout(set = 0, binding = 4) uniform sampler2D brdfLut;
+
+layout(set = 1, binding = 0) uniform sampler2D colorMap;
+layout(set = 1, binding = 1) uniform sampler2D physicalDescriptorMap;
+layout(set = 1, binding = 2) uniform sampler2D normalMap;
+layout(set = 1, binding = 3) uniform sampler2D aoMap;
+layout(set = 1, binding = 4) uniform sampler2D emissiveMap;
+
+// PBRShader::Variant, each material variant gets its own pipeline with the unused paths compiled out
+layout(constant_id = 0) const bool hasBaseColorTexture = false;
+layout(constant_id = 1) const bool hasPhysicalDescriptorTexture = false;
+layout(constant_id = 2) const bool hasNormalTexture = false;
+layout(constant_id = 3) const bool hasOcclusionTexture = false;
+layout(constant_id = 4) const bool hasEmissiveTexture = false;
+layout(constant_id = 5) const bool alphaMask = false;
+layout(constant_id = 6) const bool specularGlossiness = false;
+
+// PBRShader::MaterialParam, behind the model matrix of the vertex stage
+layout(push_constant) uniform MaterialParam {
+	layout(offset = 64) vec4 baseColorFactor;
+	vec4 emissiveFactor;
+	vec4 diffuseFactor;
+	// w is the glossiness factor
+	vec4 specularFactor;
+	float metallicFactor;
+	float roughnessFactor;
+	float alphaMaskCutoff;
+}material;
+
+#include "ClusteredLighting.glsl"
+
+const float PI = 3.14159265359;
+const float MIN_ROUGHNESS = 0.04;
+
+struct Surface {
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float perceptualRoughness;
+	float alphaRoughness;
+};
+
+vec3 uncharted2Tonemap(vec3 color) {
+	const float A = 0.15;
+	const float B = 0.50;
+	const float C = 0.10;
+	const float D = 0.20;
+	const float E = 0.02;
+	const float F = 0.30;
+	return ((color * (A * color + C * B) + D * E) / (color * (A * color + B) + D * F)) - E / F;
+}
+
+vec3 tonemap(vec3 color) {
+	vec3 result = uncharted2Tonemap(color * renderParam.exposure) / uncharted2Tonemap(vec3(11.2));
+	return pow(result, vec3(1.0 / renderParam.gamma));
+}
+
+vec4 SRGBtoLinear(vec4 srgb) {
+	return vec4(pow(srgb.rgb, vec3(2.2)), srgb.a);
+}
+
+vec4 getBaseColor() {
+	vec4 factor = specularGlossiness ? material.diffuseFactor : material.baseColorFactor;
+	if (hasBaseColorTexture)
+		return SRGBtoLinear(texture(colorMap, inUV)) * factor;
+	return factor;
+}
+
+// normal map in tangent space, the tangent frame is derived from the screen space derivatives
+vec3 getNormal() {
+	vec3 N = normalize(inNormal);
+	if (!hasNormalTexture)
+		return N;
+
+	vec3 tangentNormal = texture(normalMap, inUV).xyz * 2.0 - 1.0;
+	vec3 q1 = dFdx(inWorldPos);
+	vec3 q2 = dFdy(inWorldPos);
+	vec2 st1 = dFdx(inUV);
+	vec2 st2 = dFdy(inUV);
+
+	vec3 T = normalize(q1 * st2.t - q2 * st1.t);
+	vec3 B = -normalize(cross(N, T));
+	return normalize(mat3(T, B, N) * tangentNormal);
+}
+
+Surface getSurface(vec4 baseColor) {
+	Surface surface;
+	if (!specularGlossiness) {
+		float metallic = material.metallicFactor;
+		float roughness = material.roughnessFactor;
+		if (hasPhysicalDescriptorTexture) {
+			// roughness in green, metalness in blue
+			vec4 sampled = texture(physicalDescriptorMap, inUV);
+			roughness *= sampled.g;
+			metallic *= sampled.b;
+		}
+		metallic = clamp(metallic, 0.0, 1.0);
+
+		vec3 f0 = vec3(0.04);
+		surface.diffuseColor = baseColor.rgb * (vec3(1.0) - f0) * (1.0 - metallic);
+		surface.specularColor = mix(f0, baseColor.rgb, metallic);
+		surface.perceptualRoughness = roughness;
+	}
+	else {
+		vec3 specular = material.specularFactor.rgb;
+		float glossiness = material.specularFactor.w;
+		if (hasPhysicalDescriptorTexture) {
+			vec4 sampled = SRGBtoLinear(texture(physicalDescriptorMap, inUV));
+			specular *= sampled.rgb;
+			glossiness *= sampled.a;
+		}
+
+		surface.diffuseColor = baseColor.rgb * (1.0 - max(max(specular.r, specular.g), specular.b));
+		surface.specularColor = specular;
+		surface.perceptualRoughness = 1.0 - glossiness;
+	}
+
+	surface.perceptualRoughness = clamp(surface.perceptualRoughness, MIN_ROUGHNESS, 1.0);
+	surface.alphaRoughness = surface.perceptualRoughness * surface.perceptualRoughness;
+	return surface;
+}
+
+// Lambert diffuse and Cook-Torrance specular, scaled by the cosine to the light
+vec3 brdf(Surface surface, vec3 N, vec3 V, vec3 L) {
+	vec3 H = normalize(V + L);
+	float NdotL = clamp(dot(N, L), 0.001, 1.0);
+	float NdotV = clamp(abs(dot(N, V)), 0.001, 1.0);
+	float NdotH = clamp(dot(N, H), 0.0, 1.0);
+	float VdotH = clamp(dot(V, H), 0.0, 1.0);
+
+	float reflectance = max(max(surface.specularColor.r, surface.specularColor.g), surface.specularColor.b);
+	vec3 reflectance90 = vec3(clamp(reflectance * 25.0, 0.0, 1.0));
+	vec3 F = surface.specularColor + (reflectance90 - surface.specularColor) * pow(1.0 - VdotH, 5.0);
+
+	float r2 = surface.alphaRoughness * surface.alphaRoughness;
+	float G = 2.0 * NdotL / (NdotL + sqrt(r2 + (1.0 - r2) * NdotL * NdotL)) *
+			  2.0 * NdotV / (NdotV + sqrt(r2 + (1.0 - r2) * NdotV * NdotV));
+	float f = (NdotH * r2 - NdotH) * NdotH + 1.0;
+	float D = r2 / (PI * f * f);
+
+	vec3 diffuse = (1.0 - F) * surface.diffuseColor / PI;
+	vec3 specular = F * G * D / (4.0 * NdotL * NdotV);
+	return (diffuse + specular) * NdotL;
+}
+
+vec3 imageBasedLighting(Surface surface, vec3 N, vec3 V) {
+	float NdotV = clamp(abs(dot(N, V)), 0.001, 1.0);
+	vec3 reflection = -normalize(reflect(V, N));
+	reflection.y *= -1.0;
+
+	float lod = surface.perceptualRoughness * renderParam.prefilteredCubeMipLevels;
+	vec2 scaleBias = texture(brdfLut, vec2(NdotV, 1.0 - surface.perceptualRoughness)).rg;
+	vec3 diffuseLight = texture(irradianceMap, N).rgb;
+	vec3 specularLight = textureLod(prefilteredMap, reflection, lod).rgb;
+
+	vec3 diffuse = diffuseLight * surface.diffuseColor;
+	vec3 specular = specularLight * (surface.specularColor * scaleBias.x + scaleBias.y);
+	return (diffuse + specular) * renderParam.scaleIBLAmbient;
+}
+
+void main()
+{
+	vec4 baseColor = getBaseColor();
+	if (alphaMask && baseColor.a < material.alphaMaskCutoff)
+		discard;
+
+	Surface surface = getSurface(baseColor);
+	vec3 N = getNormal();
+	vec3 V = normalize(camera.position - inWorldPos);
+
+	vec3 color = brdf(surface, N, V, normalize(renderParam.lightDir.xyz)) * renderParam.lightColor.rgb;
+
+	LightCluster cluster = clusterAt(gl_FragCoord.xy, (camera.viewMat * vec4(inWorldPos, 1.0)).z);
+	for (uint i = 0u; i < cluster.count; ++i) {
+		ClusterLight light = clusterLight(cluster, i);
+		vec3 L;
+		vec3 radiance = lightRadiance(light, inWorldPos, L);
+		color += brdf(surface, N, V, L) * radiance;
+	}
+
+	color += imageBasedLighting(surface, N, V);
+
+	if (hasOcclusionTexture)
+		color *= texture(aoMap, inUV).r;
+
+	if (hasEmissiveTexture)
+		color += SRGBtoLinear(texture(emissiveMap, inUV)).rgb * material.emissiveFactor.rgb;
+
+	outColor = vec4(tonemap(color), baseColor.a);
+}
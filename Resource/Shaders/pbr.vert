@@ -0,0 +1,34 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(set = 0, binding = 0) uniform CameraUniform {
+	vec3 position;
+	vec3 forward;
+	mat4 viewMat;
+    mat4 projMat;
+}camera;
+
+layout(push_constant) uniform MeshConstant {
+	mat4 modelMat;
+}mesh;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 outWorldPos;
+layout(location = 1) out vec3 outNormal;
+layout(location = 2) out vec2 outUV;
+
+// matches the depth pre-pass exactly, see DepthOnly.vert
+invariant gl_Position;
+
+void main()
+{
+	vec4 worldPos = mesh.modelMat * vec4(inPosition, 1.0f);
+	outWorldPos = worldPos.xyz;
+	outNormal = normalize(transpose(inverse(mat3(mesh.modelMat))) * inNormal);
+	outUV = inTexCoord;
+
+    gl_Position = camera.projMat * camera.viewMat * mesh.modelMat * vec4(inPosition, 1.0f);
+}
@@ -19,6 +19,9 @@ layout(location = 2) in vec2 inTexCoord;
 layout(location = 0) out vec3 outNormal;
 layout(location = 1) out vec2 outUV;
 
+// matches the depth pre-pass exactly, see DepthOnly.vert
+invariant gl_Position;
+
 #define EPSILON 0.01
 
 mat3 getNormalMatFromModelMat(mat4 modelMat){
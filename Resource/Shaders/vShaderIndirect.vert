@@ -0,0 +1,50 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+// vShader.vert for indirect draws, the model matrix comes from the culled object instead of a push constant
+
+layout(set = 0, binding = 0) uniform CameraUniform {
+	vec3 position;
+	vec3 forward;
+	mat4 viewMat;
+    mat4 projMat;
+}camera;
+
+struct Object {
+	mat4 model;
+	vec4 sphere;
+	uint indexCount;
+	uint firstIndex;
+	int vertexOffset;
+	uint batch;
+};
+
+// firstInstance of every indirect command is the index of its object
+layout(std430, set = 2, binding = 0) readonly buffer Objects {
+	Object objects[];
+};
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) out vec2 outUV;
+
+// matches the depth pre-pass exactly, see DepthOnly.vert
+invariant gl_Position;
+
+mat3 getNormalMatFromModelMat(mat4 modelMat){
+	mat3 result = mat3(inverse(transpose(modelMat)));
+	result[0] = normalize(result[0]);
+	result[1] = normalize(result[1]);
+	result[2] = normalize(result[2]);
+	return result;
+}
+
+void main() 
+{
+	mat4 modelMat = objects[gl_InstanceIndex].model;
+    gl_Position = camera.projMat * camera.viewMat * modelMat * vec4(inPosition, 1.0f);
+	outNormal= getNormalMatFromModelMat(modelMat) * inNormal;
+	outUV=vec2(inTexCoord);
+}
@@ -20,17 +20,18 @@ namespace Scripts {
         param.samplerInfo.magFilter = TextureFilterMode::Linear;
         param.samplerInfo.mipFilter = TextureMipSampleMode::Linear;
 
+        // frames are decoded in parallel and show up as soon as they are ready
         mTextures.reserve(13);
         for (uint32_t i = 0; i < 13; ++i) {
-            mTextures.push_back(ResourceLoader::Get()->load<Texture2D>("Resource/Textures/Loading/" + std::to_string(i) + ".png", &param));
+            mTextures.push_back(ResourceLoader::Get()->loadAsync<Texture2D>("Resource/Textures/Loading/" + std::to_string(i) + ".png", param));
         }
 
         mMaterial = mGameObject->getComponent<Renderer>()->getMaterial();
-        mMaterial->setTexture("diffuseTex", mTextures[0]);
     }
 
     void Loading::update() {
-        mMaterial->setTexture("diffuseTex", mTextures[mCurrFrame]);
+        if (auto texture = mTextures[mCurrFrame].get())
+            mMaterial->setTexture("diffuseTex", texture);
         mFrameGap += Time::DeltaTime();
         if (mFrameGap >= 1 / mFps) {
             mCurrFrame = (mCurrFrame + 1) % 13;
@@ -3,6 +3,7 @@
 #include "../Mx/Component/Script/MxScript.h"
 #include "../Mx/Graphics/MxMaterial.h"
 #include "../Mx/Graphics/Texture/MxTexture.h"
+#include "../Mx/Resource/MxResourceLoader.h"
 
 namespace Scripts {
     using namespace Mix;
@@ -19,7 +20,7 @@ namespace Scripts {
         void update() override;
 
     private:
-        std::vector<std::shared_ptr<Texture2D>> mTextures;
+        std::vector<AsyncLoad<Texture2D>> mTextures;
         std::shared_ptr<Material> mMaterial;
 
         uint32_t mCurrFrame = 0;
@@ -0,0 +1,46 @@
+#include "../../Mx/Resource/MxResourceArchive.h"
+#include <cstring>
+#include <iostream>
+
+// Packs a resource directory into an archive mounted by ResourceLoader at startup.
+// Run from the directory the engine runs in so entry paths match the paths passed to ResourceLoader::load().
+//
+// usage: MxPacker [--no-compress] [--align N] [directory] [output]
+int main(int argc, char** argv) {
+    std::filesystem::path directory = "Resource";
+    std::filesystem::path output = "Resource.mxpak";
+    bool compress = true;
+    uint32_t alignment = Mix::ResourceArchive::DefaultAlignment;
+
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--no-compress") == 0)
+            compress = false;
+        else if (std::strcmp(argv[i], "--align") == 0 && i + 1 < argc)
+            alignment = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (positional == 0)
+            directory = argv[i], ++positional;
+        else
+            output = argv[i];
+    }
+
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        std::cerr << "Alignment has to be a power of two" << std::endl;
+        return 1;
+    }
+
+    if (!std::filesystem::is_directory(directory)) {
+        std::cerr << "[" << directory.generic_string() << "] is not a directory" << std::endl;
+        return 1;
+    }
+
+    if (!Mix::ResourceArchive::Build(directory, ".", output, compress, alignment)) {
+        std::cerr << "Failed to write [" << output.generic_string() << "]" << std::endl;
+        return 1;
+    }
+
+    Mix::ResourceArchive archive;
+    archive.open(output, ".");
+    std::cout << "Packed " << archive.entryCount() << " files into [" << output.generic_string() << "]" << std::endl;
+    return 0;
+}